@@ -19,11 +19,75 @@
 #define REKSI_THREADING 1
 #endif
 
+/*
+ * Platform Detection
+ */
+#if defined(_WIN32)
+#define REKSI_PLATFORM_WINDOWS 1
+#define REKSI_PLATFORM_POSIX 0
+#elif defined(__unix__) || defined(__APPLE__)
+#define REKSI_PLATFORM_WINDOWS 0
+#define REKSI_PLATFORM_POSIX 1
+#else
+#define REKSI_PLATFORM_WINDOWS 0
+#define REKSI_PLATFORM_POSIX 0
+#endif
+
+#if defined(__linux__)
+#define REKSI_PLATFORM_LINUX 1
+#else
+#define REKSI_PLATFORM_LINUX 0
+#endif
+
+/*
+ * io_uring backend for the manager's file reads, opt in and Linux only
+ * Falls back to a thread pool if the kernel does not support it
+ */
+#ifndef REKSI_IO_URING
+#define REKSI_IO_URING 0
+#endif
+#if REKSI_IO_URING == 1 && (REKSI_PLATFORM_LINUX == 0 || REKSI_THREADING == 0)
+#undef REKSI_IO_URING
+#define REKSI_IO_URING 0
+#endif
+
+/*
+ * std::span needs C++20, Reksi falls back to its own minimal Span otherwise
+ */
+#if defined(__has_include)
+#if __has_include(<span>) && __cplusplus >= 202002L
+#define REKSI_STD_SPAN 1
+#endif
+#endif
+#ifndef REKSI_STD_SPAN
+#define REKSI_STD_SPAN 0
+#endif
+
+/*
+ * Coroutine awaitables need C++20, the rest of Reksi stays usable with C++17
+ */
+#ifndef REKSI_COROUTINES
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#define REKSI_COROUTINES 1
+#else
+#define REKSI_COROUTINES 0
+#endif
+#endif
+
+/*
+ * Compile time path hashing is forced with consteval when available
+ */
+#if defined(__cpp_consteval) && __cpp_consteval >= 201811L
+#define REKSI_CONSTEVAL consteval
+#else
+#define REKSI_CONSTEVAL constexpr
+#endif
+
 /*
  * Debug Definition
  */
 #if !defined(REKSI_DEBUG) && !defined(REKSI_NDEBUG)
-// Set as debug
+ // Set as debug
 #define REKSI_DEBUG
 #endif
 
@@ -52,10 +116,10 @@
 #pragma endregion
 
 #pragma region Thread Synchronization Macros
-/*
-* Definition of Base Thread Synchronization Macros
-* Ex. Mutex, Locks, Atomic Operations etc.
-*/
+ /*
+ * Definition of Base Thread Synchronization Macros
+ * Ex. Mutex, Locks, Atomic Operations etc.
+ */
 #if REKSI_THREADING == 1
 // Mutexes
 #include <shared_mutex>
@@ -85,9 +149,9 @@ using REKSI_CV_T = std::condition_variable_any;
 #define REKSI_CV_NOTIFY_ALL_IMPL(x)
 #endif
 
-/*
-* Definition of All Thread Synchronization Macros
-*/
+ /*
+ * Definition of All Thread Synchronization Macros
+ */
 #define REKSI_MUTEX(Mutex) REKSI_MUT_IMPL(Mutex)
 #define REKSI_LOCK_SHARED(Mutex, Lock) REKSI_LOCK_SHARED_IMPL(Mutex, Lock)
 #define REKSI_LOCK_UNIQUE(Mutex, Lock) REKSI_LOCK_UNIQUE_IMPL(Mutex, Lock)
@@ -161,6 +225,166 @@ namespace Reksi
 
 #pragma endregion
 
+#pragma region Span Definitions
+#include <cstddef>
+#if REKSI_STD_SPAN == 1
+#include <span>
+
+namespace Reksi
+{
+	template <typename T>
+	using Span = std::span<T>;
+}
+#else
+#include <type_traits>
+
+namespace Reksi
+{
+	// Minimal stand-in for std::span before C++20, with the same member names
+	template <typename T>
+	class Span
+	{
+	public:
+		using element_type = T;
+		using value_type = std::remove_cv_t<T>;
+		using iterator = T*;
+
+		constexpr Span() = default;
+
+		constexpr Span(T* data, size_t size)
+			: m_Data(data), m_Size(size)
+		{
+		}
+
+		template <size_t N>
+		constexpr Span(T (&array)[N])
+			: m_Data(array), m_Size(N)
+		{
+		}
+
+		// Any contiguous container, e.g. std::vector or std::array, const ones for spans of const elements
+		// Like std::span, temporaries only bind to spans of const elements
+		template <typename Container, typename = std::enable_if_t<
+			          (std::is_lvalue_reference_v<Container> || std::is_const_v<T>) &&
+			          std::is_convertible_v<decltype(std::declval<Container&>().data()), T*>>>
+		constexpr Span(Container&& container)
+			: m_Data(container.data()), m_Size(container.size())
+		{
+		}
+
+		template <typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+		constexpr Span(const Span<U>& other)
+			: m_Data(other.data()), m_Size(other.size())
+		{
+		}
+
+		constexpr T* data() const
+		{
+			return m_Data;
+		}
+
+		constexpr size_t size() const
+		{
+			return m_Size;
+		}
+
+		constexpr size_t size_bytes() const
+		{
+			return m_Size * sizeof(T);
+		}
+
+		constexpr bool empty() const
+		{
+			return m_Size == 0;
+		}
+
+		constexpr T* begin() const
+		{
+			return m_Data;
+		}
+
+		constexpr T* end() const
+		{
+			return m_Data + m_Size;
+		}
+
+		constexpr T& operator[](size_t index) const
+		{
+			return m_Data[index];
+		}
+
+		constexpr Span first(size_t count) const
+		{
+			return Span{m_Data, count};
+		}
+
+		constexpr Span subspan(size_t offset, size_t count = static_cast<size_t>(-1)) const
+		{
+			return Span{m_Data + offset, count == static_cast<size_t>(-1) ? m_Size - offset : count};
+		}
+
+	private:
+		T* m_Data = nullptr;
+		size_t m_Size = 0;
+	};
+}
+#endif
+
+namespace Reksi
+{
+	// Read-only view of raw bytes, e.g. a memory mapped file
+	using ByteSpan = Span<const std::byte>;
+}
+
+#pragma endregion
+
+#pragma region Bit Utilities
+#include <cassert>
+#include <cstdint>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace Reksi
+{
+	// Index of the highest set bit, value must not be 0
+	inline uint32_t FloorLog2(uint64_t value)
+	{
+		assert(value != 0);
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return static_cast<uint32_t>(index);
+#else
+		return 63u - static_cast<uint32_t>(__builtin_clzll(value));
+#endif
+	}
+
+	// Index of the lowest set bit, value must not be 0
+	inline uint32_t CountTrailingZeros(uint64_t value)
+	{
+		assert(value != 0);
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return static_cast<uint32_t>(index);
+#else
+		return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+	}
+
+	inline uint32_t PopCount(uint64_t value)
+	{
+#if defined(_MSC_VER)
+		return static_cast<uint32_t>(__popcnt64(value));
+#else
+		return static_cast<uint32_t>(__builtin_popcountll(value));
+#endif
+	}
+}
+
+#pragma endregion
+
 
 /*
  ____                    
@@ -173,14 +397,27 @@ namespace Reksi
 
 
 // Standard Includes
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstdint>
+#include <deque>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include <filesystem>
+#include <fstream>
 #include <functional>
 #include <list>
 #include <typeindex>
+#include <type_traits>
+#include <utility>
+#if REKSI_COROUTINES == 1
+#include <coroutine>
+#endif
 
 
 // Forward Declarations
@@ -190,751 +427,6659 @@ namespace Reksi
 	class ResourceData;
 	template <typename T>
 	class Resource;
+	template <typename T>
+	class ResourceRef;
+	template <typename T>
+	class ResourceView;
+	class LoadTask;
+	class LoadFuture;
+	template <typename T>
+	class ResourceFuture;
+	template <typename T>
+	class ResourceAwaiter;
 }
 
 
 /*
- ____                                              ____          _          
-|  _ \   ___  ___   ___   _   _  _ __   ___   ___ |  _ \   __ _ | |_   __ _ 
-| |_) | / _ \/ __| / _ \ | | | || '__| / __| / _ \| | | | / _` || __| / _` |
-|  _ < |  __/\__ \| (_) || |_| || |   | (__ |  __/| |_| || (_| || |_ | (_| |
-|_| \_\ \___||___/ \___/  \__,_||_|    \___| \___||____/  \__,_| \__| \__,_|
-                                                                            
+ ____                                              _  __             
+|  _ \   ___  ___   ___   _   _  _ __   ___   ___ | |/ /  ___  _   _ 
+| |_) | / _ \/ __| / _ \ | | | || '__| / __| / _ \| ' /  / _ \| | | |
+|  _ < |  __/\__ \| (_) || |_| || |   | (__ |  __/| . \ |  __/| |_| |
+|_| \_\ \___||___/ \___/  \__,_||_|    \___| \___||_|\_\ \___| \__, |
+                                                               |___/ 
 */
 
 
-#define RK_BIT(x) (1 << (x))
-
 namespace Reksi
 {
-	// Forward Declaration
-	class ResourceData;
-
-	using ResourceHandleT = uint32_t;
+	// 64 bit FNV-1a hash of a resource path
+	constexpr uint64_t HashResourcePath(std::string_view path);
 
-	class ResourceStatus
+	// Path with its hash computed at compile time, written as "textures/stone.png"_rk
+	struct ResourcePathLiteral
 	{
-	public:
-		using StateT = uint32_t;
+		std::string_view Path;
+		uint64_t Hash = 0;
+	};
 
-		enum States : StateT
-		{
-			Loaded = RK_BIT(0),
-			Loading = RK_BIT(1),
-			MarkedForReload = RK_BIT(3),
-			MarkedForDelete = RK_BIT(4)
-		};
+	inline namespace Literals
+	{
+		REKSI_CONSTEVAL ResourcePathLiteral operator""_rk(const char* path, size_t size);
+	}
 
-		StateT State;
+	// Interned resource path, handed out by the ResourceManager
+	// Lookups with a key neither hash nor compare the path again
+	// Only meaningful to the manager which created it
+	struct ResourceKey
+	{
+		static constexpr uint32_t InvalidIndex = ~0u;
 
-		ResourceStatus()
-			: State(0u)
-		{
-		}
+		uint64_t Hash = 0;
+		// Index of the path in the manager's string pool
+		uint32_t Index = InvalidIndex;
 
-		ResourceStatus& Set(States state);
-		bool Is(States state) const;
-		ResourceStatus& Clear(States state);
+		bool IsValid() const;
+		bool operator==(const ResourceKey& other) const;
+		bool operator!=(const ResourceKey& other) const;
 	};
 
-	class ResourceLoadStatus
+	// Path argument of the manager's lookups, refers to the caller's string without copying it
+	// The path is hashed once on construction
+	class ResourcePathView
 	{
 	public:
-		using StateT = uint32_t;
-
-		enum States : StateT
-		{
-			Success = RK_BIT(0),
-			Reloaded = RK_BIT(1),
-			WaitedForLoad = RK_BIT(2),
-			MarkedForDelete = RK_BIT(3),
-			AlreadyReloading = RK_BIT(4),
-		};
-
-		ResourceLoadStatus()
-			: State(0u)
-		{
-		}
+		ResourcePathView(const char* path);
+		ResourcePathView(std::string_view path);
+		ResourcePathView(const std::string& path);
+		// Copies the path only on platforms where it is not stored as char, e.g. Windows
+		ResourcePathView(const std::filesystem::path& path);
+		// Uses the precomputed hash
+		ResourcePathView(const ResourcePathLiteral& path);
 
-		StateT State;
+		// Refers to the storage of this object
+		ResourcePathView(const ResourcePathView&) = delete;
+		ResourcePathView& operator=(const ResourcePathView&) = delete;
 
-		ResourceLoadStatus& Set(States state);
-		bool Is(States state) const;
-		ResourceLoadStatus& Clear(States state);
-	};
+		std::string_view GetString() const;
+		uint64_t GetHash() const;
 
-	enum class ResourceUnloadStatus
-	{
-		Success,
-		Failure,
-		Loading
+	private:
+		std::string m_Storage;
+		std::string_view m_Path;
+		uint64_t m_Hash;
 	};
+}
 
-	class ResourceListener
-	{
-	public:
-		ResourceListener() = default;
-		virtual ~ResourceListener() = default;
-
-		virtual void OnLoadComplete(ResourceData& data, ResourceLoadStatus status)
-		{
-		}
 
-		virtual void OnUnloadComplete(ResourceData& data, ResourceUnloadStatus status)
-		{
-		}
 
-		virtual void BeforeDeleting(ResourceData& data)
-		{
-		}
-	};
+/*
+    _                     _    _____         _      _       
+   / \    ___  ___   ___ | |_ |_   _|  __ _ | |__  | |  ___ 
+  / _ \  / __|/ __| / _ \| __|  | |   / _` || '_ \ | | / _ \
+ / ___ \ \__ \\__ \|  __/| |_   | |  | (_| || |_) || ||  __/
+/_/   \_\|___/|___/ \___| \__|  |_|   \__,_||_.__/ |_| \___|
+                                                            
+*/
 
-	template <typename T>
-	using ResourceLoadFunc = std::function<SharedPtr<T>(const std::filesystem::path&)>;
 
-	class ResourceData
+namespace Reksi
+{
+	// Perfect hash table over the paths of a fixed set of assets, usable in constant expressions
+	// Generated by scripts/generate_asset_table.py from an asset manifest
+	// Hash and displace, the path's hash selects a bucket whose displacement selects the slot
+	class StaticAssetTable
 	{
 	public:
-		using ListenerList = std::list<ResourceListener*>;
+		static constexpr size_t NotFound = ~static_cast<size_t>(0);
 
-		// Public for external use
-		REKSI_THREADING_MUTABLE REKSI_MUTEX_AUTO;
-		REKSI_CV_AUTO;
+		constexpr StaticAssetTable(const ResourcePathLiteral* paths, size_t count,
+		                           const uint32_t* displacements, size_t bucketCount,
+		                           const uint32_t* slots, size_t slotCount);
 
-		ResourceStatus GetStatus() const;
-		bool IsState(ResourceStatus::States state) const;
-		ResourceLoadStatus Load();
-		ResourceUnloadStatus Unload();
-		template <typename T>
-		SharedPtr<T> GetData();
-		void AddListener(ResourceListener* listener);
-		void RemoveListener(ResourceListener* listener);
-		void ClearListeners();
-		void AddListeners(const ListenerList& listeners);
-		void WaitUntilCurrentLoading();
-		std::filesystem::path GetPath() const;
-		template <typename T>
-		ResourceLoadFunc<T> GetLoader() const;
-		ResourceHandleT GetHandle() const;
-		std::type_index GetTypeIndex() const;
+		// Index of the path in the manifest, NotFound if it is not part of the table
+		constexpr size_t Find(const ResourcePathLiteral& path) const;
+		constexpr size_t Find(std::string_view path) const;
+		constexpr size_t GetCount() const;
+		constexpr const ResourcePathLiteral& operator[](size_t index) const;
 
-		~ResourceData();
+		// Shared with the generator, changing it requires regenerating the tables
+		static constexpr uint64_t Mix(uint64_t hash, uint32_t displacement);
 
 	private:
-		using LoadFunc = std::function<SharedPtr<void>(const std::filesystem::path&)>;
-		using RLS = ResourceLoadStatus;
-		using RS = ResourceStatus;
-		using RUS = ResourceUnloadStatus;
+		const ResourcePathLiteral* m_Paths;
+		size_t m_Count;
+		const uint32_t* m_Displacements;
+		size_t m_BucketCount;
+		// Index of the path in each slot, NotFound for empty slots
+		const uint32_t* m_Slots;
+		size_t m_SlotCount;
+
+		constexpr size_t FindHashed(std::string_view path, uint64_t hash) const;
+	};
+}
 
-		ResourceData(ResourceHandleT handle, std::filesystem::path path, LoadFunc loader,
-		             ResourceManager* creator, std::type_index typeIndex);
 
-		ResourceHandleT m_Handle;
-		ResourceStatus m_Status;
-		std::filesystem::path m_Path;
-		LoadFunc m_Loader;
-		SharedPtr<void> m_Data;
-		ListenerList m_Listeners;
-		ResourceManager* m_Creator;
-		const std::type_index m_TypeIndex;
 
-		ListenerList GetListenersCopy() const;
-		void NotifyListenersOnLoadComplete(ResourceLoadStatus status);
-		void NotifyListenersOnUnloadComplete(ResourceUnloadStatus status);
-		void NotifyListenersBeforeDeleting();
+/*
+ __  __                                 _  _____  _  _       
+|  \/  |  __ _  _ __   _ __    ___   __| ||  ___|(_)| |  ___ 
+| |\/| | / _` || '_ \ | '_ \  / _ \ / _` || |_   | || | / _ \
+| |  | || (_| || |_) || |_) ||  __/| (_| ||  _|  | || ||  __/
+|_|  |_| \__,_|| .__/ | .__/  \___| \__,_||_|    |_||_| \___|
+               |_|    |_|                                    
+*/
 
-		void SetState(ResourceStatus::States state);
-		void ClearState(ResourceStatus::States state);
 
-		// Thread unsafe, use with caution
-		// Performs more checks in Debug mode
-		template <typename T>
-		SharedPtr<T> GetDataInternal();
+#if REKSI_PLATFORM_WINDOWS == 1
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif REKSI_PLATFORM_POSIX == 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
 
-		// Just perform load without notifying listeners or the manager
-		ResourceLoadStatus LoadInternal();
-		// Just perform unload without notifying listeners or the manager
-		ResourceUnloadStatus UnloadInternal();
+namespace Reksi
+{
+	// Read-only memory mapping of a whole file, usable as a resource type
+	// Loading maps the file instead of copying it, pages are read in on first access
+	// The mapping lives as long as the SharedPtr holding it, so spans handed out stay valid
+	// while the caller keeps a reference, even if the resource is unloaded meanwhile
+	//
+	// manager.SetDefaultLoader<MappedFile>();
+	// ByteSpan bytes = manager.GetResource<MappedFile>("level.bin").GetRef()->GetBytes();
+	class MappedFile
+	{
+	public:
+		// Throws std::runtime_error if the file cannot be opened or mapped
+		explicit MappedFile(const std::filesystem::path& path);
+		~MappedFile();
 
-		friend class ResourceManager;
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		ByteSpan GetBytes() const;
+		const std::byte* GetData() const;
+		size_t GetSize() const;
+		// Counted by the memory budget, the pages are only resident while in use though
+		size_t GetResourceSize() const;
+
+	private:
+		const std::byte* m_Data;
+		size_t m_Size;
+#if REKSI_PLATFORM_WINDOWS == 1
+		HANDLE m_Mapping;
+#endif
 	};
 }
 
 
+
 /*
- ____                                             
-|  _ \   ___  ___   ___   _   _  _ __   ___   ___ 
-| |_) | / _ \/ __| / _ \ | | | || '__| / __| / _ \
-|  _ < |  __/\__ \| (_) || |_| || |   | (__ |  __/
-|_| \_\ \___||___/ \___/  \__,_||_|    \___| \___|
-                                                  
+ _____  _  _        ___   ___  
+|  ___|(_)| |  ___ |_ _| / _ \ 
+| |_   | || | / _ \ | | | | | |
+|  _|  | || ||  __/ | | | |_| |
+|_|    |_||_| \___||___| \___/ 
+                               
 */
 
 
+#if REKSI_PLATFORM_POSIX == 1
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+#if REKSI_IO_URING == 1
+#include <cstring>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
 namespace Reksi
 {
-	// Resource class is a wrapper around the ResourceData class, and is returned by the ResourceManager
-	template <typename T>
-	class Resource
+	using ByteBuffer = std::vector<std::byte>;
+	// Invoked on a reader thread, success is false if the file could not be read
+	using FileReadCallback = std::function<void(ByteBuffer buffer, bool success)>;
+
+	// Reads whole files in the background, owned by the ResourceManager to feed buffer loaders
+	class FileReader
 	{
 	public:
-		SharedPtr<T> GetRef();
-		T& operator*();
+		virtual ~FileReader() = default;
 
-		ResourceStatus GetStatus() const;
-		bool IsLoaded() const;
-		bool IsValid() const;
+		// Queues the read, reads queued together are submitted together where the backend allows it
+		virtual void ReadAsync(std::filesystem::path path, FileReadCallback callback) = 0;
 
-		ResourceLoadStatus Load();
-		ResourceUnloadStatus Unload();
-		ResourceLoadStatus Reload();
+		// Reads the file on the calling thread, fails with an empty buffer on errors and short reads
+		static bool Read(const std::filesystem::path& path, ByteBuffer& buffer);
+		// io_uring when compiled with REKSI_IO_URING and supported by the kernel, a thread pool otherwise
+		// A thread count of 0 uses the default of the thread pool
+		static UniquePtr<FileReader> Create(uint32_t threadCount = 0);
+	};
 
-		std::filesystem::path GetPath() const;
-		ResourceLoadFunc<T> GetLoader() const;
+	// Blocking reads on a few threads of its own
+	// With REKSI_THREADING disabled, reads are performed inline
+	class ThreadPoolFileReader : public FileReader
+	{
+	public:
+		static constexpr uint32_t DefaultThreadCount = 4;
 
-		ResourceManager* GetManager() const;
-		ResourceHandleT GetHandle() const;
+		explicit ThreadPoolFileReader(uint32_t threadCount = DefaultThreadCount);
+		// Finishes the queued reads
+		~ThreadPoolFileReader() override;
 
-		void AddListener(ResourceListener* listener);
-		void RemoveListener(ResourceListener* listener);
-		void ClearListeners();
+		void ReadAsync(std::filesystem::path path, FileReadCallback callback) override;
 
 	private:
-		Resource(ResourceHandleT handle, ResourceData* data, ResourceManager* manager);
+		struct Request
+		{
+			std::filesystem::path Path;
+			FileReadCallback Callback;
+		};
 
-		ResourceHandleT m_Handle;
-		ResourceData* m_Data;
-		ResourceManager* m_Manager;
+		std::deque<Request> m_Requests;
+#if REKSI_THREADING == 1
+		std::vector<std::thread> m_Threads;
+#endif
+		bool m_Stopping;
 
-		friend class ResourceManager;
+		REKSI_MUTEX_AUTO;
+		REKSI_CV_AUTO;
+
+		void ThreadLoop();
+	};
+
+#if REKSI_IO_URING == 1
+	// Reads files through an io_uring driven by a thread of its own
+	// Every file goes through openat, statx and read operations, the current step of all pending files
+	// is submitted with a single io_uring_enter
+	// Should the ring fail, the thread reads the pending and later files with plain reads instead
+	class IoUringFileReader : public FileReader
+	{
+	public:
+		// Throws std::runtime_error if the kernel does not support io_uring
+		explicit IoUringFileReader(uint32_t entries = 256);
+		// Finishes the queued reads
+		~IoUringFileReader() override;
+
+		IoUringFileReader(const IoUringFileReader&) = delete;
+		IoUringFileReader& operator=(const IoUringFileReader&) = delete;
+
+		void ReadAsync(std::filesystem::path path, FileReadCallback callback) override;
+
+	private:
+		enum class Stage : uint8_t
+		{
+			Open,
+			Stat,
+			Read
+		};
+
+		struct Request
+		{
+			std::filesystem::path Path;
+			FileReadCallback Callback;
+			Stage Step = Stage::Open;
+			int File = -1;
+			struct statx Stat;
+			ByteBuffer Buffer;
+			size_t Offset = 0;
+		};
+
+		int m_Ring;
+		uint32_t m_Entries;
+		void* m_SqRing;
+		size_t m_SqRingSize;
+		void* m_CqRing;
+		size_t m_CqRingSize;
+		io_uring_sqe* m_Sqes;
+		unsigned* m_SqTail;
+		unsigned* m_SqMask;
+		unsigned* m_SqArray;
+		unsigned* m_CqHead;
+		unsigned* m_CqTail;
+		unsigned* m_CqMask;
+		io_uring_cqe* m_Cqes;
+
+		std::deque<Request*> m_Queued;
+		// Requests the failed ring may still write to, freed once it is closed
+		std::vector<Request*> m_Abandoned;
+		bool m_Stopping;
+		std::thread m_Thread;
+
+		REKSI_MUTEX_AUTO;
+		REKSI_CV_AUTO;
+
+		void ThreadLoop();
+		// Writes the submission entry of the request's current step
+		void Prepare(Request* request);
+		// Moves the request to its next step, returns false once it is finished
+		bool Advance(Request* request, int result);
+		void Finish(Request* request, bool success);
+		// Reads the file with a plain read, for requests the ring does not hold
+		void FinishInline(Request* request);
+		// Serves the queued requests with plain reads until stopped, once the ring failed
+		void ThreadLoopInline();
 	};
+#endif
 }
 
 
+
 /*
- ____                                              __  __                                         
-|  _ \   ___  ___   ___   _   _  _ __   ___   ___ |  \/  |  __ _  _ __    __ _   __ _   ___  _ __ 
-| |_) | / _ \/ __| / _ \ | | | || '__| / __| / _ \| |\/| | / _` || '_ \  / _` | / _` | / _ \| '__|
-|  _ < |  __/\__ \| (_) || |_| || |   | (__ |  __/| |  | || (_| || | | || (_| || (_| ||  __/| |   
-|_| \_\ \___||___/ \___/  \__,_||_|    \___| \___||_|  |_| \__,_||_| |_| \__,_| \__, | \___||_|   
-                                                                                |___/             
+  ____             _             
+ / ___|  ___    __| |  ___   ___ 
+| |     / _ \  / _` | / _ \ / __|
+| |___ | (_) || (_| ||  __/| (__ 
+ \____| \___/  \__,_| \___| \___|
+                                 
 */
 
 
+#include <cstring>
+
 namespace Reksi
 {
-	class ResourceManager
+	// Decompresses the blocks of compressed archive entries, registered with ResourceManager::RegisterCodec
+	// Blocks are independent of each other, so they may be decompressed on several threads at once
+	class BlockCodec
 	{
 	public:
-		ResourceManager(std::filesystem::path basePath);
+		virtual ~BlockCodec() = default;
 
-		bool IsValid(ResourceHandleT handle) const;
-		ResourceHandleT GetHandle(const std::filesystem::path& path) const;
-		std::type_index GetTypeIndex(ResourceHandleT handle) const;
-		template <typename T>
-		Resource<T> GetResource(const std::filesystem::path& path, const ResourceLoadFunc<T>& loader);
-		template <typename T>
-		Resource<T> GetResource(const std::filesystem::path& path);
+		// Stored in the archive entries, 0 is reserved for uncompressed entries
+		virtual uint32_t GetId() const = 0;
+		// Must fill the output exactly, returns false for corrupt input
+		virtual bool Decompress(ByteSpan input, std::byte* output, size_t outputSize) const = 0;
+	};
 
-		template <typename T>
-		void DeleteResource(const Resource<T>& resource);
-		void MarkForDelete(ResourceHandleT handle);
+	/*
+	 * Built-in LZ77 codec, compressed by scripts/build_archive.py
+	 * A block is a list of sequences, each a token byte, literals, and a match
+	 * Token: high 4 bits literal count, low 4 bits match length - 4, 15 continues in the following bytes,
+	 *        which are added up until one is below 255
+	 * Match: 2 byte little endian offset back into the output, then the extra length bytes
+	 * The last sequence has literals only
+	 */
+	class LzBlockCodec : public BlockCodec
+	{
+	public:
+		static constexpr uint32_t Id = 1;
+		static constexpr size_t MinMatch = 4;
 
-		template <typename T>
-		SharedPtr<T> GetDefaultResource() const;
-		template <typename T>
-		void SetDefaultResource(const SharedPtr<T>& resource);
-		template <typename T>
-		ResourceLoadFunc<T> GetDefaultLoader() const;
-		template <typename T>
-		void SetDefaultLoader(const ResourceLoadFunc<T>& loader);
-		// Uses the constructor for default loader
-		template <typename T>
-		void SetDefaultLoader();
+		uint32_t GetId() const override;
+		bool Decompress(ByteSpan input, std::byte* output, size_t outputSize) const override;
+
+	private:
+		// Returns false if the input ends within the length
+		static bool ReadLength(const std::byte*& in, const std::byte* end, size_t& length);
+	};
+}
+
+
+
+/*
+    _                 _      _              
+   / \    _ __   ___ | |__  (_)__   __  ___ 
+  / _ \  | '__| / __|| '_ \ | |\ \ / / / _ \
+ / ___ \ | |   | (__ | | | || | \ V / |  __/
+/_/   \_\|_|    \___||_| |_||_|  \_/   \___|
+                                            
+*/
 
-		void Reload(ResourceHandleT handle);
+
+namespace Reksi
+{
+	/*
+	 * Packed archive, written by scripts/build_archive.py, all values little endian
+	 * Header: "RKAR", version, entry count, payload alignment, index offset, names offset
+	 * Index: entries sorted by path hash, then path
+	 * Names: the paths of the entries, not terminated
+	 * Payloads: aligned to the payload alignment
+	 * Compressed payloads start with the end offset of every block as uint32, relative to the end of that table,
+	 * blocks as long as their decompressed size are stored as is
+	 */
+	class ResourceArchive
+	{
+	public:
+		static constexpr uint32_t Version = 2;
+		static constexpr size_t NotFound = ~static_cast<size_t>(0);
+
+		struct Header
+		{
+			char Magic[4];
+			uint32_t Version;
+			uint32_t EntryCount;
+			uint32_t Alignment;
+			uint64_t IndexOffset;
+			uint64_t NamesOffset;
+		};
+
+		struct Entry
+		{
+			// HashResourcePath of the path
+			uint64_t Hash;
+			uint64_t Offset;
+			// Decompressed size
+			uint64_t Size;
+			uint64_t StoredSize;
+			uint32_t NameOffset;
+			uint32_t NameSize;
+			// BlockCodec id, 0 if stored uncompressed
+			uint32_t Codec;
+			// Decompressed size of every block but the last
+			uint32_t BlockSize;
+		};
+
+		// Maps the archive, throws std::runtime_error if it cannot be read or is malformed
+		explicit ResourceArchive(const std::filesystem::path& path);
+
+		ResourceArchive(const ResourceArchive&) = delete;
+		ResourceArchive& operator=(const ResourceArchive&) = delete;
+
+		// Index of the entry, NotFound if the path is not in the archive
+		size_t Find(std::string_view path) const;
+		size_t Find(std::string_view path, uint64_t hash) const;
+		size_t GetCount() const;
+		std::string_view GetPath(size_t index) const;
+		const Entry& GetEntry(size_t index) const;
+		// Bytes as stored, the contents unless compressed, they stay valid as long as the archive
+		ByteSpan GetBytes(size_t index) const;
+		bool IsCompressed(size_t index) const;
+		size_t GetBlockCount(size_t index) const;
+		// Decompresses a block of a compressed entry into its place in output, which holds the whole entry
+		// Blocks may be decompressed concurrently, returns false for corrupt blocks
+		bool DecompressBlock(size_t index, size_t block, const BlockCodec& codec, std::byte* output) const;
 
 	private:
-		std::filesystem::path m_BasePath;
-		std::unordered_map<ResourceHandleT, UniquePtr<ResourceData>> m_Resources;
-		std::unordered_map<std::filesystem::path, ResourceHandleT> m_ResourcePaths;
-		std::vector<uint64_t> m_ValidityMask;
+		MappedFile m_File;
+		const Entry* m_Entries;
+		size_t m_Count;
+		const char* m_Names;
+	};
+}
 
-		std::unordered_map<std::type_index, SharedPtr<void>> m_DefaultResources;
-		std::unordered_map<std::type_index, ResourceData::LoadFunc> m_DefaultLoaders;
 
-		ResourceHandleT m_NextHandle;
 
-		REKSI_THREADING_MUTABLE REKSI_MUTEX_AUTO;
-		// Mutex for the validity mask
-		REKSI_THREADING_MUTABLE REKSI_MUTEX(m_ValidMaskMutex);
-		// Mutex for default resources and loaders
-		REKSI_THREADING_MUTABLE REKSI_MUTEX(m_LoaderResourceMutex);
+/*
+ _____                      _     
+| ____| _ __    ___    ___ | |__  
+|  _|  | '_ \  / _ \  / __|| '_ \ 
+| |___ | |_) || (_) || (__ | | | |
+|_____|| .__/  \___/  \___||_| |_|
+       |_|                        
+*/
+
+
+namespace Reksi
+{
+	/*
+	 * Epoch based reclamation for data read without locks
+	 * Readers hold a Guard while using a published pointer, writers swap the pointer and retire the old object,
+	 * which is deleted once every reader that could still see it left its guard
+	 * Entering a guard only writes to a slot owned by the calling thread, so readers never share a cache line
+	 *
+	 * EpochDomain::Guard guard;
+	 * const Node* node = published.load();
+	 */
+	class EpochDomain
+	{
+		struct Slot;
+
+	public:
+		class Guard
+		{
+		public:
+			Guard();
+			~Guard();
+
+			Guard(const Guard&) = delete;
+			Guard& operator=(const Guard&) = delete;
 
-		bool GetValidityImpl(ResourceHandleT handle) const;
-		void SetValidityImpl(ResourceHandleT handle, bool valid);
+		private:
+			Slot* m_Slot;
+		};
+
+		// Shared by all resources, so threads need a single slot
+		// Never destroyed, threads and managers may still use it during static destruction
+		static EpochDomain& Get();
+
+		EpochDomain(const EpochDomain&) = delete;
+		EpochDomain& operator=(const EpochDomain&) = delete;
+
+		// Deletes the object once it cannot be read anymore, it must not be reachable for new readers
 		template <typename T>
-		ResourceData::LoadFunc GetDefaultLoaderImpl() const;
+		void Retire(T* object);
+		// Deletes the retired objects no reader can see anymore, called by Retire
+		void Collect();
+
+	private:
+		// Epoch of a thread inside a guard, 0 while outside, reused once the thread exits
+		struct alignas(64) Slot
+		{
+			std::atomic<uint64_t> Epoch{0};
+			std::atomic<bool> InUse{false};
+			// Guards may nest, only the outermost one publishes the epoch
+			uint32_t Depth = 0;
+			Slot* Next = nullptr;
+		};
+
+		struct Retired
+		{
+			void* Object;
+			void (*Delete)(void*);
+			// Readers which entered in this epoch or before may still see the object
+			uint64_t Epoch;
+		};
+
+		// Releases the slot of the thread when it exits
+		struct ThreadSlot
+		{
+			Slot* Owned = nullptr;
+
+			~ThreadSlot();
+		};
+
+		std::atomic<uint64_t> m_Epoch{1};
+		// Slots are never freed, so they may be walked without locks
+		std::atomic<Slot*> m_Slots{nullptr};
+		std::vector<Retired> m_Retired;
+
+		REKSI_MUTEX_AUTO;
+
+		EpochDomain() = default;
+
+		Slot& GetThreadSlot();
 	};
 }
 
 
+
 /*
- ____          __  _         _  _    _                    
-|  _ \   ___  / _|(_) _ __  (_)| |_ (_)  ___   _ __   ___ 
-| | | | / _ \| |_ | || '_ \ | || __|| | / _ \ | '_ \ / __|
-| |_| ||  __/|  _|| || | | || || |_ | || (_) || | | |\__ \
-|____/  \___||_|  |_||_| |_||_| \__||_| \___/ |_| |_||___/
-                                                          
+ _____                      _    _               
+|  ___| _   _  _ __    ___ | |_ (_)  ___   _ __  
+| |_   | | | || '_ \  / __|| __|| | / _ \ | '_ \ 
+|  _|  | |_| || | | || (__ | |_ | || (_) || | | |
+|_|     \__,_||_| |_| \___| \__||_| \___/ |_| |_|
+                                                 
 */
 
-#pragma region Defer
-// Implementation
+
+#include <cstddef>
+#include <new>
+
 namespace Reksi
 {
-	inline ResourceData::ResourceData(ResourceHandleT handle, std::filesystem::path path, LoadFunc loader,
-	                                  ResourceManager* creator, std::type_index typeIndex)
-		: m_Handle(handle),
-		  m_Path(std::move(path)),
-		  m_Loader(std::move(loader)),
-		  m_Creator(creator),
-		  m_TypeIndex(typeIndex)
+	template <typename Signature, size_t Capacity = 4 * sizeof(void*)>
+	class InplaceFunction;
+
+	/*
+	 * Move-only callable stored in place, used for the loaders
+	 * Callables up to Capacity bytes which can be moved without throwing never allocate, which covers
+	 * function pointers, lambdas capturing a few pointers and even a std::function, larger ones live on the heap
+	 * The result of the callable is converted to R, e.g. SharedPtr<T> to SharedPtr<void>, within the single indirect call
+	 */
+	template <typename R, typename... Args, size_t Capacity>
+	class InplaceFunction<R(Args...), Capacity>
 	{
-	}
+	public:
+		InplaceFunction() = default;
+		InplaceFunction(std::nullptr_t);
+		template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, InplaceFunction> &&
+		                                                  std::is_invocable_r_v<R, std::decay_t<F>&, Args...>>>
+		InplaceFunction(F&& function);
+		InplaceFunction(InplaceFunction&& other) noexcept;
+		InplaceFunction& operator=(InplaceFunction&& other) noexcept;
+		~InplaceFunction();
+
+		InplaceFunction(const InplaceFunction&) = delete;
+		InplaceFunction& operator=(const InplaceFunction&) = delete;
+
+		R operator()(Args... args) const;
+		explicit operator bool() const;
+
+	private:
+		struct VTable
+		{
+			R (*Invoke)(void* storage, Args&&... args);
+			// Move constructs into the destination and destroys the source
+			void (*Relocate)(void* destination, void* source) noexcept;
+			void (*Destroy)(void* storage) noexcept;
+		};
+
+		template <typename F>
+		static constexpr bool IsInPlace = sizeof(F) <= Capacity && alignof(F) <= alignof(std::max_align_t) &&
+			std::is_nothrow_move_constructible_v<F>;
+
+		template <typename F>
+		static const VTable InPlaceVTable;
+		template <typename F>
+		static const VTable HeapVTable;
+
+		// Called as non-const like std::function does, so the storage is mutable
+		alignas(std::max_align_t) mutable unsigned char m_Storage[Capacity];
+		const VTable* m_VTable = nullptr;
+
+		void Reset();
+	};
+}
+
+
+
+/*
+ _____                      ___      _ 
+|_   _| _   _  _ __    ___ |_ _|  __| |
+  | |  | | | || '_ \  / _ \ | |  / _` |
+  | |  | |_| || |_) ||  __/ | | | (_| |
+  |_|   \__, || .__/  \___||___| \__,_|
+        |___/ |_|                      
+*/
+
+
+namespace Reksi
+{
+	// Dense id of a resource type, assigned on first use and kept for the lifetime of the process
+	// Ids start at 1, 0 is never a type, so per type tables can be indexed by them directly
+	using ResourceTypeId = uint32_t;
+
+	template <typename T>
+	ResourceTypeId GetResourceTypeId();
+
+	// Assigns the ids, only entered once per type, GetResourceTypeId reads a function local static afterwards
+	class ResourceTypeRegistry
+	{
+	public:
+		// Returns the id of the type, assigning the next one if it has none yet
+		static ResourceTypeId Register(std::type_index type);
+		// typeid(void) for ids never assigned
+		static std::type_index GetTypeIndex(ResourceTypeId id);
+		// Every id assigned so far is below it
+		static ResourceTypeId GetEnd();
+
+	private:
+		// Type of id i + 1
+		std::vector<std::type_index> m_Types;
+
+		REKSI_MUTEX(m_Mutex);
+
+		// Never destroyed, ids may be requested during static destruction
+		static ResourceTypeRegistry& Get();
+	};
+}
+
+
+
+/*
+ ____                                              ____          _          
+|  _ \   ___  ___   ___   _   _  _ __   ___   ___ |  _ \   __ _ | |_   __ _ 
+| |_) | / _ \/ __| / _ \ | | | || '__| / __| / _ \| | | | / _` || __| / _` |
+|  _ < |  __/\__ \| (_) || |_| || |   | (__ |  __/| |_| || (_| || |_ | (_| |
+|_| \_\ \___||___/ \___/  \__,_||_|    \___| \___||____/  \__,_| \__| \__,_|
+                                                                            
+*/
+
+
+#define RK_BIT(x) (1 << (x))
+
+namespace Reksi
+{
+	// Forward Declaration
+	class ResourceData;
+
+	// See ResourceHandleLayout
+	using ResourceHandleT = uint64_t;
+	class ResourceStatus
+	{
+	public:
+		using StateT = uint32_t;
+
+		enum States : StateT
+		{
+			Loaded = RK_BIT(0),
+			Loading = RK_BIT(1),
+			Queued = RK_BIT(2),
+			MarkedForReload = RK_BIT(3),
+			MarkedForDelete = RK_BIT(4)
+		};
+
+		StateT State;
+
+		ResourceStatus()
+			: State(0u)
+		{
+		}
+
+		ResourceStatus& Set(States state);
+		bool Is(States state) const;
+		ResourceStatus& Clear(States state);
+	};
+
+	class ResourceLoadStatus
+	{
+	public:
+		using StateT = uint32_t;
+
+		enum States : StateT
+		{
+			Success = RK_BIT(0),
+			Reloaded = RK_BIT(1),
+			WaitedForLoad = RK_BIT(2),
+			MarkedForDelete = RK_BIT(3),
+			AlreadyReloading = RK_BIT(4),
+			// The loader threw, the load failed
+			LoaderThrew = RK_BIT(5),
+		};
+
+		ResourceLoadStatus()
+			: State(0u)
+		{
+		}
+
+		StateT State;
+
+		ResourceLoadStatus& Set(States state);
+		bool Is(States state) const;
+		ResourceLoadStatus& Clear(States state);
+	};
+
+	enum class ResourceUnloadStatus
+	{
+		Success,
+		Failure,
+		Loading
+	};
+
+	class ResourceListener
+	{
+	public:
+		ResourceListener() = default;
+		virtual ~ResourceListener() = default;
+
+		virtual void OnLoadComplete(ResourceData& data, ResourceLoadStatus status)
+		{
+		}
+
+		virtual void OnUnloadComplete(ResourceData& data, ResourceUnloadStatus status)
+		{
+		}
+
+		virtual void BeforeDeleting(ResourceData& data)
+		{
+		}
+	};
+
+	template <typename T>
+	using ResourceLoadFunc = std::function<SharedPtr<T>(const std::filesystem::path&)>;
+	// Loads from the file contents, read by the manager, batched with other reads when loading asynchronously
+	template <typename T>
+	using ResourceBufferLoadFunc = std::function<SharedPtr<T>(const std::filesystem::path&, ByteSpan)>;
+
+	namespace Detail
+	{
+		template <typename T, typename = void>
+		struct HasGetResourceSize : std::false_type
+		{
+		};
+
+		template <typename T>
+		struct HasGetResourceSize<T, std::void_t<decltype(std::declval<const T&>().GetResourceSize())>> : std::true_type
+		{
+		};
+
+		template <typename T, typename = void>
+		struct HasCapacity : std::false_type
+		{
+		};
+
+		template <typename T>
+		struct HasCapacity<T, std::void_t<typename T::value_type, decltype(std::declval<const T&>().capacity())>>
+			: std::true_type
+		{
+		};
+	}
+
+	// Bytes a loaded resource occupies, counted against the manager's memory budget
+	// Uses a GetResourceSize() member if T has one, the capacity of containers like std::vector
+	// and std::string, and sizeof(T) otherwise
+	// Specialize for other types owning memory beyond their own size
+	template <typename T>
+	struct ResourceSize
+	{
+		static size_t Get(const T& resource)
+		{
+			if constexpr ( Detail::HasGetResourceSize<T>::value )
+			{
+				return static_cast<size_t>(resource.GetResourceSize());
+			}
+			else if constexpr ( Detail::HasCapacity<T>::value )
+			{
+				return sizeof(T) + resource.capacity() * sizeof(typename T::value_type);
+			}
+			else
+			{
+				return sizeof(T);
+			}
+		}
+	};
+
+	// Invoked on the thread which finished the load
+	using LoadContinuation = std::function<void(ResourceLoadStatus)>;
+
+	class ResourceData
+	{
+	public:
+		using ListenerList = std::vector<ResourceListener*>;
+
+		// Public for external use
+		REKSI_THREADING_MUTABLE REKSI_MUTEX_AUTO;
+		REKSI_CV_AUTO;
+
+		ResourceStatus GetStatus() const;
+		bool IsState(ResourceStatus::States state) const;
+		ResourceLoadStatus Load();
+		ResourceUnloadStatus Unload();
+		template <typename T>
+		SharedPtr<T> GetData();
+		// Returns the data without loading it, nullptr if not loaded
+		template <typename T>
+		SharedPtr<T> GetDataIfLoaded();
+		// Returns the data without touching its reference count, nullptr if not loaded or the load failed
+		// Requires an EpochDomain::Guard, the data stays alive until the guard is left
+		template <typename T>
+		T* BorrowData(bool load);
+		// Runs the continuation once the load in flight completes
+		// Returns false without running it if no load is in flight
+		bool ContinueAfterLoad(LoadContinuation continuation);
+		void AddListener(ResourceListener* listener);
+		void RemoveListener(ResourceListener* listener);
+		void ClearListeners();
+		void AddListeners(const ListenerList& listeners);
+		void WaitUntilCurrentLoading();
+		// Joins the manager's base path with the name, defined with the ResourceManager
+		std::filesystem::path GetPath() const;
+		// Path relative to the manager's base path, owned by the manager, valid until it is compacted
+		std::string_view GetName() const;
+		ResourceKey GetKey() const;
+		template <typename T>
+		ResourceLoadFunc<T> GetLoader() const;
+		ResourceHandleT GetHandle() const;
+		ResourceTypeId GetTypeId() const;
+		std::type_index GetTypeIndex() const;
+		// Bytes of the loaded data, 0 if not loaded
+		size_t GetSize() const;
+		// Changes whenever the data is replaced or unloaded
+		uint32_t GetVersion() const;
+		// Pinned resources are never unloaded by the memory budget, pins are counted
+		void Pin();
+		void Unpin();
+		bool IsPinned() const;
+
+		~ResourceData();
+
+		// Created by the ResourceManager only, through Create
+		static void* operator new(size_t size) = delete;
+		// Also releases the memory of batch allocated resources, see AllocationBlock
+		static void operator delete(void* memory);
+
+	private:
+		using LoadFunc = InplaceFunction<SharedPtr<void>(const std::filesystem::path&)>;
+		using BufferLoadFunc = InplaceFunction<SharedPtr<void>(const std::filesystem::path&, ByteSpan)>;
+		using SizeFunc = size_t(*)(const void*);
+		using RLS = ResourceLoadStatus;
+		using RS = ResourceStatus;
+		using RUS = ResourceUnloadStatus;
+
+		// Everything the manager needs to create a resource of a type
+		// Shared by all resources using the same loader, default loaders by every resource of their type
+		struct Loaders
+		{
+			// One of the two is set, buffer loaders are given the file contents
+			LoadFunc Load;
+			BufferLoadFunc LoadBuffer;
+			SizeFunc SizeOf = nullptr;
+
+			// Reads the file for buffer loaders
+			SharedPtr<void> LoadFile(const std::filesystem::path& path) const;
+		};
+		using LoadersPtr = SharedPtr<const Loaders>;
+
+		// Takes any callable returning a SharedPtr<T> from a path, or from a path and the file contents
+		template <typename T, typename Func>
+		static LoadersPtr MakeLoaders(Func&& loader);
+		template <typename T>
+		static ResourceLoadFunc<T> MakeLoadFunc(LoadersPtr loaders);
+
+		// Memory for the ResourceData created by one batch, so they end up next to each other
+		// Freed once the batch and every ResourceData allocated from it released it
+		struct AllocationBlock
+		{
+			std::atomic<size_t> References;
+			size_t Used;
+			size_t Capacity;
+
+			// Holds the reference of the batch
+			static AllocationBlock* Create(size_t capacity);
+			void Release();
+		};
+
+		// Precedes every ResourceData, the block is nullptr if it was allocated on its own
+		struct alignas(std::max_align_t) AllocationHeader
+		{
+			AllocationBlock* Block;
+		};
+
+		// Allocated from the block if given, on its own otherwise
+		static ResourceData* Create(AllocationBlock* block, ResourceHandleT handle, ResourceKey key,
+		                            std::string_view name, LoadersPtr loaders, ResourceManager* creator,
+		                            ResourceTypeId typeId);
+		// Memory for a ResourceData after its header, the next free place of the block if given
+		static void* Allocate(AllocationBlock* block);
+		// Frees memory returned by Allocate
+		static void Deallocate(void* memory);
+		// Rounds up to the alignment of the headers
+		static constexpr size_t AlignAllocation(size_t size);
+		// Header and ResourceData
+		static constexpr size_t GetAllocationSize();
+
+		ResourceData(ResourceHandleT handle, ResourceKey key, std::string_view name, LoadersPtr loaders,
+		             ResourceManager* creator, ResourceTypeId typeId);
+
+		ResourceHandleT m_Handle;
+		ResourceStatus m_Status;
+		const ResourceKey m_Key;
+		// Interned by the manager, the full path is only built when needed
+		// Moved by ResourceManager::Compact along with the interned paths
+		std::string_view m_Name;
+		const LoadersPtr m_Loaders;
+		// Swapped under the lock, read without it inside an EpochDomain::Guard, nullptr while not loaded
+		std::atomic<SharedPtr<void>*> m_Data;
+		std::atomic<uint32_t> m_Version;
+		size_t m_Size;
+		uint32_t m_PinCount;
+		// Set on every access, cleared by the eviction's clock hand passing by
+		std::atomic<bool> m_Referenced;
+		// Background load waiting in the scheduler, if any
+		SharedPtr<LoadTask> m_PendingLoad;
+		// Resumed from the completion path of the load in flight
+		std::vector<LoadContinuation> m_LoadContinuations;
+		// Immutable snapshot, replaced under the lock and read without it inside an EpochDomain::Guard
+		// nullptr while there are no listeners
+		std::atomic<SharedPtr<const ListenerList>*> m_Listeners;
+		ResourceManager* m_Creator;
+		const ResourceTypeId m_TypeId;
+
+		// Shares the current snapshot, listeners added or removed meanwhile are not seen
+		SharedPtr<const ListenerList> GetListeners() const;
+		// Publishes a modified copy of the snapshot, the previous one is retired
+		template <typename Func>
+		void UpdateListeners(Func&& update);
+		void NotifyListenersOnLoadComplete(ResourceLoadStatus status);
+		void NotifyListenersOnUnloadComplete(ResourceUnloadStatus status);
+		void NotifyListenersBeforeDeleting();
+
+		void SetState(ResourceStatus::States state);
+		void ClearState(ResourceStatus::States state);
+		// Clears MarkedForReload, returns true if it was set and no other load took it over since
+		bool TakeReloadMark();
+
+		// Casts a snapshot of m_Data, which the caller keeps alive with the lock or an EpochDomain::Guard
+		// Throws std::runtime_error if T is not the type of the resource
+		template <typename T>
+		SharedPtr<T> GetDataInternal(const SharedPtr<void>* data);
+		// Only writes the flag if not set yet, so hot resources are not written on every access
+		void MarkReferenced();
+		// Publishes the data, the previous version is deleted once no reader uses it anymore
+		// Requires the unique lock, returns the previous version to retire once it is released
+		SharedPtr<void>* ExchangeData(SharedPtr<void>* data);
+
+		// Loads from the prefetched file contents if given
+		ResourceLoadStatus Load(ByteBuffer* prefetched);
+		// Just perform load without notifying listeners or the manager
+		ResourceLoadStatus LoadInternal(ByteBuffer* prefetched = nullptr);
+		bool HasBufferLoader() const;
+		// Loads the dependencies which are not loaded yet, returns false if one of them failed
+		// Defined with the ResourceManager, like ReloadDependents
+		bool LoadDependencies();
+		void ReloadDependents();
+		// Loads with the buffer loader if the manager has the resource in an archive, defined with the ResourceManager
+		// Returns false if it is not archived, data stays nullptr if it failed to decompress
+		bool LoadFromArchive(SharedPtr<void>& data) const;
+		// Just perform unload without notifying listeners or the manager
+		ResourceUnloadStatus UnloadInternal();
+		// Unloads the data unless it is pinned, loading or was referenced since the last call
+		// Clears the referenced bit, returns true if the data was unloaded
+		bool TryEvict();
+
+		template <typename T>
+		static size_t SizeOf(const void* data);
+		// Defined with the ResourceManager
+		void UpdateResidentSize(size_t oldSize, size_t newSize);
+		void EnforceMemoryBudget();
+
+		SharedPtr<LoadTask> GetPendingLoad() const;
+		// Loads the resource, or waits for its queued background load after moving it to the front
+		// Defined with the ResourceManager
+		void LoadOrWaitForPending();
+		// Returns the queued background load, creating it if none is pending
+		// created is set if the caller has to submit the new task
+		SharedPtr<LoadTask> GetOrCreatePendingLoad(bool& created);
+		// Runs a background load which the calling worker has claimed, and completes it
+		void LoadClaimed(const SharedPtr<LoadTask>& task);
+		// Detaches the task from this resource once it is no longer pending
+		void ReleasePendingLoad(LoadTask* task);
+
+		friend class ResourceManager;
+		friend class LoadTask;
+		friend class ReloadCoalescer;
+	};
+}
+
+
+
+/*
+ ____         _                _         _             
+/ ___|   ___ | |__    ___   __| | _   _ | |  ___  _ __ 
+\___ \  / __|| '_ \  / _ \ / _` || | | || | / _ \| '__|
+ ___) || (__ | | | ||  __/| (_| || |_| || ||  __/| |   
+|____/  \___||_| |_| \___| \__,_| \__,_||_| \___||_|   
+                                                       
+*/
+
+
+namespace Reksi
+{
+	// Order in which queued tasks are picked up, lower values run first
+	enum class LoadPriority : uint8_t
+	{
+		Critical = 0,
+		Visible = 1,
+		Prefetch = 2
+	};
+
+	constexpr size_t LoadPriorityCount = 3;
+
+	// Unit of work executed by the TaskScheduler
+	class SchedulerTask
+	{
+	public:
+		SchedulerTask() = default;
+		virtual ~SchedulerTask() = default;
+
+		// Runs the task on a worker thread
+		virtual void Execute() = 0;
+
+		// Called instead of Execute if the scheduler shuts down before the task was picked up
+		virtual void Cancel()
+		{
+		}
+
+		LoadPriority GetPriority() const;
+
+	private:
+		std::atomic<uint8_t> m_Priority{static_cast<uint8_t>(LoadPriority::Visible)};
+		// A promoted task sits in several queues, only the first pop gets to run it
+		std::atomic<bool> m_Taken{false};
+
+		bool TryTake();
+		// Returns false if the task already has the same or a higher priority
+		bool Raise(LoadPriority priority);
+
+		friend class TaskScheduler;
+	};
+
+	// Pool of worker threads owned by the ResourceManager, used for background loads
+	// Every worker owns a deque per priority, idle workers steal from the others
+	// With REKSI_THREADING disabled, submitted tasks are executed inline
+	class TaskScheduler
+	{
+	public:
+		// A worker count of 0 uses the hardware concurrency
+		explicit TaskScheduler(uint32_t workerCount = 0);
+		~TaskScheduler();
+
+		TaskScheduler(const TaskScheduler&) = delete;
+		TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+		// Cancels the task instead once the scheduler is shutting down
+		void Submit(SharedPtr<SchedulerTask> task, LoadPriority priority = LoadPriority::Visible);
+		// Moves a queued task to a higher priority, does nothing if it already started
+		void Promote(const SharedPtr<SchedulerTask>& task, LoadPriority priority);
+		uint32_t GetWorkerCount() const;
+		// True when called from one of this scheduler's workers
+		bool IsWorkerThread() const;
+		// Runs body(i) for every i below count on the workers and the calling thread, returns once all ran
+		// The caller runs the parts no worker picked up yet, so it may be called from a worker as well
+		void ParallelFor(size_t count, const std::function<void(size_t)>& body,
+		                 LoadPriority priority = LoadPriority::Critical);
+
+	private:
+		// Part of a ParallelFor
+		class ParallelPart;
+
+		struct WorkerQueue
+		{
+			REKSI_MUTEX_AUTO;
+			std::deque<SharedPtr<SchedulerTask>> Tasks[LoadPriorityCount];
+		};
+
+		std::vector<UniquePtr<WorkerQueue>> m_Queues;
+#if REKSI_THREADING == 1
+		std::vector<std::thread> m_Workers;
+#endif
+		// Number of queue entries, including stale ones left behind by promotions
+		std::atomic<size_t> m_QueuedCount;
+		std::atomic<uint32_t> m_NextQueue;
+		std::atomic<bool> m_Stopping;
+
+		// Guards sleeping and waking up of idle workers
+		REKSI_THREADING_MUTABLE REKSI_MUTEX_AUTO;
+		REKSI_CV_AUTO;
+
+		static thread_local const TaskScheduler* s_CurrentScheduler;
+		static thread_local uint32_t s_CurrentWorker;
+
+		// Returns false without queueing the task once the scheduler is shutting down
+		bool Push(SharedPtr<SchedulerTask> task, LoadPriority priority);
+		SharedPtr<SchedulerTask> Pop(uint32_t worker);
+		void WorkerLoop(uint32_t worker);
+	};
+}
+
+
+
+/*
+    _                              _                        _ 
+   / \    ___  _   _  _ __    ___ | |      ___    __ _   __| |
+  / _ \  / __|| | | || '_ \  / __|| |     / _ \  / _` | / _` |
+ / ___ \ \__ \| |_| || | | || (__ | |___ | (_) || (_| || (_| |
+/_/   \_\|___/ \__, ||_| |_| \___||_____| \___/  \__,_| \__,_|
+               |___/                                          
+*/
+
+
+namespace Reksi
+{
+	// Shared state of a background load, executed by the manager's TaskScheduler
+	class LoadTask : public SchedulerTask, public std::enable_shared_from_this<LoadTask>
+	{
+	public:
+		explicit LoadTask(ResourceData* data);
+
+		void Execute() override;
+		void Cancel() override;
+
+		bool IsDone() const;
+		void Wait() const;
+		// Waits for the load to finish and returns its status
+		ResourceLoadStatus GetStatus() const;
+		// Runs the continuation on the thread completing the load
+		// Returns false without running it if the load is already done
+		bool ContinueWith(LoadContinuation continuation);
+
+	private:
+		// Cleared by whoever takes ownership of running the load
+		std::atomic<ResourceData*> m_Data;
+		ResourceLoadStatus m_Status;
+		bool m_Done;
+		std::vector<LoadContinuation> m_Continuations;
+		// File contents read ahead by the manager's FileReader, for resources with a buffer loader
+		ByteBuffer m_Prefetched;
+		bool m_HasPrefetched;
+
+		REKSI_THREADING_MUTABLE REKSI_MUTEX_AUTO;
+		REKSI_THREADING_MUTABLE REKSI_CV_AUTO;
+
+		// Returns the resource if the caller now owns the load, nullptr if it was already claimed
+		ResourceData* Claim();
+		void Complete(ResourceLoadStatus status);
+		void SetPrefetched(ByteBuffer buffer);
+		// Returns false if nothing was read ahead
+		bool TakePrefetched(ByteBuffer& buffer);
+
+		friend class ResourceData;
+		friend class ResourceManager;
+	};
+
+	// Future-like handle to a background load, returned by ResourceManager::LoadAsync
+	class LoadFuture
+	{
+	public:
+		LoadFuture() = default;
+
+		bool IsValid() const;
+		bool IsReady() const;
+		void Wait() const;
+		// Waits for the load to finish and returns its status
+		ResourceLoadStatus Get() const;
+		// Runs the continuation on the thread completing the load
+		// Returns false without running it if the load is already done
+		bool ContinueWith(LoadContinuation continuation) const;
+
+	protected:
+		explicit LoadFuture(SharedPtr<LoadTask> task);
+
+		SharedPtr<LoadTask> m_Task;
+
+		friend class ResourceManager;
+	};
+
+	// Typed LoadFuture, returned by Resource<T>::LoadAsync
+	template <typename T>
+	class ResourceFuture : public LoadFuture
+	{
+	public:
+		Resource<T> GetResource() const;
+		// Waits for the load to finish and returns the data
+		SharedPtr<T> GetRef() const;
+
+	private:
+		ResourceFuture(const Resource<T>& resource, LoadFuture future);
+
+		Resource<T> m_Resource;
+
+		friend class ResourceManager;
+	};
+}
+
+
+
+/*
+ ____                                             
+|  _ \   ___  ___   ___   _   _  _ __   ___   ___ 
+| |_) | / _ \/ __| / _ \ | | | || '__| / __| / _ \
+|  _ < |  __/\__ \| (_) || |_| || |   | (__ |  __/
+|_| \_\ \___||___/ \___/  \__,_||_|    \___| \___|
+                                                  
+*/
+
+
+namespace Reksi
+{
+	// Resource class is a wrapper around the ResourceData class, and is returned by the ResourceManager
+	template <typename T>
+	class Resource
+	{
+	public:
+		SharedPtr<T> GetRef();
+		// Returns the data if loaded, the default resource otherwise, never loads
+		SharedPtr<T> TryGetRef();
+		// Like GetRef and TryGetRef, without touching the reference count of the data, see ResourceView
+		ResourceView<T> Borrow();
+		ResourceView<T> TryBorrow();
+		T& operator*();
+
+		ResourceStatus GetStatus() const;
+		bool IsLoaded() const;
+		bool IsValid() const;
+
+		ResourceLoadStatus Load();
+		ResourceUnloadStatus Unload();
+		ResourceLoadStatus Reload();
+		// Queues the load on the manager's worker threads
+		ResourceFuture<T> LoadAsync(LoadPriority priority = LoadPriority::Visible);
+
+		std::filesystem::path GetPath() const;
+		ResourceKey GetKey() const;
+		ResourceLoadFunc<T> GetLoader() const;
+
+		ResourceManager* GetManager() const;
+		ResourceHandleT GetHandle() const;
+
+		void AddListener(ResourceListener* listener);
+		void RemoveListener(ResourceListener* listener);
+		void ClearListeners();
+
+		// Keeps the data resident regardless of the manager's memory budget, pins are counted
+		void Pin();
+		void Unpin();
+		bool IsPinned() const;
+
+	private:
+		Resource(ResourceHandleT handle, ResourceData* data, ResourceManager* manager);
+
+		ResourceHandleT m_Handle;
+		ResourceData* m_Data;
+		ResourceManager* m_Manager;
+
+		friend class ResourceManager;
+		friend class ResourceAwaiter<T>;
+		friend class ResourceRef<T>;
+	};
+
+	/*
+	 * Scoped access to the data of a resource which does not touch its reference count,
+	 * so threads reading the same hot resource do not contend on its control block
+	 * The data version is kept alive by an EpochDomain::Guard instead, even if the resource is reloaded meanwhile
+	 * Holds off freeing replaced data of all resources while alive, keep it short and on the borrowing thread
+	 *
+	 * if ( auto config = resource.Borrow() ) Use(config->Value);
+	 */
+	template <typename T>
+	class ResourceView
+	{
+	public:
+		ResourceView(const ResourceView&) = delete;
+		ResourceView& operator=(const ResourceView&) = delete;
+
+		T& operator*() const;
+		T* operator->() const;
+		T* Get() const;
+		// False if the resource is not loaded and there is no default resource
+		explicit operator bool() const;
+
+	private:
+		EpochDomain::Guard m_Guard;
+		T* m_Data;
+		// The default resource is not protected by the guard, so it is referenced instead
+		SharedPtr<T> m_Default;
+
+		ResourceView(ResourceData* data, ResourceManager* manager, bool load);
+
+		friend class Resource<T>;
+	};
+
+	/*
+	 * Caches the data of a resource for hot paths, dereferencing costs two relaxed loads while the data is unchanged,
+	 * the state of the resource's slot and the version of its data, which changes with every reload and unload
+	 * Falls back to Resource::GetRef once either changed, loading the resource if needed
+	 * Keeps the cached data alive like the SharedPtr from GetRef, not thread-safe, use one per thread
+	 * Must be dropped before ResourceManager::Compact once its resource was deleted
+	 *
+	 * ResourceRef<Mesh> mesh{manager.GetResource<Mesh>("cube.obj")};
+	 * for ( auto& instance : instances ) Draw(*mesh, instance);
+	 */
+	template <typename T>
+	class ResourceRef
+	{
+	public:
+		explicit ResourceRef(const Resource<T>& resource);
+
+		// The default resource if the resource failed to load
+		const SharedPtr<T>& GetRef();
+		T& operator*();
+		T* operator->();
+		// False once the resource was deleted
+		bool IsValid() const;
+		const Resource<T>& GetResource() const;
+
+	private:
+		Resource<T> m_Resource;
+		const std::atomic<uint32_t>* m_SlotState;
+		uint32_t m_LiveState;
+		// Version of the resource's data when it was cached
+		uint32_t m_Version;
+		SharedPtr<T> m_Cached;
+
+		bool IsCurrent() const;
+		void Refresh();
+	};
+}
+
+
+
+
+/*
+ ____   _         _    __  __               
+/ ___| | |  ___  | |_ |  \/  |  __ _  _ __  
+\___ \ | | / _ \ | __|| |\/| | / _` || '_ \ 
+ ___) || || (_) || |_ | |  | || (_| || |_) |
+|____/ |_| \___/  \__||_|  |_| \__,_|| .__/ 
+                                     |_|    
+*/
+
+
+namespace Reksi
+{
+	/*
+	 * Handle layout
+	 * Bits  0-31: Slot index
+	 * Bits 32-55: Slot generation, never 0 for a live handle
+	 * Bits 56-63: Type id of the resource, 0 for ids which do not fit
+	 * Only the index and generation address the slot, the type lets typed handles be checked without a lookup
+	 */
+	class ResourceHandleLayout
+	{
+	public:
+		static constexpr uint32_t IndexBits = 32;
+		static constexpr uint32_t GenerationBits = 24;
+		static constexpr uint32_t GenerationMask = (1u << GenerationBits) - 1;
+		static constexpr uint32_t TypeShift = IndexBits + GenerationBits;
+		static constexpr uint32_t TypeMask = 0xFF;
+		// Generation of a slot which used up all of its generations, no handle carries it
+		static constexpr uint32_t ExhaustedGeneration = GenerationMask + 1;
+
+		static constexpr ResourceHandleT Make(uint32_t index, uint32_t generation)
+		{
+			return static_cast<ResourceHandleT>(index) |
+				(static_cast<ResourceHandleT>(generation & GenerationMask) << IndexBits);
+		}
+
+		static constexpr uint32_t GetIndex(ResourceHandleT handle)
+		{
+			return static_cast<uint32_t>(handle);
+		}
+
+		static constexpr uint32_t GetGeneration(ResourceHandleT handle)
+		{
+			return static_cast<uint32_t>(handle >> IndexBits) & GenerationMask;
+		}
+
+		// Ids above TypeMask are not stored
+		static constexpr ResourceHandleT WithType(ResourceHandleT handle, ResourceTypeId type)
+		{
+			return handle | static_cast<ResourceHandleT>(type <= TypeMask ? type : 0) << TypeShift;
+		}
+
+		// 0 if the handle does not carry its type
+		static constexpr ResourceTypeId GetType(ResourceHandleT handle)
+		{
+			return static_cast<ResourceTypeId>(handle >> TypeShift) & TypeMask;
+		}
+
+		// False only if the handle is known to refer to another type
+		static constexpr bool MayBeType(ResourceHandleT handle, ResourceTypeId type)
+		{
+			return GetType(handle) == 0 || GetType(handle) == type;
+		}
+
+		// Generation following the given one, ExhaustedGeneration after the last one instead of wrapping,
+		// a wrapped generation would validate old handles against an unrelated resource again
+		static constexpr uint32_t NextGeneration(uint32_t generation)
+		{
+			return generation + 1;
+		}
+	};
+
+	// Owns the ResourceData objects of a manager, addressed by generational handles
+	// Lookups and validity checks are lock-free, a handle to a deleted resource stays invalid
+	// even after its slot was reused
+	// Allocate, Publish and Release are lock-free as well, released slots are recycled through
+	// a tagged free list
+	// A slot released with its last generation is retired and never handed out again
+	class ResourceSlotMap
+	{
+	public:
+		ResourceSlotMap();
+		~ResourceSlotMap();
+
+		ResourceSlotMap(const ResourceSlotMap&) = delete;
+		ResourceSlotMap& operator=(const ResourceSlotMap&) = delete;
+
+		bool IsValid(ResourceHandleT handle) const;
+		// Returns nullptr if the handle is stale
+		ResourceData* Get(ResourceHandleT handle) const;
+		// Returns the data of the slot, nullptr if it is not live
+		ResourceData* GetAt(uint32_t index) const;
+		// Key of the handle's data, copied into the slot when published, so it can be read while a racing
+		// release destroys the data, returns false if the handle is stale
+		bool GetKey(ResourceHandleT handle, ResourceKey& key) const;
+		// One past the highest slot index handed out so far
+		uint32_t GetIndexEnd() const;
+		// State of the handle's slot, equal to GetLiveState while the handle is valid, nullptr if there is no slot
+		// Lets callers cache the slot, which stays in place until Compact frees its segment
+		const std::atomic<uint32_t>* GetState(ResourceHandleT handle) const;
+		static constexpr uint32_t GetLiveState(ResourceHandleT handle);
+
+		// Reserves a slot, the handle becomes valid once published
+		ResourceHandleT Allocate();
+		// Takes ownership of the data
+		void Publish(ResourceHandleT handle, ResourceData* data);
+		// Invalidates the handle and hands back ownership of the data
+		UniquePtr<ResourceData> Release(ResourceHandleT handle);
+
+		// Number of live resources
+		uint32_t GetLiveCount() const;
+		// Number of slots backed by memory
+		uint32_t GetCapacity() const;
+		// Bytes allocated for the slots, not counting the data they own
+		size_t GetMemoryUsage() const;
+
+		// Frees the segments past the last live slot and rebuilds the free list lowest index first,
+		// so new resources pack towards the front
+		// Must not run concurrently with any other call
+		void Compact();
+
+	private:
+		struct Slot
+		{
+			// Generation << 1 | live bit
+			std::atomic<uint32_t> State;
+			std::atomic<ResourceData*> Data{nullptr};
+			std::atomic<uint64_t> KeyHash{0};
+			std::atomic<uint32_t> KeyIndex{ResourceKey::InvalidIndex};
+			// Index + 1 of the next free slot, while this one is on the free list
+			std::atomic<uint32_t> NextFree{0};
+		};
+
+		struct Segment
+		{
+			UniquePtr<Slot[]> Slots;
+			// One bit per slot, set while the slot is live
+			UniquePtr<std::atomic<uint64_t>[]> Occupancy;
+		};
+
+		// Segment s holds FirstSegmentSize << s slots, so slots never move once created
+		static constexpr uint32_t FirstSegmentBits = 6;
+		static constexpr uint32_t FirstSegmentSize = 1u << FirstSegmentBits;
+		static constexpr uint32_t SegmentCount = 32 - FirstSegmentBits + 1;
+
+		std::atomic<Segment*> m_Segments[SegmentCount];
+		// Generation new slots of a segment start at, raised when Compact frees the segment
+		uint32_t m_SegmentGenerations[SegmentCount];
+		// Number of slots handed out from the end so far
+		std::atomic<uint32_t> m_Size;
+		// Tag << 32 | index + 1 of the first free slot, the tag guards the CAS loops against ABA
+		std::atomic<uint64_t> m_FreeHead;
+
+		static uint32_t GetSegmentIndex(uint32_t index);
+		static uint32_t GetSegmentStart(uint32_t segment);
+		static uint32_t GetSegmentSize(uint32_t segment);
+		Slot* GetSlot(uint32_t index) const;
+		Segment* GetOrCreateSegment(uint32_t segment);
+		void SetOccupied(uint32_t index, bool occupied);
+		bool PopFree(uint32_t& index);
+		void PushFree(uint32_t index);
+	};
+}
+
+
+
+/*
+ ____          _    _      ___             _             
+|  _ \   __ _ | |_ | |__  |_ _| _ __    __| |  ___ __  __
+| |_) | / _` || __|| '_ \  | | | '_ \  / _` | / _ \\ \/ /
+|  __/ | (_| || |_ | | | | | | | | | || (_| ||  __/ >  < 
+|_|     \__,_| \__||_| |_||___||_| |_| \__,_| \___|/_/\_\
+                                                         
+*/
+
+
+namespace Reksi
+{
+	// Append only storage for interned paths, stored strings only move when compacted
+	class ResourceStringPool
+	{
+	public:
+		static constexpr size_t BlockSize = 16 * 1024;
+
+		// Copies the string into the pool, returns the stored copy and its index
+		// Indices are never reused, not even by Compact
+		std::string_view Add(std::string_view str, uint32_t& index);
+		// Moves the strings still in use into new blocks and frees the old ones
+		// relocate(copy) must call copy(str) for every string in use and switch to the returned copy
+		template <typename RelocateFunc>
+		void Compact(RelocateFunc&& relocate);
+		// Bytes allocated for the strings
+		size_t GetMemoryUsage() const;
+
+	private:
+		std::vector<UniquePtr<char[]>> m_Blocks;
+		size_t m_AllocatedBytes = 0;
+		// Block small strings are appended to
+		char* m_Current = nullptr;
+		size_t m_BlockUsed = 0;
+		uint32_t m_Count = 0;
+
+		REKSI_THREADING_MUTABLE REKSI_MUTEX_AUTO;
+
+		// Requires the unique lock
+		std::string_view Copy(std::string_view str);
+	};
+
+	// Maps interned resource paths to handles
+	// Split into independently locked shards by path hash, so lookups and insertions of
+	// different paths rarely contend
+	// Every shard is an open addressing table with lookups straight from the caller's string,
+	// the lookup path does not allocate
+	// Deleting a resource only clears the handle of its entry, Compact drops the paths left without a resource
+	// Handles are kept in an array indexed by key, lookups with a key neither lock nor probe
+	// Paths of registered asset tables are found through the table's perfect hash instead of the shards
+	class ResourcePathIndex
+	{
+	public:
+		static constexpr size_t ShardCount = 64;
+
+		ResourcePathIndex();
+		~ResourcePathIndex();
+
+		ResourcePathIndex(const ResourcePathIndex&) = delete;
+		ResourcePathIndex& operator=(const ResourcePathIndex&) = delete;
+
+		// Returns 0 if the path is not registered
+		ResourceHandleT Find(const ResourcePathView& path) const;
+		ResourceHandleT Find(const ResourceKey& key) const;
+		// Returns the key of the path, interning it if needed
+		ResourceKey Intern(const ResourcePathView& path);
+		// Returns the path the key was interned from, empty for a foreign key
+		std::string_view GetString(const ResourceKey& key) const;
+		// Returns the handle of the path, calling create(key, interned path) under the shard lock if it has none,
+		// so racing callers on the same new path create it exactly once
+		template <typename CreateFunc>
+		ResourceHandleT FindOrInsert(const ResourcePathView& path, CreateFunc&& create);
+		// Same, for an already interned path, returns 0 for a foreign key
+		template <typename CreateFunc>
+		ResourceHandleT FindOrInsert(const ResourceKey& key, CreateFunc&& create);
+		// Same for many paths, locking each shard once, handles receives the handle of every path
+		// path(i) returns the i-th path, create(i, key, interned path) creates the missing ones
+		template <typename PathFunc, typename CreateFunc>
+		void FindOrInsert(size_t count, PathFunc&& path, CreateFunc&& create, ResourceHandleT* handles);
+		// Interns every path of the table, later lookups of them go through the table and its keys
+		// Returns the keys in table order
+		const std::vector<ResourceKey>& RegisterTable(const StaticAssetTable& table);
+		// Clears the handle of the path if it still is the given one
+		bool Erase(const ResourceKey& key, ResourceHandleT handle);
+		// Drops the paths without a resource, unless Intern handed out their key, and shrinks the tables
+		// The remaining paths move to new strings, moved(handle, path) is called for every one with a resource
+		// Keys of dropped paths are never reused, lookups with them fail like with a foreign key
+		// Must not run concurrently with any other use of the index
+		template <typename MovedFunc>
+		void Compact(MovedFunc&& moved);
+		// Bytes allocated for the tables, handles and interned strings
+		size_t GetMemoryUsage() const;
+
+	private:
+		static constexpr size_t InitialCapacity = 16;
+
+		struct Entry
+		{
+			uint64_t Hash = 0;
+			std::string_view Path;
+			uint32_t Index = ResourceKey::InvalidIndex;
+			// Handed out by Intern, kept by Compact as the caller may look it up later
+			bool Keyed = false;
+		};
+
+		// Segment s holds FirstHandleSegmentSize << s handles, like the slot map
+		static constexpr uint32_t FirstHandleSegmentBits = 6;
+		static constexpr uint32_t FirstHandleSegmentSize = 1u << FirstHandleSegmentBits;
+		static constexpr uint32_t HandleSegmentCount = 32 - FirstHandleSegmentBits + 1;
+
+		struct alignas(64) Shard
+		{
+			REKSI_THREADING_MUTABLE REKSI_MUTEX_AUTO;
+			// Power of two sized, empty entries have an invalid index
+			std::vector<Entry> Entries;
+			size_t Count = 0;
+		};
+
+		// Registered table with the key of each of its paths, tables are never unregistered
+		struct AssetTableNode
+		{
+			StaticAssetTable Table;
+			std::vector<ResourceKey> Keys;
+			const AssetTableNode* Next;
+		};
+
+		Shard m_Shards[ShardCount];
+		ResourceStringPool m_Strings;
+		// Pushed to the front, read without locking
+		std::atomic<const AssetTableNode*> m_AssetTables;
+		// Handle of every interned path by key index, 0 while no resource is registered for the path
+		// Written under the lock of the path's shard
+		std::atomic<std::atomic<ResourceHandleT>*> m_Handles[HandleSegmentCount];
+
+		static size_t GetShardIndex(uint64_t hash);
+		// Returns the key of the path in a registered table, an invalid key if it is in none
+		ResourceKey FindRegistered(const ResourcePathView& path) const;
+		// Returns the entry of the path, nullptr if missing
+		static const Entry* FindEntry(const Shard& shard, std::string_view path, uint64_t hash);
+		static const Entry* FindEntry(const Shard& shard, const ResourceKey& key);
+		// Interns the path, requires the unique lock of the shard
+		Entry& FindOrAddEntry(Shard& shard, const ResourcePathView& path);
+		static void Grow(Shard& shard);
+		// Reinserts the entries into a table of the given power of two size, 0 frees the table
+		static void Rehash(Shard& shard, size_t capacity);
+		// Returns nullptr if the index was never interned
+		std::atomic<ResourceHandleT>* GetHandleSlot(uint32_t index) const;
+		std::atomic<ResourceHandleT>& GetOrCreateHandleSlot(uint32_t index);
+	};
+}
+
+
+
+/*
+ ____                                              __  __                                         
+|  _ \   ___  ___   ___   _   _  _ __   ___   ___ |  \/  |  __ _  _ __    __ _   __ _   ___  _ __ 
+| |_) | / _ \/ __| / _ \ | | | || '__| / __| / _ \| |\/| | / _` || '_ \  / _` | / _` | / _ \| '__|
+|  _ < |  __/\__ \| (_) || |_| || |   | (__ |  __/| |  | || (_| || | | || (_| || (_| ||  __/| |   
+|_| \_\ \___||___/ \___/  \__,_||_|    \___| \___||_|  |_| \__,_||_| |_| \__,_| \__, | \___||_|   
+                                                                                |___/             
+*/
+
+
+namespace Reksi
+{
+	// Snapshot returned by ResourceManager::GetMemoryStats
+	struct ResourceMemoryStats
+	{
+		struct Usage
+		{
+			// Number of resources
+			size_t Count = 0;
+			// Bytes of their loaded data, as reported by ResourceSize
+			size_t Bytes = 0;
+		};
+
+		Usage Total;
+		std::unordered_map<std::type_index, Usage> PerType;
+		// A resource may be counted in several states, e.g. Loaded and Loading while reloading
+		Usage Loaded;
+		Usage Loading;
+		Usage MarkedForDelete;
+		// Bytes used by the manager itself, the resource objects, slots, path tables and interned paths
+		size_t OverheadBytes = 0;
+		size_t MemoryBudget = 0;
+	};
+
+	// Path and type of a resource, for getting resources of different types in one batch
+	struct ResourceRequest
+	{
+		std::filesystem::path Path;
+		ResourceTypeId Type = 0;
+
+		template <typename T>
+		static ResourceRequest Of(std::filesystem::path path);
+	};
+
+	// Called by ResourceManager::Preload on the calling thread whenever a load finished
+	using PreloadProgressFunc = std::function<void(size_t done, size_t total)>;
+
+	class ResourceManager
+	{
+	public:
+		// A worker count of 0 uses the hardware concurrency
+		ResourceManager(std::filesystem::path basePath, uint32_t workerCount = 0);
+		~ResourceManager();
+
+		bool IsValid(ResourceHandleT handle) const;
+		// Paths are relative to the base path, lookups do not allocate
+		ResourceHandleT GetHandle(const ResourcePathView& path) const;
+		ResourceHandleT GetHandle(const ResourceKey& key) const;
+		// Interns the path, the key skips hashing and comparing the path on later lookups
+		ResourceKey GetKey(const ResourcePathView& path);
+		// Interns every path of the table with its precomputed hash
+		// Lookups of its paths afterwards, like "textures/stone.png"_rk, go through the table instead of the path index
+		// Returns the keys in table order, index them with StaticAssetTable::Find
+		std::vector<ResourceKey> RegisterAssets(const StaticAssetTable& table);
+		// 0 if the handle is invalid
+		ResourceTypeId GetTypeId(ResourceHandleT handle) const;
+		std::type_index GetTypeIndex(ResourceHandleT handle) const;
+		// The loader returns a SharedPtr<T> from the path, like a ResourceLoadFunc, or from the path and the file
+		// contents read by the manager, like a ResourceBufferLoadFunc, it is only kept if the resource is created
+		template <typename T, typename Func>
+		Resource<T> GetResource(const ResourcePathView& path, Func&& loader);
+		// Throws std::runtime_error if the resource does not exist yet and T has no default loader
+		template <typename T>
+		Resource<T> GetResource(const ResourcePathView& path);
+		// Also throws std::runtime_error for a key of another manager or one Compact invalidated
+		template <typename T>
+		Resource<T> GetResource(const ResourceKey& key);
+		// Gets many resources with the default loader, locking each shard of the path index only once
+		// The new resources are allocated together, with load set the ones not loaded yet are queued
+		// Throws std::runtime_error before creating any resource if a type has no default loader
+		template <typename T>
+		std::vector<Resource<T>> GetResources(Span<const std::filesystem::path> paths, bool load = false,
+		                                      LoadPriority priority = LoadPriority::Visible);
+		// Resources of different types, each with the default loader of its type
+		std::vector<ResourceHandleT> GetResources(Span<const ResourceRequest> requests, bool load = false,
+		                                          LoadPriority priority = LoadPriority::Visible);
+
+		// Names the type in preload manifests, the type needs a default loader
+		template <typename T>
+		void RegisterTypeTag(std::string tag);
+		/*
+		 * Reads a preload manifest, one resource per line as "<type tag> <path>"
+		 * Paths are relative to the base path and may contain spaces, lines starting with # are comments
+		 * Throws std::runtime_error if the file cannot be read or a tag is not registered
+		 */
+		std::vector<ResourceRequest> ReadManifest(const std::filesystem::path& manifest) const;
+		/*
+		 * Registers the resources and loads them on the worker threads, returns once all loads finished
+		 * At most parallelism loads are queued at a time, 0 queues all of them at once
+		 * Resources which are already loaded are skipped, returns the number of loads which failed
+		 * Pin the resources afterwards to keep them resident under a memory budget
+		 */
+		size_t Preload(Span<const ResourceRequest> requests, uint32_t parallelism = 0,
+		               const PreloadProgressFunc& progress = nullptr);
+		size_t Preload(const std::filesystem::path& manifest, uint32_t parallelism = 0,
+		               const PreloadProgressFunc& progress = nullptr);
+
+		template <typename T>
+		void DeleteResource(const Resource<T>& resource);
+		void MarkForDelete(ResourceHandleT handle);
+
+		template <typename T>
+		SharedPtr<T> GetDefaultResource() const;
+		template <typename T>
+		void SetDefaultResource(const SharedPtr<T>& resource);
+		template <typename T>
+		ResourceLoadFunc<T> GetDefaultLoader() const;
+		// Any callable like a ResourceLoadFunc or ResourceBufferLoadFunc, stored without allocating unless it is large,
+		// see InplaceFunction, all resources of the type share it
+		template <typename T, typename Func>
+		void SetDefaultLoader(Func&& loader);
+		// Uses the constructor for default loader
+		template <typename T>
+		void SetDefaultLoader();
+		// Loads from the file contents, async loads read their files through the manager's FileReader,
+		// which batches the reads into a single submission when built with REKSI_IO_URING
+		template <typename T, typename Func>
+		void SetDefaultBufferLoader(Func&& loader);
+
+		void Reload(ResourceHandleT handle);
+		/*
+		 * The dependency is loaded before the dependent's loader runs, async loads queue the dependencies first
+		 * and the dependent once they finished, so independent branches load concurrently
+		 * Once a reload of the dependency succeeded, its loaded dependents are queued for reload
+		 * Returns false if a handle is invalid or the dependency would close a cycle
+		 */
+		bool AddDependency(ResourceHandleT dependent, ResourceHandleT dependency);
+		void RemoveDependency(ResourceHandleT dependent, ResourceHandleT dependency);
+		std::vector<ResourceHandleT> GetDependencies(ResourceHandleT handle) const;
+		std::vector<ResourceHandleT> GetDependents(ResourceHandleT handle) const;
+		// Bytes of loaded data to keep resident, 0 for no limit
+		// Once a load goes over it, cold unpinned resources are unloaded until the data fits again,
+		// they are reloaded when accessed through GetRef
+		void SetMemoryBudget(size_t bytes);
+		size_t GetMemoryBudget() const;
+		// Bytes of loaded data, as reported by ResourceSize
+		size_t GetResidentBytes() const;
+		// Unloads resources with the CLOCK algorithm until the resident bytes fit the budget
+		void EnforceMemoryBudget();
+		// Walks all resources, holds off deletions and evictions meanwhile
+		ResourceMemoryStats GetMemoryStats() const;
+
+		// Mounts a packed archive, see scripts/build_archive.py, archives mounted later take precedence
+		// Resources with a buffer loader are loaded from the archive when their path is in it, without copying
+		// unless compressed, other loaders keep loading from the base path
+		// Throws std::runtime_error if the archive cannot be read
+		void Mount(const std::filesystem::path& archive);
+		// Decompresses archive entries of the codec's id, LzBlockCodec is registered by default
+		void RegisterCodec(SharedPtr<const BlockCodec> codec);
+
+		// Shrinks the internal tables after mass deletions and frees the interned paths without a resource,
+		// except the ones GetKey or RegisterAssets handed out, keys taken from deleted resources become invalid
+		// Must not run concurrently with any other use of the manager or its resources
+		void Compact();
+		// Queues the load on the worker threads, loading a resource which is already queued
+		// returns the pending load instead of queueing another one, raising its priority if needed
+		LoadFuture LoadAsync(ResourceHandleT handle, LoadPriority priority = LoadPriority::Visible);
+		template <typename T>
+		ResourceFuture<T> LoadAsync(const Resource<T>& resource, LoadPriority priority = LoadPriority::Visible);
+		// Gets the resource using the default loader and queues its load
+		template <typename T>
+		ResourceFuture<T> LoadAsync(const ResourcePathView& path, LoadPriority priority = LoadPriority::Visible);
+
+	private:
+		std::filesystem::path m_BasePath;
+		// Declared before the resources, which report their sizes when destroyed
+		std::atomic<size_t> m_MemoryBudget;
+		std::atomic<size_t> m_ResidentBytes;
+		// Slot index the eviction continues from
+		uint32_t m_ClockHand;
+		// Resources are only released under the shared side, so no resource is destroyed while the unique side is held
+		// Walks over the slots, like eviction passes, hold the unique side to use the data they find
+		REKSI_THREADING_MUTABLE REKSI_MUTEX(m_EvictionMutex);
+		// Interns the names the resources refer to, so declared before them
+		ResourcePathIndex m_ResourcePaths;
+		ResourceSlotMap m_Resources;
+
+		// Indexed by type id, grown when a type without an entry is set
+		std::vector<SharedPtr<void>> m_DefaultResources;
+		std::vector<ResourceData::LoadersPtr> m_DefaultLoaders;
+		std::unordered_map<std::string, ResourceTypeId> m_TypeTags;
+
+		// Edges of the dependency graph, in both directions, by handle
+		std::unordered_map<ResourceHandleT, std::vector<ResourceHandleT>> m_Dependencies;
+		std::unordered_map<ResourceHandleT, std::vector<ResourceHandleT>> m_Dependents;
+		REKSI_THREADING_MUTABLE REKSI_MUTEX(m_DependencyMutex);
+
+		// Mounted archives, in mount order
+		std::vector<SharedPtr<const ResourceArchive>> m_Archives;
+		std::unordered_map<uint32_t, SharedPtr<const BlockCodec>> m_Codecs;
+		REKSI_THREADING_MUTABLE REKSI_MUTEX(m_ArchiveMutex);
+
+		// Worker threads for background loads, declared last so it shuts down first
+		UniquePtr<TaskScheduler> m_Scheduler;
+		// Set while the scheduler is destroyed, loads it cancels must not submit their dependents to it
+		std::atomic<bool> m_ShuttingDown;
+		// Reads files ahead of async loads with a buffer loader, hands them to the scheduler once read
+		UniquePtr<FileReader> m_FileReader;
+
+		// Mutex for default resources, loaders and type tags
+		REKSI_THREADING_MUTABLE REKSI_MUTEX(m_LoaderResourceMutex);
+
+		// Creates the resource, called by the path index while holding the lock of the path's shard
+		// Allocated from the block if given
+		ResourceHandleT CreateResourceImpl(const ResourceKey& key, std::string_view name, ResourceData::LoadersPtr loaders,
+		                                   ResourceTypeId type, ResourceData::AllocationBlock* block = nullptr);
+		// Shared by the batch lookups, create(i, key, name, block) creates the i-th resource if missing
+		template <typename PathFunc, typename CreateFunc>
+		std::vector<ResourceHandleT> GetResourcesImpl(size_t count, PathFunc&& path, CreateFunc&& create, bool load,
+		                                              LoadPriority priority);
+		template <typename T>
+		ResourceData::LoadersPtr GetDefaultLoaderImpl() const;
+		LoadFuture LoadAsyncImpl(ResourceData* data, LoadPriority priority);
+		// Returns the archive holding the path and the index of its entry, nullptr if none does
+		SharedPtr<const ResourceArchive> FindArchived(std::string_view name, uint64_t hash, size_t& index) const;
+		// Bytes refer to the archive, or to the buffer for compressed entries, returns false if decompression failed
+		// Large entries are decompressed block by block on the worker threads
+		bool ReadArchived(const ResourceArchive& archive, size_t index, ByteBuffer& buffer, ByteSpan& bytes) const;
+		// Moves a queued load to the front, returns false if the caller should load inline instead
+		bool PromoteLoad(const SharedPtr<LoadTask>& task);
+		// Drops the edges of a deleted resource
+		void RemoveDependencies(ResourceHandleT handle);
+
+		friend class ResourceData;
+		friend class ResourceWatcher;
+		friend class ReloadCoalescer;
+		template <typename T>
+		friend class ResourceRef;
+	};
+}
+
+
+
+/*
+__        __        _          _                 
+\ \      / /  __ _ | |_   ___ | |__    ___  _ __ 
+ \ \ /\ / /  / _` || __| / __|| '_ \  / _ \| '__|
+  \ V  V /  | (_| || |_ | (__ | | | ||  __/| |   
+   \_/\_/    \__,_| \__| \___||_| |_| \___||_|   
+                                                 
+*/
+
+
+#include <chrono>
+
+#if REKSI_PLATFORM_LINUX == 1
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace Reksi
+{
+	/*
+	 * Debounces change notifications per resource, a resource is reloaded once no change was reported
+	 * for the window, so a file written in several chunks is loaded once
+	 * Due resources are reloaded together as one parallel batch on the manager's worker threads
+	 * A change reported while the resource is reloading gets a trailing reload once the reload in flight finished
+	 */
+	class ReloadCoalescer
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		static constexpr std::chrono::milliseconds DefaultWindow{100};
+
+		// The manager must outlive the coalescer
+		explicit ReloadCoalescer(ResourceManager& manager, std::chrono::milliseconds window = DefaultWindow);
+
+		ReloadCoalescer(const ReloadCoalescer&) = delete;
+		ReloadCoalescer& operator=(const ReloadCoalescer&) = delete;
+
+		// Restarts the window of the resource
+		void Notify(ResourceHandleT handle, Clock::time_point now = Clock::now());
+		// Reloads the loaded resources whose window passed, returns the number of reloads run by this call
+		// Resources deleted meanwhile are skipped, a resource deleted while reloading waits for the reload
+		size_t Flush(Clock::time_point now = Clock::now());
+		// Time until the next window passes, rounded up, negative if nothing is pending
+		std::chrono::milliseconds GetTimeUntilNext(Clock::time_point now = Clock::now()) const;
+		size_t GetPendingCount() const;
+
+	private:
+		ResourceManager& m_Manager;
+		const Clock::duration m_Window;
+		// End of the window of every resource with pending changes
+		std::unordered_map<ResourceHandleT, Clock::time_point> m_Pending;
+
+		REKSI_THREADING_MUTABLE REKSI_MUTEX_AUTO;
+	};
+
+	/*
+	 * Reloads loaded resources when their files under the manager's base path change
+	 * On Linux one inotify watch per directory covers all of its files, so a single thread serves any number
+	 * of resources, events are mapped back to handles through the path index
+	 * Elsewhere the write times of the loaded resources are polled every interval instead
+	 * Resources must be registered by their path relative to the base path, e.g. "textures/wall.png"
+	 * Changes go through a ReloadCoalescer, so a save in several writes reloads the resource once
+	 *
+	 * ResourceWatcher watcher(manager);
+	 */
+	class ResourceWatcher
+	{
+	public:
+		static constexpr std::chrono::milliseconds DefaultInterval{500};
+
+		// The manager must outlive the watcher, the interval is only used when polling write times
+		// Throws std::runtime_error if the base path cannot be watched
+		explicit ResourceWatcher(ResourceManager& manager,
+		                         std::chrono::milliseconds debounce = ReloadCoalescer::DefaultWindow,
+		                         std::chrono::milliseconds interval = DefaultInterval);
+		~ResourceWatcher();
+
+		ResourceWatcher(const ResourceWatcher&) = delete;
+		ResourceWatcher& operator=(const ResourceWatcher&) = delete;
+
+		// Waits up to the timeout for changes, or until the next debounce window passed, and reloads the resources
+		// which are due, returns the number of reloads, a negative timeout waits for the next change
+		// Called by the watcher's thread, only call it yourself with REKSI_THREADING disabled
+		size_t Poll(std::chrono::milliseconds timeout);
+
+	private:
+		ResourceManager& m_Manager;
+		ReloadCoalescer m_Coalescer;
+		std::chrono::milliseconds m_Interval;
+		std::atomic<bool> m_Stopping;
+#if REKSI_THREADING == 1
+		std::thread m_Thread;
+#endif
+
+#if REKSI_PLATFORM_LINUX == 1
+		int m_Inotify;
+		// Signalled to wake the thread up when stopping
+		int m_WakeEvent;
+		// Directory of every watch, relative to the base path
+		std::unordered_map<int, std::string> m_Directories;
+
+		// Watches the directory and the ones below it, directories which cannot be watched are skipped
+		void AddDirectories(const std::string& relative);
+#else
+		REKSI_MUTEX_AUTO;
+		REKSI_CV_AUTO;
+		// Last seen write time of every loaded resource
+		std::unordered_map<ResourceHandleT, std::filesystem::file_time_type> m_WriteTimes;
+#endif
+
+		// Handles of all loaded resources, for when the changes are not known
+		std::vector<ResourceHandleT> GetLoadedResources() const;
+		// Shortens the timeout to the next debounce window
+		std::chrono::milliseconds GetWaitTime(std::chrono::milliseconds timeout) const;
+	};
+}
+
+
+
+/*
+  ____                             _    _              
+ / ___|  ___   _ __   ___   _   _ | |_ (_) _ __    ___ 
+| |     / _ \ | '__| / _ \ | | | || __|| || '_ \  / _ \
+| |___ | (_) || |   | (_) || |_| || |_ | || | | ||  __/
+ \____| \___/ |_|    \___/  \__,_| \__||_||_| |_| \___|
+                                                       
+*/
+
+
+#if REKSI_COROUTINES == 1
+namespace Reksi
+{
+	// Awaiter for an untyped LoadFuture, yields the load status
+	// The coroutine is resumed on the thread completing the load
+	class LoadFutureAwaiter
+	{
+	public:
+		explicit LoadFutureAwaiter(LoadFuture future);
+
+		bool await_ready() const;
+		bool await_suspend(std::coroutine_handle<> handle);
+		ResourceLoadStatus await_resume() const;
+
+	private:
+		LoadFuture m_Future;
+	};
+
+	// Awaiter for a Resource or ResourceFuture, yields the data like Resource::TryGetRef
+	// The coroutine is resumed on the thread completing the load
+	template <typename T>
+	class ResourceAwaiter
+	{
+	public:
+		explicit ResourceAwaiter(Resource<T> resource);
+		explicit ResourceAwaiter(ResourceFuture<T> future);
+
+		bool await_ready() const;
+		bool await_suspend(std::coroutine_handle<> handle);
+		SharedPtr<T> await_resume();
+
+	private:
+		Resource<T> m_Resource;
+		LoadFuture m_Future;
+	};
+
+	LoadFutureAwaiter operator co_await(LoadFuture future);
+	// co_await manager.LoadAsync<T>(path)
+	template <typename T>
+	ResourceAwaiter<T> operator co_await(ResourceFuture<T> future);
+	// co_await resource, loads the resource if it is neither loaded nor loading
+	template <typename T>
+	ResourceAwaiter<T> operator co_await(Resource<T> resource);
+}
+#endif
+
+
+
+/*
+ ____          __  _         _  _    _                    
+|  _ \   ___  / _|(_) _ __  (_)| |_ (_)  ___   _ __   ___ 
+| | | | / _ \| |_ | || '_ \ | || __|| | / _ \ | '_ \ / __|
+| |_| ||  __/|  _|| || | | || || |_ | || (_) || | | |\__ \
+|____/  \___||_|  |_||_| |_||_| \__||_| \___/ |_| |_||___/
+                                                          
+*/
+
+#pragma region Defer
+namespace Reksi
+{
+	constexpr uint64_t HashResourcePath(std::string_view path)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for ( const char c : path )
+		{
+			hash ^= static_cast<uint8_t>(c);
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	inline namespace Literals
+	{
+		REKSI_CONSTEVAL ResourcePathLiteral operator""_rk(const char* path, size_t size)
+		{
+			return ResourcePathLiteral{std::string_view{path, size}, HashResourcePath(std::string_view{path, size})};
+		}
+	}
+
+	inline bool ResourceKey::IsValid() const
+	{
+		return Index != InvalidIndex;
+	}
+
+	inline bool ResourceKey::operator==(const ResourceKey& other) const
+	{
+		return Index == other.Index;
+	}
+
+	inline bool ResourceKey::operator!=(const ResourceKey& other) const
+	{
+		return Index != other.Index;
+	}
+
+	inline ResourcePathView::ResourcePathView(const char* path)
+		: ResourcePathView(std::string_view{path})
+	{
+	}
+
+	inline ResourcePathView::ResourcePathView(std::string_view path)
+		: m_Path(path), m_Hash(HashResourcePath(path))
+	{
+	}
+
+	inline ResourcePathView::ResourcePathView(const std::string& path)
+		: ResourcePathView(std::string_view{path})
+	{
+	}
+
+	inline ResourcePathView::ResourcePathView(const std::filesystem::path& path)
+	{
+		if constexpr ( std::is_same_v<std::filesystem::path::value_type, char> )
+		{
+			m_Path = path.native();
+		}
+		else
+		{
+			m_Storage = path.generic_string();
+			m_Path = m_Storage;
+		}
+
+		m_Hash = HashResourcePath(m_Path);
+	}
+
+	inline ResourcePathView::ResourcePathView(const ResourcePathLiteral& path)
+		: m_Path(path.Path), m_Hash(path.Hash)
+	{
+	}
+
+	inline std::string_view ResourcePathView::GetString() const
+	{
+		return m_Path;
+	}
+
+	inline uint64_t ResourcePathView::GetHash() const
+	{
+		return m_Hash;
+	}
+}
+#pragma endregion
+
+
+#pragma region Defer
+namespace Reksi
+{
+	constexpr StaticAssetTable::StaticAssetTable(const ResourcePathLiteral* paths, size_t count,
+	                                             const uint32_t* displacements, size_t bucketCount,
+	                                             const uint32_t* slots, size_t slotCount)
+		: m_Paths(paths),
+		  m_Count(count),
+		  m_Displacements(displacements),
+		  m_BucketCount(bucketCount),
+		  m_Slots(slots),
+		  m_SlotCount(slotCount)
+	{
+	}
+
+	constexpr size_t StaticAssetTable::Find(const ResourcePathLiteral& path) const
+	{
+		return FindHashed(path.Path, path.Hash);
+	}
+
+	constexpr size_t StaticAssetTable::Find(std::string_view path) const
+	{
+		return FindHashed(path, HashResourcePath(path));
+	}
+
+	constexpr size_t StaticAssetTable::GetCount() const
+	{
+		return m_Count;
+	}
+
+	constexpr const ResourcePathLiteral& StaticAssetTable::operator[](size_t index) const
+	{
+		return m_Paths[index];
+	}
+
+	constexpr uint64_t StaticAssetTable::Mix(uint64_t hash, uint32_t displacement)
+	{
+		// splitmix64 finalizer
+		uint64_t x = hash ^ (static_cast<uint64_t>(displacement) * 0x9E3779B97F4A7C15ull);
+		x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+		x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+		return x ^ (x >> 31);
+	}
+
+	constexpr size_t StaticAssetTable::FindHashed(std::string_view path, uint64_t hash) const
+	{
+		if ( m_Count == 0 ) return NotFound;
+
+		const uint32_t displacement = m_Displacements[(hash >> 32) % m_BucketCount];
+		const uint32_t index = m_Slots[Mix(hash, displacement) % m_SlotCount];
+		if ( index >= m_Count ) return NotFound;
+
+		const ResourcePathLiteral& entry = m_Paths[index];
+		if ( entry.Hash != hash || entry.Path != path ) return NotFound;
+		return index;
+	}
+}
+#pragma endregion
+
+
+#pragma region Defer
+namespace Reksi
+{
+#if REKSI_PLATFORM_WINDOWS == 1
+	inline MappedFile::MappedFile(const std::filesystem::path& path)
+		: m_Data(nullptr), m_Size(0), m_Mapping(nullptr)
+	{
+		const HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		                                FILE_ATTRIBUTE_NORMAL, nullptr);
+		if ( file == INVALID_HANDLE_VALUE )
+		{
+			throw std::runtime_error("MappedFile: Failed to open file");
+		}
+
+		LARGE_INTEGER size;
+		if ( !GetFileSizeEx(file, &size) )
+		{
+			CloseHandle(file);
+			throw std::runtime_error("MappedFile: Failed to get the file size");
+		}
+		m_Size = static_cast<size_t>(size.QuadPart);
+
+		// Empty files cannot be mapped
+		if ( m_Size > 0 )
+		{
+			m_Mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if ( m_Mapping )
+			{
+				m_Data = static_cast<const std::byte*>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+			}
+		}
+
+		// The mapping keeps the file open
+		CloseHandle(file);
+
+		if ( m_Size > 0 && !m_Data )
+		{
+			if ( m_Mapping ) CloseHandle(m_Mapping);
+			throw std::runtime_error("MappedFile: Failed to map file");
+		}
+	}
+
+	inline MappedFile::~MappedFile()
+	{
+		if ( m_Data ) UnmapViewOfFile(m_Data);
+		if ( m_Mapping ) CloseHandle(m_Mapping);
+	}
+#elif REKSI_PLATFORM_POSIX == 1
+	inline MappedFile::MappedFile(const std::filesystem::path& path)
+		: m_Data(nullptr), m_Size(0)
+	{
+		const int file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if ( file < 0 )
+		{
+			throw std::runtime_error("MappedFile: Failed to open file");
+		}
+
+		struct stat info;
+		if ( fstat(file, &info) != 0 )
+		{
+			close(file);
+			throw std::runtime_error("MappedFile: Failed to get the file size");
+		}
+		m_Size = static_cast<size_t>(info.st_size);
+
+		// Empty files cannot be mapped
+		void* data = nullptr;
+		if ( m_Size > 0 )
+		{
+			data = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, file, 0);
+		}
+
+		// The mapping keeps the file open
+		close(file);
+
+		if ( data == MAP_FAILED )
+		{
+			throw std::runtime_error("MappedFile: Failed to map file");
+		}
+		m_Data = static_cast<const std::byte*>(data);
+	}
+
+	inline MappedFile::~MappedFile()
+	{
+		if ( m_Data ) munmap(const_cast<std::byte*>(m_Data), m_Size);
+	}
+#else
+	// No mapping support, read the whole file instead
+	inline MappedFile::MappedFile(const std::filesystem::path& path)
+		: m_Data(nullptr), m_Size(0)
+	{
+		std::ifstream stream(path, std::ios::in | std::ios::binary | std::ios::ate);
+		if ( !stream )
+		{
+			throw std::runtime_error("MappedFile: Failed to open file");
+		}
+
+		m_Size = static_cast<size_t>(stream.tellg());
+		stream.seekg(0, std::ios::beg);
+
+		auto data = new std::byte[m_Size];
+		stream.read(reinterpret_cast<char*>(data), static_cast<std::streamsize>(m_Size));
+		m_Data = data;
+	}
+
+	inline MappedFile::~MappedFile()
+	{
+		delete[] m_Data;
+	}
+#endif
+
+	inline ByteSpan MappedFile::GetBytes() const
+	{
+		return ByteSpan{m_Data, m_Size};
+	}
+
+	inline const std::byte* MappedFile::GetData() const
+	{
+		return m_Data;
+	}
+
+	inline size_t MappedFile::GetSize() const
+	{
+		return m_Size;
+	}
+
+	inline size_t MappedFile::GetResourceSize() const
+	{
+		return sizeof(MappedFile) + m_Size;
+	}
+}
+#pragma endregion
+
+
+#pragma region Defer
+namespace Reksi
+{
+	inline bool FileReader::Read(const std::filesystem::path& path, ByteBuffer& buffer)
+	{
+		buffer.clear();
+
+#if REKSI_PLATFORM_POSIX == 1
+		const int file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if ( file < 0 ) return false;
+
+		struct stat info;
+		if ( fstat(file, &info) != 0 )
+		{
+			close(file);
+			return false;
+		}
+
+		buffer.resize(static_cast<size_t>(info.st_size));
+		size_t offset = 0;
+		while ( offset < buffer.size() )
+		{
+			const ssize_t count = read(file, buffer.data() + offset, buffer.size() - offset);
+			if ( count < 0 && errno == EINTR ) continue;
+			if ( count <= 0 ) break;
+			offset += static_cast<size_t>(count);
+		}
+
+		close(file);
+		// Errors and files which shrank in the meantime fail, like with the io_uring reader
+		if ( offset < buffer.size() )
+		{
+			buffer.clear();
+			return false;
+		}
+		return true;
+#else
+		std::ifstream stream(path, std::ios::in | std::ios::binary | std::ios::ate);
+		if ( !stream ) return false;
+
+		buffer.resize(static_cast<size_t>(stream.tellg()));
+		stream.seekg(0, std::ios::beg);
+		stream.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+		if ( !stream || static_cast<size_t>(stream.gcount()) != buffer.size() )
+		{
+			buffer.clear();
+			return false;
+		}
+		return true;
+#endif
+	}
+
+	inline UniquePtr<FileReader> FileReader::Create(uint32_t threadCount)
+	{
+#if REKSI_IO_URING == 1
+		try
+		{
+			return CreateUnique<IoUringFileReader>();
+		}
+		catch ( const std::runtime_error& )
+		{
+			// Fall back to the thread pool, e.g. io_uring disabled by the kernel or a sandbox
+		}
+#endif
+
+		return CreateUnique<ThreadPoolFileReader>(threadCount == 0 ? ThreadPoolFileReader::DefaultThreadCount : threadCount);
+	}
+
+	inline ThreadPoolFileReader::ThreadPoolFileReader([[maybe_unused]] uint32_t threadCount)
+		: m_Stopping(false)
+	{
+#if REKSI_THREADING == 1
+		m_Threads.reserve(threadCount);
+		for ( uint32_t i = 0; i < threadCount; ++i )
+		{
+			m_Threads.emplace_back([this] { ThreadLoop(); });
+		}
+#endif
+	}
+
+	inline ThreadPoolFileReader::~ThreadPoolFileReader()
+	{
+		{
+			REKSI_LOCK_UNIQUE_AUTO;
+
+			m_Stopping = true;
+		}
+
+		REKSI_CV_NOTIFY_ALL_AUTO;
+
+#if REKSI_THREADING == 1
+		for ( auto& thread : m_Threads )
+		{
+			thread.join();
+		}
+#endif
+	}
+
+	inline void ThreadPoolFileReader::ReadAsync(std::filesystem::path path, FileReadCallback callback)
+	{
+#if REKSI_THREADING == 1
+		{
+			REKSI_LOCK_UNIQUE_AUTO;
+
+			m_Requests.push_back(Request{std::move(path), std::move(callback)});
+		}
+
+		REKSI_CV_NOTIFY_ONE_AUTO;
+#else
+		ByteBuffer buffer;
+		const bool success = Read(path, buffer);
+		callback(std::move(buffer), success);
+#endif
+	}
+
+	inline void ThreadPoolFileReader::ThreadLoop()
+	{
+		while ( true )
+		{
+			Request request;
+
+			{
+				REKSI_LOCK_UNIQUE_AUTO;
+
+				REKSI_CV_WAIT_AUTO([&] { return m_Stopping || !m_Requests.empty(); });
+				// Queued reads are finished before stopping
+				if ( m_Requests.empty() ) return;
+
+				request = std::move(m_Requests.front());
+				m_Requests.pop_front();
+			}
+
+			ByteBuffer buffer;
+			const bool success = Read(request.Path, buffer);
+			request.Callback(std::move(buffer), success);
+		}
+	}
+
+#if REKSI_IO_URING == 1
+	inline IoUringFileReader::IoUringFileReader(uint32_t entries)
+		: m_SqRing(MAP_FAILED), m_CqRing(MAP_FAILED), m_Sqes(nullptr), m_Stopping(false)
+	{
+		io_uring_params params;
+		std::memset(&params, 0, sizeof(params));
+
+		m_Ring = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+		if ( m_Ring < 0 )
+		{
+			throw std::runtime_error("IoUringFileReader: io_uring_setup failed");
+		}
+
+		m_Entries = params.sq_entries;
+		m_SqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		m_CqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+		const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+		if ( single_mmap ) m_SqRingSize = m_CqRingSize = std::max(m_SqRingSize, m_CqRingSize);
+
+		m_SqRing = mmap(nullptr, m_SqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_Ring,
+		                IORING_OFF_SQ_RING);
+		m_CqRing = single_mmap
+			           ? m_SqRing
+			           : mmap(nullptr, m_CqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_Ring,
+			                  IORING_OFF_CQ_RING);
+		void* sqes = mmap(nullptr, params.sq_entries * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE,
+		                  MAP_SHARED | MAP_POPULATE, m_Ring, IORING_OFF_SQES);
+
+		if ( m_SqRing == MAP_FAILED || m_CqRing == MAP_FAILED || sqes == MAP_FAILED )
+		{
+			if ( sqes != MAP_FAILED ) munmap(sqes, params.sq_entries * sizeof(io_uring_sqe));
+			if ( m_CqRing != MAP_FAILED && m_CqRing != m_SqRing ) munmap(m_CqRing, m_CqRingSize);
+			if ( m_SqRing != MAP_FAILED ) munmap(m_SqRing, m_SqRingSize);
+			close(m_Ring);
+			throw std::runtime_error("IoUringFileReader: Failed to map the rings");
+		}
+
+		const auto sq = static_cast<char*>(m_SqRing);
+		const auto cq = static_cast<char*>(m_CqRing);
+		m_Sqes = static_cast<io_uring_sqe*>(sqes);
+		m_SqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+		m_SqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+		m_SqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+		m_CqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+		m_CqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+		m_CqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+		m_Cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+		m_Thread = std::thread([this] { ThreadLoop(); });
+	}
+
+	inline IoUringFileReader::~IoUringFileReader()
+	{
+		{
+			REKSI_LOCK_UNIQUE_AUTO;
+
+			m_Stopping = true;
+		}
+
+		REKSI_CV_NOTIFY_ALL_AUTO;
+		m_Thread.join();
+
+		munmap(m_Sqes, m_Entries * sizeof(io_uring_sqe));
+		if ( m_CqRing != m_SqRing ) munmap(m_CqRing, m_CqRingSize);
+		munmap(m_SqRing, m_SqRingSize);
+		// Cancels whatever the ring still holds
+		close(m_Ring);
+
+		for ( Request* request : m_Abandoned )
+		{
+			if ( request->File >= 0 ) close(request->File);
+			delete request;
+		}
+	}
+
+	inline void IoUringFileReader::ReadAsync(std::filesystem::path path, FileReadCallback callback)
+	{
+		auto request = new Request;
+		request->Path = std::move(path);
+		request->Callback = std::move(callback);
+
+		{
+			REKSI_LOCK_UNIQUE_AUTO;
+
+			m_Queued.push_back(request);
+		}
+
+		REKSI_CV_NOTIFY_ONE_AUTO;
+	}
+
+	inline void IoUringFileReader::ThreadLoop()
+	{
+		// Requests waiting for room in the ring, moving to their next step first
+		std::deque<Request*> backlog;
+		// Every request prepared in the ring and not finished yet
+		std::unordered_set<Request*> active;
+		uint32_t in_flight = 0;
+		uint32_t unsubmitted = 0;
+
+		while ( true )
+		{
+			{
+				REKSI_LOCK_UNIQUE_AUTO;
+
+				if ( in_flight == 0 && unsubmitted == 0 && backlog.empty() )
+				{
+					REKSI_CV_WAIT_AUTO([&] { return m_Stopping || !m_Queued.empty(); });
+					// Queued reads are finished before stopping
+					if ( m_Queued.empty() ) return;
+				}
+
+				backlog.insert(backlog.end(), m_Queued.begin(), m_Queued.end());
+				m_Queued.clear();
+			}
+
+			// Completions never overflow as long as in flight entries fit the submission ring
+			while ( !backlog.empty() && in_flight + unsubmitted < m_Entries )
+			{
+				Prepare(backlog.front());
+				active.insert(backlog.front());
+				backlog.pop_front();
+				++unsubmitted;
+			}
+
+			// Submits everything prepared and waits for at least one completion
+			const int submitted = static_cast<int>(syscall(__NR_io_uring_enter, m_Ring, unsubmitted, 1,
+			                                               IORING_ENTER_GETEVENTS, nullptr, 0));
+			if ( submitted < 0 )
+			{
+				if ( errno == EINTR || errno == EAGAIN || errno == EBUSY ) continue;
+
+				// Throwing would terminate the process, fail over to plain reads instead
+				// The ring may still write to the requests it holds, so they are kept until it is closed
+				for ( Request* request : backlog )
+				{
+					active.erase(request);
+					FinishInline(request);
+				}
+				for ( Request* request : active )
+				{
+					ByteBuffer buffer;
+					const bool success = Read(request->Path, buffer);
+					request->Callback(std::move(buffer), success);
+					m_Abandoned.push_back(request);
+				}
+
+				ThreadLoopInline();
+				return;
+			}
+			unsubmitted -= static_cast<uint32_t>(submitted);
+			in_flight += static_cast<uint32_t>(submitted);
+
+			unsigned head = *m_CqHead;
+			const unsigned tail = __atomic_load_n(m_CqTail, __ATOMIC_ACQUIRE);
+			for ( ; head != tail; ++head )
+			{
+				const io_uring_cqe& cqe = m_Cqes[head & *m_CqMask];
+				const auto request = reinterpret_cast<Request*>(cqe.user_data);
+				--in_flight;
+
+				// Steps of one file follow each other, the next step joins the next submission
+				if ( Advance(request, cqe.res) )
+				{
+					backlog.push_front(request);
+				}
+				else
+				{
+					active.erase(request);
+				}
+			}
+			__atomic_store_n(m_CqHead, head, __ATOMIC_RELEASE);
+		}
+	}
+
+	inline void IoUringFileReader::Prepare(Request* request)
+	{
+		static const char empty_path[] = "";
+
+		const unsigned tail = *m_SqTail;
+		const unsigned index = tail & *m_SqMask;
+		io_uring_sqe& sqe = m_Sqes[index];
+		std::memset(&sqe, 0, sizeof(sqe));
+		sqe.user_data = reinterpret_cast<uint64_t>(request);
+
+		switch ( request->Step )
+		{
+		case Stage::Open:
+			sqe.opcode = IORING_OP_OPENAT;
+			sqe.fd = AT_FDCWD;
+			sqe.addr = reinterpret_cast<uint64_t>(request->Path.c_str());
+			sqe.open_flags = O_RDONLY | O_CLOEXEC;
+			break;
+		case Stage::Stat:
+			sqe.opcode = IORING_OP_STATX;
+			sqe.fd = request->File;
+			sqe.addr = reinterpret_cast<uint64_t>(empty_path);
+			sqe.statx_flags = AT_EMPTY_PATH;
+			sqe.len = STATX_SIZE;
+			sqe.off = reinterpret_cast<uint64_t>(&request->Stat);
+			break;
+		case Stage::Read:
+			// Reads are capped at 1 GiB, larger files take several
+			sqe.opcode = IORING_OP_READ;
+			sqe.fd = request->File;
+			sqe.addr = reinterpret_cast<uint64_t>(request->Buffer.data() + request->Offset);
+			sqe.len = static_cast<uint32_t>(std::min<size_t>(request->Buffer.size() - request->Offset, 1u << 30));
+			sqe.off = request->Offset;
+			break;
+		}
+
+		m_SqArray[index] = index;
+		__atomic_store_n(m_SqTail, tail + 1, __ATOMIC_RELEASE);
+	}
+
+	inline bool IoUringFileReader::Advance(Request* request, int result)
+	{
+		if ( result < 0 )
+		{
+			// Kernels lacking one of the operations are served by a plain read
+			if ( result == -EINVAL || result == -EOPNOTSUPP )
+			{
+				if ( request->File >= 0 ) close(request->File);
+				request->File = -1;
+				Finish(request, Read(request->Path, request->Buffer));
+			}
+			else
+			{
+				Finish(request, false);
+			}
+			return false;
+		}
+
+		switch ( request->Step )
+		{
+		case Stage::Open:
+			request->File = result;
+			request->Step = Stage::Stat;
+			return true;
+		case Stage::Stat:
+			request->Buffer.resize(static_cast<size_t>(request->Stat.stx_size));
+			if ( request->Buffer.empty() ) break;
+			request->Step = Stage::Read;
+			return true;
+		case Stage::Read:
+			// The file shrank in the meantime, fails like a plain read
+			if ( result == 0 )
+			{
+				Finish(request, false);
+				return false;
+			}
+			request->Offset += static_cast<size_t>(result);
+			if ( request->Offset < request->Buffer.size() ) return true;
+			break;
+		}
+
+		Finish(request, true);
+		return false;
+	}
+
+	inline void IoUringFileReader::Finish(Request* request, bool success)
+	{
+		const UniquePtr<Request> owned{request};
+		if ( owned->File >= 0 ) close(owned->File);
+
+		if ( !success ) owned->Buffer.clear();
+		owned->Callback(std::move(owned->Buffer), success);
+	}
+
+	inline void IoUringFileReader::FinishInline(Request* request)
+	{
+		if ( request->File >= 0 ) close(request->File);
+		request->File = -1;
+
+		const bool success = Read(request->Path, request->Buffer);
+		Finish(request, success);
+	}
+
+	inline void IoUringFileReader::ThreadLoopInline()
+	{
+		while ( true )
+		{
+			std::deque<Request*> queued;
+
+			{
+				REKSI_LOCK_UNIQUE_AUTO;
+
+				REKSI_CV_WAIT_AUTO([&] { return m_Stopping || !m_Queued.empty(); });
+				// Queued reads are finished before stopping
+				if ( m_Queued.empty() ) return;
+
+				queued.swap(m_Queued);
+			}
+
+			for ( Request* request : queued )
+			{
+				FinishInline(request);
+			}
+		}
+	}
+#endif
+}
+#pragma endregion
+
+
+#pragma region Defer
+namespace Reksi
+{
+	inline uint32_t LzBlockCodec::GetId() const
+	{
+		return Id;
+	}
+
+	inline bool LzBlockCodec::Decompress(ByteSpan input, std::byte* output, size_t outputSize) const
+	{
+		const std::byte* in = input.data();
+		const std::byte* inEnd = in + input.size();
+		std::byte* out = output;
+		std::byte* const outEnd = output + outputSize;
+
+		while ( in < inEnd )
+		{
+			const auto token = static_cast<uint8_t>(*in++);
+
+			size_t literals = token >> 4;
+			if ( literals == 15 && !ReadLength(in, inEnd, literals) ) return false;
+			if ( literals > static_cast<size_t>(inEnd - in) || literals > static_cast<size_t>(outEnd - out) ) return false;
+
+			std::memcpy(out, in, literals);
+			in += literals;
+			out += literals;
+
+			// The last sequence ends after its literals
+			if ( in == inEnd ) break;
+
+			if ( inEnd - in < 2 ) return false;
+			const size_t offset = static_cast<size_t>(in[0]) | static_cast<size_t>(in[1]) << 8;
+			in += 2;
+
+			size_t length = token & 15;
+			if ( length == 15 && !ReadLength(in, inEnd, length) ) return false;
+			length += MinMatch;
+
+			if ( offset == 0 || offset > static_cast<size_t>(out - output) ||
+				length > static_cast<size_t>(outEnd - out) )
+			{
+				return false;
+			}
+
+			// Matches may overlap the bytes they produce
+			const std::byte* match = out - offset;
+			if ( offset >= length )
+			{
+				std::memcpy(out, match, length);
+				out += length;
+			}
+			else
+			{
+				for ( size_t i = 0; i < length; ++i )
+				{
+					*out++ = match[i];
+				}
+			}
+		}
+
+		return out == outEnd;
+	}
+
+	inline bool LzBlockCodec::ReadLength(const std::byte*& in, const std::byte* end, size_t& length)
+	{
+		while ( true )
+		{
+			if ( in == end ) return false;
+
+			const auto byte = static_cast<uint8_t>(*in++);
+			length += byte;
+			if ( byte != 255 ) return true;
+		}
+	}
+}
+#pragma endregion
+
+
+#pragma region Defer
+namespace Reksi
+{
+	inline ResourceArchive::ResourceArchive(const std::filesystem::path& path)
+		: m_File(path), m_Entries(nullptr), m_Count(0), m_Names(nullptr)
+	{
+		const std::byte* data = m_File.GetData();
+		const size_t size = m_File.GetSize();
+
+		Header header;
+		if ( size < sizeof(Header) )
+		{
+			throw std::runtime_error("ResourceArchive: File too small");
+		}
+		std::memcpy(&header, data, sizeof(Header));
+
+		if ( std::string_view{header.Magic, 4} != "RKAR" || header.Version != Version )
+		{
+			throw std::runtime_error("ResourceArchive: Not an archive or unsupported version");
+		}
+
+		// The index is used in place, the mapping itself is page aligned
+		if ( header.IndexOffset % alignof(Entry) != 0 || header.IndexOffset > size ||
+			(size - header.IndexOffset) / sizeof(Entry) < header.EntryCount || header.NamesOffset > size )
+		{
+			throw std::runtime_error("ResourceArchive: Malformed index");
+		}
+
+		m_Entries = reinterpret_cast<const Entry*>(data + header.IndexOffset);
+		m_Count = header.EntryCount;
+		m_Names = reinterpret_cast<const char*>(data + header.NamesOffset);
+
+		// Check everything once, so lookups can trust the index
+		for ( size_t i = 0; i < m_Count; ++i )
+		{
+			const Entry& entry = m_Entries[i];
+			if ( entry.Offset > size || entry.StoredSize > size - entry.Offset ||
+				header.NamesOffset + entry.NameOffset + entry.NameSize > size ||
+				(i > 0 && m_Entries[i - 1].Hash > entry.Hash) )
+			{
+				throw std::runtime_error("ResourceArchive: Malformed entry");
+			}
+
+			// Block contents are checked when decompressing
+			const bool compressed = entry.Codec != 0;
+			if ( compressed ? entry.BlockSize == 0 || GetBlockCount(i) > entry.StoredSize / sizeof(uint32_t)
+			                : entry.StoredSize != entry.Size )
+			{
+				throw std::runtime_error("ResourceArchive: Malformed entry");
+			}
+		}
+	}
+
+	inline size_t ResourceArchive::Find(std::string_view path) const
+	{
+		return Find(path, HashResourcePath(path));
+	}
+
+	inline size_t ResourceArchive::Find(std::string_view path, uint64_t hash) const
+	{
+		const Entry* end = m_Entries + m_Count;
+		const Entry* entry = std::lower_bound(m_Entries, end, hash, [](const Entry& e, uint64_t h)
+		{
+			return e.Hash < h;
+		});
+
+		// Colliding hashes are next to each other
+		for ( ; entry != end && entry->Hash == hash; ++entry )
+		{
+			const auto index = static_cast<size_t>(entry - m_Entries);
+			if ( GetPath(index) == path ) return index;
+		}
+
+		return NotFound;
+	}
+
+	inline size_t ResourceArchive::GetCount() const
+	{
+		return m_Count;
+	}
+
+	inline std::string_view ResourceArchive::GetPath(size_t index) const
+	{
+		assert(index < m_Count);
+
+		return std::string_view{m_Names + m_Entries[index].NameOffset, m_Entries[index].NameSize};
+	}
+
+	inline const ResourceArchive::Entry& ResourceArchive::GetEntry(size_t index) const
+	{
+		assert(index < m_Count);
+
+		return m_Entries[index];
+	}
+
+	inline ByteSpan ResourceArchive::GetBytes(size_t index) const
+	{
+		assert(index < m_Count);
+
+		return ByteSpan{m_File.GetData() + m_Entries[index].Offset, static_cast<size_t>(m_Entries[index].StoredSize)};
+	}
+
+	inline bool ResourceArchive::IsCompressed(size_t index) const
+	{
+		assert(index < m_Count);
+
+		return m_Entries[index].Codec != 0;
+	}
+
+	inline size_t ResourceArchive::GetBlockCount(size_t index) const
+	{
+		assert(index < m_Count);
+
+		const Entry& entry = m_Entries[index];
+		if ( entry.Codec == 0 ) return 1;
+		return static_cast<size_t>((entry.Size + entry.BlockSize - 1) / entry.BlockSize);
+	}
+
+	inline bool ResourceArchive::DecompressBlock(size_t index, size_t block, const BlockCodec& codec,
+	                                             std::byte* output) const
+	{
+		assert(IsCompressed(index) && block < GetBlockCount(index));
+
+		const Entry& entry = m_Entries[index];
+		const ByteSpan stored = GetBytes(index);
+		const size_t tableSize = GetBlockCount(index) * sizeof(uint32_t);
+
+		// The payload is not necessarily aligned for uint32
+		uint32_t begin = 0;
+		uint32_t end;
+		if ( block > 0 ) std::memcpy(&begin, stored.data() + (block - 1) * sizeof(uint32_t), sizeof(uint32_t));
+		std::memcpy(&end, stored.data() + block * sizeof(uint32_t), sizeof(uint32_t));
+		if ( begin > end || end > stored.size() - tableSize ) return false;
+
+		const uint64_t offset = static_cast<uint64_t>(block) * entry.BlockSize;
+		const auto size = static_cast<size_t>(std::min<uint64_t>(entry.BlockSize, entry.Size - offset));
+		const ByteSpan input{stored.data() + tableSize + begin, end - begin};
+
+		// Blocks which did not compress are stored as is
+		if ( input.size() == size )
+		{
+			std::memcpy(output + offset, input.data(), size);
+			return true;
+		}
+
+		return codec.Decompress(input, output + offset, size);
+	}
+}
+#pragma endregion
+
+
+#pragma region Defer
+namespace Reksi
+{
+	inline EpochDomain::Guard::Guard()
+		: m_Slot(&Get().GetThreadSlot())
+	{
+		// Published before the caller loads any pointer, sequentially consistent like the writers' swaps
+		if ( m_Slot->Depth++ == 0 ) m_Slot->Epoch.store(Get().m_Epoch.load());
+	}
+
+	inline EpochDomain::Guard::~Guard()
+	{
+		if ( --m_Slot->Depth == 0 ) m_Slot->Epoch.store(0, std::memory_order_release);
+	}
+
+	inline EpochDomain& EpochDomain::Get()
+	{
+		static EpochDomain* domain = new EpochDomain;
+		return *domain;
+	}
+
+	template <typename T>
+	void EpochDomain::Retire(T* object)
+	{
+		if ( !object ) return;
+
+		{
+			// The object was unlinked before, so readers entering from now on cannot see it
+			const uint64_t epoch = m_Epoch.fetch_add(1);
+
+			REKSI_LOCK_UNIQUE_AUTO;
+			m_Retired.push_back(Retired{object, [](void* retired) { delete static_cast<T*>(retired); }, epoch});
+		}
+
+		Collect();
+	}
+
+	inline void EpochDomain::Collect()
+	{
+		uint64_t oldest = ~0ull;
+		for ( const Slot* slot = m_Slots.load(); slot; slot = slot->Next )
+		{
+			const uint64_t epoch = slot->Epoch.load();
+			if ( epoch != 0 && epoch < oldest ) oldest = epoch;
+		}
+
+		std::vector<Retired> expired;
+
+		{
+			REKSI_LOCK_UNIQUE_AUTO;
+
+			const auto it = std::partition(m_Retired.begin(), m_Retired.end(), [oldest](const Retired& retired)
+			{
+				return retired.Epoch >= oldest;
+			});
+			expired.assign(it, m_Retired.end());
+			m_Retired.erase(it, m_Retired.end());
+		}
+
+		// Deleted outside the lock, destructors may retire objects themselves
+		for ( const Retired& retired : expired )
+		{
+			retired.Delete(retired.Object);
+		}
+	}
+
+	inline EpochDomain::Slot& EpochDomain::GetThreadSlot()
+	{
+		thread_local ThreadSlot thread;
+		if ( thread.Owned ) return *thread.Owned;
+
+		// Take over the slot of an exited thread
+		for ( Slot* slot = m_Slots.load(); slot; slot = slot->Next )
+		{
+			bool inUse = false;
+			if ( slot->InUse.compare_exchange_strong(inUse, true) )
+			{
+				thread.Owned = slot;
+				return *slot;
+			}
+		}
+
+		auto slot = new Slot;
+		slot->InUse.store(true, std::memory_order_relaxed);
+		slot->Next = m_Slots.load();
+		while ( !m_Slots.compare_exchange_weak(slot->Next, slot) )
+		{
+		}
+
+		thread.Owned = slot;
+		return *slot;
+	}
+
+	inline EpochDomain::ThreadSlot::~ThreadSlot()
+	{
+		if ( Owned ) Owned->InUse.store(false, std::memory_order_release);
+	}
+}
+#pragma endregion
+
+
+#pragma region Defer
+namespace Reksi
+{
+	template <typename R, typename... Args, size_t Capacity>
+	template <typename F>
+	const typename InplaceFunction<R(Args...), Capacity>::VTable
+	InplaceFunction<R(Args...), Capacity>::InPlaceVTable = {
+		[](void* storage, Args&&... args) -> R
+		{
+			return std::invoke(*static_cast<F*>(storage), std::forward<Args>(args)...);
+		},
+		[](void* destination, void* source) noexcept
+		{
+			new(destination) F(std::move(*static_cast<F*>(source)));
+			static_cast<F*>(source)->~F();
+		},
+		[](void* storage) noexcept
+		{
+			static_cast<F*>(storage)->~F();
+		}
+	};
+
+	template <typename R, typename... Args, size_t Capacity>
+	template <typename F>
+	const typename InplaceFunction<R(Args...), Capacity>::VTable
+	InplaceFunction<R(Args...), Capacity>::HeapVTable = {
+		[](void* storage, Args&&... args) -> R
+		{
+			return std::invoke(**static_cast<F**>(storage), std::forward<Args>(args)...);
+		},
+		[](void* destination, void* source) noexcept
+		{
+			new(destination) F*(*static_cast<F**>(source));
+		},
+		[](void* storage) noexcept
+		{
+			delete *static_cast<F**>(storage);
+		}
+	};
+
+	template <typename R, typename... Args, size_t Capacity>
+	InplaceFunction<R(Args...), Capacity>::InplaceFunction(std::nullptr_t)
+	{
+	}
+
+	template <typename R, typename... Args, size_t Capacity>
+	template <typename F, typename>
+	InplaceFunction<R(Args...), Capacity>::InplaceFunction(F&& function)
+	{
+		using Stored = std::decay_t<F>;
+
+		// Empty function pointers and std::functions stay empty
+		if constexpr ( std::is_constructible_v<bool, const Stored&> )
+		{
+			const Stored& stored = function;
+			if ( !static_cast<bool>(stored) ) return;
+		}
+
+		if constexpr ( IsInPlace<Stored> )
+		{
+			new(m_Storage) Stored(std::forward<F>(function));
+			m_VTable = &InPlaceVTable<Stored>;
+		}
+		else
+		{
+			new(m_Storage) Stored*(new Stored(std::forward<F>(function)));
+			m_VTable = &HeapVTable<Stored>;
+		}
+	}
+
+	template <typename R, typename... Args, size_t Capacity>
+	InplaceFunction<R(Args...), Capacity>::InplaceFunction(InplaceFunction&& other) noexcept
+		: m_VTable(other.m_VTable)
+	{
+		if ( !m_VTable ) return;
+
+		m_VTable->Relocate(m_Storage, other.m_Storage);
+		other.m_VTable = nullptr;
+	}
+
+	template <typename R, typename... Args, size_t Capacity>
+	InplaceFunction<R(Args...), Capacity>& InplaceFunction<R(Args...), Capacity>::operator=(
+		InplaceFunction&& other) noexcept
+	{
+		if ( this == &other ) return *this;
+
+		Reset();
+		if ( !other.m_VTable ) return *this;
+
+		m_VTable = other.m_VTable;
+		m_VTable->Relocate(m_Storage, other.m_Storage);
+		other.m_VTable = nullptr;
+		return *this;
+	}
+
+	template <typename R, typename... Args, size_t Capacity>
+	InplaceFunction<R(Args...), Capacity>::~InplaceFunction()
+	{
+		Reset();
+	}
+
+	template <typename R, typename... Args, size_t Capacity>
+	R InplaceFunction<R(Args...), Capacity>::operator()(Args... args) const
+	{
+		assert(m_VTable);
+
+		return m_VTable->Invoke(m_Storage, std::forward<Args>(args)...);
+	}
+
+	template <typename R, typename... Args, size_t Capacity>
+	InplaceFunction<R(Args...), Capacity>::operator bool() const
+	{
+		return m_VTable != nullptr;
+	}
+
+	template <typename R, typename... Args, size_t Capacity>
+	void InplaceFunction<R(Args...), Capacity>::Reset()
+	{
+		if ( !m_VTable ) return;
+
+		m_VTable->Destroy(m_Storage);
+		m_VTable = nullptr;
+	}
+}
+#pragma endregion
+
+
+#pragma region Defer
+namespace Reksi
+{
+	template <typename T>
+	ResourceTypeId GetResourceTypeId()
+	{
+		// Registered by type_index, so const T and T from another module share the id
+		static const ResourceTypeId id = ResourceTypeRegistry::Register(typeid(T));
+		return id;
+	}
+
+	inline ResourceTypeId ResourceTypeRegistry::Register(std::type_index type)
+	{
+		ResourceTypeRegistry& registry = Get();
+		REKSI_LOCK_UNIQUE(registry.m_Mutex, lock);
+
+		const auto itr = std::find(registry.m_Types.begin(), registry.m_Types.end(), type);
+		if ( itr != registry.m_Types.end() ) return static_cast<ResourceTypeId>(itr - registry.m_Types.begin()) + 1;
+
+		registry.m_Types.push_back(type);
+		return static_cast<ResourceTypeId>(registry.m_Types.size());
+	}
+
+	inline std::type_index ResourceTypeRegistry::GetTypeIndex(ResourceTypeId id)
+	{
+		ResourceTypeRegistry& registry = Get();
+		REKSI_LOCK_SHARED(registry.m_Mutex, lock);
+
+		if ( id == 0 || id > registry.m_Types.size() ) return typeid(void);
+		return registry.m_Types[id - 1];
+	}
+
+	inline ResourceTypeId ResourceTypeRegistry::GetEnd()
+	{
+		ResourceTypeRegistry& registry = Get();
+		REKSI_LOCK_SHARED(registry.m_Mutex, lock);
+
+		return static_cast<ResourceTypeId>(registry.m_Types.size()) + 1;
+	}
+
+	inline ResourceTypeRegistry& ResourceTypeRegistry::Get()
+	{
+		static ResourceTypeRegistry* registry = new ResourceTypeRegistry;
+		return *registry;
+	}
+}
+#pragma endregion
+
+
+#pragma region Defer
+// Implementation
+namespace Reksi
+{
+	inline ResourceData::ResourceData(ResourceHandleT handle, ResourceKey key, std::string_view name, LoadersPtr loaders,
+	                                  ResourceManager* creator, ResourceTypeId typeId)
+		: m_Handle(handle),
+		  m_Key(key),
+		  m_Name(name),
+		  m_Loaders(std::move(loaders)),
+		  m_Data(nullptr),
+		  m_Version(0),
+		  m_Size(0),
+		  m_PinCount(0),
+		  m_Referenced(false),
+		  m_Listeners(nullptr),
+		  m_Creator(creator),
+		  m_TypeId(typeId)
+	{
+	}
+
+	inline ResourceStatus ResourceData::GetStatus() const
+	{
+		REKSI_LOCK_SHARED_AUTO;
+		return m_Status;
+	}
+
+	inline bool ResourceData::IsState(ResourceStatus::States state) const
+	{
+		REKSI_LOCK_SHARED_AUTO;
+		return static_cast<bool>(state & m_Status.State);
+	}
+
+	inline ResourceLoadStatus ResourceData::Load()
+	{
+		return Load(nullptr);
+	}
+
+	inline ResourceLoadStatus ResourceData::Load(ByteBuffer* prefetched)
+	{
+		// Internal Load
+		const RLS status = LoadInternal(prefetched);
+		// Notify listeners
+		NotifyListenersOnLoadComplete(status);
+		// Let the manager unload cold resources if this load went over the memory budget
+		if ( status.Is(RLS::Success) ) EnforceMemoryBudget();
+		// Dependents built from the old data are reloaded as well
+		if ( status.Is(RLS::Success) && status.Is(RLS::Reloaded) ) ReloadDependents();
+		// The file changed again while loading, the data may already be stale
+		if ( TakeReloadMark() ) return Load(nullptr);
+
+		// Return status
+		return status;
+	}
+
+	inline ResourceUnloadStatus ResourceData::Unload()
+	{
+		// Internal Unload
+		const ResourceUnloadStatus status = UnloadInternal();
+		// Notify listeners
+		NotifyListenersOnUnloadComplete(status);
+
+		// TODO: Notify the resource manager as well
+
+		// Return status
+		return status;
+	}
+
+	template <typename T>
+	SharedPtr<T> ResourceData::GetData()
+	{
+		{
+			// If data is loaded, return it without touching the lock
+			// Read once, an unload or eviction right after the check would otherwise leave nothing to return
+			EpochDomain::Guard guard;
+
+			if ( const SharedPtr<void>* data = m_Data.load() )
+			{
+				MarkReferenced();
+				return GetDataInternal<T>(data);
+			}
+		}
+
+		// Pinned until handed out, so the memory budget cannot unload it right after the load
+		Pin();
+		LoadOrWaitForPending();
+
+		{
+			// Return the data
+			REKSI_LOCK_UNIQUE_AUTO;
+
+			--m_PinCount;
+			return GetDataInternal<T>(m_Data.load());
+		}
+	}
+
+	template <typename T>
+	SharedPtr<T> ResourceData::GetDataIfLoaded()
+	{
+		EpochDomain::Guard guard;
+
+		const SharedPtr<void>* data = m_Data.load();
+		if ( !data ) return nullptr;
+		MarkReferenced();
+		return GetDataInternal<T>(data);
+	}
+
+	template <typename T>
+	T* ResourceData::BorrowData(bool load)
+	{
+		if ( m_TypeId != GetResourceTypeId<T>() )
+		{
+			throw std::runtime_error("ResourceData::BorrowData: Type mismatch");
+		}
+
+		const SharedPtr<void>* data = m_Data.load();
+		if ( !data && load )
+		{
+			// Pinned until read, versions published after entering the guard are protected by it as well
+			Pin();
+			LoadOrWaitForPending();
+			data = m_Data.load();
+			Unpin();
+		}
+		if ( !data ) return nullptr;
+
+		MarkReferenced();
+		return static_cast<T*>(data->get());
+	}
+
+	inline bool ResourceData::ContinueAfterLoad(LoadContinuation continuation)
+	{
+		REKSI_LOCK_UNIQUE_AUTO;
+
+		if ( !m_Status.Is(RS::Loading) ) return false;
+
+		m_LoadContinuations.emplace_back(std::move(continuation));
+		return true;
+	}
+
+	template <typename T>
+	SharedPtr<T> ResourceData::GetDataInternal(const SharedPtr<void>* data)
+	{
+		if ( m_TypeId != GetResourceTypeId<T>() )
+		{
+			throw std::runtime_error("ResourceData::GetDataInternal: Type mismatch");
+		}
+
+		return data ? StaticSharedCast<T>(*data) : nullptr;
+	}
+
+	inline void ResourceData::MarkReferenced()
+	{
+		if ( !m_Referenced.load(std::memory_order_relaxed) ) m_Referenced.store(true, std::memory_order_relaxed);
+	}
+
+	inline SharedPtr<void>* ResourceData::ExchangeData(SharedPtr<void>* data)
+	{
+		m_Version.fetch_add(1, std::memory_order_relaxed);
+		// Sequentially consistent, so readers entering a guard afterwards cannot see the previous version
+		return m_Data.exchange(data);
+	}
+
+	inline uint32_t ResourceData::GetVersion() const
+	{
+		return m_Version.load(std::memory_order_relaxed);
+	}
+
+	inline void ResourceData::AddListener(ResourceListener* listener)
+	{
+		UpdateListeners([listener](ListenerList& listeners)
+		{
+			listeners.push_back(listener);
+		});
+	}
+
+	inline void ResourceData::RemoveListener(ResourceListener* listener)
+	{
+		UpdateListeners([listener](ListenerList& listeners)
+		{
+			listeners.erase(std::remove(listeners.begin(), listeners.end(), listener), listeners.end());
+		});
+	}
+
+	inline void ResourceData::ClearListeners()
+	{
+		UpdateListeners([](ListenerList& listeners)
+		{
+			listeners.clear();
+		});
+	}
+
+	inline void ResourceData::AddListeners(const ListenerList& listeners)
+	{
+		UpdateListeners([&added = listeners](ListenerList& listeners)
+		{
+			listeners.insert(listeners.end(), added.begin(), added.end());
+		});
+	}
+
+	inline void ResourceData::WaitUntilCurrentLoading()
+	{
+		REKSI_LOCK_UNIQUE_AUTO;
+
+		REKSI_CV_WAIT_AUTO([&] { return !m_Status.Is(ResourceStatus::Loading); });
+	}
+
+	inline std::string_view ResourceData::GetName() const
+	{
+		return m_Name;
+	}
+
+	inline ResourceKey ResourceData::GetKey() const
+	{
+		return m_Key;
+	}
+
+	template <typename T>
+	ResourceLoadFunc<T> ResourceData::GetLoader() const
+	{
+		if ( m_TypeId != GetResourceTypeId<T>() )
+		{
+			throw std::runtime_error("ResourceData::GetLoader: Type mismatch");
+		}
+
+		return MakeLoadFunc<T>(m_Loaders);
+	}
+
+	inline ResourceHandleT ResourceData::GetHandle() const
+	{
+		REKSI_LOCK_SHARED_AUTO;
+
+		return m_Handle;
+	}
+
+	inline ResourceTypeId ResourceData::GetTypeId() const
+	{
+		return m_TypeId;
+	}
+
+	inline std::type_index ResourceData::GetTypeIndex() const
+	{
+		return ResourceTypeRegistry::GetTypeIndex(m_TypeId);
+	}
+
+	inline size_t ResourceData::GetSize() const
+	{
+		REKSI_LOCK_SHARED_AUTO;
+
+		return m_Size;
+	}
+
+	inline void ResourceData::Pin()
+	{
+		REKSI_LOCK_UNIQUE_AUTO;
+
+		++m_PinCount;
+	}
+
+	inline void ResourceData::Unpin()
+	{
+		REKSI_LOCK_UNIQUE_AUTO;
+
+		assert(m_PinCount > 0);
+		--m_PinCount;
+	}
+
+	inline bool ResourceData::IsPinned() const
+	{
+		REKSI_LOCK_SHARED_AUTO;
+
+		return m_PinCount > 0;
+	}
+
+	inline ResourceData::~ResourceData()
+	{
+		NotifyListenersBeforeDeleting();
+
+		SharedPtr<LoadTask> cancelled;
+
+		{
+			REKSI_LOCK_UNIQUE_AUTO;
+			m_Status.Set(RS::MarkedForDelete).Clear(RS::MarkedForReload);
+
+			// A queued background load which nobody picked up yet is cancelled
+			if ( m_PendingLoad && m_PendingLoad->Claim() )
+			{
+				cancelled = std::move(m_PendingLoad);
+				m_Status.Clear(RS::Queued);
+			}
+
+			// Otherwise wait for the worker running it to let go of this resource
+			REKSI_CV_WAIT_AUTO([&] { return !m_Status.Is(ResourceStatus::Loading) && !m_PendingLoad; });
+		}
+
+		if ( cancelled )
+		{
+			cancelled->Complete(RLS().Set(RLS::MarkedForDelete));
+		}
+
+		// A ResourceView borrowed on another thread may still read the data, it only holds a guard
+		EpochDomain::Get().Retire(m_Data.exchange(nullptr));
+		// Notifications only run from this resource's own calls, none is left by now
+		delete m_Listeners.exchange(nullptr);
+		UpdateResidentSize(m_Size, 0);
+	}
+
+	inline SharedPtr<const ResourceData::ListenerList> ResourceData::GetListeners() const
+	{
+		// Only held while taking a reference, listeners may run for long and add or remove listeners themselves
+		EpochDomain::Guard guard;
+
+		const SharedPtr<const ListenerList>* listeners = m_Listeners.load();
+		return listeners ? *listeners : nullptr;
+	}
+
+	template <typename Func>
+	void ResourceData::UpdateListeners(Func&& update)
+	{
+		SharedPtr<const ListenerList>* retired;
+
+		{
+			REKSI_LOCK_UNIQUE_AUTO;
+
+			const SharedPtr<const ListenerList>* current = m_Listeners.load(std::memory_order_relaxed);
+			ListenerList listeners = current ? **current : ListenerList{};
+			update(listeners);
+
+			SharedPtr<const ListenerList>* next = nullptr;
+			if ( !listeners.empty() )
+			{
+				next = new SharedPtr<const ListenerList>(CreateShared<const ListenerList>(std::move(listeners)));
+			}
+			retired = m_Listeners.exchange(next);
+		}
+
+		// Notifications in flight keep their snapshot alive through the reference they took
+		EpochDomain::Get().Retire(retired);
+	}
+
+	inline void ResourceData::NotifyListenersOnLoadComplete(ResourceLoadStatus status)
+	{
+		const SharedPtr<const ListenerList> listeners = GetListeners();
+		if ( !listeners ) return;
+
+		for ( const auto listener : *listeners )
+		{
+			listener->OnLoadComplete(*this, status);
+		}
+	}
+
+	inline void ResourceData::NotifyListenersOnUnloadComplete(ResourceUnloadStatus status)
+	{
+		const SharedPtr<const ListenerList> listeners = GetListeners();
+		if ( !listeners ) return;
+
+		for ( const auto listener : *listeners )
+		{
+			listener->OnUnloadComplete(*this, status);
+		}
+	}
+
+
+	inline void ResourceData::NotifyListenersBeforeDeleting()
+	{
+		const SharedPtr<const ListenerList> listeners = GetListeners();
+		if ( !listeners ) return;
+
+		for ( const auto listener : *listeners )
+		{
+			listener->BeforeDeleting(*this);
+		}
+	}
+
+	inline void ResourceData::SetState(ResourceStatus::States state)
+	{
+		// Writes the status, readers hold the shared lock
+		REKSI_LOCK_UNIQUE_AUTO;
+
+		m_Status.Set(state);
+	}
+
+	inline void ResourceData::ClearState(ResourceStatus::States state)
+	{
+		REKSI_LOCK_UNIQUE_AUTO;
+
+		m_Status.Clear(state);
+	}
+
+	inline bool ResourceData::TakeReloadMark()
+	{
+		REKSI_LOCK_UNIQUE_AUTO;
+
+		// A load started since clears the mark itself
+		if ( !m_Status.Is(RS::MarkedForReload) || m_Status.Is(RS::Loading) || m_Status.Is(RS::MarkedForDelete) )
+		{
+			return false;
+		}
+
+		m_Status.Clear(RS::MarkedForReload);
+		return true;
+	}
+
+	/*
+	 * If not loaded, goes ahead and loads the resource
+	 * If loading on another thread, waits for the load to complete
+	 * If already loaded, reloads the resource
+	 * If reloading on another thread, returns immediately and marks it for reload,
+	 * the reloading thread then reloads it once more after finishing
+	 */
+	inline ResourceLoadStatus ResourceData::LoadInternal(ByteBuffer* prefetched)
+	{
+		RLS out;
+		// Queued background load taken over by this call
+		SharedPtr<LoadTask> claimed;
+		std::vector<LoadContinuation> continuations;
+
+		{
+			REKSI_LOCK_UNIQUE_AUTO;
+
+			// Resource is marked for delete
+			if ( m_Status.Is(RS::MarkedForDelete) )
+			{
+				return out.Set(RLS::MarkedForDelete);
+			}
+			// Resource is previously not loaded and loading, wait for load to complete
+			if ( !m_Status.Is(RS::Loaded) && m_Status.Is(RS::Loading) )
+			{
+				REKSI_CV_WAIT_AUTO([&] { return !m_Status.Is(RS::Loading); });
+				if ( m_Status.Is(RS::Loaded) ) out.Set(RLS::Success);
+				return out.Set(RLS::WaitedForLoad);
+			}
+			// Resource is previously loaded and loading, the reload in flight may have missed the latest change
+			if ( m_Status.Is(RS::Loaded) && m_Status.Is(RS::Loading) )
+			{
+				m_Status.Set(RS::MarkedForReload);
+				return out.Set(RLS::AlreadyReloading).Set(RLS::Reloaded);
+			}
+
+			// If already loaded
+			if ( m_Status.Is(RS::Loaded) )
+			{
+				out.Set(RLS::Reloaded);
+			}
+			// Take over a queued background load, so it is not performed twice
+			if ( m_PendingLoad && m_PendingLoad->Claim() )
+			{
+				claimed = std::move(m_PendingLoad);
+			}
+
+			m_Status.Set(RS::Loading).Clear(RS::MarkedForReload).Clear(RS::Queued);
+		}
+
+		// Load the resource, buffer loaders read archived resources from the mapped archive
+		// The loader only runs once all dependencies are loaded
+		// A throwing loader fails the load like one returning nullptr, the state below must be restored either way,
+		// otherwise waiters block forever and the exception would terminate a worker thread
+		SharedPtr<void> data;
+		size_t size = 0;
+		try
+		{
+			if ( LoadDependencies() )
+			{
+				if ( prefetched && m_Loaders->LoadBuffer )
+				{
+					data = m_Loaders->LoadBuffer(GetPath(), ByteSpan{prefetched->data(), prefetched->size()});
+				}
+				else if ( !m_Loaders->LoadBuffer || !LoadFromArchive(data) )
+				{
+					data = m_Loaders->LoadFile(GetPath());
+				}
+			}
+			if ( data ) size = m_Loaders->SizeOf(data.get());
+		}
+		catch ( ... )
+		{
+			data = nullptr;
+			out.Set(RLS::LoaderThrew);
+		}
+		size_t old_size = 0;
+		SharedPtr<void>* retired = nullptr;
+
+		{
+			REKSI_LOCK_UNIQUE_AUTO;
+
+			m_Status.Clear(RS::Loading);
+
+			// In case of load failure, clear the loading state
+			if ( data )
+			{
+				retired = ExchangeData(new SharedPtr<void>(data));
+				old_size = m_Size;
+				m_Size = size;
+				m_Status.Set(RS::Loaded);
+				m_Referenced.store(true, std::memory_order_relaxed);
+				out.Set(RLS::Success);
+			}
+
+			continuations.swap(m_LoadContinuations);
+		}
+
+		// Readers of the previous version keep it alive until they leave their guards
+		EpochDomain::Get().Retire(retired);
+		if ( data ) UpdateResidentSize(old_size, size);
+
+		// Loading is complete, send Condition Variable signal
+		REKSI_CV_NOTIFY_ALL_AUTO;
+
+		if ( claimed )
+		{
+			claimed->Complete(out);
+		}
+
+		for ( const auto& continuation : continuations )
+		{
+			continuation(out);
+		}
+
+		return out;
+	}
+
+	inline ResourceUnloadStatus ResourceData::UnloadInternal()
+	{
+		size_t old_size;
+		SharedPtr<void>* retired;
+
+		{
+			REKSI_LOCK_UNIQUE_AUTO;
+
+			retired = ExchangeData(nullptr);
+			m_Status.Clear(ResourceStatus::Loaded);
+			old_size = m_Size;
+			m_Size = 0;
+		}
+
+		EpochDomain::Get().Retire(retired);
+		UpdateResidentSize(old_size, 0);
+		return ResourceUnloadStatus::Success;
+	}
+
+	inline bool ResourceData::TryEvict()
+	{
+		// Second chance for resources used since the clock hand last passed
+		if ( m_Referenced.exchange(false, std::memory_order_relaxed) ) return false;
+
+		size_t old_size;
+		SharedPtr<void>* retired;
+
+		{
+			REKSI_LOCK_UNIQUE_AUTO;
+
+			if ( !m_Status.Is(RS::Loaded) || m_Status.Is(RS::Loading) || m_PinCount > 0 ) return false;
+
+			retired = ExchangeData(nullptr);
+			m_Status.Clear(RS::Loaded);
+			old_size = m_Size;
+			m_Size = 0;
+		}
+
+		EpochDomain::Get().Retire(retired);
+
+		UpdateResidentSize(old_size, 0);
+		return true;
+	}
+
+	inline SharedPtr<void> ResourceData::Loaders::LoadFile(const std::filesystem::path& path) const
+	{
+		if ( Load ) return Load(path);
+		// Given an empty loader, fails the load like calling an empty std::function
+		if ( !LoadBuffer ) throw std::bad_function_call();
+
+		// Synchronous loads read the file on the calling thread
+		ByteBuffer buffer;
+		if ( !FileReader::Read(path, buffer) ) return nullptr;
+		return LoadBuffer(path, ByteSpan{buffer.data(), buffer.size()});
+	}
+
+	template <typename T, typename Func>
+	ResourceData::LoadersPtr ResourceData::MakeLoaders(Func&& loader)
+	{
+		static_assert(std::is_invocable_r_v<SharedPtr<T>, Func&, const std::filesystem::path&> ||
+		              std::is_invocable_r_v<SharedPtr<T>, Func&, const std::filesystem::path&, ByteSpan>,
+		              "The loader must return a SharedPtr<T> from a path, or from a path and the file contents");
+
+		auto loaders = CreateShared<Loaders>();
+		if constexpr ( std::is_invocable_r_v<SharedPtr<T>, Func&, const std::filesystem::path&, ByteSpan> )
+		{
+			loaders->LoadBuffer = BufferLoadFunc{std::forward<Func>(loader)};
+		}
+		else
+		{
+			loaders->Load = LoadFunc{std::forward<Func>(loader)};
+		}
+		loaders->SizeOf = &SizeOf<T>;
+		return loaders;
+	}
+
+	template <typename T>
+	ResourceLoadFunc<T> ResourceData::MakeLoadFunc(LoadersPtr loaders)
+	{
+		if ( !loaders ) return nullptr;
+
+		// Only allocates here, when the loader is handed out
+		return [loaders = std::move(loaders)](const std::filesystem::path& path) -> SharedPtr<T>
+		{
+			return StaticSharedCast<T>(loaders->LoadFile(path));
+		};
+	}
+
+	inline ResourceData::AllocationBlock* ResourceData::AllocationBlock::Create(size_t capacity)
+	{
+		void* memory = ::operator new(AlignAllocation(sizeof(AllocationBlock)) + capacity * GetAllocationSize());
+		auto block = new(memory) AllocationBlock;
+		block->References.store(1, std::memory_order_relaxed);
+		block->Used = 0;
+		block->Capacity = capacity;
+		return block;
+	}
+
+	inline void ResourceData::AllocationBlock::Release()
+	{
+		if ( References.fetch_sub(1, std::memory_order_acq_rel) != 1 ) return;
+
+		this->~AllocationBlock();
+		::operator delete(this);
+	}
+
+	inline ResourceData* ResourceData::Create(AllocationBlock* block, ResourceHandleT handle, ResourceKey key,
+	                                          std::string_view name, LoadersPtr loaders, ResourceManager* creator,
+	                                          ResourceTypeId typeId)
+	{
+		void* memory = Allocate(block);
+		try
+		{
+			return ::new(memory) ResourceData{handle, key, name, std::move(loaders), creator, typeId};
+		}
+		catch ( ... )
+		{
+			Deallocate(memory);
+			throw;
+		}
+	}
+
+	inline void* ResourceData::Allocate(AllocationBlock* block)
+	{
+		AllocationHeader* header;
+		if ( block )
+		{
+			assert(block->Used < block->Capacity);
+
+			auto slots = reinterpret_cast<std::byte*>(block) + AlignAllocation(sizeof(AllocationBlock));
+			header = reinterpret_cast<AllocationHeader*>(slots + block->Used++ * GetAllocationSize());
+			block->References.fetch_add(1, std::memory_order_relaxed);
+		}
+		else
+		{
+			header = static_cast<AllocationHeader*>(::operator new(GetAllocationSize()));
+		}
+
+		header->Block = block;
+		return header + 1;
+	}
+
+	inline void ResourceData::operator delete(void* memory)
+	{
+		Deallocate(memory);
+	}
+
+	inline void ResourceData::Deallocate(void* memory)
+	{
+		if ( !memory ) return;
+
+		auto header = static_cast<AllocationHeader*>(memory) - 1;
+		if ( header->Block )
+		{
+			header->Block->Release();
+		}
+		else
+		{
+			::operator delete(header);
+		}
+	}
+
+	constexpr size_t ResourceData::AlignAllocation(size_t size)
+	{
+		constexpr size_t align = alignof(AllocationHeader);
+		return (size + align - 1) / align * align;
+	}
+
+	constexpr size_t ResourceData::GetAllocationSize()
+	{
+		static_assert(alignof(ResourceData) <= alignof(AllocationHeader));
+
+		return sizeof(AllocationHeader) + AlignAllocation(sizeof(ResourceData));
+	}
+
+	inline bool ResourceData::HasBufferLoader() const
+	{
+		return static_cast<bool>(m_Loaders->LoadBuffer);
+	}
+
+	template <typename T>
+	size_t ResourceData::SizeOf(const void* data)
+	{
+		return ResourceSize<T>::Get(*static_cast<const T*>(data));
+	}
+
+	inline SharedPtr<LoadTask> ResourceData::GetPendingLoad() const
+	{
+		REKSI_LOCK_SHARED_AUTO;
+
+		return m_PendingLoad;
+	}
+
+	inline SharedPtr<LoadTask> ResourceData::GetOrCreatePendingLoad(bool& created)
+	{
+		created = false;
+
+		{
+			REKSI_LOCK_UNIQUE_AUTO;
+
+			// Coalesce with the load which is already queued
+			if ( m_PendingLoad ) return m_PendingLoad;
+
+			if ( !m_Status.Is(RS::MarkedForDelete) )
+			{
+				m_PendingLoad = CreateShared<LoadTask>(this);
+				m_Status.Set(RS::Queued);
+				created = true;
+				return m_PendingLoad;
+			}
+		}
+
+		// Resource is marked for delete, hand out an already completed task
+		auto task = CreateShared<LoadTask>(nullptr);
+		task->Complete(RLS().Set(RLS::MarkedForDelete));
+		return task;
+	}
+
+	inline void ResourceData::LoadClaimed(const SharedPtr<LoadTask>& task)
+	{
+		{
+			REKSI_LOCK_UNIQUE_AUTO;
+
+			// Another thread is loading already, complete from its completion path instead of blocking the worker
+			if ( !m_Status.Is(RS::Loaded) && m_Status.Is(RS::Loading) )
+			{
+				if ( m_PendingLoad == task )
+				{
+					m_PendingLoad.reset();
+					m_Status.Clear(RS::Queued);
+				}
+
+				m_LoadContinuations.emplace_back([task](RLS status)
+				{
+					task->Complete(status.Set(RLS::WaitedForLoad));
+				});
+
+				REKSI_CV_NOTIFY_ALL_AUTO;
+				return;
+			}
+		}
+
+		ByteBuffer buffer;
+		const bool prefetched = task->TakePrefetched(buffer);
+		const RLS status = Load(prefetched ? &buffer : nullptr);
+		ReleasePendingLoad(task.get());
+		task->Complete(status);
+	}
+
+	inline void ResourceData::ReleasePendingLoad(LoadTask* task)
+	{
+		REKSI_LOCK_UNIQUE_AUTO;
+
+		if ( m_PendingLoad.get() == task )
+		{
+			m_PendingLoad.reset();
+			m_Status.Clear(RS::Queued);
+		}
+
+		// Notify while holding the lock, a waiting destructor may free this resource right after
+		REKSI_CV_NOTIFY_ALL_AUTO;
+	}
+
+	inline ResourceStatus& ResourceStatus::Set(States state)
+	{
+		State |= state;
+		return *this;
+	}
+
+	inline bool ResourceStatus::Is(States state) const
+	{
+		return static_cast<bool>(this->State & state);
+	}
+
+	inline ResourceStatus& ResourceStatus::Clear(States state)
+	{
+		State &= ~state;
+		return *this;
+	}
+
+	inline ResourceLoadStatus& ResourceLoadStatus::Set(States state)
+	{
+		State |= state;
+		return *this;
+	}
+
+	inline bool ResourceLoadStatus::Is(States state) const
+	{
+		return static_cast<bool>(this->State & state);
+	}
+
+	inline ResourceLoadStatus& ResourceLoadStatus::Clear(States state)
+	{
+		State &= ~state;
+		return *this;
+	}
+}
+#pragma endregion
+
+
+#pragma region Defer
+namespace Reksi
+{
+	inline thread_local const TaskScheduler* TaskScheduler::s_CurrentScheduler = nullptr;
+	inline thread_local uint32_t TaskScheduler::s_CurrentWorker = 0;
+
+	inline LoadPriority SchedulerTask::GetPriority() const
+	{
+		return static_cast<LoadPriority>(m_Priority.load(std::memory_order_relaxed));
+	}
+
+	inline bool SchedulerTask::TryTake()
+	{
+		return !m_Taken.exchange(true, std::memory_order_acq_rel);
+	}
+
+	inline bool SchedulerTask::Raise(LoadPriority priority)
+	{
+		auto current = m_Priority.load(std::memory_order_relaxed);
+		while ( static_cast<uint8_t>(priority) < current )
+		{
+			if ( m_Priority.compare_exchange_weak(current, static_cast<uint8_t>(priority)) ) return true;
+		}
+		return false;
+	}
+
+	inline TaskScheduler::TaskScheduler([[maybe_unused]] uint32_t workerCount)
+		: m_QueuedCount(0), m_NextQueue(0), m_Stopping(false)
+	{
+#if REKSI_THREADING == 1
+		if ( workerCount == 0 )
+		{
+			workerCount = std::max(1u, std::thread::hardware_concurrency());
+		}
+
+		m_Queues.reserve(workerCount);
+		for ( uint32_t i = 0; i < workerCount; ++i )
+		{
+			m_Queues.emplace_back(CreateUnique<WorkerQueue>());
+		}
+
+		m_Workers.reserve(workerCount);
+		for ( uint32_t i = 0; i < workerCount; ++i )
+		{
+			m_Workers.emplace_back([this, i] { WorkerLoop(i); });
+		}
+#endif
+	}
+
+	inline TaskScheduler::~TaskScheduler()
+	{
+		{
+			REKSI_LOCK_UNIQUE_AUTO;
+
+			m_Stopping = true;
+		}
+
+		REKSI_CV_NOTIFY_ALL_AUTO;
+
+#if REKSI_THREADING == 1
+		for ( auto& worker : m_Workers )
+		{
+			worker.join();
+		}
+#endif
+
+		// Tasks which never got picked up are cancelled, so that anyone waiting on them is released
+		// Taken out of the queues first, cancelling may complete continuations which submit more work
+		std::vector<SharedPtr<SchedulerTask>> queued;
+		for ( const auto& queue : m_Queues )
+		{
+			REKSI_LOCK(queue->REKSI_MUTEX_AUTO_NAME, lock);
+
+			for ( auto& tasks : queue->Tasks )
+			{
+				queued.insert(queued.end(), std::make_move_iterator(tasks.begin()), std::make_move_iterator(tasks.end()));
+				tasks.clear();
+			}
+		}
+
+		for ( const auto& task : queued )
+		{
+			if ( task->TryTake() ) task->Cancel();
+		}
+	}
+
+	inline void TaskScheduler::Submit(SharedPtr<SchedulerTask> task, LoadPriority priority)
+	{
+		task->m_Priority.store(static_cast<uint8_t>(priority), std::memory_order_relaxed);
+
+#if REKSI_THREADING == 1
+		if ( Push(task, priority) ) return;
+
+		if ( task->TryTake() ) task->Cancel();
+#else
+		if ( task->TryTake() ) task->Execute();
+#endif
+	}
+
+	inline void TaskScheduler::Promote(const SharedPtr<SchedulerTask>& task, LoadPriority priority)
+	{
+		if ( task->m_Taken.load(std::memory_order_acquire) || !task->Raise(priority) ) return;
+
+		// The entry at the old priority stays behind and is skipped once the task was taken
+		Push(task, priority);
+	}
+
+	inline uint32_t TaskScheduler::GetWorkerCount() const
+	{
+#if REKSI_THREADING == 1
+		return static_cast<uint32_t>(m_Workers.size());
+#else
+		return 0;
+#endif
+	}
+
+	inline bool TaskScheduler::IsWorkerThread() const
+	{
+		return s_CurrentScheduler == this;
+	}
+
+#if REKSI_THREADING == 1
+	class TaskScheduler::ParallelPart : public SchedulerTask
+	{
+	public:
+		struct Group
+		{
+			const std::function<void(size_t)>* Body;
+			size_t Remaining;
+			REKSI_MUTEX_AUTO;
+			REKSI_CV_AUTO;
+
+			void Run(size_t index)
+			{
+				(*Body)(index);
+
+				{
+					REKSI_LOCK_UNIQUE_AUTO;
+
+					if ( --Remaining != 0 ) return;
+				}
+
+				REKSI_CV_NOTIFY_ALL_AUTO;
+			}
+		};
+
+		ParallelPart(SharedPtr<Group> group, size_t index)
+			: m_Group(std::move(group)), m_Index(index)
+		{
+		}
+
+		void Execute() override
+		{
+			m_Group->Run(m_Index);
+		}
+
+		// The caller is waiting for it
+		void Cancel() override
+		{
+			Execute();
+		}
+
+	private:
+		SharedPtr<Group> m_Group;
+		size_t m_Index;
+	};
+#endif
+
+	inline void TaskScheduler::ParallelFor(size_t count, const std::function<void(size_t)>& body,
+	                                       [[maybe_unused]] LoadPriority priority)
+	{
+#if REKSI_THREADING == 1
+		if ( count > 1 )
+		{
+			auto group = CreateShared<ParallelPart::Group>();
+			group->Body = &body;
+			group->Remaining = count;
+
+			std::vector<SharedPtr<ParallelPart>> parts;
+			parts.reserve(count - 1);
+			for ( size_t i = 1; i < count; ++i )
+			{
+				parts.push_back(CreateShared<ParallelPart>(group, i));
+				Submit(parts.back(), priority);
+			}
+
+			// The first part runs right away, the rest unless a worker took it meanwhile,
+			// newest first as the workers start with the oldest
+			group->Run(0);
+			for ( auto itr = parts.rbegin(); itr != parts.rend(); ++itr )
+			{
+				if ( (*itr)->TryTake() ) (*itr)->Execute();
+			}
+
+			REKSI_LOCK_UNIQUE(group->REKSI_MUTEX_AUTO_NAME, lock);
+			REKSI_CV_WAIT(group->REKSI_CV_AUTO_NAME, lock, [&] { return group->Remaining == 0; });
+			return;
+		}
+#endif
+
+		for ( size_t i = 0; i < count; ++i )
+		{
+			body(i);
+		}
+	}
+
+	inline bool TaskScheduler::Push(SharedPtr<SchedulerTask> task, LoadPriority priority)
+	{
+		// Workers keep what they spawn local, other threads spread submissions round robin
+		const uint32_t index = IsWorkerThread()
+			                       ? s_CurrentWorker
+			                       : m_NextQueue.fetch_add(1, std::memory_order_relaxed) % m_Queues.size();
+
+		{
+			WorkerQueue& queue = *m_Queues[index];
+			REKSI_LOCK(queue.REKSI_MUTEX_AUTO_NAME, lock);
+
+			// Checked under the queue lock, the destructor empties the queues under it once stopping
+			if ( m_Stopping.load(std::memory_order_acquire) ) return false;
+
+			queue.Tasks[static_cast<size_t>(priority)].emplace_back(std::move(task));
+		}
+
+		{
+			// Counted under the sleep lock, so a worker about to sleep cannot miss it
+			REKSI_LOCK_UNIQUE_AUTO;
+
+			m_QueuedCount.fetch_add(1, std::memory_order_release);
+		}
+
+		REKSI_CV_NOTIFY_ONE_AUTO;
+		return true;
+	}
+
+	inline SharedPtr<SchedulerTask> TaskScheduler::Pop(uint32_t worker)
+	{
+		const auto count = static_cast<uint32_t>(m_Queues.size());
+
+		for ( size_t priority = 0; priority < LoadPriorityCount; ++priority )
+		{
+			// Own queue first, oldest entry first
+			// then steal the newest entry of the same priority from the others
+			for ( uint32_t i = 0; i < count; ++i )
+			{
+				const uint32_t index = (worker + i) % count;
+				WorkerQueue& queue = *m_Queues[index];
+
+				while ( true )
+				{
+					SharedPtr<SchedulerTask> task;
+
+					{
+						REKSI_LOCK(queue.REKSI_MUTEX_AUTO_NAME, lock);
+
+						auto& tasks = queue.Tasks[priority];
+						if ( tasks.empty() ) break;
+
+						if ( i == 0 )
+						{
+							task = std::move(tasks.front());
+							tasks.pop_front();
+						}
+						else
+						{
+							task = std::move(tasks.back());
+							tasks.pop_back();
+						}
+					}
+
+					m_QueuedCount.fetch_sub(1, std::memory_order_relaxed);
+					if ( task->TryTake() ) return task;
+				}
+			}
+		}
+
+		return nullptr;
+	}
+
+	inline void TaskScheduler::WorkerLoop(uint32_t worker)
+	{
+		s_CurrentScheduler = this;
+		s_CurrentWorker = worker;
+
+		while ( !m_Stopping.load(std::memory_order_acquire) )
+		{
+			if ( auto task = Pop(worker) )
+			{
+				task->Execute();
+				continue;
+			}
+
+			REKSI_LOCK_UNIQUE_AUTO;
+
+			REKSI_CV_WAIT_AUTO([&] { return m_Stopping || m_QueuedCount.load(std::memory_order_acquire) > 0; });
+			if ( m_Stopping ) return;
+		}
+	}
+}
+#pragma endregion
+
+
+#pragma region Defer
+namespace Reksi
+{
+	inline LoadTask::LoadTask(ResourceData* data)
+		: m_Data(data), m_Done(false), m_HasPrefetched(false)
+	{
+	}
+
+	inline void LoadTask::Execute()
+	{
+		ResourceData* data = Claim();
+		// Load was already picked up by a synchronous caller, or the resource was deleted
+		if ( !data ) return;
+
+		data->LoadClaimed(shared_from_this());
+	}
+
+	inline void LoadTask::Cancel()
+	{
+		ResourceData* data = Claim();
+		if ( !data ) return;
+
+		data->ReleasePendingLoad(this);
+		Complete(ResourceLoadStatus());
+	}
+
+	inline bool LoadTask::IsDone() const
+	{
+		REKSI_LOCK_SHARED_AUTO;
+
+		return m_Done;
+	}
+
+	inline void LoadTask::Wait() const
+	{
+		REKSI_LOCK_UNIQUE_AUTO;
+
+		REKSI_CV_WAIT_AUTO([&] { return m_Done; });
+	}
+
+	inline ResourceLoadStatus LoadTask::GetStatus() const
+	{
+		REKSI_LOCK_UNIQUE_AUTO;
+
+		REKSI_CV_WAIT_AUTO([&] { return m_Done; });
+		return m_Status;
+	}
+
+	inline bool LoadTask::ContinueWith(LoadContinuation continuation)
+	{
+		REKSI_LOCK_UNIQUE_AUTO;
+
+		if ( m_Done ) return false;
+
+		m_Continuations.emplace_back(std::move(continuation));
+		return true;
+	}
+
+	inline ResourceData* LoadTask::Claim()
+	{
+		return m_Data.exchange(nullptr);
+	}
+
+	inline void LoadTask::Complete(ResourceLoadStatus status)
+	{
+		std::vector<LoadContinuation> continuations;
+
+		{
+			REKSI_LOCK_UNIQUE_AUTO;
+
+			m_Status = status;
+			m_Done = true;
+			continuations.swap(m_Continuations);
+		}
+
+		REKSI_CV_NOTIFY_ALL_AUTO;
+
+		for ( const auto& continuation : continuations )
+		{
+			continuation(status);
+		}
+	}
+
+	inline void LoadTask::SetPrefetched(ByteBuffer buffer)
+	{
+		REKSI_LOCK_UNIQUE_AUTO;
+
+		m_Prefetched = std::move(buffer);
+		m_HasPrefetched = true;
+	}
+
+	inline bool LoadTask::TakePrefetched(ByteBuffer& buffer)
+	{
+		REKSI_LOCK_UNIQUE_AUTO;
+
+		if ( !m_HasPrefetched ) return false;
+
+		buffer = std::move(m_Prefetched);
+		m_HasPrefetched = false;
+		return true;
+	}
+
+	inline LoadFuture::LoadFuture(SharedPtr<LoadTask> task)
+		: m_Task(std::move(task))
+	{
+	}
+
+	inline bool LoadFuture::IsValid() const
+	{
+		return static_cast<bool>(m_Task);
+	}
+
+	inline bool LoadFuture::IsReady() const
+	{
+		assert(IsValid());
+
+		return m_Task->IsDone();
+	}
+
+	inline void LoadFuture::Wait() const
+	{
+		assert(IsValid());
+
+		m_Task->Wait();
+	}
+
+	inline ResourceLoadStatus LoadFuture::Get() const
+	{
+		assert(IsValid());
+
+		return m_Task->GetStatus();
+	}
+
+	inline bool LoadFuture::ContinueWith(LoadContinuation continuation) const
+	{
+		assert(IsValid());
+
+		return m_Task->ContinueWith(std::move(continuation));
+	}
+
+	template <typename T>
+	ResourceFuture<T>::ResourceFuture(const Resource<T>& resource, LoadFuture future)
+		: LoadFuture(std::move(future)), m_Resource(resource)
+	{
+	}
+
+	template <typename T>
+	Resource<T> ResourceFuture<T>::GetResource() const
+	{
+		return m_Resource;
+	}
+
+	template <typename T>
+	SharedPtr<T> ResourceFuture<T>::GetRef() const
+	{
+		if ( IsValid() ) Wait();
+
+		return Resource<T>{m_Resource}.GetRef();
+	}
+}
+#pragma endregion
+
+
+#pragma region Defer
+// Implementation
+namespace Reksi
+{
+	template <typename T>
+	SharedPtr<T> Resource<T>::GetRef()
+	{
+		assert(IsValid());
+
+		auto ref = m_Data->GetData<T>();
+		// If data is valid, return it, else try to get a default resource from the manager
+		if ( ref ) return ref;
+
+		ref = m_Manager->GetDefaultResource<T>();
+		return ref;
+	}
+
+	template <typename T>
+	SharedPtr<T> Resource<T>::TryGetRef()
+	{
+		assert(IsValid());
+
+		auto ref = m_Data->GetDataIfLoaded<T>();
+		if ( ref ) return ref;
+
+		return m_Manager->GetDefaultResource<T>();
+	}
+
+	template <typename T>
+	ResourceView<T> Resource<T>::Borrow()
+	{
+		assert(IsValid());
+
+		return ResourceView<T>{m_Data, m_Manager, true};
+	}
+
+	template <typename T>
+	ResourceView<T> Resource<T>::TryBorrow()
+	{
+		assert(IsValid());
+
+		return ResourceView<T>{m_Data, m_Manager, false};
+	}
+
+	template <typename T>
+	T& Resource<T>::operator*()
+	{
+		return *GetRef();
+	}
+
+	template <typename T>
+	ResourceStatus Resource<T>::GetStatus() const
+	{
+		assert(IsValid());
+
+		return m_Data->GetStatus();
+	}
+
+	template <typename T>
+	bool Resource<T>::IsLoaded() const
+	{
+		assert(IsValid());
+
+		return m_Data->IsState(ResourceStatus::States::Loaded);
+	}
+
+	template <typename T>
+	bool Resource<T>::IsValid() const
+	{
+		return this->m_Manager->IsValid(m_Handle);
+	}
+
+	template <typename T>
+	ResourceLoadStatus Resource<T>::Load()
+	{
+		assert(IsValid());
+
+		return m_Data->Load();
+	}
+
+	template <typename T>
+	ResourceUnloadStatus Resource<T>::Unload()
+	{
+		assert(IsValid());
+
+		return m_Data->Unload();
+	}
+
+	template <typename T>
+	ResourceLoadStatus Resource<T>::Reload()
+	{
+		assert(IsValid());
+
+		m_Data->WaitUntilCurrentLoading();
+		return m_Data->Load();
+	}
+
+	template <typename T>
+	ResourceFuture<T> Resource<T>::LoadAsync(LoadPriority priority)
+	{
+		assert(IsValid());
+
+		return m_Manager->LoadAsync(*this, priority);
+	}
+
+	template <typename T>
+	std::filesystem::path Resource<T>::GetPath() const
+	{
+		assert(IsValid());
+
+		return m_Data->GetPath();
+	}
+
+	template <typename T>
+	ResourceKey Resource<T>::GetKey() const
+	{
+		assert(IsValid());
+
+		return m_Data->GetKey();
+	}
+
+	template <typename T>
+	ResourceLoadFunc<T> Resource<T>::GetLoader() const
+	{
+		assert(IsValid());
+
+		return m_Data->GetLoader<T>();
+	}
+
+	template <typename T>
+	ResourceManager* Resource<T>::GetManager() const
+	{
+		return m_Manager;
+	}
+
+	template <typename T>
+	ResourceHandleT Resource<T>::GetHandle() const
+	{
+		return m_Handle;
+	}
+
+	template <typename T>
+	void Resource<T>::AddListener(ResourceListener* listener)
+	{
+		assert(IsValid());
+
+		m_Data->AddListener(listener);
+	}
+
+	template <typename T>
+	void Resource<T>::RemoveListener(ResourceListener* listener)
+	{
+		assert(IsValid());
+
+		m_Data->RemoveListener(listener);
+	}
+
+	template <typename T>
+	void Resource<T>::ClearListeners()
+	{
+		assert(IsValid());
+
+		m_Data->ClearListeners();
+	}
+
+	template <typename T>
+	void Resource<T>::Pin()
+	{
+		assert(IsValid());
+
+		m_Data->Pin();
+	}
+
+	template <typename T>
+	void Resource<T>::Unpin()
+	{
+		assert(IsValid());
+
+		m_Data->Unpin();
+	}
+
+	template <typename T>
+	bool Resource<T>::IsPinned() const
+	{
+		assert(IsValid());
+
+		return m_Data->IsPinned();
+	}
+
+	template <typename T>
+	Resource<T>::Resource(ResourceHandleT handle, ResourceData* data, ResourceManager* manager)
+		: m_Handle(handle), m_Data(data), m_Manager(manager)
+	{
+	}
+
+	template <typename T>
+	ResourceView<T>::ResourceView(ResourceData* data, ResourceManager* manager, bool load)
+		: m_Data(data->BorrowData<T>(load))
+	{
+		if ( m_Data ) return;
+
+		m_Default = manager->GetDefaultResource<T>();
+		m_Data = m_Default.get();
+	}
+
+	template <typename T>
+	T& ResourceView<T>::operator*() const
+	{
+		assert(m_Data);
+
+		return *m_Data;
+	}
+
+	template <typename T>
+	T* ResourceView<T>::operator->() const
+	{
+		return m_Data;
+	}
+
+	template <typename T>
+	T* ResourceView<T>::Get() const
+	{
+		return m_Data;
+	}
+
+	template <typename T>
+	ResourceView<T>::operator bool() const
+	{
+		return m_Data != nullptr;
+	}
+
+	template <typename T>
+	ResourceRef<T>::ResourceRef(const Resource<T>& resource)
+		: m_Resource(resource),
+		  m_SlotState(resource.m_Manager->m_Resources.GetState(resource.m_Handle)),
+		  m_LiveState(ResourceSlotMap::GetLiveState(resource.m_Handle)),
+		  m_Version(0)
+	{
+	}
+
+	template <typename T>
+	const SharedPtr<T>& ResourceRef<T>::GetRef()
+	{
+		if ( !IsCurrent() ) Refresh();
+		return m_Cached;
+	}
+
+	template <typename T>
+	T& ResourceRef<T>::operator*()
+	{
+		return *GetRef();
+	}
+
+	template <typename T>
+	T* ResourceRef<T>::operator->()
+	{
+		return GetRef().get();
+	}
+
+	template <typename T>
+	bool ResourceRef<T>::IsValid() const
+	{
+		return m_SlotState && m_SlotState->load(std::memory_order_acquire) == m_LiveState;
+	}
+
+	template <typename T>
+	const Resource<T>& ResourceRef<T>::GetResource() const
+	{
+		return m_Resource;
+	}
+
+	template <typename T>
+	bool ResourceRef<T>::IsCurrent() const
+	{
+		// The cached data is owned, so it stays usable even if it was replaced meanwhile
+		// The slot is checked first, the ResourceData is gone once the resource was deleted
+		return m_Cached && m_SlotState->load(std::memory_order_relaxed) == m_LiveState &&
+			m_Resource.m_Data->GetVersion() == m_Version;
+	}
+
+	template <typename T>
+	void ResourceRef<T>::Refresh()
+	{
+		assert(IsValid());
+
+		// Read first, a change during the load is picked up by the next access
+		m_Version = m_Resource.m_Data->GetVersion();
+		m_Cached = m_Resource.GetRef();
+	}
+
+}
+#pragma endregion
+
+
+#pragma region Defer
+namespace Reksi
+{
+	inline ResourceSlotMap::ResourceSlotMap()
+		: m_Size(0), m_FreeHead(0)
+	{
+		for ( uint32_t segment = 0; segment < SegmentCount; ++segment )
+		{
+			m_Segments[segment].store(nullptr, std::memory_order_relaxed);
+			m_SegmentGenerations[segment] = 1;
+		}
+	}
+
+	inline ResourceSlotMap::~ResourceSlotMap()
+	{
+		for ( uint32_t segment = 0; segment < SegmentCount; ++segment )
+		{
+			Segment* entry = m_Segments[segment].load(std::memory_order_acquire);
+			if ( !entry ) continue;
+
+			for ( uint32_t i = 0; i < GetSegmentSize(segment); ++i )
+			{
+				delete entry->Slots[i].Data.load(std::memory_order_acquire);
+			}
+			delete entry;
+		}
+	}
+
+	inline bool ResourceSlotMap::IsValid(ResourceHandleT handle) const
+	{
+		const Slot* slot = GetSlot(ResourceHandleLayout::GetIndex(handle));
+		if ( !slot ) return false;
+
+		return slot->State.load(std::memory_order_acquire) == (ResourceHandleLayout::GetGeneration(handle) << 1 | 1u);
+	}
+
+	inline ResourceData* ResourceSlotMap::Get(ResourceHandleT handle) const
+	{
+		const Slot* slot = GetSlot(ResourceHandleLayout::GetIndex(handle));
+		if ( !slot ) return nullptr;
+
+		const uint32_t expected = ResourceHandleLayout::GetGeneration(handle) << 1 | 1u;
+		if ( slot->State.load(std::memory_order_acquire) != expected ) return nullptr;
+
+		ResourceData* data = slot->Data.load(std::memory_order_acquire);
+		// The slot could have been released and reused between the two loads
+		if ( slot->State.load(std::memory_order_acquire) != expected ) return nullptr;
+		return data;
+	}
+
+	inline bool ResourceSlotMap::GetKey(ResourceHandleT handle, ResourceKey& key) const
+	{
+		const Slot* slot = GetSlot(ResourceHandleLayout::GetIndex(handle));
+		if ( !slot ) return false;
+
+		const uint32_t expected = ResourceHandleLayout::GetGeneration(handle) << 1 | 1u;
+		if ( slot->State.load(std::memory_order_acquire) != expected ) return false;
+
+		key.Hash = slot->KeyHash.load(std::memory_order_relaxed);
+		key.Index = slot->KeyIndex.load(std::memory_order_relaxed);
+		// Same as Get, the slot could have been reused in between
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return slot->State.load(std::memory_order_relaxed) == expected;
+	}
+
+	inline ResourceData* ResourceSlotMap::GetAt(uint32_t index) const
+	{
+		const Slot* slot = GetSlot(index);
+		if ( !slot ) return nullptr;
+
+		const uint32_t state = slot->State.load(std::memory_order_acquire);
+		if ( !(state & 1u) ) return nullptr;
+
+		ResourceData* data = slot->Data.load(std::memory_order_acquire);
+		if ( slot->State.load(std::memory_order_acquire) != state ) return nullptr;
+		return data;
+	}
+
+	inline const std::atomic<uint32_t>* ResourceSlotMap::GetState(ResourceHandleT handle) const
+	{
+		const Slot* slot = GetSlot(ResourceHandleLayout::GetIndex(handle));
+		return slot ? &slot->State : nullptr;
+	}
+
+	constexpr uint32_t ResourceSlotMap::GetLiveState(ResourceHandleT handle)
+	{
+		return ResourceHandleLayout::GetGeneration(handle) << 1 | 1u;
+	}
+
+	inline uint32_t ResourceSlotMap::GetIndexEnd() const
+	{
+		return m_Size.load(std::memory_order_acquire);
+	}
+
+	inline ResourceHandleT ResourceSlotMap::Allocate()
+	{
+		while ( true )
+		{
+			uint32_t index;
+			if ( !PopFree(index) )
+			{
+				index = m_Size.fetch_add(1, std::memory_order_relaxed);
+				GetOrCreateSegment(GetSegmentIndex(index));
+			}
+
+			// Growing passes over retired slots again once Compact moved the end below them
+			const uint32_t generation = GetSlot(index)->State.load(std::memory_order_relaxed) >> 1;
+			if ( generation != ResourceHandleLayout::ExhaustedGeneration )
+			{
+				return ResourceHandleLayout::Make(index, generation);
+			}
+		}
+	}
+
+	inline void ResourceSlotMap::Publish(ResourceHandleT handle, ResourceData* data)
+	{
+		const uint32_t index = ResourceHandleLayout::GetIndex(handle);
+		Slot* slot = GetSlot(index);
+		assert(slot && !slot->Data.load(std::memory_order_relaxed));
+
+		slot->Data.store(data, std::memory_order_release);
+		slot->KeyHash.store(data->GetKey().Hash, std::memory_order_relaxed);
+		slot->KeyIndex.store(data->GetKey().Index, std::memory_order_relaxed);
+		slot->State.store(ResourceHandleLayout::GetGeneration(handle) << 1 | 1u, std::memory_order_release);
+		SetOccupied(index, true);
+	}
+
+	inline UniquePtr<ResourceData> ResourceSlotMap::Release(ResourceHandleT handle)
+	{
+		const uint32_t index = ResourceHandleLayout::GetIndex(handle);
+		Slot* slot = GetSlot(index);
+		if ( !slot ) return nullptr;
+
+		// Bumping the generation invalidates every outstanding handle to the slot,
+		// and only one of several racing releases wins
+		const uint32_t generation = ResourceHandleLayout::GetGeneration(handle);
+		const uint32_t next = ResourceHandleLayout::NextGeneration(generation);
+		uint32_t expected = generation << 1 | 1u;
+		if ( !slot->State.compare_exchange_strong(expected, next << 1, std::memory_order_acq_rel) )
+		{
+			return nullptr;
+		}
+
+		UniquePtr<ResourceData> data{slot->Data.exchange(nullptr, std::memory_order_acq_rel)};
+		SetOccupied(index, false);
+		// Retired once its generations are used up
+		if ( next != ResourceHandleLayout::ExhaustedGeneration ) PushFree(index);
+		return data;
+	}
+
+	inline uint32_t ResourceSlotMap::GetLiveCount() const
+	{
+		uint32_t count = 0;
+		for ( uint32_t segment = 0; segment < SegmentCount; ++segment )
+		{
+			const Segment* entry = m_Segments[segment].load(std::memory_order_acquire);
+			if ( !entry ) continue;
+
+			const uint32_t words = GetSegmentSize(segment) / 64;
+			for ( uint32_t word = 0; word < words; ++word )
+			{
+				count += PopCount(entry->Occupancy[word].load(std::memory_order_relaxed));
+			}
+		}
+		return count;
+	}
+
+	inline uint32_t ResourceSlotMap::GetCapacity() const
+	{
+		uint32_t capacity = 0;
+		for ( uint32_t segment = 0; segment < SegmentCount; ++segment )
+		{
+			if ( m_Segments[segment].load(std::memory_order_acquire) ) capacity += GetSegmentSize(segment);
+		}
+		return capacity;
+	}
+
+	inline size_t ResourceSlotMap::GetMemoryUsage() const
+	{
+		size_t bytes = 0;
+		for ( uint32_t segment = 0; segment < SegmentCount; ++segment )
+		{
+			if ( !m_Segments[segment].load(std::memory_order_acquire) ) continue;
+
+			const size_t size = GetSegmentSize(segment);
+			bytes += sizeof(Segment) + size * sizeof(Slot) + size / 64 * sizeof(uint64_t);
+		}
+		return bytes;
+	}
+
+	inline void ResourceSlotMap::Compact()
+	{
+		// Find the end of the live slots, scanning the occupancy bitmap from the top
+		uint32_t size = 0;
+		for ( uint32_t segment = SegmentCount; segment-- > 0 && size == 0; )
+		{
+			const Segment* entry = m_Segments[segment].load(std::memory_order_relaxed);
+			if ( !entry ) continue;
+
+			for ( uint32_t word = GetSegmentSize(segment) / 64; word-- > 0; )
+			{
+				const uint64_t bits = entry->Occupancy[word].load(std::memory_order_relaxed);
+				if ( bits == 0 ) continue;
+
+				size = GetSegmentStart(segment) + word * 64 + FloorLog2(bits) + 1;
+				break;
+			}
+		}
+
+		// Free the segments past the end, remembering their generations so that stale handles
+		// to them stay invalid once the segment is created again
+		// A segment whose slots would restart at an exhausted generation is kept instead, with its retired slots
+		for ( uint32_t segment = 0; segment < SegmentCount; ++segment )
+		{
+			Segment* entry = m_Segments[segment].load(std::memory_order_relaxed);
+			if ( !entry || GetSegmentStart(segment) < size ) continue;
+
+			uint32_t generation = m_SegmentGenerations[segment];
+			for ( uint32_t i = 0; i < GetSegmentSize(segment); ++i )
+			{
+				generation = std::max(generation, entry->Slots[i].State.load(std::memory_order_relaxed) >> 1);
+			}
+			if ( generation >= ResourceHandleLayout::GenerationMask ) continue;
+			m_SegmentGenerations[segment] = ResourceHandleLayout::NextGeneration(generation);
+
+			m_Segments[segment].store(nullptr, std::memory_order_relaxed);
+			delete entry;
+		}
+
+		// Rebuild the free list from the zero bits below the end, pushed from the top so the
+		// lowest index is handed out first
+		m_FreeHead.store(0, std::memory_order_relaxed);
+		m_Size.store(size, std::memory_order_relaxed);
+		for ( uint32_t word = (size + 63) / 64; word-- > 0; )
+		{
+			const uint32_t first = word * 64;
+			const uint32_t segment = GetSegmentIndex(first);
+			const Segment* entry = m_Segments[segment].load(std::memory_order_relaxed);
+			const uint32_t local = (first - GetSegmentStart(segment)) / 64;
+
+			uint64_t free = ~entry->Occupancy[local].load(std::memory_order_relaxed);
+			// Slots at or past the end are handed out by growing instead
+			if ( size - first < 64 ) free &= (1ull << (size - first)) - 1;
+
+			while ( free )
+			{
+				const uint32_t bit = FloorLog2(free);
+				free &= ~(1ull << bit);
+
+				if ( (GetSlot(first + bit)->State.load(std::memory_order_relaxed) >> 1) ==
+				     ResourceHandleLayout::ExhaustedGeneration )
+				{
+					continue;
+				}
+				PushFree(first + bit);
+			}
+		}
+	}
+
+	inline uint32_t ResourceSlotMap::GetSegmentIndex(uint32_t index)
+	{
+		return FloorLog2((static_cast<uint64_t>(index) >> FirstSegmentBits) + 1);
+	}
+
+	inline uint32_t ResourceSlotMap::GetSegmentStart(uint32_t segment)
+	{
+		return static_cast<uint32_t>(((1ull << segment) - 1) << FirstSegmentBits);
+	}
+
+	inline uint32_t ResourceSlotMap::GetSegmentSize(uint32_t segment)
+	{
+		return FirstSegmentSize << segment;
+	}
+
+	inline ResourceSlotMap::Slot* ResourceSlotMap::GetSlot(uint32_t index) const
+	{
+		const uint32_t segment = GetSegmentIndex(index);
+		Segment* entry = m_Segments[segment].load(std::memory_order_acquire);
+		if ( !entry ) return nullptr;
+
+		return &entry->Slots[index - GetSegmentStart(segment)];
+	}
+
+	inline ResourceSlotMap::Segment* ResourceSlotMap::GetOrCreateSegment(uint32_t segment)
+	{
+		Segment* entry = m_Segments[segment].load(std::memory_order_acquire);
+		if ( entry ) return entry;
+
+		const uint32_t size = GetSegmentSize(segment);
+		auto created = CreateUnique<Segment>();
+		created->Slots = UniquePtr<Slot[]>(new Slot[size]);
+		created->Occupancy = UniquePtr<std::atomic<uint64_t>[]>(new std::atomic<uint64_t>[size / 64]);
+		for ( uint32_t i = 0; i < size; ++i )
+		{
+			created->Slots[i].State.store(m_SegmentGenerations[segment] << 1, std::memory_order_relaxed);
+		}
+		for ( uint32_t word = 0; word < size / 64; ++word )
+		{
+			created->Occupancy[word].store(0, std::memory_order_relaxed);
+		}
+
+		// Several threads may grow into a new segment at once, the first one to publish wins
+		if ( m_Segments[segment].compare_exchange_strong(entry, created.get(), std::memory_order_acq_rel) )
+		{
+			return created.release();
+		}
+		return entry;
+	}
+
+	inline void ResourceSlotMap::SetOccupied(uint32_t index, bool occupied)
+	{
+		const uint32_t segment = GetSegmentIndex(index);
+		const uint32_t local = index - GetSegmentStart(segment);
+		auto& word = m_Segments[segment].load(std::memory_order_acquire)->Occupancy[local / 64];
+
+		const uint64_t mask = 1ull << (local % 64);
+		if ( occupied ) word.fetch_or(mask, std::memory_order_relaxed);
+		else word.fetch_and(~mask, std::memory_order_relaxed);
+	}
+
+	inline bool ResourceSlotMap::PopFree(uint32_t& index)
+	{
+		uint64_t head = m_FreeHead.load(std::memory_order_acquire);
+		while ( static_cast<uint32_t>(head) != 0 )
+		{
+			const uint32_t first = static_cast<uint32_t>(head) - 1;
+			const uint64_t next = ((head >> 32) + 1) << 32 | GetSlot(first)->NextFree.load(std::memory_order_relaxed);
+			if ( m_FreeHead.compare_exchange_weak(head, next, std::memory_order_acq_rel) )
+			{
+				index = first;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	inline void ResourceSlotMap::PushFree(uint32_t index)
+	{
+		Slot* slot = GetSlot(index);
+		uint64_t head = m_FreeHead.load(std::memory_order_relaxed);
+		while ( true )
+		{
+			slot->NextFree.store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+			const uint64_t next = ((head >> 32) + 1) << 32 | (index + 1);
+			if ( m_FreeHead.compare_exchange_weak(head, next, std::memory_order_release) ) return;
+		}
+	}
+}
+#pragma endregion
+
+
+#pragma region Defer
+namespace Reksi
+{
+	inline std::string_view ResourceStringPool::Add(std::string_view str, uint32_t& index)
+	{
+		REKSI_LOCK_UNIQUE_AUTO;
+
+		index = m_Count++;
+		return Copy(str);
+	}
+
+	template <typename RelocateFunc>
+	void ResourceStringPool::Compact(RelocateFunc&& relocate)
+	{
+		// Freed at the end, once every string in use was copied out
+		std::vector<UniquePtr<char[]>> blocks;
+
+		{
+			REKSI_LOCK_UNIQUE_AUTO;
+
+			blocks.swap(m_Blocks);
+			m_AllocatedBytes = 0;
+			m_Current = nullptr;
+			m_BlockUsed = 0;
+		}
+
+		// Not locked meanwhile, the caller's locks are taken before the pool's like when adding
+		relocate([this](std::string_view str)
+		{
+			REKSI_LOCK_UNIQUE_AUTO;
+			return Copy(str);
+		});
+	}
+
+	inline std::string_view ResourceStringPool::Copy(std::string_view str)
+	{
+		char* dest;
+		if ( str.size() > BlockSize / 4 )
+		{
+			// Large strings get a block of their own, the current block stays in use
+			m_Blocks.emplace_back(new char[str.size()]);
+			m_AllocatedBytes += str.size();
+			dest = m_Blocks.back().get();
+		}
+		else
+		{
+			if ( !m_Current || m_BlockUsed + str.size() > BlockSize )
+			{
+				m_Blocks.emplace_back(new char[BlockSize]);
+				m_AllocatedBytes += BlockSize;
+				m_Current = m_Blocks.back().get();
+				m_BlockUsed = 0;
+			}
+
+			dest = m_Current + m_BlockUsed;
+			m_BlockUsed += str.size();
+		}
+
+		std::copy(str.begin(), str.end(), dest);
+		return std::string_view{dest, str.size()};
+	}
+
+	inline size_t ResourceStringPool::GetMemoryUsage() const
+	{
+		REKSI_LOCK_SHARED_AUTO;
+
+		return m_AllocatedBytes + m_Blocks.capacity() * sizeof(UniquePtr<char[]>);
+	}
+
+	inline ResourcePathIndex::ResourcePathIndex()
+		: m_AssetTables(nullptr)
+	{
+		for ( auto& segment : m_Handles )
+		{
+			segment.store(nullptr, std::memory_order_relaxed);
+		}
+	}
+
+	inline ResourcePathIndex::~ResourcePathIndex()
+	{
+		for ( auto& segment : m_Handles )
+		{
+			delete[] segment.load(std::memory_order_relaxed);
+		}
+
+		const AssetTableNode* node = m_AssetTables.load(std::memory_order_relaxed);
+		while ( node )
+		{
+			const AssetTableNode* next = node->Next;
+			delete node;
+			node = next;
+		}
+	}
+
+	inline ResourceHandleT ResourcePathIndex::Find(const ResourcePathView& path) const
+	{
+		const ResourceKey registered = FindRegistered(path);
+		if ( registered.IsValid() ) return Find(registered);
+
+		uint32_t index;
+
+		{
+			const Shard& shard = m_Shards[GetShardIndex(path.GetHash())];
+			REKSI_LOCK_SHARED(shard.REKSI_MUTEX_AUTO_NAME, lock);
+
+			const Entry* entry = FindEntry(shard, path.GetString(), path.GetHash());
+			if ( !entry ) return 0;
+			index = entry->Index;
+		}
+
+		return GetHandleSlot(index)->load(std::memory_order_acquire);
+	}
+
+	inline ResourceHandleT ResourcePathIndex::Find(const ResourceKey& key) const
+	{
+		if ( !key.IsValid() ) return 0;
+
+		const std::atomic<ResourceHandleT>* slot = GetHandleSlot(key.Index);
+		return slot ? slot->load(std::memory_order_acquire) : 0;
+	}
+
+	inline ResourceKey ResourcePathIndex::Intern(const ResourcePathView& path)
+	{
+		const ResourceKey registered = FindRegistered(path);
+		if ( registered.IsValid() ) return registered;
+
+		Shard& shard = m_Shards[GetShardIndex(path.GetHash())];
+
+		{
+			REKSI_LOCK_SHARED(shard.REKSI_MUTEX_AUTO_NAME, lock);
+
+			const Entry* entry = FindEntry(shard, path.GetString(), path.GetHash());
+			if ( entry && entry->Keyed ) return ResourceKey{entry->Hash, entry->Index};
+		}
+
+		REKSI_LOCK_UNIQUE(shard.REKSI_MUTEX_AUTO_NAME, lock);
+
+		Entry& entry = FindOrAddEntry(shard, path);
+		entry.Keyed = true;
+		return ResourceKey{entry.Hash, entry.Index};
+	}
+
+	inline std::string_view ResourcePathIndex::GetString(const ResourceKey& key) const
+	{
+		const Shard& shard = m_Shards[GetShardIndex(key.Hash)];
+		REKSI_LOCK_SHARED(shard.REKSI_MUTEX_AUTO_NAME, lock);
+
+		const Entry* entry = FindEntry(shard, key);
+		return entry ? entry->Path : std::string_view{};
+	}
+
+	template <typename CreateFunc>
+	ResourceHandleT ResourcePathIndex::FindOrInsert(const ResourcePathView& path, CreateFunc&& create)
+	{
+		const ResourceKey registered = FindRegistered(path);
+		if ( registered.IsValid() ) return FindOrInsert(registered, std::forward<CreateFunc>(create));
+
+		Shard& shard = m_Shards[GetShardIndex(path.GetHash())];
+		REKSI_LOCK_UNIQUE(shard.REKSI_MUTEX_AUTO_NAME, lock);
+
+		const Entry& entry = FindOrAddEntry(shard, path);
+		std::atomic<ResourceHandleT>& slot = *GetHandleSlot(entry.Index);
+
+		ResourceHandleT handle = slot.load(std::memory_order_relaxed);
+		if ( handle == 0 )
+		{
+			handle = create(ResourceKey{entry.Hash, entry.Index}, entry.Path);
+			slot.store(handle, std::memory_order_release);
+		}
+		return handle;
+	}
+
+	template <typename CreateFunc>
+	ResourceHandleT ResourcePathIndex::FindOrInsert(const ResourceKey& key, CreateFunc&& create)
+	{
+		if ( const ResourceHandleT handle = Find(key) ) return handle;
+
+		Shard& shard = m_Shards[GetShardIndex(key.Hash)];
+		REKSI_LOCK_UNIQUE(shard.REKSI_MUTEX_AUTO_NAME, lock);
+
+		const Entry* entry = FindEntry(shard, key);
+		if ( !entry ) return 0;
+
+		std::atomic<ResourceHandleT>& slot = *GetHandleSlot(entry->Index);
+
+		ResourceHandleT handle = slot.load(std::memory_order_relaxed);
+		if ( handle == 0 )
+		{
+			handle = create(key, entry->Path);
+			slot.store(handle, std::memory_order_release);
+		}
+		return handle;
+	}
+
+	template <typename PathFunc, typename CreateFunc>
+	void ResourcePathIndex::FindOrInsert(size_t count, PathFunc&& path, CreateFunc&& create, ResourceHandleT* handles)
+	{
+		// Counting sort of the paths by shard
+		size_t starts[ShardCount + 1] = {};
+		for ( size_t i = 0; i < count; ++i )
+		{
+			++starts[GetShardIndex(path(i).GetHash()) + 1];
+		}
+		for ( size_t shard = 0; shard < ShardCount; ++shard )
+		{
+			starts[shard + 1] += starts[shard];
+		}
+
+		std::vector<size_t> order(count);
+		size_t next[ShardCount];
+		std::copy(starts, starts + ShardCount, next);
+		for ( size_t i = 0; i < count; ++i )
+		{
+			order[next[GetShardIndex(path(i).GetHash())]++] = i;
+		}
+
+		for ( size_t index = 0; index < ShardCount; ++index )
+		{
+			if ( starts[index] == starts[index + 1] ) continue;
+
+			Shard& shard = m_Shards[index];
+			REKSI_LOCK_UNIQUE(shard.REKSI_MUTEX_AUTO_NAME, lock);
+
+			// Grow once up front, assuming all paths are new
+			while ( shard.Entries.empty() || (shard.Count + starts[index + 1] - starts[index]) * 4 > shard.Entries.size() * 3 )
+			{
+				Grow(shard);
+			}
+
+			for ( size_t i = starts[index]; i < starts[index + 1]; ++i )
+			{
+				const size_t request = order[i];
+				const Entry& entry = FindOrAddEntry(shard, path(request));
+				std::atomic<ResourceHandleT>& slot = *GetHandleSlot(entry.Index);
+
+				ResourceHandleT handle = slot.load(std::memory_order_relaxed);
+				if ( handle == 0 )
+				{
+					handle = create(request, ResourceKey{entry.Hash, entry.Index}, entry.Path);
+					slot.store(handle, std::memory_order_release);
+				}
+				handles[request] = handle;
+			}
+		}
+	}
+
+	inline const std::vector<ResourceKey>& ResourcePathIndex::RegisterTable(const StaticAssetTable& table)
+	{
+		auto node = new AssetTableNode{table, {}, nullptr};
+		node->Keys.reserve(table.GetCount());
+
+		for ( size_t i = 0; i < table.GetCount(); ++i )
+		{
+			node->Keys.emplace_back(Intern(table[i]));
+		}
+
+		// Published once every key is interned, so lookups through the table always find their entry
+		const AssetTableNode* head = m_AssetTables.load(std::memory_order_relaxed);
+		do
+		{
+			node->Next = head;
+		}
+		while ( !m_AssetTables.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_relaxed) );
+
+		return node->Keys;
+	}
+
+	inline bool ResourcePathIndex::Erase(const ResourceKey& key, ResourceHandleT handle)
+	{
+		Shard& shard = m_Shards[GetShardIndex(key.Hash)];
+		REKSI_LOCK_UNIQUE(shard.REKSI_MUTEX_AUTO_NAME, lock);
+
+		if ( !FindEntry(shard, key) ) return false;
+
+		return GetHandleSlot(key.Index)->compare_exchange_strong(handle, 0, std::memory_order_acq_rel);
+	}
+
+	template <typename MovedFunc>
+	void ResourcePathIndex::Compact(MovedFunc&& moved)
+	{
+		for ( Shard& shard : m_Shards )
+		{
+			REKSI_LOCK_UNIQUE(shard.REKSI_MUTEX_AUTO_NAME, lock);
+
+			for ( Entry& entry : shard.Entries )
+			{
+				if ( entry.Index == ResourceKey::InvalidIndex || entry.Keyed ) continue;
+				if ( GetHandleSlot(entry.Index)->load(std::memory_order_relaxed) != 0 ) continue;
+
+				entry.Index = ResourceKey::InvalidIndex;
+				--shard.Count;
+			}
+
+			// Smallest table keeping the load factor below 3/4
+			size_t capacity = 0;
+			if ( shard.Count > 0 )
+			{
+				capacity = InitialCapacity;
+				while ( shard.Count * 4 > capacity * 3 )
+				{
+					capacity *= 2;
+				}
+			}
+			Rehash(shard, capacity);
+		}
+
+		m_Strings.Compact([&](const auto& copy)
+		{
+			for ( Shard& shard : m_Shards )
+			{
+				REKSI_LOCK_UNIQUE(shard.REKSI_MUTEX_AUTO_NAME, lock);
+
+				for ( Entry& entry : shard.Entries )
+				{
+					if ( entry.Index == ResourceKey::InvalidIndex ) continue;
+
+					entry.Path = copy(entry.Path);
+					const ResourceHandleT handle = GetHandleSlot(entry.Index)->load(std::memory_order_relaxed);
+					if ( handle != 0 ) moved(handle, entry.Path);
+				}
+			}
+		});
+	}
+
+	inline size_t ResourcePathIndex::GetMemoryUsage() const
+	{
+		size_t bytes = m_Strings.GetMemoryUsage();
+
+		for ( const auto& shard : m_Shards )
+		{
+			REKSI_LOCK_SHARED(shard.REKSI_MUTEX_AUTO_NAME, lock);
+
+			bytes += shard.Entries.capacity() * sizeof(Entry);
+		}
+
+		for ( auto node = m_AssetTables.load(std::memory_order_acquire); node; node = node->Next )
+		{
+			bytes += sizeof(AssetTableNode) + node->Keys.capacity() * sizeof(ResourceKey);
+		}
+
+		for ( uint32_t segment = 0; segment < HandleSegmentCount; ++segment )
+		{
+			if ( m_Handles[segment].load(std::memory_order_acquire) )
+			{
+				bytes += (FirstHandleSegmentSize << segment) * sizeof(std::atomic<ResourceHandleT>);
+			}
+		}
+
+		return bytes;
+	}
+
+	inline size_t ResourcePathIndex::GetShardIndex(uint64_t hash)
+	{
+		return hash % ShardCount;
+	}
+
+	inline ResourceKey ResourcePathIndex::FindRegistered(const ResourcePathView& path) const
+	{
+		const ResourcePathLiteral literal{path.GetString(), path.GetHash()};
+
+		for ( auto node = m_AssetTables.load(std::memory_order_acquire); node; node = node->Next )
+		{
+			const size_t index = node->Table.Find(literal);
+			if ( index != StaticAssetTable::NotFound ) return node->Keys[index];
+		}
+
+		return ResourceKey{};
+	}
+
+	inline const ResourcePathIndex::Entry* ResourcePathIndex::FindEntry(const Shard& shard, std::string_view path,
+	                                                                     uint64_t hash)
+	{
+		if ( shard.Entries.empty() ) return nullptr;
+
+		// The low bits select the shard, probe with the rest
+		const size_t mask = shard.Entries.size() - 1;
+		for ( size_t i = (hash / ShardCount) & mask; ; i = (i + 1) & mask )
+		{
+			const Entry& entry = shard.Entries[i];
+			if ( entry.Index == ResourceKey::InvalidIndex ) return nullptr;
+			if ( entry.Hash == hash && entry.Path == path ) return &entry;
+		}
+	}
+
+	inline const ResourcePathIndex::Entry* ResourcePathIndex::FindEntry(const Shard& shard, const ResourceKey& key)
+	{
+		if ( shard.Entries.empty() || !key.IsValid() ) return nullptr;
+
+		const size_t mask = shard.Entries.size() - 1;
+		for ( size_t i = (key.Hash / ShardCount) & mask; ; i = (i + 1) & mask )
+		{
+			const Entry& entry = shard.Entries[i];
+			if ( entry.Index == ResourceKey::InvalidIndex ) return nullptr;
+			if ( entry.Index == key.Index ) return &entry;
+		}
+	}
+
+	inline ResourcePathIndex::Entry& ResourcePathIndex::FindOrAddEntry(Shard& shard, const ResourcePathView& path)
+	{
+		if ( const Entry* entry = FindEntry(shard, path.GetString(), path.GetHash()) )
+		{
+			return const_cast<Entry&>(*entry);
+		}
+
+		// Keep the load factor below 3/4
+		if ( (shard.Count + 1) * 4 > shard.Entries.size() * 3 ) Grow(shard);
+
+		const size_t mask = shard.Entries.size() - 1;
+		size_t i = (path.GetHash() / ShardCount) & mask;
+		while ( shard.Entries[i].Index != ResourceKey::InvalidIndex )
+		{
+			i = (i + 1) & mask;
+		}
+
+		Entry& entry = shard.Entries[i];
+		entry.Hash = path.GetHash();
+		entry.Path = m_Strings.Add(path.GetString(), entry.Index);
+		GetOrCreateHandleSlot(entry.Index);
+		++shard.Count;
+		return entry;
+	}
+
+	inline void ResourcePathIndex::Grow(Shard& shard)
+	{
+		Rehash(shard, std::max(InitialCapacity, shard.Entries.size() * 2));
+	}
+
+	inline void ResourcePathIndex::Rehash(Shard& shard, size_t capacity)
+	{
+		std::vector<Entry> entries(capacity);
+		const size_t mask = capacity - 1;
+
+		for ( const Entry& entry : shard.Entries )
+		{
+			if ( entry.Index == ResourceKey::InvalidIndex ) continue;
+
+			size_t i = (entry.Hash / ShardCount) & mask;
+			while ( entries[i].Index != ResourceKey::InvalidIndex )
+			{
+				i = (i + 1) & mask;
+			}
+			entries[i] = entry;
+		}
+
+		shard.Entries.swap(entries);
+	}
+
+	inline std::atomic<ResourceHandleT>* ResourcePathIndex::GetHandleSlot(uint32_t index) const
+	{
+		const uint32_t segment = FloorLog2((static_cast<uint64_t>(index) >> FirstHandleSegmentBits) + 1);
+		std::atomic<ResourceHandleT>* handles = m_Handles[segment].load(std::memory_order_acquire);
+		if ( !handles ) return nullptr;
+
+		return &handles[index - (((1u << segment) - 1) << FirstHandleSegmentBits)];
+	}
+
+	inline std::atomic<ResourceHandleT>& ResourcePathIndex::GetOrCreateHandleSlot(uint32_t index)
+	{
+		const uint32_t segment = FloorLog2((static_cast<uint64_t>(index) >> FirstHandleSegmentBits) + 1);
+		if ( !m_Handles[segment].load(std::memory_order_acquire) )
+		{
+			// Paths of different shards may race for the same segment, the loser frees its copy
+			const uint32_t size = FirstHandleSegmentSize << segment;
+			auto handles = new std::atomic<ResourceHandleT>[size];
+			for ( uint32_t i = 0; i < size; ++i )
+			{
+				handles[i].store(0, std::memory_order_relaxed);
+			}
+
+			std::atomic<ResourceHandleT>* expected = nullptr;
+			if ( !m_Handles[segment].compare_exchange_strong(expected, handles, std::memory_order_acq_rel) )
+			{
+				delete[] handles;
+			}
+		}
+
+		return *GetHandleSlot(index);
+	}
+}
+#pragma endregion
+
+
+#pragma region Defer
+namespace Reksi
+{
+	inline ResourceManager::ResourceManager(std::filesystem::path basePath, uint32_t workerCount)
+		: m_BasePath(std::move(basePath)),
+		  m_MemoryBudget(0),
+		  m_ResidentBytes(0),
+		  m_ClockHand(0),
+		  m_Scheduler(CreateUnique<TaskScheduler>(workerCount)),
+		  m_ShuttingDown(false),
+		  m_FileReader(FileReader::Create())
+	{
+		m_Codecs.emplace(LzBlockCodec::Id, CreateShared<const LzBlockCodec>());
+	}
+
+	inline ResourceManager::~ResourceManager()
+	{
+		// Finish the reads first, they submit their loads to the scheduler
+		m_FileReader.reset();
+		// Stop the workers before the resources they reference go away
+		// The pointer is cleared before the scheduler is destroyed, the queued loads it cancels cannot reach it
+		m_ShuttingDown.store(true, std::memory_order_release);
+		m_Scheduler.reset();
+
+		// Destroyed while the rest of the manager is alive, listeners notified before deleting may still use it
+		const uint32_t end = m_Resources.GetIndexEnd();
+		for ( uint32_t index = 0; index < end; ++index )
+		{
+			if ( const ResourceData* data = m_Resources.GetAt(index) ) m_Resources.Release(data->GetHandle()).reset();
+		}
+
+		// Data replaced by reloads is freed once unused, free what is left now
+		EpochDomain::Get().Collect();
+	}
+
+	inline bool ResourceManager::IsValid(ResourceHandleT handle) const
+	{
+		return m_Resources.IsValid(handle);
+	}
+
+	inline ResourceHandleT ResourceManager::GetHandle(const ResourcePathView& path) const
+	{
+		return m_ResourcePaths.Find(path);
+	}
+
+	inline ResourceHandleT ResourceManager::GetHandle(const ResourceKey& key) const
+	{
+		return m_ResourcePaths.Find(key);
+	}
+
+	inline ResourceKey ResourceManager::GetKey(const ResourcePathView& path)
+	{
+		return m_ResourcePaths.Intern(path);
+	}
+
+	inline std::vector<ResourceKey> ResourceManager::RegisterAssets(const StaticAssetTable& table)
+	{
+		return m_ResourcePaths.RegisterTable(table);
+	}
+
+	inline ResourceTypeId ResourceManager::GetTypeId(ResourceHandleT handle) const
+	{
+		ResourceData* data = m_Resources.Get(handle);
+		if ( !data ) return 0;
+		return data->GetTypeId();
+	}
+
+	inline std::type_index ResourceManager::GetTypeIndex(ResourceHandleT handle) const
+	{
+		return ResourceTypeRegistry::GetTypeIndex(GetTypeId(handle));
+	}
+
+	template <typename T, typename Func>
+	Resource<T> ResourceManager::GetResource(const ResourcePathView& path, Func&& loader)
+	{
+		// Creates the resource unless the path already exists
+		const ResourceHandleT handle = m_ResourcePaths.FindOrInsert(path, [&](const ResourceKey& key, std::string_view name)
+		{
+			return CreateResourceImpl(key, name, ResourceData::MakeLoaders<T>(std::forward<Func>(loader)), GetResourceTypeId<T>());
+		});
+		return Resource<T>{handle, m_Resources.Get(handle), this};
+	}
+
+	template <typename T>
+	Resource<T> ResourceManager::GetResource(const ResourcePathView& path)
+	{
+		// Check if the resource already exists
+		if ( const ResourceHandleT handle = m_ResourcePaths.Find(path) )
+		{
+			// Another type was requested for the path before
+			assert(ResourceHandleLayout::MayBeType(handle, GetResourceTypeId<T>()));
+			return Resource<T>{handle, m_Resources.Get(handle), this};
+		}
+
+		// Need to have the loader, try to get it from the default loaders
+		ResourceData::LoadersPtr loader = GetDefaultLoaderImpl<T>();
+		if ( !loader )
+		{
+			throw std::runtime_error("ResourceManager::GetResource: No default loader for the type");
+		}
+
+		// Another thread may have created it in the meantime, in which case the loader goes unused
+		const ResourceHandleT handle = m_ResourcePaths.FindOrInsert(path, [&](const ResourceKey& key, std::string_view name)
+		{
+			return CreateResourceImpl(key, name, std::move(loader), GetResourceTypeId<T>());
+		});
+		return Resource<T>{handle, m_Resources.Get(handle), this};
+	}
+
+	template <typename T>
+	Resource<T> ResourceManager::GetResource(const ResourceKey& key)
+	{
+		if ( const ResourceHandleT handle = m_ResourcePaths.Find(key) )
+		{
+			assert(ResourceHandleLayout::MayBeType(handle, GetResourceTypeId<T>()));
+			return Resource<T>{handle, m_Resources.Get(handle), this};
+		}
+
+		ResourceData::LoadersPtr loader = GetDefaultLoaderImpl<T>();
+		if ( !loader )
+		{
+			throw std::runtime_error("ResourceManager::GetResource: No default loader for the type");
+		}
 
-	inline ResourceStatus ResourceData::GetStatus() const
-	{
-		REKSI_LOCK_SHARED_AUTO;
-		return m_Status;
+		const ResourceHandleT handle = m_ResourcePaths.FindOrInsert(key, [&](const ResourceKey&, std::string_view name)
+		{
+			return CreateResourceImpl(key, name, std::move(loader), GetResourceTypeId<T>());
+		});
+		// Key of another manager, or of a path Compact dropped
+		if ( handle == 0 )
+		{
+			throw std::runtime_error("ResourceManager::GetResource: Invalid key");
+		}
+		return Resource<T>{handle, m_Resources.Get(handle), this};
 	}
 
-	inline bool ResourceData::IsState(ResourceStatus::States state) const
+	template <typename T>
+	std::vector<Resource<T>> ResourceManager::GetResources(Span<const std::filesystem::path> paths, bool load,
+	                                                       LoadPriority priority)
 	{
-		REKSI_LOCK_SHARED_AUTO;
-		return static_cast<bool>(state & m_Status.State);
+		ResourceData::LoadersPtr loaders = GetDefaultLoaderImpl<T>();
+		if ( !loaders )
+		{
+			throw std::runtime_error("ResourceManager::GetResources: No default loader for the type");
+		}
+
+		const std::vector<ResourceHandleT> handles = GetResourcesImpl(
+			paths.size(),
+			[&](size_t i) -> const std::filesystem::path& { return paths[i]; },
+			[&](size_t, const ResourceKey& key, std::string_view name, ResourceData::AllocationBlock& block)
+			{
+				return CreateResourceImpl(key, name, loaders, GetResourceTypeId<T>(), &block);
+			},
+			load, priority);
+
+		std::vector<Resource<T>> resources;
+		resources.reserve(handles.size());
+		for ( const ResourceHandleT handle : handles )
+		{
+			resources.push_back(Resource<T>{handle, m_Resources.Get(handle), this});
+		}
+		return resources;
 	}
 
-	inline ResourceLoadStatus ResourceData::Load()
+	inline std::vector<ResourceHandleT> ResourceManager::GetResources(Span<const ResourceRequest> requests, bool load,
+	                                                                  LoadPriority priority)
 	{
-		// Internal Load
-		const RLS status = LoadInternal();
-		// Notify listeners
-		NotifyListenersOnLoadComplete(status);
+		// Copied once, there is an entry per type at most
+		std::vector<ResourceData::LoadersPtr> loaders;
 
-		// TODO: Notify the resource manager as well
+		{
+			REKSI_LOCK_SHARED(m_LoaderResourceMutex, lock);
+			loaders = m_DefaultLoaders;
+		}
 
-		// Return status
-		return status;
+		// Checked before creating any of them
+		for ( const auto& request : requests )
+		{
+			if ( request.Type >= loaders.size() || !loaders[request.Type] )
+			{
+				throw std::runtime_error("ResourceManager::GetResources: No default loader for " + request.Path.string());
+			}
+		}
+
+		return GetResourcesImpl(
+			requests.size(),
+			[&](size_t i) -> const std::filesystem::path& { return requests[i].Path; },
+			[&](size_t i, const ResourceKey& key, std::string_view name, ResourceData::AllocationBlock& block)
+			{
+				return CreateResourceImpl(key, name, loaders[requests[i].Type], requests[i].Type, &block);
+			},
+			load, priority);
 	}
 
-	inline ResourceUnloadStatus ResourceData::Unload()
+	template <typename T>
+	void ResourceManager::RegisterTypeTag(std::string tag)
 	{
-		// Internal Unload
-		const ResourceUnloadStatus status = UnloadInternal();
-		// Notify listeners
-		NotifyListenersOnUnloadComplete(status);
-
-		// TODO: Notify the resource manager as well
+		REKSI_LOCK_UNIQUE(m_LoaderResourceMutex, lock);
 
-		// Return status
-		return status;
+		m_TypeTags.insert_or_assign(std::move(tag), GetResourceTypeId<T>());
 	}
 
-	template <typename T>
-	SharedPtr<T> ResourceData::GetData()
+	inline std::vector<ResourceRequest> ResourceManager::ReadManifest(const std::filesystem::path& manifest) const
 	{
+		std::ifstream stream(manifest);
+		if ( !stream )
 		{
-			// If data is loaded, return it
-			REKSI_LOCK_SHARED_AUTO;
+			throw std::runtime_error("ResourceManager: Failed to open manifest " + manifest.string());
+		}
+
+		std::vector<ResourceRequest> requests;
+		std::string line;
 
-			if ( m_Status.Is(ResourceStatus::Loaded) )
+		while ( std::getline(stream, line) )
+		{
+			// Trim, also drops the \r of files written on Windows
+			const size_t begin = line.find_first_not_of(" \t\r");
+			if ( begin == std::string::npos || line[begin] == '#' ) continue;
+			const size_t end = line.find_last_not_of(" \t\r") + 1;
+
+			const size_t tagEnd = line.find_first_of(" \t", begin);
+			const size_t pathBegin = tagEnd < end ? line.find_first_not_of(" \t", tagEnd) : std::string::npos;
+			if ( pathBegin == std::string::npos )
 			{
-				return GetDataInternal<T>();
+				throw std::runtime_error("ResourceManager: Manifest line without a path: " + line);
 			}
-		}
 
-		auto status = Load();
+			const std::string tag = line.substr(begin, tagEnd - begin);
+			ResourceTypeId type = 0;
 
-		{
-			// Return the data
-			REKSI_LOCK_SHARED_AUTO;
+			{
+				REKSI_LOCK_SHARED(m_LoaderResourceMutex, lock);
+
+				auto itr = m_TypeTags.find(tag);
+				if ( itr == m_TypeTags.end() )
+				{
+					throw std::runtime_error("ResourceManager: Unknown type tag in manifest: " + tag);
+				}
+				type = itr->second;
+			}
 
-			return GetDataInternal<T>();
+			requests.push_back(ResourceRequest{line.substr(pathBegin, end - pathBegin), type});
 		}
+
+		return requests;
 	}
 
-	template <typename T>
-	SharedPtr<T> ResourceData::GetDataInternal()
+	inline size_t ResourceManager::Preload(Span<const ResourceRequest> requests, uint32_t parallelism,
+	                                       const PreloadProgressFunc& progress)
 	{
-		if ( m_TypeIndex != typeid(T) )
+		const std::vector<ResourceHandleT> handles = GetResources(requests);
+
+		// Loads in flight, waited for oldest first
+		std::deque<LoadFuture> pending;
+		size_t done = 0;
+		size_t failed = 0;
+
+		auto waitOldest = [&]
 		{
-			throw std::runtime_error("ResourceData::GetDataInternal: Type mismatch");
+			if ( !pending.front().Get().Is(ResourceLoadStatus::Success) ) ++failed;
+			pending.pop_front();
+			if ( progress ) progress(++done, handles.size());
+		};
+
+		for ( const ResourceHandleT handle : handles )
+		{
+			ResourceData* data = m_Resources.Get(handle);
+			if ( !data || data->IsState(ResourceStatus::States::Loaded) )
+			{
+				if ( !data ) ++failed;
+				if ( progress ) progress(++done, handles.size());
+				continue;
+			}
+
+			if ( parallelism != 0 && pending.size() >= parallelism ) waitOldest();
+			pending.push_back(LoadAsyncImpl(data, LoadPriority::Critical));
+		}
+
+		while ( !pending.empty() )
+		{
+			waitOldest();
 		}
 
-		return StaticSharedCast<T>(m_Data);
+		return failed;
 	}
 
-	inline void ResourceData::AddListener(ResourceListener* listener)
+	inline size_t ResourceManager::Preload(const std::filesystem::path& manifest, uint32_t parallelism,
+	                                       const PreloadProgressFunc& progress)
 	{
-		REKSI_LOCK_UNIQUE_AUTO;
-
-		m_Listeners.emplace_back(listener);
+		const std::vector<ResourceRequest> requests = ReadManifest(manifest);
+		return Preload(Span<const ResourceRequest>{requests}, parallelism, progress);
 	}
 
-	inline void ResourceData::RemoveListener(ResourceListener* listener)
+	template <typename PathFunc, typename CreateFunc>
+	std::vector<ResourceHandleT> ResourceManager::GetResourcesImpl(size_t count, PathFunc&& path, CreateFunc&& create,
+	                                                               bool load, LoadPriority priority)
 	{
-		REKSI_LOCK_UNIQUE_AUTO;
+		// Path views cannot be moved, a deque constructs them in place
+		std::deque<ResourcePathView> views;
+		for ( size_t i = 0; i < count; ++i )
+		{
+			views.emplace_back(path(i));
+		}
 
-		m_Listeners.remove(listener);
-	}
+		std::vector<ResourceHandleT> handles(count);
+		// Sized for the whole batch, slots of paths which already exist stay unused
+		ResourceData::AllocationBlock* block = ResourceData::AllocationBlock::Create(count);
 
-	inline void ResourceData::ClearListeners()
-	{
-		REKSI_LOCK_UNIQUE_AUTO;
+		m_ResourcePaths.FindOrInsert(
+			count,
+			[&](size_t i) -> const ResourcePathView& { return views[i]; },
+			[&](size_t i, const ResourceKey& key, std::string_view name)
+			{
+				return create(i, key, name, *block);
+			},
+			handles.data());
 
-		m_Listeners.clear();
-	}
+		// Freed right away if every path existed
+		block->Release();
 
-	inline void ResourceData::AddListeners(const ListenerList& listeners)
-	{
-		REKSI_LOCK_UNIQUE_AUTO;
+		if ( load )
+		{
+			for ( const ResourceHandleT handle : handles )
+			{
+				ResourceData* data = m_Resources.Get(handle);
+				if ( data && !data->IsState(ResourceStatus::States::Loaded) ) LoadAsyncImpl(data, priority);
+			}
+		}
 
-		m_Listeners.insert(m_Listeners.end(), listeners.begin(), listeners.end());
+		return handles;
 	}
 
-	inline void ResourceData::WaitUntilCurrentLoading()
+	inline ResourceHandleT ResourceManager::CreateResourceImpl(const ResourceKey& key, std::string_view name,
+	                                                           ResourceData::LoadersPtr loaders, ResourceTypeId type,
+	                                                           ResourceData::AllocationBlock* block)
 	{
-		REKSI_LOCK_UNIQUE_AUTO;
-
-		REKSI_CV_WAIT_AUTO([&] { return !m_Status.Is(ResourceStatus::Loading); });
+		const ResourceHandleT handle = ResourceHandleLayout::WithType(m_Resources.Allocate(), type);
+		ResourceData* data = ResourceData::Create(block, handle, key, name, std::move(loaders), this, type);
+		m_Resources.Publish(handle, data);
+		return handle;
 	}
 
-	inline std::filesystem::path ResourceData::GetPath() const
+	template <typename T>
+	void ResourceManager::DeleteResource(const Resource<T>& resource)
 	{
-		REKSI_LOCK_SHARED_AUTO;
+		const ResourceHandleT handle = resource.m_Handle;
+		UniquePtr<ResourceData> deleted;
 
-		return m_Path;
+		{
+			REKSI_LOCK_SHARED(m_EvictionMutex, lock);
+
+			// Read from the slot, a racing delete may be destroying the data already
+			// Also returns if the resource is deleted already
+			ResourceKey key;
+			if ( !m_Resources.GetKey(handle, key) ) return;
+
+			// Remove the resource from the resource paths first, so it cannot be found once invalid
+			// Only clears the entry while it still holds this handle
+			m_ResourcePaths.Erase(key, handle);
+
+			// Invalidate the handle, the slot may be reused from here on
+			// Only one of several racing deletes gets the data back and destroys it
+			deleted = m_Resources.Release(handle);
+		}
+
+		if ( !deleted ) return;
+		RemoveDependencies(handle);
+
+		// Destroyed outside the lock, as it waits for loads in flight
+		deleted.reset();
 	}
 
-	template <typename T>
-	ResourceLoadFunc<T> ResourceData::GetLoader() const
+	inline void ResourceManager::MarkForDelete(ResourceHandleT handle)
 	{
-		REKSI_LOCK_SHARED_AUTO;
+		ResourceData* data = m_Resources.Get(handle);
+		if ( !data ) return;
 
-		return m_Loader;
+		data->SetState(ResourceStatus::MarkedForDelete);
+		data->ClearState(ResourceStatus::MarkedForReload);
 	}
 
-	inline ResourceHandleT ResourceData::GetHandle() const
+	inline void ResourceManager::Reload(ResourceHandleT handle)
 	{
-		REKSI_LOCK_SHARED_AUTO;
+		ResourceData* data = m_Resources.Get(handle);
+		if ( !data ) return;
 
-		return m_Handle;
+		data->WaitUntilCurrentLoading();
+		data->Load();
 	}
 
-	inline std::type_index ResourceData::GetTypeIndex() const
+	inline void ResourceManager::SetMemoryBudget(size_t bytes)
 	{
-		return m_TypeIndex;
+		m_MemoryBudget.store(bytes, std::memory_order_relaxed);
+		EnforceMemoryBudget();
 	}
 
-	inline ResourceData::~ResourceData()
+	inline size_t ResourceManager::GetMemoryBudget() const
 	{
-		NotifyListenersBeforeDeleting();
+		return m_MemoryBudget.load(std::memory_order_relaxed);
+	}
 
-		REKSI_LOCK_UNIQUE_AUTO;
-		m_Status.Set(RS::MarkedForDelete).Clear(RS::MarkedForReload);
-		REKSI_CV_WAIT_AUTO([&] { return !m_Status.Is(ResourceStatus::Loading); });
+	inline size_t ResourceManager::GetResidentBytes() const
+	{
+		return m_ResidentBytes.load(std::memory_order_relaxed);
 	}
 
-	inline ResourceData::ListenerList ResourceData::GetListenersCopy() const
+	inline void ResourceManager::EnforceMemoryBudget()
 	{
-		ListenerList listeners_copy;
+		const size_t budget = m_MemoryBudget.load(std::memory_order_relaxed);
+		if ( budget == 0 || m_ResidentBytes.load(std::memory_order_relaxed) <= budget ) return;
+
+		REKSI_LOCK_UNIQUE(m_EvictionMutex, lock);
 
+		// The first sweep may only clear referenced bits, give up after the second
+		const uint32_t end = m_Resources.GetIndexEnd();
+		for ( uint64_t step = 0; step < 2ull * end; ++step )
 		{
-			REKSI_LOCK_SHARED_AUTO;
+			if ( m_ResidentBytes.load(std::memory_order_relaxed) <= budget ) return;
 
-			// Create a copy of the listeners
-			listeners_copy = m_Listeners;
+			if ( m_ClockHand >= end ) m_ClockHand = 0;
+			if ( ResourceData* data = m_Resources.GetAt(m_ClockHand) ) data->TryEvict();
+			++m_ClockHand;
 		}
-
-		return listeners_copy;
 	}
 
-	inline void ResourceData::NotifyListenersOnLoadComplete(ResourceLoadStatus status)
+	inline ResourceMemoryStats ResourceManager::GetMemoryStats() const
 	{
-		for ( const auto listener : GetListenersCopy() )
-		{
-			listener->OnLoadComplete(*this, status);
-		}
-	}
+		ResourceMemoryStats stats;
+		stats.MemoryBudget = m_MemoryBudget.load(std::memory_order_relaxed);
+
+		// By type id while walking, every resource's type was registered before it was created
+		std::vector<ResourceMemoryStats::Usage> perType(ResourceTypeRegistry::GetEnd());
 
-	inline void ResourceData::NotifyListenersOnUnloadComplete(ResourceUnloadStatus status)
-	{
-		for ( const auto listener : GetListenersCopy() )
 		{
-			listener->OnUnloadComplete(*this, status);
-		}
-	}
+			REKSI_LOCK_UNIQUE(m_EvictionMutex, lock);
 
+			const uint32_t end = m_Resources.GetIndexEnd();
+			for ( uint32_t index = 0; index < end; ++index )
+			{
+				const ResourceData* data = m_Resources.GetAt(index);
+				if ( !data ) continue;
+
+				const ResourceStatus status = data->GetStatus();
+				const size_t bytes = data->GetSize();
+				const auto add = [bytes](ResourceMemoryStats::Usage& usage)
+				{
+					++usage.Count;
+					usage.Bytes += bytes;
+				};
+
+				add(stats.Total);
+				add(perType[data->GetTypeId()]);
+				if ( status.Is(ResourceStatus::Loaded) ) add(stats.Loaded);
+				if ( status.Is(ResourceStatus::Loading) ) add(stats.Loading);
+				if ( status.Is(ResourceStatus::MarkedForDelete) ) add(stats.MarkedForDelete);
+			}
+		}
 
-	inline void ResourceData::NotifyListenersBeforeDeleting()
-	{
-		for ( const auto listener : GetListenersCopy() )
+		for ( ResourceTypeId type = 0; type < perType.size(); ++type )
 		{
-			listener->BeforeDeleting(*this);
+			if ( perType[type].Count ) stats.PerType[ResourceTypeRegistry::GetTypeIndex(type)] = perType[type];
 		}
+
+		stats.OverheadBytes = sizeof(ResourceManager) + stats.Total.Count * ResourceData::GetAllocationSize() +
+			m_Resources.GetMemoryUsage() + m_ResourcePaths.GetMemoryUsage();
+		return stats;
 	}
 
-	inline void ResourceData::SetState(ResourceStatus::States state)
+	inline void ResourceManager::Mount(const std::filesystem::path& archive)
 	{
-		REKSI_LOCK_SHARED_AUTO;
+		auto mounted = CreateShared<const ResourceArchive>(archive);
 
-		m_Status.Set(state);
+		REKSI_LOCK_UNIQUE(m_ArchiveMutex, lock);
+		m_Archives.push_back(std::move(mounted));
 	}
 
-	inline void ResourceData::ClearState(ResourceStatus::States state)
+	inline void ResourceManager::RegisterCodec(SharedPtr<const BlockCodec> codec)
 	{
-		REKSI_LOCK_SHARED_AUTO;
+		REKSI_LOCK_UNIQUE(m_ArchiveMutex, lock);
 
-		m_Status.Clear(state);
+		const uint32_t id = codec->GetId();
+		m_Codecs[id] = std::move(codec);
 	}
 
-	/*
-	 * If not loaded, goes ahead and loads the resource
-	 * If loading on another thread, waits for the load to complete
-	 * If already loaded, reloads the resource
-	 * If reloading on another thread, returns immediately
-	 */
-	inline ResourceLoadStatus ResourceData::LoadInternal()
+	inline SharedPtr<const ResourceArchive> ResourceManager::FindArchived(std::string_view name, uint64_t hash,
+	                                                                      size_t& index) const
 	{
-		std::filesystem::path res_path;
-		RLS out;
+		REKSI_LOCK_SHARED(m_ArchiveMutex, lock);
 
+		for ( auto itr = m_Archives.rbegin(); itr != m_Archives.rend(); ++itr )
 		{
-			REKSI_LOCK_UNIQUE_AUTO;
+			index = (*itr)->Find(name, hash);
+			if ( index != ResourceArchive::NotFound ) return *itr;
+		}
 
-			// Resource is marked for delete
-			if ( m_Status.Is(RS::MarkedForDelete) )
-			{
-				return out.Set(RLS::MarkedForDelete);
-			}
-			// Resource is previously not loaded and loading, wait for load to complete
-			if ( !m_Status.Is(RS::Loaded) && m_Status.Is(RS::Loading) )
-			{
-				REKSI_CV_WAIT_AUTO([&] { return m_Status.Is(RS::Loaded); });
-				return out.Set(RLS::WaitedForLoad);
-			}
-			// Resource is previously loaded and loading, return already reloading
-			if ( m_Status.Is(RS::Loaded) && m_Status.Is(RS::Loading) )
-			{
-				return out.Set(RLS::AlreadyReloading).Set(RLS::Reloaded);
-			}
+		return nullptr;
+	}
 
-			// If already loaded
-			if ( m_Status.Is(RS::Loaded) )
-			{
-				out.Set(RLS::Reloaded);
-			}
-			m_Status.Set(RS::Loading).Clear(RS::MarkedForReload);
-			res_path = m_Path;
+	inline bool ResourceManager::ReadArchived(const ResourceArchive& archive, size_t index, ByteBuffer& buffer,
+	                                          ByteSpan& bytes) const
+	{
+		if ( !archive.IsCompressed(index) )
+		{
+			bytes = archive.GetBytes(index);
+			return true;
 		}
 
-		// Load the resource
-		const auto data = m_Loader(res_path);
+		SharedPtr<const BlockCodec> codec;
 
 		{
-			REKSI_LOCK_UNIQUE_AUTO;
+			REKSI_LOCK_SHARED(m_ArchiveMutex, lock);
 
-			m_Status.Clear(RS::Loading);
+			auto itr = m_Codecs.find(archive.GetEntry(index).Codec);
+			if ( itr == m_Codecs.end() ) return false;
+			codec = itr->second;
+		}
 
-			// In case of load failure, clear the loading state
-			if ( data )
+		buffer.resize(static_cast<size_t>(archive.GetEntry(index).Size));
+		std::atomic<bool> success{true};
+
+		m_Scheduler->ParallelFor(archive.GetBlockCount(index), [&](size_t block)
+		{
+			if ( !archive.DecompressBlock(index, block, *codec, buffer.data()) )
 			{
-				m_Data = data;
-				m_Status.Set(RS::Loaded);
-				out.Set(RLS::Success);
+				success.store(false, std::memory_order_relaxed);
 			}
-		}
-
-		// Loading is complete, send Condition Variable signal
-		REKSI_CV_NOTIFY_ALL_AUTO;
+		});
 
-		return out;
+		bytes = ByteSpan{buffer.data(), buffer.size()};
+		return success.load(std::memory_order_relaxed);
 	}
 
-	inline ResourceUnloadStatus ResourceData::UnloadInternal()
+	inline bool ResourceData::LoadFromArchive(SharedPtr<void>& data) const
 	{
-		REKSI_LOCK_UNIQUE_AUTO;
+		size_t index;
+		const auto archive = m_Creator->FindArchived(m_Name, m_Key.Hash, index);
+		if ( !archive ) return false;
 
-		m_Data.reset();
-		m_Status.Clear(ResourceStatus::Loaded);
-		return ResourceUnloadStatus::Success;
+		ByteBuffer buffer;
+		ByteSpan bytes;
+		if ( m_Creator->ReadArchived(*archive, index, buffer, bytes) )
+		{
+			data = m_Loaders->LoadBuffer(GetPath(), bytes);
+		}
+		return true;
 	}
 
-	inline ResourceStatus& ResourceStatus::Set(States state)
+	inline void ResourceManager::Compact()
 	{
-		State |= state;
-		return *this;
+		m_Resources.Compact();
+		m_ResourcePaths.Compact([this](ResourceHandleT handle, std::string_view path)
+		{
+			if ( ResourceData* data = m_Resources.Get(handle) ) data->m_Name = path;
+		});
 	}
 
-	inline bool ResourceStatus::Is(States state) const
+	inline LoadFuture ResourceManager::LoadAsync(ResourceHandleT handle, LoadPriority priority)
 	{
-		return static_cast<bool>(this->State & state);
+		ResourceData* data = m_Resources.Get(handle);
+		if ( !data ) return LoadFuture();
+
+		return LoadAsyncImpl(data, priority);
 	}
 
-	inline ResourceStatus& ResourceStatus::Clear(States state)
+	template <typename T>
+	ResourceFuture<T> ResourceManager::LoadAsync(const Resource<T>& resource, LoadPriority priority)
 	{
-		State &= ~state;
-		return *this;
+		return ResourceFuture<T>{resource, LoadAsyncImpl(resource.m_Data, priority)};
 	}
 
-	inline ResourceLoadStatus& ResourceLoadStatus::Set(States state)
+	template <typename T>
+	ResourceFuture<T> ResourceManager::LoadAsync(const ResourcePathView& path, LoadPriority priority)
 	{
-		State |= state;
-		return *this;
+		return LoadAsync(GetResource<T>(path), priority);
 	}
 
-	inline bool ResourceLoadStatus::Is(States state) const
+	inline LoadFuture ResourceManager::LoadAsyncImpl(ResourceData* data, LoadPriority priority)
 	{
-		return static_cast<bool>(this->State & state);
+		bool created;
+		auto task = data->GetOrCreatePendingLoad(created);
+		if ( !created )
+		{
+			m_Scheduler->Promote(task, priority);
+			return LoadFuture{std::move(task)};
+		}
+
+		// Queued once the file is read ahead and the dependencies finished loading, successfully or not
+		// Promoting it meanwhile loads it right away, the dependencies inline and without the read ahead
+		auto remaining = CreateShared<std::atomic<size_t>>(1);
+		auto ready = [this, task, priority, remaining]
+		{
+			if ( remaining->fetch_sub(1, std::memory_order_acq_rel) != 1 ) return;
+
+			// A dependency cancelled by the scheduler shutting down cancels the dependent as well
+			if ( m_ShuttingDown.load(std::memory_order_acquire) )
+			{
+				task->Cancel();
+				return;
+			}
+			m_Scheduler->Submit(task, priority);
+		};
+
+		size_t archived;
+		if ( data->HasBufferLoader() && !FindArchived(data->GetName(), data->GetKey().Hash, archived) )
+		{
+			remaining->fetch_add(1, std::memory_order_relaxed);
+			m_FileReader->ReadAsync(data->GetPath(), [task, ready](ByteBuffer buffer, bool success)
+			{
+				// A failed read is left to the loader, which reports the error
+				if ( success ) task->SetPrefetched(std::move(buffer));
+				ready();
+			});
+		}
+
+		for ( const ResourceHandleT handle : GetDependencies(data->GetHandle()) )
+		{
+			ResourceData* dependency = m_Resources.Get(handle);
+			if ( !dependency || dependency->IsState(ResourceStatus::States::Loaded) ) continue;
+
+			remaining->fetch_add(1, std::memory_order_relaxed);
+			const LoadFuture future = LoadAsyncImpl(dependency, priority);
+			if ( !future.ContinueWith([ready](ResourceLoadStatus) { ready(); }) ) ready();
+		}
+
+		ready();
+		return LoadFuture{std::move(task)};
 	}
 
-	inline ResourceLoadStatus& ResourceLoadStatus::Clear(States state)
+	inline bool ResourceManager::AddDependency(ResourceHandleT dependent, ResourceHandleT dependency)
 	{
-		State &= ~state;
-		return *this;
-	}
-}
-#pragma endregion
+		if ( dependent == dependency || !m_Resources.IsValid(dependent) || !m_Resources.IsValid(dependency) )
+		{
+			return false;
+		}
 
+		REKSI_LOCK_UNIQUE(m_DependencyMutex, lock);
 
-#pragma region Defer
-// Implementation
-namespace Reksi
-{
-	template <typename T>
-	SharedPtr<T> Resource<T>::GetRef()
+		auto& dependencies = m_Dependencies[dependent];
+		if ( std::find(dependencies.begin(), dependencies.end(), dependency) != dependencies.end() ) return true;
+
+		// Walk everything the dependency depends on, finding the dependent there would close a cycle
+		std::vector<ResourceHandleT> stack{dependency};
+		std::vector<ResourceHandleT> visited;
+		while ( !stack.empty() )
+		{
+			const ResourceHandleT handle = stack.back();
+			stack.pop_back();
+
+			if ( handle == dependent ) return false;
+			if ( std::find(visited.begin(), visited.end(), handle) != visited.end() ) continue;
+			visited.push_back(handle);
+
+			auto itr = m_Dependencies.find(handle);
+			if ( itr != m_Dependencies.end() ) stack.insert(stack.end(), itr->second.begin(), itr->second.end());
+		}
+
+		dependencies.push_back(dependency);
+		m_Dependents[dependency].push_back(dependent);
+		return true;
+	}
+
+	inline void ResourceManager::RemoveDependency(ResourceHandleT dependent, ResourceHandleT dependency)
 	{
-		assert(IsValid());
+		REKSI_LOCK_UNIQUE(m_DependencyMutex, lock);
+
+		auto erase = [](std::unordered_map<ResourceHandleT, std::vector<ResourceHandleT>>& edges,
+		                ResourceHandleT from, ResourceHandleT to)
+		{
+			auto itr = edges.find(from);
+			if ( itr == edges.end() ) return;
 
-		auto ref = m_Data->GetData<T>();
-		// If data is valid, return it, else try to get a default resource from the manager
-		if ( ref ) return ref;
+			auto& handles = itr->second;
+			handles.erase(std::remove(handles.begin(), handles.end(), to), handles.end());
+			if ( handles.empty() ) edges.erase(itr);
+		};
 
-		ref = m_Manager->GetDefaultResource<T>();
-		return ref;
+		erase(m_Dependencies, dependent, dependency);
+		erase(m_Dependents, dependency, dependent);
 	}
 
-	template <typename T>
-	T& Resource<T>::operator*()
+	inline std::vector<ResourceHandleT> ResourceManager::GetDependencies(ResourceHandleT handle) const
 	{
-		return *GetRef();
+		REKSI_LOCK_SHARED(m_DependencyMutex, lock);
+
+		auto itr = m_Dependencies.find(handle);
+		if ( itr == m_Dependencies.end() ) return {};
+		return itr->second;
 	}
 
-	template <typename T>
-	ResourceStatus Resource<T>::GetStatus() const
+	inline std::vector<ResourceHandleT> ResourceManager::GetDependents(ResourceHandleT handle) const
 	{
-		assert(IsValid());
+		REKSI_LOCK_SHARED(m_DependencyMutex, lock);
 
-		return m_Data->GetStatus();
+		auto itr = m_Dependents.find(handle);
+		if ( itr == m_Dependents.end() ) return {};
+		return itr->second;
 	}
 
-	template <typename T>
-	bool Resource<T>::IsLoaded() const
+	inline void ResourceManager::RemoveDependencies(ResourceHandleT handle)
 	{
-		assert(IsValid());
+		for ( const ResourceHandleT dependency : GetDependencies(handle) )
+		{
+			RemoveDependency(handle, dependency);
+		}
+		for ( const ResourceHandleT dependent : GetDependents(handle) )
+		{
+			RemoveDependency(dependent, handle);
+		}
+	}
 
-		return m_Data->IsState(ResourceStatus::States::Loaded);
+	inline bool ResourceData::LoadDependencies()
+	{
+		for ( const ResourceHandleT handle : m_Creator->GetDependencies(m_Handle) )
+		{
+			ResourceData* dependency = m_Creator->m_Resources.Get(handle);
+			if ( !dependency ) continue;
+
+			if ( !dependency->IsState(RS::Loaded) ) dependency->LoadOrWaitForPending();
+			if ( !dependency->IsState(RS::Loaded) ) return false;
+		}
+
+		return true;
 	}
 
-	template <typename T>
-	bool Resource<T>::IsValid() const
+	inline void ResourceData::ReloadDependents()
 	{
-		return this->m_Manager->IsValid(m_Handle);
+		for ( const ResourceHandleT handle : m_Creator->GetDependents(m_Handle) )
+		{
+			ResourceData* dependent = m_Creator->m_Resources.Get(handle);
+			if ( dependent && dependent->IsState(RS::Loaded) ) m_Creator->LoadAsyncImpl(dependent, LoadPriority::Visible);
+		}
 	}
 
-	template <typename T>
-	ResourceLoadStatus Resource<T>::Load()
+	inline std::filesystem::path ResourceData::GetPath() const
 	{
-		assert(IsValid());
+		return m_Creator->m_BasePath / m_Name;
+	}
 
-		return m_Data->Load();
+	inline void ResourceData::UpdateResidentSize(size_t oldSize, size_t newSize)
+	{
+		if ( newSize >= oldSize )
+		{
+			m_Creator->m_ResidentBytes.fetch_add(newSize - oldSize, std::memory_order_relaxed);
+		}
+		else
+		{
+			m_Creator->m_ResidentBytes.fetch_sub(oldSize - newSize, std::memory_order_relaxed);
+		}
 	}
 
-	template <typename T>
-	ResourceUnloadStatus Resource<T>::Unload()
+	inline void ResourceData::EnforceMemoryBudget()
 	{
-		assert(IsValid());
+		m_Creator->EnforceMemoryBudget();
+	}
 
-		return m_Data->Unload();
+	inline void ResourceData::LoadOrWaitForPending()
+	{
+		// Waiting for the promoted load is cheaper than loading twice
+		const auto pending = GetPendingLoad();
+		if ( pending && m_Creator->PromoteLoad(pending) )
+		{
+			pending->Wait();
+			return;
+		}
+
+		Load();
 	}
 
-	template <typename T>
-	ResourceLoadStatus Resource<T>::Reload()
+	inline bool ResourceManager::PromoteLoad(const SharedPtr<LoadTask>& task)
 	{
-		assert(IsValid());
+		// Blocking a worker on the queue it is supposed to drain could deadlock
+		if ( m_Scheduler->IsWorkerThread() ) return false;
 
-		m_Data->WaitUntilCurrentLoading();
-		return m_Data->Load();
+		m_Scheduler->Promote(task, LoadPriority::Critical);
+		return true;
 	}
 
 	template <typename T>
-	std::filesystem::path Resource<T>::GetPath() const
+	ResourceRequest ResourceRequest::Of(std::filesystem::path path)
 	{
-		assert(IsValid());
-
-		return m_Data->GetPath();
+		return ResourceRequest{std::move(path), GetResourceTypeId<T>()};
 	}
 
 	template <typename T>
-	ResourceLoadFunc<T> Resource<T>::GetLoader() const
+	SharedPtr<T> ResourceManager::GetDefaultResource() const
 	{
-		assert(IsValid());
+		const ResourceTypeId type = GetResourceTypeId<T>();
 
-		return m_Data->GetLoader<T>();
+		REKSI_LOCK_SHARED(m_LoaderResourceMutex, lock);
+
+		if ( type >= m_DefaultResources.size() ) return nullptr;
+		return StaticSharedCast<T>(m_DefaultResources[type]);
 	}
 
 	template <typename T>
-	ResourceManager* Resource<T>::GetManager() const
+	void ResourceManager::SetDefaultResource(const SharedPtr<T>& resource)
 	{
-		return m_Manager;
+		const ResourceTypeId type = GetResourceTypeId<T>();
+
+		REKSI_LOCK_UNIQUE(m_LoaderResourceMutex, lock);
+
+		if ( type >= m_DefaultResources.size() ) m_DefaultResources.resize(type + 1);
+		m_DefaultResources[type] = resource;
 	}
 
 	template <typename T>
-	ResourceHandleT Resource<T>::GetHandle() const
+	ResourceLoadFunc<T> ResourceManager::GetDefaultLoader() const
 	{
-		return m_Handle;
+		return ResourceData::MakeLoadFunc<T>(GetDefaultLoaderImpl<T>());
 	}
 
-	template <typename T>
-	void Resource<T>::AddListener(ResourceListener* listener)
+	template <typename T, typename Func>
+	void ResourceManager::SetDefaultLoader(Func&& loader)
 	{
-		assert(IsValid());
+		// Built outside the lock, resources created meanwhile keep sharing the previous loader
+		ResourceData::LoadersPtr loaders = ResourceData::MakeLoaders<T>(std::forward<Func>(loader));
+		const ResourceTypeId type = GetResourceTypeId<T>();
 
-		m_Data->AddListener(listener);
+		REKSI_LOCK_UNIQUE(m_LoaderResourceMutex, lock);
+
+		if ( type >= m_DefaultLoaders.size() ) m_DefaultLoaders.resize(type + 1);
+		m_DefaultLoaders[type] = std::move(loaders);
 	}
 
 	template <typename T>
-	void Resource<T>::RemoveListener(ResourceListener* listener)
+	void ResourceManager::SetDefaultLoader()
 	{
-		assert(IsValid());
+		// Assert that T has a constructor that takes a path
+		static_assert(std::is_constructible_v<T, const std::filesystem::path&>,
+		              "T must have a constructor that takes a path");
 
-		m_Data->RemoveListener(listener);
+		SetDefaultLoader<T>([](const std::filesystem::path& path) -> SharedPtr<T>
+		{
+			return CreateShared<T>(path);
+		});
 	}
 
-	template <typename T>
-	void Resource<T>::ClearListeners()
+	template <typename T, typename Func>
+	void ResourceManager::SetDefaultBufferLoader(Func&& loader)
 	{
-		assert(IsValid());
+		static_assert(std::is_invocable_r_v<SharedPtr<T>, Func&, const std::filesystem::path&, ByteSpan>,
+		              "The loader must return a SharedPtr<T> from a path and the file contents");
 
-		m_Data->ClearListeners();
+		SetDefaultLoader<T>(std::forward<Func>(loader));
 	}
 
 	template <typename T>
-	Resource<T>::Resource(ResourceHandleT handle, ResourceData* data, ResourceManager* manager)
-		: m_Handle(handle), m_Data(data), m_Manager(manager)
+	ResourceData::LoadersPtr ResourceManager::GetDefaultLoaderImpl() const
 	{
-	}
+		const ResourceTypeId type = GetResourceTypeId<T>();
+
+		REKSI_LOCK_SHARED(m_LoaderResourceMutex, lock);
 
+		if ( type >= m_DefaultLoaders.size() ) return {};
+		return m_DefaultLoaders[type];
+	}
 }
 #pragma endregion
 
@@ -942,216 +7087,418 @@ namespace Reksi
 #pragma region Defer
 namespace Reksi
 {
-	inline ResourceManager::ResourceManager(std::filesystem::path basePath)
-		: m_BasePath(std::move(basePath)), m_ValidityMask({0}), m_NextHandle(1)
+	inline ReloadCoalescer::ReloadCoalescer(ResourceManager& manager, std::chrono::milliseconds window)
+		: m_Manager(manager), m_Window(window)
 	{
 	}
 
-	inline bool ResourceManager::IsValid(ResourceHandleT handle) const
+	inline void ReloadCoalescer::Notify(ResourceHandleT handle, Clock::time_point now)
 	{
-		return GetValidityImpl(handle);
+		REKSI_LOCK_UNIQUE_AUTO;
+
+		m_Pending[handle] = now + m_Window;
 	}
 
-	inline ResourceHandleT ResourceManager::GetHandle(const std::filesystem::path& path) const
+	inline size_t ReloadCoalescer::Flush(Clock::time_point now)
 	{
-		REKSI_LOCK_SHARED_AUTO;
+		std::vector<ResourceHandleT> due;
 
-		auto itr = m_ResourcePaths.find(path);
-		if ( itr == m_ResourcePaths.end() ) return 0;
-		return itr->second;
+		{
+			REKSI_LOCK_UNIQUE_AUTO;
+
+			for ( auto it = m_Pending.begin(); it != m_Pending.end(); )
+			{
+				if ( it->second > now )
+				{
+					++it;
+					continue;
+				}
+
+				due.push_back(it->first);
+				it = m_Pending.erase(it);
+			}
+		}
+
+		// Each reload is queued as the resource's pending load, which its destructor waits for,
+		// so the resource stays alive once the eviction lock is left
+		std::vector<SharedPtr<LoadTask>> reloads;
+
+		{
+			REKSI_LOCK_UNIQUE(m_Manager.m_EvictionMutex, lock);
+
+			for ( const ResourceHandleT handle : due )
+			{
+				// Resources which were never loaded stay that way
+				ResourceData* data = m_Manager.m_Resources.Get(handle);
+				if ( !data || !data->GetStatus().Is(ResourceStatus::Loaded) ) continue;
+
+				bool created;
+				SharedPtr<LoadTask> task = data->GetOrCreatePendingLoad(created);
+				if ( created )
+				{
+					reloads.push_back(std::move(task));
+					continue;
+				}
+
+				// A load queued already may be reading the old file, it reloads once more after finishing
+				data->SetState(ResourceStatus::MarkedForReload);
+			}
+		}
+
+		// Reloading a resource which is reloading already marks it for a trailing reload instead of waiting
+		// A task promoted by a LoadAsync caller meanwhile is only run once
+		m_Manager.m_Scheduler->ParallelFor(reloads.size(), [&reloads](size_t i)
+		{
+			reloads[i]->Execute();
+		}, LoadPriority::Visible);
+
+		return reloads.size();
 	}
 
-	inline bool ResourceManager::GetValidityImpl(ResourceHandleT handle) const
+	inline std::chrono::milliseconds ReloadCoalescer::GetTimeUntilNext(Clock::time_point now) const
 	{
-		REKSI_LOCK_SHARED(m_ValidMaskMutex, lock);
+		REKSI_LOCK_SHARED_AUTO;
+
+		if ( m_Pending.empty() ) return std::chrono::milliseconds(-1);
 
-		if ( handle / 64 >= m_ValidityMask.size() || handle == 0 ) return false;
-		return m_ValidityMask[handle / 64] & (1ull << (handle % 64));
+		Clock::time_point next = Clock::time_point::max();
+		for ( const auto& pending : m_Pending )
+		{
+			next = std::min(next, pending.second);
+		}
+
+		if ( next <= now ) return std::chrono::milliseconds(0);
+		return std::chrono::ceil<std::chrono::milliseconds>(next - now);
 	}
 
-	inline void ResourceManager::SetValidityImpl(ResourceHandleT handle, bool valid)
+	inline size_t ReloadCoalescer::GetPendingCount() const
 	{
-		REKSI_LOCK_UNIQUE(m_ValidMaskMutex, lock);
+		REKSI_LOCK_SHARED_AUTO;
 
-		if ( handle / 64 == m_ValidityMask.size() )
+		return m_Pending.size();
+	}
+
+#if REKSI_PLATFORM_LINUX == 1
+	inline ResourceWatcher::ResourceWatcher(ResourceManager& manager, std::chrono::milliseconds debounce,
+	                                        std::chrono::milliseconds interval)
+		: m_Manager(manager), m_Coalescer(manager, debounce), m_Interval(interval), m_Stopping(false), m_Inotify(-1),
+		  m_WakeEvent(-1)
+	{
+		m_Inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		m_WakeEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if ( m_Inotify < 0 || m_WakeEvent < 0 )
 		{
-			m_ValidityMask.push_back(0);
+			if ( m_Inotify >= 0 ) close(m_Inotify);
+			if ( m_WakeEvent >= 0 ) close(m_WakeEvent);
+			throw std::runtime_error("ResourceWatcher: Failed to create inotify instance");
 		}
-		else if ( handle / 64 > m_ValidityMask.size() )
+
+		AddDirectories("");
+		if ( m_Directories.empty() )
 		{
-			// resize the vector and set all bits to 0
-			m_ValidityMask.resize(handle / 64 + 1, 0);
+			close(m_Inotify);
+			close(m_WakeEvent);
+			throw std::runtime_error("ResourceWatcher: Failed to watch the base path");
 		}
 
-		// Set the bit to the valid bool
-		auto mask = 1ull << (handle % 64);
-		m_ValidityMask[handle / 64] = (m_ValidityMask[handle / 64] & (~mask)) | (valid ? mask : 0);
+#if REKSI_THREADING == 1
+		m_Thread = std::thread([this]()
+		{
+			while ( !m_Stopping.load(std::memory_order_acquire) )
+			{
+				Poll(std::chrono::milliseconds(-1));
+			}
+		});
+#endif
 	}
 
-	template <typename T>
-	Resource<T> ResourceManager::GetResource(const std::filesystem::path& path, const ResourceLoadFunc<T>& loader)
+	inline ResourceWatcher::~ResourceWatcher()
 	{
-		REKSI_LOCK_UNIQUE_AUTO;
-
-		// Check if the resource already exists
-		auto itr = m_ResourcePaths.find(path);
-		if ( itr != m_ResourcePaths.end() )
-		{
-			auto handle = itr->second;
-			ResourceData* data = m_Resources[handle].get();
-			return Resource<T>{handle, data, this};
-		}
+		m_Stopping.store(true, std::memory_order_release);
+#if REKSI_THREADING == 1
+		const uint64_t wake = 1;
+		[[maybe_unused]] const ssize_t written = write(m_WakeEvent, &wake, sizeof(wake));
+		m_Thread.join();
+#endif
 
-		// Create a new resource
-		uint32_t handle = m_NextHandle++;
-		ResourceData* data = new ResourceData{handle, m_BasePath / path, loader, this, typeid(T)};
-		m_Resources[handle] = UniquePtr<ResourceData>{data};
-		m_ResourcePaths[path] = handle;
-		SetValidityImpl(handle, true);
-		return Resource<T>{handle, data, this};
+		close(m_Inotify);
+		close(m_WakeEvent);
 	}
 
-	template <typename T>
-	Resource<T> ResourceManager::GetResource(const std::filesystem::path& path)
+	inline size_t ResourceWatcher::Poll(std::chrono::milliseconds timeout)
 	{
+		pollfd fds[2] = {{m_Inotify, POLLIN, 0}, {m_WakeEvent, POLLIN, 0}};
+		const int ready = poll(fds, 2, static_cast<int>(GetWaitTime(timeout).count()));
+		if ( ready > 0 && (fds[1].revents & POLLIN) ) return 0;
+
+		bool overflow = false;
+		std::string path;
+		const auto now = ReloadCoalescer::Clock::now();
+
+		alignas(inotify_event) char buffer[64 * 1024];
+		while ( ready > 0 )
 		{
-			REKSI_LOCK_SHARED_AUTO;
+			const ssize_t size = read(m_Inotify, buffer, sizeof(buffer));
+			if ( size <= 0 ) break;
 
-			// Check if the resource already exists
-			auto itr = m_ResourcePaths.find(path);
-			if ( itr != m_ResourcePaths.end() )
+			for ( ssize_t offset = 0; offset < size; )
 			{
-				auto handle = itr->second;
-				ResourceData* data = m_Resources[handle].get();
-				return Resource<T>{handle, data, this};
+				const auto event = reinterpret_cast<const inotify_event*>(buffer + offset);
+				offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+				if ( event->mask & IN_Q_OVERFLOW )
+				{
+					overflow = true;
+					continue;
+				}
+
+				const auto directory = m_Directories.find(event->wd);
+				if ( directory == m_Directories.end() ) continue;
+
+				// The kernel drops the watch once the directory is gone
+				if ( event->mask & IN_IGNORED )
+				{
+					m_Directories.erase(directory);
+					continue;
+				}
+				if ( event->len == 0 ) continue;
+
+				path = directory->second;
+				if ( !path.empty() ) path += '/';
+				path += event->name;
+
+				if ( event->mask & IN_ISDIR )
+				{
+					AddDirectories(path);
+				}
+				else if ( const ResourceHandleT handle = m_Manager.GetHandle(ResourcePathView{path}) )
+				{
+					m_Coalescer.Notify(handle, now);
+				}
 			}
 		}
 
-		// Need to have the loader, try to get it from the default loaders
-		ResourceData::LoadFunc loader = GetDefaultLoaderImpl<T>();
-		if ( !loader )
+		// Events were lost, any file may have changed
+		if ( overflow )
 		{
-			assert(false);
+			for ( const ResourceHandleT handle : GetLoadedResources() )
+			{
+				m_Coalescer.Notify(handle, now);
+			}
 		}
 
+		return m_Coalescer.Flush();
+	}
+
+	inline void ResourceWatcher::AddDirectories(const std::string& relative)
+	{
+		const std::filesystem::path& base = m_Manager.m_BasePath;
+		const std::filesystem::path full = relative.empty() ? base : base / relative;
+
+		// Files are reported once written and closed, or once moved in, which covers editors saving by rename
+		const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_ONLYDIR;
+		const int watch = inotify_add_watch(m_Inotify, full.c_str(), mask);
+		if ( watch < 0 ) return;
+		m_Directories[watch] = relative;
+
+		std::error_code error;
+		for ( std::filesystem::directory_iterator it{full, error}, end; !error && it != end; it.increment(error) )
 		{
-			REKSI_LOCK_UNIQUE_AUTO;
+			if ( !it->is_directory(error) || it->is_symlink(error) ) continue;
 
-			// Create the resource
-			uint32_t handle = m_NextHandle++;
-			auto data = new ResourceData{handle, m_BasePath / path, loader, this, typeid(T)};
-			m_Resources[handle] = UniquePtr<ResourceData>{data};
-			m_ResourcePaths[path] = handle;
-			SetValidityImpl(handle, true);
-			return Resource<T>{handle, data, this};
+			const std::string name = it->path().filename().string();
+			AddDirectories(relative.empty() ? name : relative + '/' + name);
 		}
 	}
-
-	template <typename T>
-	void ResourceManager::DeleteResource(const Resource<T>& resource)
+#else
+	inline ResourceWatcher::ResourceWatcher(ResourceManager& manager, std::chrono::milliseconds debounce,
+	                                        std::chrono::milliseconds interval)
+		: m_Manager(manager), m_Coalescer(manager, debounce), m_Interval(interval), m_Stopping(false)
 	{
-		REKSI_LOCK_UNIQUE_AUTO;
+		std::error_code error;
+		if ( !std::filesystem::is_directory(m_Manager.m_BasePath, error) )
+		{
+			throw std::runtime_error("ResourceWatcher: Failed to watch the base path");
+		}
 
-		// Check if resource is already deleted
-		if ( !GetValidityImpl(resource.m_Handle) ) return;
+#if REKSI_THREADING == 1
+		m_Thread = std::thread([this]()
+		{
+			while ( !m_Stopping.load(std::memory_order_acquire) )
+			{
+				Poll(m_Interval);
+			}
+		});
+#endif
+	}
 
-		// If not, delete the resource
-		// Set validity to false
-		SetValidityImpl(resource.m_Handle, false);
-		// Remove the resource from the resource paths
-		auto path = resource.m_Data->GetPath();
-		// Remove the base path from the path
-		path = path.string().substr(m_BasePath.string().size());
-		m_ResourcePaths.erase(path);
-		// Remove the resource from the resources
-		m_Resources.erase(resource.m_Handle); // UniquePtr will delete the resource
+	inline ResourceWatcher::~ResourceWatcher()
+	{
+#if REKSI_THREADING == 1
+		{
+			REKSI_LOCK_UNIQUE_AUTO;
+			m_Stopping.store(true, std::memory_order_release);
+		}
+		REKSI_CV_NOTIFY_ALL_AUTO;
+		m_Thread.join();
+#endif
 	}
 
-	inline void ResourceManager::MarkForDelete(ResourceHandleT handle)
+	inline size_t ResourceWatcher::Poll(std::chrono::milliseconds timeout)
 	{
-		if ( !GetValidityImpl(handle) ) return;
+		// Without change notifications the next change is only seen by polling
+		const std::chrono::milliseconds wait = GetWaitTime(timeout.count() < 0 ? m_Interval : timeout);
+#if REKSI_THREADING == 1
+		{
+			REKSI_LOCK_UNIQUE_AUTO;
+			REKSI_CV_AUTO_NAME.wait_for(REKSI_LOCK_AUTO_NAME, wait, [this]()
+			{
+				return m_Stopping.load(std::memory_order_acquire);
+			});
+			if ( m_Stopping.load(std::memory_order_acquire) ) return 0;
+		}
+#else
+		std::this_thread::sleep_for(wait);
+#endif
 
-		REKSI_LOCK_UNIQUE_AUTO;
+		std::unordered_map<ResourceHandleT, std::filesystem::file_time_type> writeTimes;
+		const auto now = ReloadCoalescer::Clock::now();
 
-		auto data = m_Resources[handle].get();
-		data->SetState(ResourceStatus::MarkedForDelete);
-		data->ClearState(ResourceStatus::MarkedForReload);
+		for ( const ResourceHandleT handle : GetLoadedResources() )
+		{
+			const ResourceData* data = m_Manager.m_Resources.Get(handle);
+			if ( !data ) continue;
+
+			std::error_code error;
+			const auto time = std::filesystem::last_write_time(data->GetPath(), error);
+			if ( error ) continue;
+
+			// Resources seen for the first time are taken as up to date
+			const auto last = m_WriteTimes.find(handle);
+			if ( last != m_WriteTimes.end() && last->second != time ) m_Coalescer.Notify(handle, now);
+			writeTimes.emplace(handle, time);
+		}
+
+		// Drops the deleted and unloaded resources
+		m_WriteTimes = std::move(writeTimes);
+
+		return m_Coalescer.Flush();
 	}
+#endif
 
-	inline void ResourceManager::Reload(ResourceHandleT handle)
+	inline std::vector<ResourceHandleT> ResourceWatcher::GetLoadedResources() const
 	{
-		if ( !GetValidityImpl(handle) ) ResourceLoadStatus();
+		std::vector<ResourceHandleT> handles;
+
+		REKSI_LOCK_UNIQUE(m_Manager.m_EvictionMutex, lock);
 
-		ResourceData* data;
+		const uint32_t end = m_Manager.m_Resources.GetIndexEnd();
+		for ( uint32_t index = 0; index < end; ++index )
 		{
-			REKSI_LOCK_UNIQUE_AUTO;
-			data = m_Resources[handle].get();
+			const ResourceData* data = m_Manager.m_Resources.GetAt(index);
+			if ( data && data->GetStatus().Is(ResourceStatus::Loaded) ) handles.push_back(data->GetHandle());
 		}
-		data->WaitUntilCurrentLoading();
-		data->Load();
+
+		return handles;
 	}
 
-	template <typename T>
-	SharedPtr<T> ResourceManager::GetDefaultResource() const
+	inline std::chrono::milliseconds ResourceWatcher::GetWaitTime(std::chrono::milliseconds timeout) const
 	{
-		REKSI_LOCK_SHARED(m_LoaderResourceMutex, lock);
+		const std::chrono::milliseconds next = m_Coalescer.GetTimeUntilNext();
+		if ( next.count() < 0 ) return timeout;
+		if ( timeout.count() < 0 ) return next;
+		return std::min(timeout, next);
+	}
+}
+#pragma endregion
+
+
+#pragma region Defer
+#if REKSI_COROUTINES == 1
+namespace Reksi
+{
+	inline LoadFutureAwaiter::LoadFutureAwaiter(LoadFuture future)
+		: m_Future(std::move(future))
+	{
+	}
 
-		auto itr = m_DefaultResources.find(typeid(T));
-		if ( itr == m_DefaultResources.end() ) return nullptr;
-		return StaticSharedCast<T>(itr->second);
+	inline bool LoadFutureAwaiter::await_ready() const
+	{
+		return !m_Future.IsValid() || m_Future.IsReady();
 	}
 
-	template <typename T>
-	void ResourceManager::SetDefaultResource(const SharedPtr<T>& resource)
+	inline bool LoadFutureAwaiter::await_suspend(std::coroutine_handle<> handle)
 	{
-		REKSI_LOCK_UNIQUE(m_LoaderResourceMutex, lock);
+		// Completed in the meantime, continue without suspending
+		return m_Future.ContinueWith([handle](ResourceLoadStatus) { handle.resume(); });
+	}
 
-		m_DefaultResources[typeid(T)] = resource;
+	inline ResourceLoadStatus LoadFutureAwaiter::await_resume() const
+	{
+		if ( !m_Future.IsValid() ) return ResourceLoadStatus();
+		return m_Future.Get();
 	}
 
 	template <typename T>
-	ResourceLoadFunc<T> ResourceManager::GetDefaultLoader() const
+	ResourceAwaiter<T>::ResourceAwaiter(Resource<T> resource)
+		: m_Resource(std::move(resource))
 	{
-		auto loader = GetDefaultLoaderImpl<T>();
-		if ( !loader ) return nullptr;
-		return [loader](const std::filesystem::path& path) -> SharedPtr<T>
-		{
-			return StaticSharedCast<T>(loader(path));
-		};
 	}
 
 	template <typename T>
-	void ResourceManager::SetDefaultLoader(const ResourceLoadFunc<T>& loader)
+	ResourceAwaiter<T>::ResourceAwaiter(ResourceFuture<T> future)
+		: m_Resource(future.GetResource()), m_Future(std::move(future))
 	{
-		REKSI_LOCK_UNIQUE(m_LoaderResourceMutex, lock);
+	}
 
-		m_DefaultLoaders[typeid(T)] = loader;
+	template <typename T>
+	bool ResourceAwaiter<T>::await_ready() const
+	{
+		if ( m_Future.IsValid() ) return m_Future.IsReady();
+		return m_Resource.IsLoaded();
 	}
 
 	template <typename T>
-	void ResourceManager::SetDefaultLoader()
+	bool ResourceAwaiter<T>::await_suspend(std::coroutine_handle<> handle)
 	{
-		// Assert that T has a constructor that takes a path
-		static_assert(std::is_constructible_v<T, const std::filesystem::path&>,
-		              "T must have a constructor that takes a path");
+		auto resume = [handle](ResourceLoadStatus) { handle.resume(); };
 
-		ResourceData::LoadFunc loader = [](const std::filesystem::path& path) -> SharedPtr<T>
+		if ( !m_Future.IsValid() )
 		{
-			return CreateShared<T>(path);
-		};
+			// Ride along with a load which is already running
+			if ( m_Resource.m_Data->ContinueAfterLoad(resume) ) return true;
+			if ( m_Resource.IsLoaded() ) return false;
 
-		REKSI_LOCK_UNIQUE(m_LoaderResourceMutex, lock);
-		m_DefaultLoaders[typeid(T)] = loader;
+			m_Future = m_Resource.LoadAsync();
+		}
+
+		return m_Future.ContinueWith(std::move(resume));
 	}
 
 	template <typename T>
-	ResourceData::LoadFunc ResourceManager::GetDefaultLoaderImpl() const
+	SharedPtr<T> ResourceAwaiter<T>::await_resume()
 	{
-		REKSI_LOCK_SHARED(m_LoaderResourceMutex, lock);
+		return m_Resource.TryGetRef();
+	}
 
-		auto itr = m_DefaultLoaders.find(typeid(T));
-		if ( itr == m_DefaultLoaders.end() ) return nullptr;
-		return itr->second;
+	inline LoadFutureAwaiter operator co_await(LoadFuture future)
+	{
+		return LoadFutureAwaiter{std::move(future)};
+	}
+
+	template <typename T>
+	ResourceAwaiter<T> operator co_await(ResourceFuture<T> future)
+	{
+		return ResourceAwaiter<T>{std::move(future)};
+	}
+
+	template <typename T>
+	ResourceAwaiter<T> operator co_await(Resource<T> resource)
+	{
+		return ResourceAwaiter<T>{std::move(resource)};
 	}
 }
+#endif
 #pragma endregion
+
+
@@ -11,6 +11,12 @@ workspace "Reksi"
     
 outputdir = "%{cfg.buildcfg}-%{cfg.system}-%{cfg.architecture}"
 
+newoption
+{
+    trigger = "cpp20",
+    description = "Build with C++20 to enable the coroutine awaitables"
+}
+
 project "Reksi"
     kind "ConsoleApp"
     language "C++"
@@ -30,9 +36,15 @@ project "Reksi"
         "src",
     }
 
+    filter "options:cpp20"
+        cppdialect "C++20"
+
     filter "system:windows"
         systemversion "latest"
 
+    filter "system:linux"
+        links { "pthread" }
+
     filter "configurations:Debug"
         defines "DEBUG"
         runtime "Debug"
@@ -42,3 +54,24 @@ project "Reksi"
         defines "NDEBUG"
         runtime "Release"
         optimize "On"
+
+project "ReksiTests"
+    kind "ConsoleApp"
+    language "C++"
+    cppdialect "C++17"
+
+    targetdir ("bin/" .. outputdir .. "/%{prj.name}")
+    objdir ("bin/int/" .. outputdir .. "/%{prj.name}")
+
+    files
+    {
+        "tests/SchedulerTeardown.cpp"
+    }
+
+    includedirs
+    {
+        "src",
+    }
+
+    filter "system:linux"
+        links { "pthread" }
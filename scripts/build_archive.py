@@ -0,0 +1,159 @@
+import argparse
+import fnmatch
+import os
+import struct
+from typing import List, Tuple
+
+from generate_asset_table import hash_path, read_manifest
+
+# Must match Reksi::ResourceArchive
+MAGIC = b'RKAR'
+VERSION = 2
+HEADER = struct.Struct('<4sIIIQQ')
+ENTRY = struct.Struct('<QQQQIIII')
+
+# Must match Reksi::LzBlockCodec
+LZ_CODEC = 1
+MIN_MATCH = 4
+MAX_OFFSET = 0xFFFF
+
+def align_up(value: int, alignment: int) -> int:
+    return (value + alignment - 1) // alignment * alignment
+
+def write_length(out: bytearray, length: int):
+    # Continues the 15 of the token
+    while length >= 255:
+        out.append(255)
+        length -= 255
+    out.append(length)
+
+def write_sequence(out: bytearray, literals: bytes, offset: int, match: int):
+    literal_nibble = min(len(literals), 15)
+    match_nibble = min(match - MIN_MATCH, 15) if offset else 0
+    out.append(literal_nibble << 4 | match_nibble)
+    if literal_nibble == 15:
+        write_length(out, len(literals) - 15)
+    out += literals
+    if not offset:
+        return
+    out += struct.pack('<H', offset)
+    if match_nibble == 15:
+        write_length(out, match - MIN_MATCH - 15)
+
+def lz_compress(data: bytes) -> bytes:
+    # Greedy, remembering the last position of every 4 byte sequence
+    out = bytearray()
+    positions = {}
+    anchor = 0
+    i = 0
+    while i + MIN_MATCH <= len(data):
+        key = data[i:i + MIN_MATCH]
+        candidate = positions.get(key)
+        positions[key] = i
+        if candidate is None or i - candidate > MAX_OFFSET:
+            i += 1
+            continue
+
+        length = MIN_MATCH
+        while i + length < len(data) and data[candidate + length] == data[i + length]:
+            length += 1
+
+        write_sequence(out, data[anchor:i], i - candidate, length)
+        i += length
+        anchor = i
+
+    if anchor < len(data):
+        write_sequence(out, data[anchor:], 0, 0)
+    return bytes(out)
+
+def compress_entry(data: bytes, block_size: int) -> bytes:
+    # End offset of every block, followed by the blocks, which are stored as is unless they got smaller
+    blocks = []
+    for start in range(0, len(data), block_size):
+        block = data[start:start + block_size]
+        compressed = lz_compress(block)
+        blocks.append(compressed if len(compressed) < len(block) else block)
+
+    table = bytearray()
+    end = 0
+    for block in blocks:
+        end += len(block)
+        table += struct.pack('<I', end)
+    if end > 0xFFFFFFFF:
+        raise ValueError("Compressed entries must be below 4 GiB")
+    return bytes(table) + b''.join(blocks)
+
+def collect_files(root: str) -> List[str]:
+    paths: List[str] = []
+    for directory, _, files in os.walk(root):
+        for file in files:
+            full = os.path.join(directory, file)
+            paths.append(os.path.relpath(full, root).replace(os.sep, '/'))
+    return sorted(paths)
+
+def build(root: str, paths: List[str], alignment: int, compress: bool, block_size: int, store: List[str]) -> bytes:
+    entries: List[Tuple[int, bytes, bytes, int, int]] = []
+    for path in paths:
+        encoded = path.encode('utf-8')
+        with open(os.path.join(root, path), 'rb') as file:
+            data = file.read()
+
+        # Entries which do not get smaller are stored uncompressed
+        codec = 0
+        stored = data
+        if compress and data and not any(fnmatch.fnmatch(path, pattern) for pattern in store):
+            compressed = compress_entry(data, block_size)
+            if len(compressed) < len(data):
+                codec = LZ_CODEC
+                stored = compressed
+
+        entries.append((hash_path(encoded), encoded, stored, codec, len(data)))
+
+    # Sorted by hash so the reader can binary search, colliding hashes end up next to each other
+    entries.sort(key=lambda entry: (entry[0], entry[1]))
+
+    index_offset = HEADER.size
+    names_offset = index_offset + ENTRY.size * len(entries)
+    names = b''.join(entry[1] for entry in entries)
+    payload_offset = align_up(names_offset + len(names), alignment)
+
+    index = b''
+    payloads = bytearray()
+    name_offset = 0
+    for hash, name, data, codec, size in entries:
+        offset = align_up(payload_offset + len(payloads), alignment)
+        payloads += b'\0' * (offset - payload_offset - len(payloads))
+        index += ENTRY.pack(hash, offset, size, len(data), name_offset, len(name), codec, block_size if codec else 0)
+        payloads += data
+        name_offset += len(name)
+
+    res = HEADER.pack(MAGIC, VERSION, len(entries), alignment, index_offset, names_offset)
+    res += index + names
+    res += b'\0' * (payload_offset - len(res))
+    return res + bytes(payloads)
+
+def main():
+    parser = argparse.ArgumentParser(description="Packs asset files into an archive for ResourceManager::Mount")
+    parser.add_argument('root', help="Directory the paths are relative to, usually the manager's base path")
+    parser.add_argument('output', help="Archive file to write")
+    parser.add_argument('--manifest', help="Text file with the paths to pack, one per line, defaults to every file in root")
+    parser.add_argument('--align', type=int, default=16, help="Alignment of the payloads in bytes")
+    parser.add_argument('--compress', action='store_true', help="Compress the entries with the built-in LZ codec")
+    parser.add_argument('--block-size', type=int, default=256 * 1024,
+                        help="Bytes per compressed block, blocks of an entry are decompressed in parallel")
+    parser.add_argument('--store', action='append', default=[],
+                        help="Pattern of paths to store uncompressed, e.g. '*.png', may be repeated")
+    args = parser.parse_args()
+
+    if args.align <= 0 or args.align & (args.align - 1):
+        raise ValueError("Alignment must be a power of two")
+    if args.block_size <= 0 or args.block_size > 0xFFFFFFFF:
+        raise ValueError("Block size out of range")
+
+    paths = read_manifest(args.manifest) if args.manifest else collect_files(args.root)
+    archive = build(args.root, paths, args.align, args.compress, args.block_size, args.store)
+    with open(args.output, 'wb') as file:
+        file.write(archive)
+
+if __name__ == '__main__':
+    main()
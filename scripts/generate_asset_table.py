@@ -0,0 +1,135 @@
+import argparse
+import os
+from typing import List
+
+# Must match Reksi::HashResourcePath and Reksi::StaticAssetTable::Mix
+FNV_OFFSET = 14695981039346656037
+FNV_PRIME = 1099511628211
+MASK_64 = (1 << 64) - 1
+EMPTY_SLOT = 0xFFFFFFFF
+
+def hash_path(path: bytes) -> int:
+    hash = FNV_OFFSET
+    for byte in path:
+        hash ^= byte
+        hash = (hash * FNV_PRIME) & MASK_64
+    return hash
+
+def mix(hash: int, displacement: int) -> int:
+    x = hash ^ ((displacement * 0x9E3779B97F4A7C15) & MASK_64)
+    x = ((x ^ (x >> 30)) * 0xBF58476D1CE4E5B9) & MASK_64
+    x = ((x ^ (x >> 27)) * 0x94D049BB133111EB) & MASK_64
+    return x ^ (x >> 31)
+
+def read_manifest(file_path: str) -> List[str]:
+    paths: List[str] = []
+
+    with open(file_path, 'r', encoding='utf-8') as file:
+        for line in file:
+            line = line.strip()
+            # Skip empty lines and comments
+            if not line or line.startswith('#'):
+                continue
+            paths.append(line)
+
+    if len(set(paths)) != len(paths):
+        raise ValueError("Manifest contains duplicate paths")
+    return paths
+
+def build_table(hashes: List[int]):
+    slot_count = max(1, len(hashes) + len(hashes) // 4)
+    bucket_count = max(1, (len(hashes) + 1) // 2)
+
+    buckets: List[List[int]] = [[] for _ in range(bucket_count)]
+    for index, hash in enumerate(hashes):
+        buckets[(hash >> 32) % bucket_count].append(index)
+
+    displacements = [0] * bucket_count
+    slots = [EMPTY_SLOT] * slot_count
+
+    # Place the largest buckets first, while most slots are still free
+    for bucket in sorted(range(bucket_count), key=lambda b: len(buckets[b]), reverse=True):
+        entries = buckets[bucket]
+        if not entries:
+            break
+
+        displacement = 0
+        while True:
+            positions = [mix(hashes[i], displacement) % slot_count for i in entries]
+            if len(set(positions)) == len(positions) and all(slots[p] == EMPTY_SLOT for p in positions):
+                break
+            displacement += 1
+            if displacement > 0xFFFFFFFF:
+                raise ValueError("Could not build the perfect hash, are there colliding paths?")
+
+        displacements[bucket] = displacement
+        for i, position in zip(entries, positions):
+            slots[position] = i
+
+    return displacements, slots
+
+def to_cpp_string(path: bytes) -> str:
+    res = '"'
+    for byte in path:
+        char = chr(byte)
+        if char in '"\\':
+            res += '\\' + char
+        elif 0x20 <= byte < 0x7F:
+            res += char
+        else:
+            res += '\\{:03o}'.format(byte)
+    return res + '"'
+
+def format_list(values: List[str], per_line: int) -> str:
+    lines = []
+    for i in range(0, len(values), per_line):
+        lines.append("\t\t" + ", ".join(values[i:i + per_line]) + ",")
+    return "\n".join(lines)
+
+def generate(paths: List[str], manifest: str, namespace: str, name: str, include: str) -> str:
+    encoded = [path.encode('utf-8') for path in paths]
+    hashes = [hash_path(path) for path in encoded]
+    if len(set(hashes)) != len(hashes):
+        raise ValueError("Manifest contains paths with colliding hashes")
+
+    displacements, slots = build_table(hashes)
+
+    # Zero sized arrays are not allowed
+    entries = ["{{{}, 0x{:016X}ull}}".format(to_cpp_string(path), hash) for path, hash in zip(encoded, hashes)]
+    if not entries:
+        entries = ['{"", 0ull}']
+
+    res: str = ""
+    res += "// Generated by scripts/generate_asset_table.py from {}, do not edit\n".format(os.path.basename(manifest))
+    res += "#pragma once\n\n"
+    res += '#include "{}"\n\n'.format(include)
+    res += "namespace {}\n{{\n".format(namespace)
+    res += "\tinline constexpr Reksi::ResourcePathLiteral {}Paths[] = {{\n".format(name)
+    res += "\n".join("\t\t{},".format(entry) for entry in entries) + "\n"
+    res += "\t};\n\n"
+    res += "\tinline constexpr uint32_t {}Displacements[] = {{\n".format(name)
+    res += format_list([str(d) for d in displacements], 16) + "\n"
+    res += "\t};\n\n"
+    res += "\tinline constexpr uint32_t {}Slots[] = {{\n".format(name)
+    res += format_list(["0x{:X}".format(s) for s in slots], 12) + "\n"
+    res += "\t};\n\n"
+    res += "\tinline constexpr Reksi::StaticAssetTable {0}{{\n\t\t{0}Paths, {1},\n\t\t{0}Displacements, {2},\n\t\t{0}Slots, {3}\n\t}};\n".format(
+        name, len(paths), len(displacements), len(slots))
+    res += "}\n"
+    return res
+
+def main():
+    parser = argparse.ArgumentParser(description="Generates a constexpr perfect hash table of the assets in a manifest")
+    parser.add_argument('manifest', help="Text file with one asset path per line, # starts a comment")
+    parser.add_argument('output', help="Header file to write")
+    parser.add_argument('--namespace', default='Assets', help="Namespace of the generated table")
+    parser.add_argument('--name', default='Table', help="Name of the generated table")
+    parser.add_argument('--include', default='Reksi.h', help="Header providing Reksi")
+    args = parser.parse_args()
+
+    paths = read_manifest(args.manifest)
+    with open(args.output, 'w') as file:
+        file.write(generate(paths, args.manifest, args.namespace, args.name, args.include))
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,227 @@
+#pragma once
+
+#include "Reksi/Base.h"
+#include "Reksi/ResourceKey.h"
+#include "Reksi/MappedFile.h"
+#include "Reksi/Codec.h"
+
+namespace Reksi
+{
+	/*
+	 * Packed archive, written by scripts/build_archive.py, all values little endian
+	 * Header: "RKAR", version, entry count, payload alignment, index offset, names offset
+	 * Index: entries sorted by path hash, then path
+	 * Names: the paths of the entries, not terminated
+	 * Payloads: aligned to the payload alignment
+	 * Compressed payloads start with the end offset of every block as uint32, relative to the end of that table,
+	 * blocks as long as their decompressed size are stored as is
+	 */
+	class ResourceArchive
+	{
+	public:
+		static constexpr uint32_t Version = 2;
+		static constexpr size_t NotFound = ~static_cast<size_t>(0);
+
+		struct Header
+		{
+			char Magic[4];
+			uint32_t Version;
+			uint32_t EntryCount;
+			uint32_t Alignment;
+			uint64_t IndexOffset;
+			uint64_t NamesOffset;
+		};
+
+		struct Entry
+		{
+			// HashResourcePath of the path
+			uint64_t Hash;
+			uint64_t Offset;
+			// Decompressed size
+			uint64_t Size;
+			uint64_t StoredSize;
+			uint32_t NameOffset;
+			uint32_t NameSize;
+			// BlockCodec id, 0 if stored uncompressed
+			uint32_t Codec;
+			// Decompressed size of every block but the last
+			uint32_t BlockSize;
+		};
+
+		// Maps the archive, throws std::runtime_error if it cannot be read or is malformed
+		explicit ResourceArchive(const std::filesystem::path& path);
+
+		ResourceArchive(const ResourceArchive&) = delete;
+		ResourceArchive& operator=(const ResourceArchive&) = delete;
+
+		// Index of the entry, NotFound if the path is not in the archive
+		size_t Find(std::string_view path) const;
+		size_t Find(std::string_view path, uint64_t hash) const;
+		size_t GetCount() const;
+		std::string_view GetPath(size_t index) const;
+		const Entry& GetEntry(size_t index) const;
+		// Bytes as stored, the contents unless compressed, they stay valid as long as the archive
+		ByteSpan GetBytes(size_t index) const;
+		bool IsCompressed(size_t index) const;
+		size_t GetBlockCount(size_t index) const;
+		// Decompresses a block of a compressed entry into its place in output, which holds the whole entry
+		// Blocks may be decompressed concurrently, returns false for corrupt blocks
+		bool DecompressBlock(size_t index, size_t block, const BlockCodec& codec, std::byte* output) const;
+
+	private:
+		MappedFile m_File;
+		const Entry* m_Entries;
+		size_t m_Count;
+		const char* m_Names;
+	};
+}
+
+#pragma region Defer
+namespace Reksi
+{
+	inline ResourceArchive::ResourceArchive(const std::filesystem::path& path)
+		: m_File(path), m_Entries(nullptr), m_Count(0), m_Names(nullptr)
+	{
+		const std::byte* data = m_File.GetData();
+		const size_t size = m_File.GetSize();
+
+		Header header;
+		if ( size < sizeof(Header) )
+		{
+			throw std::runtime_error("ResourceArchive: File too small");
+		}
+		std::memcpy(&header, data, sizeof(Header));
+
+		if ( std::string_view{header.Magic, 4} != "RKAR" || header.Version != Version )
+		{
+			throw std::runtime_error("ResourceArchive: Not an archive or unsupported version");
+		}
+
+		// The index is used in place, the mapping itself is page aligned
+		if ( header.IndexOffset % alignof(Entry) != 0 || header.IndexOffset > size ||
+			(size - header.IndexOffset) / sizeof(Entry) < header.EntryCount || header.NamesOffset > size )
+		{
+			throw std::runtime_error("ResourceArchive: Malformed index");
+		}
+
+		m_Entries = reinterpret_cast<const Entry*>(data + header.IndexOffset);
+		m_Count = header.EntryCount;
+		m_Names = reinterpret_cast<const char*>(data + header.NamesOffset);
+
+		// Check everything once, so lookups can trust the index
+		for ( size_t i = 0; i < m_Count; ++i )
+		{
+			const Entry& entry = m_Entries[i];
+			if ( entry.Offset > size || entry.StoredSize > size - entry.Offset ||
+				header.NamesOffset + entry.NameOffset + entry.NameSize > size ||
+				(i > 0 && m_Entries[i - 1].Hash > entry.Hash) )
+			{
+				throw std::runtime_error("ResourceArchive: Malformed entry");
+			}
+
+			// Block contents are checked when decompressing
+			const bool compressed = entry.Codec != 0;
+			if ( compressed ? entry.BlockSize == 0 || GetBlockCount(i) > entry.StoredSize / sizeof(uint32_t)
+			                : entry.StoredSize != entry.Size )
+			{
+				throw std::runtime_error("ResourceArchive: Malformed entry");
+			}
+		}
+	}
+
+	inline size_t ResourceArchive::Find(std::string_view path) const
+	{
+		return Find(path, HashResourcePath(path));
+	}
+
+	inline size_t ResourceArchive::Find(std::string_view path, uint64_t hash) const
+	{
+		const Entry* end = m_Entries + m_Count;
+		const Entry* entry = std::lower_bound(m_Entries, end, hash, [](const Entry& e, uint64_t h)
+		{
+			return e.Hash < h;
+		});
+
+		// Colliding hashes are next to each other
+		for ( ; entry != end && entry->Hash == hash; ++entry )
+		{
+			const auto index = static_cast<size_t>(entry - m_Entries);
+			if ( GetPath(index) == path ) return index;
+		}
+
+		return NotFound;
+	}
+
+	inline size_t ResourceArchive::GetCount() const
+	{
+		return m_Count;
+	}
+
+	inline std::string_view ResourceArchive::GetPath(size_t index) const
+	{
+		assert(index < m_Count);
+
+		return std::string_view{m_Names + m_Entries[index].NameOffset, m_Entries[index].NameSize};
+	}
+
+	inline const ResourceArchive::Entry& ResourceArchive::GetEntry(size_t index) const
+	{
+		assert(index < m_Count);
+
+		return m_Entries[index];
+	}
+
+	inline ByteSpan ResourceArchive::GetBytes(size_t index) const
+	{
+		assert(index < m_Count);
+
+		return ByteSpan{m_File.GetData() + m_Entries[index].Offset, static_cast<size_t>(m_Entries[index].StoredSize)};
+	}
+
+	inline bool ResourceArchive::IsCompressed(size_t index) const
+	{
+		assert(index < m_Count);
+
+		return m_Entries[index].Codec != 0;
+	}
+
+	inline size_t ResourceArchive::GetBlockCount(size_t index) const
+	{
+		assert(index < m_Count);
+
+		const Entry& entry = m_Entries[index];
+		if ( entry.Codec == 0 ) return 1;
+		return static_cast<size_t>((entry.Size + entry.BlockSize - 1) / entry.BlockSize);
+	}
+
+	inline bool ResourceArchive::DecompressBlock(size_t index, size_t block, const BlockCodec& codec,
+	                                             std::byte* output) const
+	{
+		assert(IsCompressed(index) && block < GetBlockCount(index));
+
+		const Entry& entry = m_Entries[index];
+		const ByteSpan stored = GetBytes(index);
+		const size_t tableSize = GetBlockCount(index) * sizeof(uint32_t);
+
+		// The payload is not necessarily aligned for uint32
+		uint32_t begin = 0;
+		uint32_t end;
+		if ( block > 0 ) std::memcpy(&begin, stored.data() + (block - 1) * sizeof(uint32_t), sizeof(uint32_t));
+		std::memcpy(&end, stored.data() + block * sizeof(uint32_t), sizeof(uint32_t));
+		if ( begin > end || end > stored.size() - tableSize ) return false;
+
+		const uint64_t offset = static_cast<uint64_t>(block) * entry.BlockSize;
+		const auto size = static_cast<size_t>(std::min<uint64_t>(entry.BlockSize, entry.Size - offset));
+		const ByteSpan input{stored.data() + tableSize + begin, end - begin};
+
+		// Blocks which did not compress are stored as is
+		if ( input.size() == size )
+		{
+			std::memcpy(output + offset, input.data(), size);
+			return true;
+		}
+
+		return codec.Decompress(input, output + offset, size);
+	}
+}
+#pragma endregion
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "Reksi/Base.h"
+#include "Reksi/ResourceKey.h"
+
+namespace Reksi
+{
+	// Perfect hash table over the paths of a fixed set of assets, usable in constant expressions
+	// Generated by scripts/generate_asset_table.py from an asset manifest
+	// Hash and displace, the path's hash selects a bucket whose displacement selects the slot
+	class StaticAssetTable
+	{
+	public:
+		static constexpr size_t NotFound = ~static_cast<size_t>(0);
+
+		constexpr StaticAssetTable(const ResourcePathLiteral* paths, size_t count,
+		                           const uint32_t* displacements, size_t bucketCount,
+		                           const uint32_t* slots, size_t slotCount);
+
+		// Index of the path in the manifest, NotFound if it is not part of the table
+		constexpr size_t Find(const ResourcePathLiteral& path) const;
+		constexpr size_t Find(std::string_view path) const;
+		constexpr size_t GetCount() const;
+		constexpr const ResourcePathLiteral& operator[](size_t index) const;
+
+		// Shared with the generator, changing it requires regenerating the tables
+		static constexpr uint64_t Mix(uint64_t hash, uint32_t displacement);
+
+	private:
+		const ResourcePathLiteral* m_Paths;
+		size_t m_Count;
+		const uint32_t* m_Displacements;
+		size_t m_BucketCount;
+		// Index of the path in each slot, NotFound for empty slots
+		const uint32_t* m_Slots;
+		size_t m_SlotCount;
+
+		constexpr size_t FindHashed(std::string_view path, uint64_t hash) const;
+	};
+}
+
+#pragma region Defer
+namespace Reksi
+{
+	constexpr StaticAssetTable::StaticAssetTable(const ResourcePathLiteral* paths, size_t count,
+	                                             const uint32_t* displacements, size_t bucketCount,
+	                                             const uint32_t* slots, size_t slotCount)
+		: m_Paths(paths),
+		  m_Count(count),
+		  m_Displacements(displacements),
+		  m_BucketCount(bucketCount),
+		  m_Slots(slots),
+		  m_SlotCount(slotCount)
+	{
+	}
+
+	constexpr size_t StaticAssetTable::Find(const ResourcePathLiteral& path) const
+	{
+		return FindHashed(path.Path, path.Hash);
+	}
+
+	constexpr size_t StaticAssetTable::Find(std::string_view path) const
+	{
+		return FindHashed(path, HashResourcePath(path));
+	}
+
+	constexpr size_t StaticAssetTable::GetCount() const
+	{
+		return m_Count;
+	}
+
+	constexpr const ResourcePathLiteral& StaticAssetTable::operator[](size_t index) const
+	{
+		return m_Paths[index];
+	}
+
+	constexpr uint64_t StaticAssetTable::Mix(uint64_t hash, uint32_t displacement)
+	{
+		// splitmix64 finalizer
+		uint64_t x = hash ^ (static_cast<uint64_t>(displacement) * 0x9E3779B97F4A7C15ull);
+		x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+		x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+		return x ^ (x >> 31);
+	}
+
+	constexpr size_t StaticAssetTable::FindHashed(std::string_view path, uint64_t hash) const
+	{
+		if ( m_Count == 0 ) return NotFound;
+
+		const uint32_t displacement = m_Displacements[(hash >> 32) % m_BucketCount];
+		const uint32_t index = m_Slots[Mix(hash, displacement) % m_SlotCount];
+		if ( index >= m_Count ) return NotFound;
+
+		const ResourcePathLiteral& entry = m_Paths[index];
+		if ( entry.Hash != hash || entry.Path != path ) return NotFound;
+		return index;
+	}
+}
+#pragma endregion
@@ -0,0 +1,251 @@
+#pragma once
+
+#include "Reksi/Base.h"
+#include "Reksi/ResourceData.h"
+#include "Reksi/Scheduler.h"
+
+namespace Reksi
+{
+	// Shared state of a background load, executed by the manager's TaskScheduler
+	class LoadTask : public SchedulerTask, public std::enable_shared_from_this<LoadTask>
+	{
+	public:
+		explicit LoadTask(ResourceData* data);
+
+		void Execute() override;
+		void Cancel() override;
+
+		bool IsDone() const;
+		void Wait() const;
+		// Waits for the load to finish and returns its status
+		ResourceLoadStatus GetStatus() const;
+		// Runs the continuation on the thread completing the load
+		// Returns false without running it if the load is already done
+		bool ContinueWith(LoadContinuation continuation);
+
+	private:
+		// Cleared by whoever takes ownership of running the load
+		std::atomic<ResourceData*> m_Data;
+		ResourceLoadStatus m_Status;
+		bool m_Done;
+		std::vector<LoadContinuation> m_Continuations;
+		// File contents read ahead by the manager's FileReader, for resources with a buffer loader
+		ByteBuffer m_Prefetched;
+		bool m_HasPrefetched;
+
+		REKSI_THREADING_MUTABLE REKSI_MUTEX_AUTO;
+		REKSI_THREADING_MUTABLE REKSI_CV_AUTO;
+
+		// Returns the resource if the caller now owns the load, nullptr if it was already claimed
+		ResourceData* Claim();
+		void Complete(ResourceLoadStatus status);
+		void SetPrefetched(ByteBuffer buffer);
+		// Returns false if nothing was read ahead
+		bool TakePrefetched(ByteBuffer& buffer);
+
+		friend class ResourceData;
+		friend class ResourceManager;
+	};
+
+	// Future-like handle to a background load, returned by ResourceManager::LoadAsync
+	class LoadFuture
+	{
+	public:
+		LoadFuture() = default;
+
+		bool IsValid() const;
+		bool IsReady() const;
+		void Wait() const;
+		// Waits for the load to finish and returns its status
+		ResourceLoadStatus Get() const;
+		// Runs the continuation on the thread completing the load
+		// Returns false without running it if the load is already done
+		bool ContinueWith(LoadContinuation continuation) const;
+
+	protected:
+		explicit LoadFuture(SharedPtr<LoadTask> task);
+
+		SharedPtr<LoadTask> m_Task;
+
+		friend class ResourceManager;
+	};
+
+	// Typed LoadFuture, returned by Resource<T>::LoadAsync
+	template <typename T>
+	class ResourceFuture : public LoadFuture
+	{
+	public:
+		Resource<T> GetResource() const;
+		// Waits for the load to finish and returns the data
+		SharedPtr<T> GetRef() const;
+
+	private:
+		ResourceFuture(const Resource<T>& resource, LoadFuture future);
+
+		Resource<T> m_Resource;
+
+		friend class ResourceManager;
+	};
+}
+
+#pragma region Defer
+namespace Reksi
+{
+	inline LoadTask::LoadTask(ResourceData* data)
+		: m_Data(data), m_Done(false), m_HasPrefetched(false)
+	{
+	}
+
+	inline void LoadTask::Execute()
+	{
+		ResourceData* data = Claim();
+		// Load was already picked up by a synchronous caller, or the resource was deleted
+		if ( !data ) return;
+
+		data->LoadClaimed(shared_from_this());
+	}
+
+	inline void LoadTask::Cancel()
+	{
+		ResourceData* data = Claim();
+		if ( !data ) return;
+
+		data->ReleasePendingLoad(this);
+		Complete(ResourceLoadStatus());
+	}
+
+	inline bool LoadTask::IsDone() const
+	{
+		REKSI_LOCK_SHARED_AUTO;
+
+		return m_Done;
+	}
+
+	inline void LoadTask::Wait() const
+	{
+		REKSI_LOCK_UNIQUE_AUTO;
+
+		REKSI_CV_WAIT_AUTO([&] { return m_Done; });
+	}
+
+	inline ResourceLoadStatus LoadTask::GetStatus() const
+	{
+		REKSI_LOCK_UNIQUE_AUTO;
+
+		REKSI_CV_WAIT_AUTO([&] { return m_Done; });
+		return m_Status;
+	}
+
+	inline bool LoadTask::ContinueWith(LoadContinuation continuation)
+	{
+		REKSI_LOCK_UNIQUE_AUTO;
+
+		if ( m_Done ) return false;
+
+		m_Continuations.emplace_back(std::move(continuation));
+		return true;
+	}
+
+	inline ResourceData* LoadTask::Claim()
+	{
+		return m_Data.exchange(nullptr);
+	}
+
+	inline void LoadTask::Complete(ResourceLoadStatus status)
+	{
+		std::vector<LoadContinuation> continuations;
+
+		{
+			REKSI_LOCK_UNIQUE_AUTO;
+
+			m_Status = status;
+			m_Done = true;
+			continuations.swap(m_Continuations);
+		}
+
+		REKSI_CV_NOTIFY_ALL_AUTO;
+
+		for ( const auto& continuation : continuations )
+		{
+			continuation(status);
+		}
+	}
+
+	inline void LoadTask::SetPrefetched(ByteBuffer buffer)
+	{
+		REKSI_LOCK_UNIQUE_AUTO;
+
+		m_Prefetched = std::move(buffer);
+		m_HasPrefetched = true;
+	}
+
+	inline bool LoadTask::TakePrefetched(ByteBuffer& buffer)
+	{
+		REKSI_LOCK_UNIQUE_AUTO;
+
+		if ( !m_HasPrefetched ) return false;
+
+		buffer = std::move(m_Prefetched);
+		m_HasPrefetched = false;
+		return true;
+	}
+
+	inline LoadFuture::LoadFuture(SharedPtr<LoadTask> task)
+		: m_Task(std::move(task))
+	{
+	}
+
+	inline bool LoadFuture::IsValid() const
+	{
+		return static_cast<bool>(m_Task);
+	}
+
+	inline bool LoadFuture::IsReady() const
+	{
+		assert(IsValid());
+
+		return m_Task->IsDone();
+	}
+
+	inline void LoadFuture::Wait() const
+	{
+		assert(IsValid());
+
+		m_Task->Wait();
+	}
+
+	inline ResourceLoadStatus LoadFuture::Get() const
+	{
+		assert(IsValid());
+
+		return m_Task->GetStatus();
+	}
+
+	inline bool LoadFuture::ContinueWith(LoadContinuation continuation) const
+	{
+		assert(IsValid());
+
+		return m_Task->ContinueWith(std::move(continuation));
+	}
+
+	template <typename T>
+	ResourceFuture<T>::ResourceFuture(const Resource<T>& resource, LoadFuture future)
+		: LoadFuture(std::move(future)), m_Resource(resource)
+	{
+	}
+
+	template <typename T>
+	Resource<T> ResourceFuture<T>::GetResource() const
+	{
+		return m_Resource;
+	}
+
+	template <typename T>
+	SharedPtr<T> ResourceFuture<T>::GetRef() const
+	{
+		if ( IsValid() ) Wait();
+
+		return Resource<T>{m_Resource}.GetRef();
+	}
+}
+#pragma endregion
@@ -4,14 +4,27 @@
 #include "Reksi/Definitions.h"
 
 // Standard Includes
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstdint>
+#include <deque>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include <filesystem>
+#include <fstream>
 #include <functional>
 #include <list>
 #include <typeindex>
+#include <type_traits>
+#include <utility>
+#if REKSI_COROUTINES == 1
+#include <coroutine>
+#endif
 
 
 // Forward Declarations
@@ -21,4 +34,14 @@ namespace Reksi
 	class ResourceData;
 	template <typename T>
 	class Resource;
+	template <typename T>
+	class ResourceRef;
+	template <typename T>
+	class ResourceView;
+	class LoadTask;
+	class LoadFuture;
+	template <typename T>
+	class ResourceFuture;
+	template <typename T>
+	class ResourceAwaiter;
 }
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "Reksi/Base.h"
+
+#include <cstring>
+
+namespace Reksi
+{
+	// Decompresses the blocks of compressed archive entries, registered with ResourceManager::RegisterCodec
+	// Blocks are independent of each other, so they may be decompressed on several threads at once
+	class BlockCodec
+	{
+	public:
+		virtual ~BlockCodec() = default;
+
+		// Stored in the archive entries, 0 is reserved for uncompressed entries
+		virtual uint32_t GetId() const = 0;
+		// Must fill the output exactly, returns false for corrupt input
+		virtual bool Decompress(ByteSpan input, std::byte* output, size_t outputSize) const = 0;
+	};
+
+	/*
+	 * Built-in LZ77 codec, compressed by scripts/build_archive.py
+	 * A block is a list of sequences, each a token byte, literals, and a match
+	 * Token: high 4 bits literal count, low 4 bits match length - 4, 15 continues in the following bytes,
+	 *        which are added up until one is below 255
+	 * Match: 2 byte little endian offset back into the output, then the extra length bytes
+	 * The last sequence has literals only
+	 */
+	class LzBlockCodec : public BlockCodec
+	{
+	public:
+		static constexpr uint32_t Id = 1;
+		static constexpr size_t MinMatch = 4;
+
+		uint32_t GetId() const override;
+		bool Decompress(ByteSpan input, std::byte* output, size_t outputSize) const override;
+
+	private:
+		// Returns false if the input ends within the length
+		static bool ReadLength(const std::byte*& in, const std::byte* end, size_t& length);
+	};
+}
+
+#pragma region Defer
+namespace Reksi
+{
+	inline uint32_t LzBlockCodec::GetId() const
+	{
+		return Id;
+	}
+
+	inline bool LzBlockCodec::Decompress(ByteSpan input, std::byte* output, size_t outputSize) const
+	{
+		const std::byte* in = input.data();
+		const std::byte* inEnd = in + input.size();
+		std::byte* out = output;
+		std::byte* const outEnd = output + outputSize;
+
+		while ( in < inEnd )
+		{
+			const auto token = static_cast<uint8_t>(*in++);
+
+			size_t literals = token >> 4;
+			if ( literals == 15 && !ReadLength(in, inEnd, literals) ) return false;
+			if ( literals > static_cast<size_t>(inEnd - in) || literals > static_cast<size_t>(outEnd - out) ) return false;
+
+			std::memcpy(out, in, literals);
+			in += literals;
+			out += literals;
+
+			// The last sequence ends after its literals
+			if ( in == inEnd ) break;
+
+			if ( inEnd - in < 2 ) return false;
+			const size_t offset = static_cast<size_t>(in[0]) | static_cast<size_t>(in[1]) << 8;
+			in += 2;
+
+			size_t length = token & 15;
+			if ( length == 15 && !ReadLength(in, inEnd, length) ) return false;
+			length += MinMatch;
+
+			if ( offset == 0 || offset > static_cast<size_t>(out - output) ||
+				length > static_cast<size_t>(outEnd - out) )
+			{
+				return false;
+			}
+
+			// Matches may overlap the bytes they produce
+			const std::byte* match = out - offset;
+			if ( offset >= length )
+			{
+				std::memcpy(out, match, length);
+				out += length;
+			}
+			else
+			{
+				for ( size_t i = 0; i < length; ++i )
+				{
+					*out++ = match[i];
+				}
+			}
+		}
+
+		return out == outEnd;
+	}
+
+	inline bool LzBlockCodec::ReadLength(const std::byte*& in, const std::byte* end, size_t& length)
+	{
+		while ( true )
+		{
+			if ( in == end ) return false;
+
+			const auto byte = static_cast<uint8_t>(*in++);
+			length += byte;
+			if ( byte != 255 ) return true;
+		}
+	}
+}
+#pragma endregion
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "Reksi/Base.h"
+#include "Reksi/AsyncLoad.h"
+#include "Reksi/Resource.h"
+
+#if REKSI_COROUTINES == 1
+namespace Reksi
+{
+	// Awaiter for an untyped LoadFuture, yields the load status
+	// The coroutine is resumed on the thread completing the load
+	class LoadFutureAwaiter
+	{
+	public:
+		explicit LoadFutureAwaiter(LoadFuture future);
+
+		bool await_ready() const;
+		bool await_suspend(std::coroutine_handle<> handle);
+		ResourceLoadStatus await_resume() const;
+
+	private:
+		LoadFuture m_Future;
+	};
+
+	// Awaiter for a Resource or ResourceFuture, yields the data like Resource::TryGetRef
+	// The coroutine is resumed on the thread completing the load
+	template <typename T>
+	class ResourceAwaiter
+	{
+	public:
+		explicit ResourceAwaiter(Resource<T> resource);
+		explicit ResourceAwaiter(ResourceFuture<T> future);
+
+		bool await_ready() const;
+		bool await_suspend(std::coroutine_handle<> handle);
+		SharedPtr<T> await_resume();
+
+	private:
+		Resource<T> m_Resource;
+		LoadFuture m_Future;
+	};
+
+	LoadFutureAwaiter operator co_await(LoadFuture future);
+	// co_await manager.LoadAsync<T>(path)
+	template <typename T>
+	ResourceAwaiter<T> operator co_await(ResourceFuture<T> future);
+	// co_await resource, loads the resource if it is neither loaded nor loading
+	template <typename T>
+	ResourceAwaiter<T> operator co_await(Resource<T> resource);
+}
+#endif
+
+#pragma region Defer
+#if REKSI_COROUTINES == 1
+namespace Reksi
+{
+	inline LoadFutureAwaiter::LoadFutureAwaiter(LoadFuture future)
+		: m_Future(std::move(future))
+	{
+	}
+
+	inline bool LoadFutureAwaiter::await_ready() const
+	{
+		return !m_Future.IsValid() || m_Future.IsReady();
+	}
+
+	inline bool LoadFutureAwaiter::await_suspend(std::coroutine_handle<> handle)
+	{
+		// Completed in the meantime, continue without suspending
+		return m_Future.ContinueWith([handle](ResourceLoadStatus) { handle.resume(); });
+	}
+
+	inline ResourceLoadStatus LoadFutureAwaiter::await_resume() const
+	{
+		if ( !m_Future.IsValid() ) return ResourceLoadStatus();
+		return m_Future.Get();
+	}
+
+	template <typename T>
+	ResourceAwaiter<T>::ResourceAwaiter(Resource<T> resource)
+		: m_Resource(std::move(resource))
+	{
+	}
+
+	template <typename T>
+	ResourceAwaiter<T>::ResourceAwaiter(ResourceFuture<T> future)
+		: m_Resource(future.GetResource()), m_Future(std::move(future))
+	{
+	}
+
+	template <typename T>
+	bool ResourceAwaiter<T>::await_ready() const
+	{
+		if ( m_Future.IsValid() ) return m_Future.IsReady();
+		return m_Resource.IsLoaded();
+	}
+
+	template <typename T>
+	bool ResourceAwaiter<T>::await_suspend(std::coroutine_handle<> handle)
+	{
+		auto resume = [handle](ResourceLoadStatus) { handle.resume(); };
+
+		if ( !m_Future.IsValid() )
+		{
+			// Ride along with a load which is already running
+			if ( m_Resource.m_Data->ContinueAfterLoad(resume) ) return true;
+			if ( m_Resource.IsLoaded() ) return false;
+
+			m_Future = m_Resource.LoadAsync();
+		}
+
+		return m_Future.ContinueWith(std::move(resume));
+	}
+
+	template <typename T>
+	SharedPtr<T> ResourceAwaiter<T>::await_resume()
+	{
+		return m_Resource.TryGetRef();
+	}
+
+	inline LoadFutureAwaiter operator co_await(LoadFuture future)
+	{
+		return LoadFutureAwaiter{std::move(future)};
+	}
+
+	template <typename T>
+	ResourceAwaiter<T> operator co_await(ResourceFuture<T> future)
+	{
+		return ResourceAwaiter<T>{std::move(future)};
+	}
+
+	template <typename T>
+	ResourceAwaiter<T> operator co_await(Resource<T> resource)
+	{
+		return ResourceAwaiter<T>{std::move(resource)};
+	}
+}
+#endif
+#pragma endregion
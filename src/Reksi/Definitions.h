@@ -125,3 +125,163 @@ namespace Reksi
 #endif
 
 #pragma endregion
+
+#pragma region Span Definitions
+#include <cstddef>
+#if REKSI_STD_SPAN == 1
+#include <span>
+
+namespace Reksi
+{
+	template <typename T>
+	using Span = std::span<T>;
+}
+#else
+#include <type_traits>
+
+namespace Reksi
+{
+	// Minimal stand-in for std::span before C++20, with the same member names
+	template <typename T>
+	class Span
+	{
+	public:
+		using element_type = T;
+		using value_type = std::remove_cv_t<T>;
+		using iterator = T*;
+
+		constexpr Span() = default;
+
+		constexpr Span(T* data, size_t size)
+			: m_Data(data), m_Size(size)
+		{
+		}
+
+		template <size_t N>
+		constexpr Span(T (&array)[N])
+			: m_Data(array), m_Size(N)
+		{
+		}
+
+		// Any contiguous container, e.g. std::vector or std::array, const ones for spans of const elements
+		// Like std::span, temporaries only bind to spans of const elements
+		template <typename Container, typename = std::enable_if_t<
+			          (std::is_lvalue_reference_v<Container> || std::is_const_v<T>) &&
+			          std::is_convertible_v<decltype(std::declval<Container&>().data()), T*>>>
+		constexpr Span(Container&& container)
+			: m_Data(container.data()), m_Size(container.size())
+		{
+		}
+
+		template <typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+		constexpr Span(const Span<U>& other)
+			: m_Data(other.data()), m_Size(other.size())
+		{
+		}
+
+		constexpr T* data() const
+		{
+			return m_Data;
+		}
+
+		constexpr size_t size() const
+		{
+			return m_Size;
+		}
+
+		constexpr size_t size_bytes() const
+		{
+			return m_Size * sizeof(T);
+		}
+
+		constexpr bool empty() const
+		{
+			return m_Size == 0;
+		}
+
+		constexpr T* begin() const
+		{
+			return m_Data;
+		}
+
+		constexpr T* end() const
+		{
+			return m_Data + m_Size;
+		}
+
+		constexpr T& operator[](size_t index) const
+		{
+			return m_Data[index];
+		}
+
+		constexpr Span first(size_t count) const
+		{
+			return Span{m_Data, count};
+		}
+
+		constexpr Span subspan(size_t offset, size_t count = static_cast<size_t>(-1)) const
+		{
+			return Span{m_Data + offset, count == static_cast<size_t>(-1) ? m_Size - offset : count};
+		}
+
+	private:
+		T* m_Data = nullptr;
+		size_t m_Size = 0;
+	};
+}
+#endif
+
+namespace Reksi
+{
+	// Read-only view of raw bytes, e.g. a memory mapped file
+	using ByteSpan = Span<const std::byte>;
+}
+
+#pragma endregion
+
+#pragma region Bit Utilities
+#include <cassert>
+#include <cstdint>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace Reksi
+{
+	// Index of the highest set bit, value must not be 0
+	inline uint32_t FloorLog2(uint64_t value)
+	{
+		assert(value != 0);
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return static_cast<uint32_t>(index);
+#else
+		return 63u - static_cast<uint32_t>(__builtin_clzll(value));
+#endif
+	}
+
+	// Index of the lowest set bit, value must not be 0
+	inline uint32_t CountTrailingZeros(uint64_t value)
+	{
+		assert(value != 0);
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return static_cast<uint32_t>(index);
+#else
+		return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+	}
+
+	inline uint32_t PopCount(uint64_t value)
+	{
+#if defined(_MSC_VER)
+		return static_cast<uint32_t>(__popcnt64(value));
+#else
+		return static_cast<uint32_t>(__builtin_popcountll(value));
+#endif
+	}
+}
+
+#pragma endregion
@@ -0,0 +1,185 @@
+#pragma once
+
+#include "Reksi/Base.h"
+
+namespace Reksi
+{
+	/*
+	 * Epoch based reclamation for data read without locks
+	 * Readers hold a Guard while using a published pointer, writers swap the pointer and retire the old object,
+	 * which is deleted once every reader that could still see it left its guard
+	 * Entering a guard only writes to a slot owned by the calling thread, so readers never share a cache line
+	 *
+	 * EpochDomain::Guard guard;
+	 * const Node* node = published.load();
+	 */
+	class EpochDomain
+	{
+		struct Slot;
+
+	public:
+		class Guard
+		{
+		public:
+			Guard();
+			~Guard();
+
+			Guard(const Guard&) = delete;
+			Guard& operator=(const Guard&) = delete;
+
+		private:
+			Slot* m_Slot;
+		};
+
+		// Shared by all resources, so threads need a single slot
+		// Never destroyed, threads and managers may still use it during static destruction
+		static EpochDomain& Get();
+
+		EpochDomain(const EpochDomain&) = delete;
+		EpochDomain& operator=(const EpochDomain&) = delete;
+
+		// Deletes the object once it cannot be read anymore, it must not be reachable for new readers
+		template <typename T>
+		void Retire(T* object);
+		// Deletes the retired objects no reader can see anymore, called by Retire
+		void Collect();
+
+	private:
+		// Epoch of a thread inside a guard, 0 while outside, reused once the thread exits
+		struct alignas(64) Slot
+		{
+			std::atomic<uint64_t> Epoch{0};
+			std::atomic<bool> InUse{false};
+			// Guards may nest, only the outermost one publishes the epoch
+			uint32_t Depth = 0;
+			Slot* Next = nullptr;
+		};
+
+		struct Retired
+		{
+			void* Object;
+			void (*Delete)(void*);
+			// Readers which entered in this epoch or before may still see the object
+			uint64_t Epoch;
+		};
+
+		// Releases the slot of the thread when it exits
+		struct ThreadSlot
+		{
+			Slot* Owned = nullptr;
+
+			~ThreadSlot();
+		};
+
+		std::atomic<uint64_t> m_Epoch{1};
+		// Slots are never freed, so they may be walked without locks
+		std::atomic<Slot*> m_Slots{nullptr};
+		std::vector<Retired> m_Retired;
+
+		REKSI_MUTEX_AUTO;
+
+		EpochDomain() = default;
+
+		Slot& GetThreadSlot();
+	};
+}
+
+#pragma region Defer
+namespace Reksi
+{
+	inline EpochDomain::Guard::Guard()
+		: m_Slot(&Get().GetThreadSlot())
+	{
+		// Published before the caller loads any pointer, sequentially consistent like the writers' swaps
+		if ( m_Slot->Depth++ == 0 ) m_Slot->Epoch.store(Get().m_Epoch.load());
+	}
+
+	inline EpochDomain::Guard::~Guard()
+	{
+		if ( --m_Slot->Depth == 0 ) m_Slot->Epoch.store(0, std::memory_order_release);
+	}
+
+	inline EpochDomain& EpochDomain::Get()
+	{
+		static EpochDomain* domain = new EpochDomain;
+		return *domain;
+	}
+
+	template <typename T>
+	void EpochDomain::Retire(T* object)
+	{
+		if ( !object ) return;
+
+		{
+			// The object was unlinked before, so readers entering from now on cannot see it
+			const uint64_t epoch = m_Epoch.fetch_add(1);
+
+			REKSI_LOCK_UNIQUE_AUTO;
+			m_Retired.push_back(Retired{object, [](void* retired) { delete static_cast<T*>(retired); }, epoch});
+		}
+
+		Collect();
+	}
+
+	inline void EpochDomain::Collect()
+	{
+		uint64_t oldest = ~0ull;
+		for ( const Slot* slot = m_Slots.load(); slot; slot = slot->Next )
+		{
+			const uint64_t epoch = slot->Epoch.load();
+			if ( epoch != 0 && epoch < oldest ) oldest = epoch;
+		}
+
+		std::vector<Retired> expired;
+
+		{
+			REKSI_LOCK_UNIQUE_AUTO;
+
+			const auto it = std::partition(m_Retired.begin(), m_Retired.end(), [oldest](const Retired& retired)
+			{
+				return retired.Epoch >= oldest;
+			});
+			expired.assign(it, m_Retired.end());
+			m_Retired.erase(it, m_Retired.end());
+		}
+
+		// Deleted outside the lock, destructors may retire objects themselves
+		for ( const Retired& retired : expired )
+		{
+			retired.Delete(retired.Object);
+		}
+	}
+
+	inline EpochDomain::Slot& EpochDomain::GetThreadSlot()
+	{
+		thread_local ThreadSlot thread;
+		if ( thread.Owned ) return *thread.Owned;
+
+		// Take over the slot of an exited thread
+		for ( Slot* slot = m_Slots.load(); slot; slot = slot->Next )
+		{
+			bool inUse = false;
+			if ( slot->InUse.compare_exchange_strong(inUse, true) )
+			{
+				thread.Owned = slot;
+				return *slot;
+			}
+		}
+
+		auto slot = new Slot;
+		slot->InUse.store(true, std::memory_order_relaxed);
+		slot->Next = m_Slots.load();
+		while ( !m_Slots.compare_exchange_weak(slot->Next, slot) )
+		{
+		}
+
+		thread.Owned = slot;
+		return *slot;
+	}
+
+	inline EpochDomain::ThreadSlot::~ThreadSlot()
+	{
+		if ( Owned ) Owned->InUse.store(false, std::memory_order_release);
+	}
+}
+#pragma endregion
@@ -0,0 +1,589 @@
+#pragma once
+
+#include "Reksi/Base.h"
+
+#if REKSI_PLATFORM_POSIX == 1
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+#if REKSI_IO_URING == 1
+#include <cstring>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace Reksi
+{
+	using ByteBuffer = std::vector<std::byte>;
+	// Invoked on a reader thread, success is false if the file could not be read
+	using FileReadCallback = std::function<void(ByteBuffer buffer, bool success)>;
+
+	// Reads whole files in the background, owned by the ResourceManager to feed buffer loaders
+	class FileReader
+	{
+	public:
+		virtual ~FileReader() = default;
+
+		// Queues the read, reads queued together are submitted together where the backend allows it
+		virtual void ReadAsync(std::filesystem::path path, FileReadCallback callback) = 0;
+
+		// Reads the file on the calling thread, fails with an empty buffer on errors and short reads
+		static bool Read(const std::filesystem::path& path, ByteBuffer& buffer);
+		// io_uring when compiled with REKSI_IO_URING and supported by the kernel, a thread pool otherwise
+		// A thread count of 0 uses the default of the thread pool
+		static UniquePtr<FileReader> Create(uint32_t threadCount = 0);
+	};
+
+	// Blocking reads on a few threads of its own
+	// With REKSI_THREADING disabled, reads are performed inline
+	class ThreadPoolFileReader : public FileReader
+	{
+	public:
+		static constexpr uint32_t DefaultThreadCount = 4;
+
+		explicit ThreadPoolFileReader(uint32_t threadCount = DefaultThreadCount);
+		// Finishes the queued reads
+		~ThreadPoolFileReader() override;
+
+		void ReadAsync(std::filesystem::path path, FileReadCallback callback) override;
+
+	private:
+		struct Request
+		{
+			std::filesystem::path Path;
+			FileReadCallback Callback;
+		};
+
+		std::deque<Request> m_Requests;
+#if REKSI_THREADING == 1
+		std::vector<std::thread> m_Threads;
+#endif
+		bool m_Stopping;
+
+		REKSI_MUTEX_AUTO;
+		REKSI_CV_AUTO;
+
+		void ThreadLoop();
+	};
+
+#if REKSI_IO_URING == 1
+	// Reads files through an io_uring driven by a thread of its own
+	// Every file goes through openat, statx and read operations, the current step of all pending files
+	// is submitted with a single io_uring_enter
+	// Should the ring fail, the thread reads the pending and later files with plain reads instead
+	class IoUringFileReader : public FileReader
+	{
+	public:
+		// Throws std::runtime_error if the kernel does not support io_uring
+		explicit IoUringFileReader(uint32_t entries = 256);
+		// Finishes the queued reads
+		~IoUringFileReader() override;
+
+		IoUringFileReader(const IoUringFileReader&) = delete;
+		IoUringFileReader& operator=(const IoUringFileReader&) = delete;
+
+		void ReadAsync(std::filesystem::path path, FileReadCallback callback) override;
+
+	private:
+		enum class Stage : uint8_t
+		{
+			Open,
+			Stat,
+			Read
+		};
+
+		struct Request
+		{
+			std::filesystem::path Path;
+			FileReadCallback Callback;
+			Stage Step = Stage::Open;
+			int File = -1;
+			struct statx Stat;
+			ByteBuffer Buffer;
+			size_t Offset = 0;
+		};
+
+		int m_Ring;
+		uint32_t m_Entries;
+		void* m_SqRing;
+		size_t m_SqRingSize;
+		void* m_CqRing;
+		size_t m_CqRingSize;
+		io_uring_sqe* m_Sqes;
+		unsigned* m_SqTail;
+		unsigned* m_SqMask;
+		unsigned* m_SqArray;
+		unsigned* m_CqHead;
+		unsigned* m_CqTail;
+		unsigned* m_CqMask;
+		io_uring_cqe* m_Cqes;
+
+		std::deque<Request*> m_Queued;
+		// Requests the failed ring may still write to, freed once it is closed
+		std::vector<Request*> m_Abandoned;
+		bool m_Stopping;
+		std::thread m_Thread;
+
+		REKSI_MUTEX_AUTO;
+		REKSI_CV_AUTO;
+
+		void ThreadLoop();
+		// Writes the submission entry of the request's current step
+		void Prepare(Request* request);
+		// Moves the request to its next step, returns false once it is finished
+		bool Advance(Request* request, int result);
+		void Finish(Request* request, bool success);
+		// Reads the file with a plain read, for requests the ring does not hold
+		void FinishInline(Request* request);
+		// Serves the queued requests with plain reads until stopped, once the ring failed
+		void ThreadLoopInline();
+	};
+#endif
+}
+
+#pragma region Defer
+namespace Reksi
+{
+	inline bool FileReader::Read(const std::filesystem::path& path, ByteBuffer& buffer)
+	{
+		buffer.clear();
+
+#if REKSI_PLATFORM_POSIX == 1
+		const int file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if ( file < 0 ) return false;
+
+		struct stat info;
+		if ( fstat(file, &info) != 0 )
+		{
+			close(file);
+			return false;
+		}
+
+		buffer.resize(static_cast<size_t>(info.st_size));
+		size_t offset = 0;
+		while ( offset < buffer.size() )
+		{
+			const ssize_t count = read(file, buffer.data() + offset, buffer.size() - offset);
+			if ( count < 0 && errno == EINTR ) continue;
+			if ( count <= 0 ) break;
+			offset += static_cast<size_t>(count);
+		}
+
+		close(file);
+		// Errors and files which shrank in the meantime fail, like with the io_uring reader
+		if ( offset < buffer.size() )
+		{
+			buffer.clear();
+			return false;
+		}
+		return true;
+#else
+		std::ifstream stream(path, std::ios::in | std::ios::binary | std::ios::ate);
+		if ( !stream ) return false;
+
+		buffer.resize(static_cast<size_t>(stream.tellg()));
+		stream.seekg(0, std::ios::beg);
+		stream.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+		if ( !stream || static_cast<size_t>(stream.gcount()) != buffer.size() )
+		{
+			buffer.clear();
+			return false;
+		}
+		return true;
+#endif
+	}
+
+	inline UniquePtr<FileReader> FileReader::Create(uint32_t threadCount)
+	{
+#if REKSI_IO_URING == 1
+		try
+		{
+			return CreateUnique<IoUringFileReader>();
+		}
+		catch ( const std::runtime_error& )
+		{
+			// Fall back to the thread pool, e.g. io_uring disabled by the kernel or a sandbox
+		}
+#endif
+
+		return CreateUnique<ThreadPoolFileReader>(threadCount == 0 ? ThreadPoolFileReader::DefaultThreadCount : threadCount);
+	}
+
+	inline ThreadPoolFileReader::ThreadPoolFileReader([[maybe_unused]] uint32_t threadCount)
+		: m_Stopping(false)
+	{
+#if REKSI_THREADING == 1
+		m_Threads.reserve(threadCount);
+		for ( uint32_t i = 0; i < threadCount; ++i )
+		{
+			m_Threads.emplace_back([this] { ThreadLoop(); });
+		}
+#endif
+	}
+
+	inline ThreadPoolFileReader::~ThreadPoolFileReader()
+	{
+		{
+			REKSI_LOCK_UNIQUE_AUTO;
+
+			m_Stopping = true;
+		}
+
+		REKSI_CV_NOTIFY_ALL_AUTO;
+
+#if REKSI_THREADING == 1
+		for ( auto& thread : m_Threads )
+		{
+			thread.join();
+		}
+#endif
+	}
+
+	inline void ThreadPoolFileReader::ReadAsync(std::filesystem::path path, FileReadCallback callback)
+	{
+#if REKSI_THREADING == 1
+		{
+			REKSI_LOCK_UNIQUE_AUTO;
+
+			m_Requests.push_back(Request{std::move(path), std::move(callback)});
+		}
+
+		REKSI_CV_NOTIFY_ONE_AUTO;
+#else
+		ByteBuffer buffer;
+		const bool success = Read(path, buffer);
+		callback(std::move(buffer), success);
+#endif
+	}
+
+	inline void ThreadPoolFileReader::ThreadLoop()
+	{
+		while ( true )
+		{
+			Request request;
+
+			{
+				REKSI_LOCK_UNIQUE_AUTO;
+
+				REKSI_CV_WAIT_AUTO([&] { return m_Stopping || !m_Requests.empty(); });
+				// Queued reads are finished before stopping
+				if ( m_Requests.empty() ) return;
+
+				request = std::move(m_Requests.front());
+				m_Requests.pop_front();
+			}
+
+			ByteBuffer buffer;
+			const bool success = Read(request.Path, buffer);
+			request.Callback(std::move(buffer), success);
+		}
+	}
+
+#if REKSI_IO_URING == 1
+	inline IoUringFileReader::IoUringFileReader(uint32_t entries)
+		: m_SqRing(MAP_FAILED), m_CqRing(MAP_FAILED), m_Sqes(nullptr), m_Stopping(false)
+	{
+		io_uring_params params;
+		std::memset(&params, 0, sizeof(params));
+
+		m_Ring = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+		if ( m_Ring < 0 )
+		{
+			throw std::runtime_error("IoUringFileReader: io_uring_setup failed");
+		}
+
+		m_Entries = params.sq_entries;
+		m_SqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		m_CqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+		const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+		if ( single_mmap ) m_SqRingSize = m_CqRingSize = std::max(m_SqRingSize, m_CqRingSize);
+
+		m_SqRing = mmap(nullptr, m_SqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_Ring,
+		                IORING_OFF_SQ_RING);
+		m_CqRing = single_mmap
+			           ? m_SqRing
+			           : mmap(nullptr, m_CqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_Ring,
+			                  IORING_OFF_CQ_RING);
+		void* sqes = mmap(nullptr, params.sq_entries * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE,
+		                  MAP_SHARED | MAP_POPULATE, m_Ring, IORING_OFF_SQES);
+
+		if ( m_SqRing == MAP_FAILED || m_CqRing == MAP_FAILED || sqes == MAP_FAILED )
+		{
+			if ( sqes != MAP_FAILED ) munmap(sqes, params.sq_entries * sizeof(io_uring_sqe));
+			if ( m_CqRing != MAP_FAILED && m_CqRing != m_SqRing ) munmap(m_CqRing, m_CqRingSize);
+			if ( m_SqRing != MAP_FAILED ) munmap(m_SqRing, m_SqRingSize);
+			close(m_Ring);
+			throw std::runtime_error("IoUringFileReader: Failed to map the rings");
+		}
+
+		const auto sq = static_cast<char*>(m_SqRing);
+		const auto cq = static_cast<char*>(m_CqRing);
+		m_Sqes = static_cast<io_uring_sqe*>(sqes);
+		m_SqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+		m_SqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+		m_SqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+		m_CqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+		m_CqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+		m_CqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+		m_Cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+		m_Thread = std::thread([this] { ThreadLoop(); });
+	}
+
+	inline IoUringFileReader::~IoUringFileReader()
+	{
+		{
+			REKSI_LOCK_UNIQUE_AUTO;
+
+			m_Stopping = true;
+		}
+
+		REKSI_CV_NOTIFY_ALL_AUTO;
+		m_Thread.join();
+
+		munmap(m_Sqes, m_Entries * sizeof(io_uring_sqe));
+		if ( m_CqRing != m_SqRing ) munmap(m_CqRing, m_CqRingSize);
+		munmap(m_SqRing, m_SqRingSize);
+		// Cancels whatever the ring still holds
+		close(m_Ring);
+
+		for ( Request* request : m_Abandoned )
+		{
+			if ( request->File >= 0 ) close(request->File);
+			delete request;
+		}
+	}
+
+	inline void IoUringFileReader::ReadAsync(std::filesystem::path path, FileReadCallback callback)
+	{
+		auto request = new Request;
+		request->Path = std::move(path);
+		request->Callback = std::move(callback);
+
+		{
+			REKSI_LOCK_UNIQUE_AUTO;
+
+			m_Queued.push_back(request);
+		}
+
+		REKSI_CV_NOTIFY_ONE_AUTO;
+	}
+
+	inline void IoUringFileReader::ThreadLoop()
+	{
+		// Requests waiting for room in the ring, moving to their next step first
+		std::deque<Request*> backlog;
+		// Every request prepared in the ring and not finished yet
+		std::unordered_set<Request*> active;
+		uint32_t in_flight = 0;
+		uint32_t unsubmitted = 0;
+
+		while ( true )
+		{
+			{
+				REKSI_LOCK_UNIQUE_AUTO;
+
+				if ( in_flight == 0 && unsubmitted == 0 && backlog.empty() )
+				{
+					REKSI_CV_WAIT_AUTO([&] { return m_Stopping || !m_Queued.empty(); });
+					// Queued reads are finished before stopping
+					if ( m_Queued.empty() ) return;
+				}
+
+				backlog.insert(backlog.end(), m_Queued.begin(), m_Queued.end());
+				m_Queued.clear();
+			}
+
+			// Completions never overflow as long as in flight entries fit the submission ring
+			while ( !backlog.empty() && in_flight + unsubmitted < m_Entries )
+			{
+				Prepare(backlog.front());
+				active.insert(backlog.front());
+				backlog.pop_front();
+				++unsubmitted;
+			}
+
+			// Submits everything prepared and waits for at least one completion
+			const int submitted = static_cast<int>(syscall(__NR_io_uring_enter, m_Ring, unsubmitted, 1,
+			                                               IORING_ENTER_GETEVENTS, nullptr, 0));
+			if ( submitted < 0 )
+			{
+				if ( errno == EINTR || errno == EAGAIN || errno == EBUSY ) continue;
+
+				// Throwing would terminate the process, fail over to plain reads instead
+				// The ring may still write to the requests it holds, so they are kept until it is closed
+				for ( Request* request : backlog )
+				{
+					active.erase(request);
+					FinishInline(request);
+				}
+				for ( Request* request : active )
+				{
+					ByteBuffer buffer;
+					const bool success = Read(request->Path, buffer);
+					request->Callback(std::move(buffer), success);
+					m_Abandoned.push_back(request);
+				}
+
+				ThreadLoopInline();
+				return;
+			}
+			unsubmitted -= static_cast<uint32_t>(submitted);
+			in_flight += static_cast<uint32_t>(submitted);
+
+			unsigned head = *m_CqHead;
+			const unsigned tail = __atomic_load_n(m_CqTail, __ATOMIC_ACQUIRE);
+			for ( ; head != tail; ++head )
+			{
+				const io_uring_cqe& cqe = m_Cqes[head & *m_CqMask];
+				const auto request = reinterpret_cast<Request*>(cqe.user_data);
+				--in_flight;
+
+				// Steps of one file follow each other, the next step joins the next submission
+				if ( Advance(request, cqe.res) )
+				{
+					backlog.push_front(request);
+				}
+				else
+				{
+					active.erase(request);
+				}
+			}
+			__atomic_store_n(m_CqHead, head, __ATOMIC_RELEASE);
+		}
+	}
+
+	inline void IoUringFileReader::Prepare(Request* request)
+	{
+		static const char empty_path[] = "";
+
+		const unsigned tail = *m_SqTail;
+		const unsigned index = tail & *m_SqMask;
+		io_uring_sqe& sqe = m_Sqes[index];
+		std::memset(&sqe, 0, sizeof(sqe));
+		sqe.user_data = reinterpret_cast<uint64_t>(request);
+
+		switch ( request->Step )
+		{
+		case Stage::Open:
+			sqe.opcode = IORING_OP_OPENAT;
+			sqe.fd = AT_FDCWD;
+			sqe.addr = reinterpret_cast<uint64_t>(request->Path.c_str());
+			sqe.open_flags = O_RDONLY | O_CLOEXEC;
+			break;
+		case Stage::Stat:
+			sqe.opcode = IORING_OP_STATX;
+			sqe.fd = request->File;
+			sqe.addr = reinterpret_cast<uint64_t>(empty_path);
+			sqe.statx_flags = AT_EMPTY_PATH;
+			sqe.len = STATX_SIZE;
+			sqe.off = reinterpret_cast<uint64_t>(&request->Stat);
+			break;
+		case Stage::Read:
+			// Reads are capped at 1 GiB, larger files take several
+			sqe.opcode = IORING_OP_READ;
+			sqe.fd = request->File;
+			sqe.addr = reinterpret_cast<uint64_t>(request->Buffer.data() + request->Offset);
+			sqe.len = static_cast<uint32_t>(std::min<size_t>(request->Buffer.size() - request->Offset, 1u << 30));
+			sqe.off = request->Offset;
+			break;
+		}
+
+		m_SqArray[index] = index;
+		__atomic_store_n(m_SqTail, tail + 1, __ATOMIC_RELEASE);
+	}
+
+	inline bool IoUringFileReader::Advance(Request* request, int result)
+	{
+		if ( result < 0 )
+		{
+			// Kernels lacking one of the operations are served by a plain read
+			if ( result == -EINVAL || result == -EOPNOTSUPP )
+			{
+				if ( request->File >= 0 ) close(request->File);
+				request->File = -1;
+				Finish(request, Read(request->Path, request->Buffer));
+			}
+			else
+			{
+				Finish(request, false);
+			}
+			return false;
+		}
+
+		switch ( request->Step )
+		{
+		case Stage::Open:
+			request->File = result;
+			request->Step = Stage::Stat;
+			return true;
+		case Stage::Stat:
+			request->Buffer.resize(static_cast<size_t>(request->Stat.stx_size));
+			if ( request->Buffer.empty() ) break;
+			request->Step = Stage::Read;
+			return true;
+		case Stage::Read:
+			// The file shrank in the meantime, fails like a plain read
+			if ( result == 0 )
+			{
+				Finish(request, false);
+				return false;
+			}
+			request->Offset += static_cast<size_t>(result);
+			if ( request->Offset < request->Buffer.size() ) return true;
+			break;
+		}
+
+		Finish(request, true);
+		return false;
+	}
+
+	inline void IoUringFileReader::Finish(Request* request, bool success)
+	{
+		const UniquePtr<Request> owned{request};
+		if ( owned->File >= 0 ) close(owned->File);
+
+		if ( !success ) owned->Buffer.clear();
+		owned->Callback(std::move(owned->Buffer), success);
+	}
+
+	inline void IoUringFileReader::FinishInline(Request* request)
+	{
+		if ( request->File >= 0 ) close(request->File);
+		request->File = -1;
+
+		const bool success = Read(request->Path, request->Buffer);
+		Finish(request, success);
+	}
+
+	inline void IoUringFileReader::ThreadLoopInline()
+	{
+		while ( true )
+		{
+			std::deque<Request*> queued;
+
+			{
+				REKSI_LOCK_UNIQUE_AUTO;
+
+				REKSI_CV_WAIT_AUTO([&] { return m_Stopping || !m_Queued.empty(); });
+				// Queued reads are finished before stopping
+				if ( m_Queued.empty() ) return;
+
+				queued.swap(m_Queued);
+			}
+
+			for ( Request* request : queued )
+			{
+				FinishInline(request);
+			}
+		}
+	}
+#endif
+}
+#pragma endregion
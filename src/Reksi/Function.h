@@ -0,0 +1,188 @@
+#pragma once
+
+#include "Reksi/Base.h"
+
+#include <cstddef>
+#include <new>
+
+namespace Reksi
+{
+	template <typename Signature, size_t Capacity = 4 * sizeof(void*)>
+	class InplaceFunction;
+
+	/*
+	 * Move-only callable stored in place, used for the loaders
+	 * Callables up to Capacity bytes which can be moved without throwing never allocate, which covers
+	 * function pointers, lambdas capturing a few pointers and even a std::function, larger ones live on the heap
+	 * The result of the callable is converted to R, e.g. SharedPtr<T> to SharedPtr<void>, within the single indirect call
+	 */
+	template <typename R, typename... Args, size_t Capacity>
+	class InplaceFunction<R(Args...), Capacity>
+	{
+	public:
+		InplaceFunction() = default;
+		InplaceFunction(std::nullptr_t);
+		template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, InplaceFunction> &&
+		                                                  std::is_invocable_r_v<R, std::decay_t<F>&, Args...>>>
+		InplaceFunction(F&& function);
+		InplaceFunction(InplaceFunction&& other) noexcept;
+		InplaceFunction& operator=(InplaceFunction&& other) noexcept;
+		~InplaceFunction();
+
+		InplaceFunction(const InplaceFunction&) = delete;
+		InplaceFunction& operator=(const InplaceFunction&) = delete;
+
+		R operator()(Args... args) const;
+		explicit operator bool() const;
+
+	private:
+		struct VTable
+		{
+			R (*Invoke)(void* storage, Args&&... args);
+			// Move constructs into the destination and destroys the source
+			void (*Relocate)(void* destination, void* source) noexcept;
+			void (*Destroy)(void* storage) noexcept;
+		};
+
+		template <typename F>
+		static constexpr bool IsInPlace = sizeof(F) <= Capacity && alignof(F) <= alignof(std::max_align_t) &&
+			std::is_nothrow_move_constructible_v<F>;
+
+		template <typename F>
+		static const VTable InPlaceVTable;
+		template <typename F>
+		static const VTable HeapVTable;
+
+		// Called as non-const like std::function does, so the storage is mutable
+		alignas(std::max_align_t) mutable unsigned char m_Storage[Capacity];
+		const VTable* m_VTable = nullptr;
+
+		void Reset();
+	};
+}
+
+#pragma region Defer
+namespace Reksi
+{
+	template <typename R, typename... Args, size_t Capacity>
+	template <typename F>
+	const typename InplaceFunction<R(Args...), Capacity>::VTable
+	InplaceFunction<R(Args...), Capacity>::InPlaceVTable = {
+		[](void* storage, Args&&... args) -> R
+		{
+			return std::invoke(*static_cast<F*>(storage), std::forward<Args>(args)...);
+		},
+		[](void* destination, void* source) noexcept
+		{
+			new(destination) F(std::move(*static_cast<F*>(source)));
+			static_cast<F*>(source)->~F();
+		},
+		[](void* storage) noexcept
+		{
+			static_cast<F*>(storage)->~F();
+		}
+	};
+
+	template <typename R, typename... Args, size_t Capacity>
+	template <typename F>
+	const typename InplaceFunction<R(Args...), Capacity>::VTable
+	InplaceFunction<R(Args...), Capacity>::HeapVTable = {
+		[](void* storage, Args&&... args) -> R
+		{
+			return std::invoke(**static_cast<F**>(storage), std::forward<Args>(args)...);
+		},
+		[](void* destination, void* source) noexcept
+		{
+			new(destination) F*(*static_cast<F**>(source));
+		},
+		[](void* storage) noexcept
+		{
+			delete *static_cast<F**>(storage);
+		}
+	};
+
+	template <typename R, typename... Args, size_t Capacity>
+	InplaceFunction<R(Args...), Capacity>::InplaceFunction(std::nullptr_t)
+	{
+	}
+
+	template <typename R, typename... Args, size_t Capacity>
+	template <typename F, typename>
+	InplaceFunction<R(Args...), Capacity>::InplaceFunction(F&& function)
+	{
+		using Stored = std::decay_t<F>;
+
+		// Empty function pointers and std::functions stay empty
+		if constexpr ( std::is_constructible_v<bool, const Stored&> )
+		{
+			const Stored& stored = function;
+			if ( !static_cast<bool>(stored) ) return;
+		}
+
+		if constexpr ( IsInPlace<Stored> )
+		{
+			new(m_Storage) Stored(std::forward<F>(function));
+			m_VTable = &InPlaceVTable<Stored>;
+		}
+		else
+		{
+			new(m_Storage) Stored*(new Stored(std::forward<F>(function)));
+			m_VTable = &HeapVTable<Stored>;
+		}
+	}
+
+	template <typename R, typename... Args, size_t Capacity>
+	InplaceFunction<R(Args...), Capacity>::InplaceFunction(InplaceFunction&& other) noexcept
+		: m_VTable(other.m_VTable)
+	{
+		if ( !m_VTable ) return;
+
+		m_VTable->Relocate(m_Storage, other.m_Storage);
+		other.m_VTable = nullptr;
+	}
+
+	template <typename R, typename... Args, size_t Capacity>
+	InplaceFunction<R(Args...), Capacity>& InplaceFunction<R(Args...), Capacity>::operator=(
+		InplaceFunction&& other) noexcept
+	{
+		if ( this == &other ) return *this;
+
+		Reset();
+		if ( !other.m_VTable ) return *this;
+
+		m_VTable = other.m_VTable;
+		m_VTable->Relocate(m_Storage, other.m_Storage);
+		other.m_VTable = nullptr;
+		return *this;
+	}
+
+	template <typename R, typename... Args, size_t Capacity>
+	InplaceFunction<R(Args...), Capacity>::~InplaceFunction()
+	{
+		Reset();
+	}
+
+	template <typename R, typename... Args, size_t Capacity>
+	R InplaceFunction<R(Args...), Capacity>::operator()(Args... args) const
+	{
+		assert(m_VTable);
+
+		return m_VTable->Invoke(m_Storage, std::forward<Args>(args)...);
+	}
+
+	template <typename R, typename... Args, size_t Capacity>
+	InplaceFunction<R(Args...), Capacity>::operator bool() const
+	{
+		return m_VTable != nullptr;
+	}
+
+	template <typename R, typename... Args, size_t Capacity>
+	void InplaceFunction<R(Args...), Capacity>::Reset()
+	{
+		if ( !m_VTable ) return;
+
+		m_VTable->Destroy(m_Storage);
+		m_VTable = nullptr;
+	}
+}
+#pragma endregion
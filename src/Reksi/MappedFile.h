@@ -0,0 +1,187 @@
+#pragma once
+
+#include "Reksi/Base.h"
+
+#if REKSI_PLATFORM_WINDOWS == 1
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif REKSI_PLATFORM_POSIX == 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+
+namespace Reksi
+{
+	// Read-only memory mapping of a whole file, usable as a resource type
+	// Loading maps the file instead of copying it, pages are read in on first access
+	// The mapping lives as long as the SharedPtr holding it, so spans handed out stay valid
+	// while the caller keeps a reference, even if the resource is unloaded meanwhile
+	//
+	// manager.SetDefaultLoader<MappedFile>();
+	// ByteSpan bytes = manager.GetResource<MappedFile>("level.bin").GetRef()->GetBytes();
+	class MappedFile
+	{
+	public:
+		// Throws std::runtime_error if the file cannot be opened or mapped
+		explicit MappedFile(const std::filesystem::path& path);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		ByteSpan GetBytes() const;
+		const std::byte* GetData() const;
+		size_t GetSize() const;
+		// Counted by the memory budget, the pages are only resident while in use though
+		size_t GetResourceSize() const;
+
+	private:
+		const std::byte* m_Data;
+		size_t m_Size;
+#if REKSI_PLATFORM_WINDOWS == 1
+		HANDLE m_Mapping;
+#endif
+	};
+}
+
+#pragma region Defer
+namespace Reksi
+{
+#if REKSI_PLATFORM_WINDOWS == 1
+	inline MappedFile::MappedFile(const std::filesystem::path& path)
+		: m_Data(nullptr), m_Size(0), m_Mapping(nullptr)
+	{
+		const HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		                                FILE_ATTRIBUTE_NORMAL, nullptr);
+		if ( file == INVALID_HANDLE_VALUE )
+		{
+			throw std::runtime_error("MappedFile: Failed to open file");
+		}
+
+		LARGE_INTEGER size;
+		if ( !GetFileSizeEx(file, &size) )
+		{
+			CloseHandle(file);
+			throw std::runtime_error("MappedFile: Failed to get the file size");
+		}
+		m_Size = static_cast<size_t>(size.QuadPart);
+
+		// Empty files cannot be mapped
+		if ( m_Size > 0 )
+		{
+			m_Mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if ( m_Mapping )
+			{
+				m_Data = static_cast<const std::byte*>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+			}
+		}
+
+		// The mapping keeps the file open
+		CloseHandle(file);
+
+		if ( m_Size > 0 && !m_Data )
+		{
+			if ( m_Mapping ) CloseHandle(m_Mapping);
+			throw std::runtime_error("MappedFile: Failed to map file");
+		}
+	}
+
+	inline MappedFile::~MappedFile()
+	{
+		if ( m_Data ) UnmapViewOfFile(m_Data);
+		if ( m_Mapping ) CloseHandle(m_Mapping);
+	}
+#elif REKSI_PLATFORM_POSIX == 1
+	inline MappedFile::MappedFile(const std::filesystem::path& path)
+		: m_Data(nullptr), m_Size(0)
+	{
+		const int file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if ( file < 0 )
+		{
+			throw std::runtime_error("MappedFile: Failed to open file");
+		}
+
+		struct stat info;
+		if ( fstat(file, &info) != 0 )
+		{
+			close(file);
+			throw std::runtime_error("MappedFile: Failed to get the file size");
+		}
+		m_Size = static_cast<size_t>(info.st_size);
+
+		// Empty files cannot be mapped
+		void* data = nullptr;
+		if ( m_Size > 0 )
+		{
+			data = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, file, 0);
+		}
+
+		// The mapping keeps the file open
+		close(file);
+
+		if ( data == MAP_FAILED )
+		{
+			throw std::runtime_error("MappedFile: Failed to map file");
+		}
+		m_Data = static_cast<const std::byte*>(data);
+	}
+
+	inline MappedFile::~MappedFile()
+	{
+		if ( m_Data ) munmap(const_cast<std::byte*>(m_Data), m_Size);
+	}
+#else
+	// No mapping support, read the whole file instead
+	inline MappedFile::MappedFile(const std::filesystem::path& path)
+		: m_Data(nullptr), m_Size(0)
+	{
+		std::ifstream stream(path, std::ios::in | std::ios::binary | std::ios::ate);
+		if ( !stream )
+		{
+			throw std::runtime_error("MappedFile: Failed to open file");
+		}
+
+		m_Size = static_cast<size_t>(stream.tellg());
+		stream.seekg(0, std::ios::beg);
+
+		auto data = new std::byte[m_Size];
+		stream.read(reinterpret_cast<char*>(data), static_cast<std::streamsize>(m_Size));
+		m_Data = data;
+	}
+
+	inline MappedFile::~MappedFile()
+	{
+		delete[] m_Data;
+	}
+#endif
+
+	inline ByteSpan MappedFile::GetBytes() const
+	{
+		return ByteSpan{m_Data, m_Size};
+	}
+
+	inline const std::byte* MappedFile::GetData() const
+	{
+		return m_Data;
+	}
+
+	inline size_t MappedFile::GetSize() const
+	{
+		return m_Size;
+	}
+
+	inline size_t MappedFile::GetResourceSize() const
+	{
+		return sizeof(MappedFile) + m_Size;
+	}
+}
+#pragma endregion
@@ -0,0 +1,628 @@
+#pragma once
+
+#include "Reksi/Base.h"
+#include "Reksi/AssetTable.h"
+#include "Reksi/ResourceKey.h"
+#include "Reksi/ResourceData.h"
+
+namespace Reksi
+{
+	// Append only storage for interned paths, stored strings only move when compacted
+	class ResourceStringPool
+	{
+	public:
+		static constexpr size_t BlockSize = 16 * 1024;
+
+		// Copies the string into the pool, returns the stored copy and its index
+		// Indices are never reused, not even by Compact
+		std::string_view Add(std::string_view str, uint32_t& index);
+		// Moves the strings still in use into new blocks and frees the old ones
+		// relocate(copy) must call copy(str) for every string in use and switch to the returned copy
+		template <typename RelocateFunc>
+		void Compact(RelocateFunc&& relocate);
+		// Bytes allocated for the strings
+		size_t GetMemoryUsage() const;
+
+	private:
+		std::vector<UniquePtr<char[]>> m_Blocks;
+		size_t m_AllocatedBytes = 0;
+		// Block small strings are appended to
+		char* m_Current = nullptr;
+		size_t m_BlockUsed = 0;
+		uint32_t m_Count = 0;
+
+		REKSI_THREADING_MUTABLE REKSI_MUTEX_AUTO;
+
+		// Requires the unique lock
+		std::string_view Copy(std::string_view str);
+	};
+
+	// Maps interned resource paths to handles
+	// Split into independently locked shards by path hash, so lookups and insertions of
+	// different paths rarely contend
+	// Every shard is an open addressing table with lookups straight from the caller's string,
+	// the lookup path does not allocate
+	// Deleting a resource only clears the handle of its entry, Compact drops the paths left without a resource
+	// Handles are kept in an array indexed by key, lookups with a key neither lock nor probe
+	// Paths of registered asset tables are found through the table's perfect hash instead of the shards
+	class ResourcePathIndex
+	{
+	public:
+		static constexpr size_t ShardCount = 64;
+
+		ResourcePathIndex();
+		~ResourcePathIndex();
+
+		ResourcePathIndex(const ResourcePathIndex&) = delete;
+		ResourcePathIndex& operator=(const ResourcePathIndex&) = delete;
+
+		// Returns 0 if the path is not registered
+		ResourceHandleT Find(const ResourcePathView& path) const;
+		ResourceHandleT Find(const ResourceKey& key) const;
+		// Returns the key of the path, interning it if needed
+		ResourceKey Intern(const ResourcePathView& path);
+		// Returns the path the key was interned from, empty for a foreign key
+		std::string_view GetString(const ResourceKey& key) const;
+		// Returns the handle of the path, calling create(key, interned path) under the shard lock if it has none,
+		// so racing callers on the same new path create it exactly once
+		template <typename CreateFunc>
+		ResourceHandleT FindOrInsert(const ResourcePathView& path, CreateFunc&& create);
+		// Same, for an already interned path, returns 0 for a foreign key
+		template <typename CreateFunc>
+		ResourceHandleT FindOrInsert(const ResourceKey& key, CreateFunc&& create);
+		// Same for many paths, locking each shard once, handles receives the handle of every path
+		// path(i) returns the i-th path, create(i, key, interned path) creates the missing ones
+		template <typename PathFunc, typename CreateFunc>
+		void FindOrInsert(size_t count, PathFunc&& path, CreateFunc&& create, ResourceHandleT* handles);
+		// Interns every path of the table, later lookups of them go through the table and its keys
+		// Returns the keys in table order
+		const std::vector<ResourceKey>& RegisterTable(const StaticAssetTable& table);
+		// Clears the handle of the path if it still is the given one
+		bool Erase(const ResourceKey& key, ResourceHandleT handle);
+		// Drops the paths without a resource, unless Intern handed out their key, and shrinks the tables
+		// The remaining paths move to new strings, moved(handle, path) is called for every one with a resource
+		// Keys of dropped paths are never reused, lookups with them fail like with a foreign key
+		// Must not run concurrently with any other use of the index
+		template <typename MovedFunc>
+		void Compact(MovedFunc&& moved);
+		// Bytes allocated for the tables, handles and interned strings
+		size_t GetMemoryUsage() const;
+
+	private:
+		static constexpr size_t InitialCapacity = 16;
+
+		struct Entry
+		{
+			uint64_t Hash = 0;
+			std::string_view Path;
+			uint32_t Index = ResourceKey::InvalidIndex;
+			// Handed out by Intern, kept by Compact as the caller may look it up later
+			bool Keyed = false;
+		};
+
+		// Segment s holds FirstHandleSegmentSize << s handles, like the slot map
+		static constexpr uint32_t FirstHandleSegmentBits = 6;
+		static constexpr uint32_t FirstHandleSegmentSize = 1u << FirstHandleSegmentBits;
+		static constexpr uint32_t HandleSegmentCount = 32 - FirstHandleSegmentBits + 1;
+
+		struct alignas(64) Shard
+		{
+			REKSI_THREADING_MUTABLE REKSI_MUTEX_AUTO;
+			// Power of two sized, empty entries have an invalid index
+			std::vector<Entry> Entries;
+			size_t Count = 0;
+		};
+
+		// Registered table with the key of each of its paths, tables are never unregistered
+		struct AssetTableNode
+		{
+			StaticAssetTable Table;
+			std::vector<ResourceKey> Keys;
+			const AssetTableNode* Next;
+		};
+
+		Shard m_Shards[ShardCount];
+		ResourceStringPool m_Strings;
+		// Pushed to the front, read without locking
+		std::atomic<const AssetTableNode*> m_AssetTables;
+		// Handle of every interned path by key index, 0 while no resource is registered for the path
+		// Written under the lock of the path's shard
+		std::atomic<std::atomic<ResourceHandleT>*> m_Handles[HandleSegmentCount];
+
+		static size_t GetShardIndex(uint64_t hash);
+		// Returns the key of the path in a registered table, an invalid key if it is in none
+		ResourceKey FindRegistered(const ResourcePathView& path) const;
+		// Returns the entry of the path, nullptr if missing
+		static const Entry* FindEntry(const Shard& shard, std::string_view path, uint64_t hash);
+		static const Entry* FindEntry(const Shard& shard, const ResourceKey& key);
+		// Interns the path, requires the unique lock of the shard
+		Entry& FindOrAddEntry(Shard& shard, const ResourcePathView& path);
+		static void Grow(Shard& shard);
+		// Reinserts the entries into a table of the given power of two size, 0 frees the table
+		static void Rehash(Shard& shard, size_t capacity);
+		// Returns nullptr if the index was never interned
+		std::atomic<ResourceHandleT>* GetHandleSlot(uint32_t index) const;
+		std::atomic<ResourceHandleT>& GetOrCreateHandleSlot(uint32_t index);
+	};
+}
+
+#pragma region Defer
+namespace Reksi
+{
+	inline std::string_view ResourceStringPool::Add(std::string_view str, uint32_t& index)
+	{
+		REKSI_LOCK_UNIQUE_AUTO;
+
+		index = m_Count++;
+		return Copy(str);
+	}
+
+	template <typename RelocateFunc>
+	void ResourceStringPool::Compact(RelocateFunc&& relocate)
+	{
+		// Freed at the end, once every string in use was copied out
+		std::vector<UniquePtr<char[]>> blocks;
+
+		{
+			REKSI_LOCK_UNIQUE_AUTO;
+
+			blocks.swap(m_Blocks);
+			m_AllocatedBytes = 0;
+			m_Current = nullptr;
+			m_BlockUsed = 0;
+		}
+
+		// Not locked meanwhile, the caller's locks are taken before the pool's like when adding
+		relocate([this](std::string_view str)
+		{
+			REKSI_LOCK_UNIQUE_AUTO;
+			return Copy(str);
+		});
+	}
+
+	inline std::string_view ResourceStringPool::Copy(std::string_view str)
+	{
+		char* dest;
+		if ( str.size() > BlockSize / 4 )
+		{
+			// Large strings get a block of their own, the current block stays in use
+			m_Blocks.emplace_back(new char[str.size()]);
+			m_AllocatedBytes += str.size();
+			dest = m_Blocks.back().get();
+		}
+		else
+		{
+			if ( !m_Current || m_BlockUsed + str.size() > BlockSize )
+			{
+				m_Blocks.emplace_back(new char[BlockSize]);
+				m_AllocatedBytes += BlockSize;
+				m_Current = m_Blocks.back().get();
+				m_BlockUsed = 0;
+			}
+
+			dest = m_Current + m_BlockUsed;
+			m_BlockUsed += str.size();
+		}
+
+		std::copy(str.begin(), str.end(), dest);
+		return std::string_view{dest, str.size()};
+	}
+
+	inline size_t ResourceStringPool::GetMemoryUsage() const
+	{
+		REKSI_LOCK_SHARED_AUTO;
+
+		return m_AllocatedBytes + m_Blocks.capacity() * sizeof(UniquePtr<char[]>);
+	}
+
+	inline ResourcePathIndex::ResourcePathIndex()
+		: m_AssetTables(nullptr)
+	{
+		for ( auto& segment : m_Handles )
+		{
+			segment.store(nullptr, std::memory_order_relaxed);
+		}
+	}
+
+	inline ResourcePathIndex::~ResourcePathIndex()
+	{
+		for ( auto& segment : m_Handles )
+		{
+			delete[] segment.load(std::memory_order_relaxed);
+		}
+
+		const AssetTableNode* node = m_AssetTables.load(std::memory_order_relaxed);
+		while ( node )
+		{
+			const AssetTableNode* next = node->Next;
+			delete node;
+			node = next;
+		}
+	}
+
+	inline ResourceHandleT ResourcePathIndex::Find(const ResourcePathView& path) const
+	{
+		const ResourceKey registered = FindRegistered(path);
+		if ( registered.IsValid() ) return Find(registered);
+
+		uint32_t index;
+
+		{
+			const Shard& shard = m_Shards[GetShardIndex(path.GetHash())];
+			REKSI_LOCK_SHARED(shard.REKSI_MUTEX_AUTO_NAME, lock);
+
+			const Entry* entry = FindEntry(shard, path.GetString(), path.GetHash());
+			if ( !entry ) return 0;
+			index = entry->Index;
+		}
+
+		return GetHandleSlot(index)->load(std::memory_order_acquire);
+	}
+
+	inline ResourceHandleT ResourcePathIndex::Find(const ResourceKey& key) const
+	{
+		if ( !key.IsValid() ) return 0;
+
+		const std::atomic<ResourceHandleT>* slot = GetHandleSlot(key.Index);
+		return slot ? slot->load(std::memory_order_acquire) : 0;
+	}
+
+	inline ResourceKey ResourcePathIndex::Intern(const ResourcePathView& path)
+	{
+		const ResourceKey registered = FindRegistered(path);
+		if ( registered.IsValid() ) return registered;
+
+		Shard& shard = m_Shards[GetShardIndex(path.GetHash())];
+
+		{
+			REKSI_LOCK_SHARED(shard.REKSI_MUTEX_AUTO_NAME, lock);
+
+			const Entry* entry = FindEntry(shard, path.GetString(), path.GetHash());
+			if ( entry && entry->Keyed ) return ResourceKey{entry->Hash, entry->Index};
+		}
+
+		REKSI_LOCK_UNIQUE(shard.REKSI_MUTEX_AUTO_NAME, lock);
+
+		Entry& entry = FindOrAddEntry(shard, path);
+		entry.Keyed = true;
+		return ResourceKey{entry.Hash, entry.Index};
+	}
+
+	inline std::string_view ResourcePathIndex::GetString(const ResourceKey& key) const
+	{
+		const Shard& shard = m_Shards[GetShardIndex(key.Hash)];
+		REKSI_LOCK_SHARED(shard.REKSI_MUTEX_AUTO_NAME, lock);
+
+		const Entry* entry = FindEntry(shard, key);
+		return entry ? entry->Path : std::string_view{};
+	}
+
+	template <typename CreateFunc>
+	ResourceHandleT ResourcePathIndex::FindOrInsert(const ResourcePathView& path, CreateFunc&& create)
+	{
+		const ResourceKey registered = FindRegistered(path);
+		if ( registered.IsValid() ) return FindOrInsert(registered, std::forward<CreateFunc>(create));
+
+		Shard& shard = m_Shards[GetShardIndex(path.GetHash())];
+		REKSI_LOCK_UNIQUE(shard.REKSI_MUTEX_AUTO_NAME, lock);
+
+		const Entry& entry = FindOrAddEntry(shard, path);
+		std::atomic<ResourceHandleT>& slot = *GetHandleSlot(entry.Index);
+
+		ResourceHandleT handle = slot.load(std::memory_order_relaxed);
+		if ( handle == 0 )
+		{
+			handle = create(ResourceKey{entry.Hash, entry.Index}, entry.Path);
+			slot.store(handle, std::memory_order_release);
+		}
+		return handle;
+	}
+
+	template <typename CreateFunc>
+	ResourceHandleT ResourcePathIndex::FindOrInsert(const ResourceKey& key, CreateFunc&& create)
+	{
+		if ( const ResourceHandleT handle = Find(key) ) return handle;
+
+		Shard& shard = m_Shards[GetShardIndex(key.Hash)];
+		REKSI_LOCK_UNIQUE(shard.REKSI_MUTEX_AUTO_NAME, lock);
+
+		const Entry* entry = FindEntry(shard, key);
+		if ( !entry ) return 0;
+
+		std::atomic<ResourceHandleT>& slot = *GetHandleSlot(entry->Index);
+
+		ResourceHandleT handle = slot.load(std::memory_order_relaxed);
+		if ( handle == 0 )
+		{
+			handle = create(key, entry->Path);
+			slot.store(handle, std::memory_order_release);
+		}
+		return handle;
+	}
+
+	template <typename PathFunc, typename CreateFunc>
+	void ResourcePathIndex::FindOrInsert(size_t count, PathFunc&& path, CreateFunc&& create, ResourceHandleT* handles)
+	{
+		// Counting sort of the paths by shard
+		size_t starts[ShardCount + 1] = {};
+		for ( size_t i = 0; i < count; ++i )
+		{
+			++starts[GetShardIndex(path(i).GetHash()) + 1];
+		}
+		for ( size_t shard = 0; shard < ShardCount; ++shard )
+		{
+			starts[shard + 1] += starts[shard];
+		}
+
+		std::vector<size_t> order(count);
+		size_t next[ShardCount];
+		std::copy(starts, starts + ShardCount, next);
+		for ( size_t i = 0; i < count; ++i )
+		{
+			order[next[GetShardIndex(path(i).GetHash())]++] = i;
+		}
+
+		for ( size_t index = 0; index < ShardCount; ++index )
+		{
+			if ( starts[index] == starts[index + 1] ) continue;
+
+			Shard& shard = m_Shards[index];
+			REKSI_LOCK_UNIQUE(shard.REKSI_MUTEX_AUTO_NAME, lock);
+
+			// Grow once up front, assuming all paths are new
+			while ( shard.Entries.empty() || (shard.Count + starts[index + 1] - starts[index]) * 4 > shard.Entries.size() * 3 )
+			{
+				Grow(shard);
+			}
+
+			for ( size_t i = starts[index]; i < starts[index + 1]; ++i )
+			{
+				const size_t request = order[i];
+				const Entry& entry = FindOrAddEntry(shard, path(request));
+				std::atomic<ResourceHandleT>& slot = *GetHandleSlot(entry.Index);
+
+				ResourceHandleT handle = slot.load(std::memory_order_relaxed);
+				if ( handle == 0 )
+				{
+					handle = create(request, ResourceKey{entry.Hash, entry.Index}, entry.Path);
+					slot.store(handle, std::memory_order_release);
+				}
+				handles[request] = handle;
+			}
+		}
+	}
+
+	inline const std::vector<ResourceKey>& ResourcePathIndex::RegisterTable(const StaticAssetTable& table)
+	{
+		auto node = new AssetTableNode{table, {}, nullptr};
+		node->Keys.reserve(table.GetCount());
+
+		for ( size_t i = 0; i < table.GetCount(); ++i )
+		{
+			node->Keys.emplace_back(Intern(table[i]));
+		}
+
+		// Published once every key is interned, so lookups through the table always find their entry
+		const AssetTableNode* head = m_AssetTables.load(std::memory_order_relaxed);
+		do
+		{
+			node->Next = head;
+		}
+		while ( !m_AssetTables.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_relaxed) );
+
+		return node->Keys;
+	}
+
+	inline bool ResourcePathIndex::Erase(const ResourceKey& key, ResourceHandleT handle)
+	{
+		Shard& shard = m_Shards[GetShardIndex(key.Hash)];
+		REKSI_LOCK_UNIQUE(shard.REKSI_MUTEX_AUTO_NAME, lock);
+
+		if ( !FindEntry(shard, key) ) return false;
+
+		return GetHandleSlot(key.Index)->compare_exchange_strong(handle, 0, std::memory_order_acq_rel);
+	}
+
+	template <typename MovedFunc>
+	void ResourcePathIndex::Compact(MovedFunc&& moved)
+	{
+		for ( Shard& shard : m_Shards )
+		{
+			REKSI_LOCK_UNIQUE(shard.REKSI_MUTEX_AUTO_NAME, lock);
+
+			for ( Entry& entry : shard.Entries )
+			{
+				if ( entry.Index == ResourceKey::InvalidIndex || entry.Keyed ) continue;
+				if ( GetHandleSlot(entry.Index)->load(std::memory_order_relaxed) != 0 ) continue;
+
+				entry.Index = ResourceKey::InvalidIndex;
+				--shard.Count;
+			}
+
+			// Smallest table keeping the load factor below 3/4
+			size_t capacity = 0;
+			if ( shard.Count > 0 )
+			{
+				capacity = InitialCapacity;
+				while ( shard.Count * 4 > capacity * 3 )
+				{
+					capacity *= 2;
+				}
+			}
+			Rehash(shard, capacity);
+		}
+
+		m_Strings.Compact([&](const auto& copy)
+		{
+			for ( Shard& shard : m_Shards )
+			{
+				REKSI_LOCK_UNIQUE(shard.REKSI_MUTEX_AUTO_NAME, lock);
+
+				for ( Entry& entry : shard.Entries )
+				{
+					if ( entry.Index == ResourceKey::InvalidIndex ) continue;
+
+					entry.Path = copy(entry.Path);
+					const ResourceHandleT handle = GetHandleSlot(entry.Index)->load(std::memory_order_relaxed);
+					if ( handle != 0 ) moved(handle, entry.Path);
+				}
+			}
+		});
+	}
+
+	inline size_t ResourcePathIndex::GetMemoryUsage() const
+	{
+		size_t bytes = m_Strings.GetMemoryUsage();
+
+		for ( const auto& shard : m_Shards )
+		{
+			REKSI_LOCK_SHARED(shard.REKSI_MUTEX_AUTO_NAME, lock);
+
+			bytes += shard.Entries.capacity() * sizeof(Entry);
+		}
+
+		for ( auto node = m_AssetTables.load(std::memory_order_acquire); node; node = node->Next )
+		{
+			bytes += sizeof(AssetTableNode) + node->Keys.capacity() * sizeof(ResourceKey);
+		}
+
+		for ( uint32_t segment = 0; segment < HandleSegmentCount; ++segment )
+		{
+			if ( m_Handles[segment].load(std::memory_order_acquire) )
+			{
+				bytes += (FirstHandleSegmentSize << segment) * sizeof(std::atomic<ResourceHandleT>);
+			}
+		}
+
+		return bytes;
+	}
+
+	inline size_t ResourcePathIndex::GetShardIndex(uint64_t hash)
+	{
+		return hash % ShardCount;
+	}
+
+	inline ResourceKey ResourcePathIndex::FindRegistered(const ResourcePathView& path) const
+	{
+		const ResourcePathLiteral literal{path.GetString(), path.GetHash()};
+
+		for ( auto node = m_AssetTables.load(std::memory_order_acquire); node; node = node->Next )
+		{
+			const size_t index = node->Table.Find(literal);
+			if ( index != StaticAssetTable::NotFound ) return node->Keys[index];
+		}
+
+		return ResourceKey{};
+	}
+
+	inline const ResourcePathIndex::Entry* ResourcePathIndex::FindEntry(const Shard& shard, std::string_view path,
+	                                                                     uint64_t hash)
+	{
+		if ( shard.Entries.empty() ) return nullptr;
+
+		// The low bits select the shard, probe with the rest
+		const size_t mask = shard.Entries.size() - 1;
+		for ( size_t i = (hash / ShardCount) & mask; ; i = (i + 1) & mask )
+		{
+			const Entry& entry = shard.Entries[i];
+			if ( entry.Index == ResourceKey::InvalidIndex ) return nullptr;
+			if ( entry.Hash == hash && entry.Path == path ) return &entry;
+		}
+	}
+
+	inline const ResourcePathIndex::Entry* ResourcePathIndex::FindEntry(const Shard& shard, const ResourceKey& key)
+	{
+		if ( shard.Entries.empty() || !key.IsValid() ) return nullptr;
+
+		const size_t mask = shard.Entries.size() - 1;
+		for ( size_t i = (key.Hash / ShardCount) & mask; ; i = (i + 1) & mask )
+		{
+			const Entry& entry = shard.Entries[i];
+			if ( entry.Index == ResourceKey::InvalidIndex ) return nullptr;
+			if ( entry.Index == key.Index ) return &entry;
+		}
+	}
+
+	inline ResourcePathIndex::Entry& ResourcePathIndex::FindOrAddEntry(Shard& shard, const ResourcePathView& path)
+	{
+		if ( const Entry* entry = FindEntry(shard, path.GetString(), path.GetHash()) )
+		{
+			return const_cast<Entry&>(*entry);
+		}
+
+		// Keep the load factor below 3/4
+		if ( (shard.Count + 1) * 4 > shard.Entries.size() * 3 ) Grow(shard);
+
+		const size_t mask = shard.Entries.size() - 1;
+		size_t i = (path.GetHash() / ShardCount) & mask;
+		while ( shard.Entries[i].Index != ResourceKey::InvalidIndex )
+		{
+			i = (i + 1) & mask;
+		}
+
+		Entry& entry = shard.Entries[i];
+		entry.Hash = path.GetHash();
+		entry.Path = m_Strings.Add(path.GetString(), entry.Index);
+		GetOrCreateHandleSlot(entry.Index);
+		++shard.Count;
+		return entry;
+	}
+
+	inline void ResourcePathIndex::Grow(Shard& shard)
+	{
+		Rehash(shard, std::max(InitialCapacity, shard.Entries.size() * 2));
+	}
+
+	inline void ResourcePathIndex::Rehash(Shard& shard, size_t capacity)
+	{
+		std::vector<Entry> entries(capacity);
+		const size_t mask = capacity - 1;
+
+		for ( const Entry& entry : shard.Entries )
+		{
+			if ( entry.Index == ResourceKey::InvalidIndex ) continue;
+
+			size_t i = (entry.Hash / ShardCount) & mask;
+			while ( entries[i].Index != ResourceKey::InvalidIndex )
+			{
+				i = (i + 1) & mask;
+			}
+			entries[i] = entry;
+		}
+
+		shard.Entries.swap(entries);
+	}
+
+	inline std::atomic<ResourceHandleT>* ResourcePathIndex::GetHandleSlot(uint32_t index) const
+	{
+		const uint32_t segment = FloorLog2((static_cast<uint64_t>(index) >> FirstHandleSegmentBits) + 1);
+		std::atomic<ResourceHandleT>* handles = m_Handles[segment].load(std::memory_order_acquire);
+		if ( !handles ) return nullptr;
+
+		return &handles[index - (((1u << segment) - 1) << FirstHandleSegmentBits)];
+	}
+
+	inline std::atomic<ResourceHandleT>& ResourcePathIndex::GetOrCreateHandleSlot(uint32_t index)
+	{
+		const uint32_t segment = FloorLog2((static_cast<uint64_t>(index) >> FirstHandleSegmentBits) + 1);
+		if ( !m_Handles[segment].load(std::memory_order_acquire) )
+		{
+			// Paths of different shards may race for the same segment, the loser frees its copy
+			const uint32_t size = FirstHandleSegmentSize << segment;
+			auto handles = new std::atomic<ResourceHandleT>[size];
+			for ( uint32_t i = 0; i < size; ++i )
+			{
+				handles[i].store(0, std::memory_order_relaxed);
+			}
+
+			std::atomic<ResourceHandleT>* expected = nullptr;
+			if ( !m_Handles[segment].compare_exchange_strong(expected, handles, std::memory_order_acq_rel) )
+			{
+				delete[] handles;
+			}
+		}
+
+		return *GetHandleSlot(index);
+	}
+}
+#pragma endregion
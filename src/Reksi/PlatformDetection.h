@@ -10,6 +10,70 @@
 #define REKSI_THREADING 1
 #endif
 
+/*
+ * Platform Detection
+ */
+#if defined(_WIN32)
+#define REKSI_PLATFORM_WINDOWS 1
+#define REKSI_PLATFORM_POSIX 0
+#elif defined(__unix__) || defined(__APPLE__)
+#define REKSI_PLATFORM_WINDOWS 0
+#define REKSI_PLATFORM_POSIX 1
+#else
+#define REKSI_PLATFORM_WINDOWS 0
+#define REKSI_PLATFORM_POSIX 0
+#endif
+
+#if defined(__linux__)
+#define REKSI_PLATFORM_LINUX 1
+#else
+#define REKSI_PLATFORM_LINUX 0
+#endif
+
+/*
+ * io_uring backend for the manager's file reads, opt in and Linux only
+ * Falls back to a thread pool if the kernel does not support it
+ */
+#ifndef REKSI_IO_URING
+#define REKSI_IO_URING 0
+#endif
+#if REKSI_IO_URING == 1 && (REKSI_PLATFORM_LINUX == 0 || REKSI_THREADING == 0)
+#undef REKSI_IO_URING
+#define REKSI_IO_URING 0
+#endif
+
+/*
+ * std::span needs C++20, Reksi falls back to its own minimal Span otherwise
+ */
+#if defined(__has_include)
+#if __has_include(<span>) && __cplusplus >= 202002L
+#define REKSI_STD_SPAN 1
+#endif
+#endif
+#ifndef REKSI_STD_SPAN
+#define REKSI_STD_SPAN 0
+#endif
+
+/*
+ * Coroutine awaitables need C++20, the rest of Reksi stays usable with C++17
+ */
+#ifndef REKSI_COROUTINES
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#define REKSI_COROUTINES 1
+#else
+#define REKSI_COROUTINES 0
+#endif
+#endif
+
+/*
+ * Compile time path hashing is forced with consteval when available
+ */
+#if defined(__cpp_consteval) && __cpp_consteval >= 201811L
+#define REKSI_CONSTEVAL consteval
+#else
+#define REKSI_CONSTEVAL constexpr
+#endif
+
 /*
  * Debug Definition
  */
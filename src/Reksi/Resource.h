@@ -11,6 +11,11 @@ namespace Reksi
 	{
 	public:
 		SharedPtr<T> GetRef();
+		// Returns the data if loaded, the default resource otherwise, never loads
+		SharedPtr<T> TryGetRef();
+		// Like GetRef and TryGetRef, without touching the reference count of the data, see ResourceView
+		ResourceView<T> Borrow();
+		ResourceView<T> TryBorrow();
 		T& operator*();
 
 		ResourceStatus GetStatus() const;
@@ -20,8 +25,11 @@ namespace Reksi
 		ResourceLoadStatus Load();
 		ResourceUnloadStatus Unload();
 		ResourceLoadStatus Reload();
+		// Queues the load on the manager's worker threads
+		ResourceFuture<T> LoadAsync(LoadPriority priority = LoadPriority::Visible);
 
 		std::filesystem::path GetPath() const;
+		ResourceKey GetKey() const;
 		ResourceLoadFunc<T> GetLoader() const;
 
 		ResourceManager* GetManager() const;
@@ -31,6 +39,11 @@ namespace Reksi
 		void RemoveListener(ResourceListener* listener);
 		void ClearListeners();
 
+		// Keeps the data resident regardless of the manager's memory budget, pins are counted
+		void Pin();
+		void Unpin();
+		bool IsPinned() const;
+
 	private:
 		Resource(ResourceHandleT handle, ResourceData* data, ResourceManager* manager);
 
@@ -39,6 +52,76 @@ namespace Reksi
 		ResourceManager* m_Manager;
 
 		friend class ResourceManager;
+		friend class ResourceAwaiter<T>;
+		friend class ResourceRef<T>;
+	};
+
+	/*
+	 * Scoped access to the data of a resource which does not touch its reference count,
+	 * so threads reading the same hot resource do not contend on its control block
+	 * The data version is kept alive by an EpochDomain::Guard instead, even if the resource is reloaded meanwhile
+	 * Holds off freeing replaced data of all resources while alive, keep it short and on the borrowing thread
+	 *
+	 * if ( auto config = resource.Borrow() ) Use(config->Value);
+	 */
+	template <typename T>
+	class ResourceView
+	{
+	public:
+		ResourceView(const ResourceView&) = delete;
+		ResourceView& operator=(const ResourceView&) = delete;
+
+		T& operator*() const;
+		T* operator->() const;
+		T* Get() const;
+		// False if the resource is not loaded and there is no default resource
+		explicit operator bool() const;
+
+	private:
+		EpochDomain::Guard m_Guard;
+		T* m_Data;
+		// The default resource is not protected by the guard, so it is referenced instead
+		SharedPtr<T> m_Default;
+
+		ResourceView(ResourceData* data, ResourceManager* manager, bool load);
+
+		friend class Resource<T>;
+	};
+
+	/*
+	 * Caches the data of a resource for hot paths, dereferencing costs two relaxed loads while the data is unchanged,
+	 * the state of the resource's slot and the version of its data, which changes with every reload and unload
+	 * Falls back to Resource::GetRef once either changed, loading the resource if needed
+	 * Keeps the cached data alive like the SharedPtr from GetRef, not thread-safe, use one per thread
+	 * Must be dropped before ResourceManager::Compact once its resource was deleted
+	 *
+	 * ResourceRef<Mesh> mesh{manager.GetResource<Mesh>("cube.obj")};
+	 * for ( auto& instance : instances ) Draw(*mesh, instance);
+	 */
+	template <typename T>
+	class ResourceRef
+	{
+	public:
+		explicit ResourceRef(const Resource<T>& resource);
+
+		// The default resource if the resource failed to load
+		const SharedPtr<T>& GetRef();
+		T& operator*();
+		T* operator->();
+		// False once the resource was deleted
+		bool IsValid() const;
+		const Resource<T>& GetResource() const;
+
+	private:
+		Resource<T> m_Resource;
+		const std::atomic<uint32_t>* m_SlotState;
+		uint32_t m_LiveState;
+		// Version of the resource's data when it was cached
+		uint32_t m_Version;
+		SharedPtr<T> m_Cached;
+
+		bool IsCurrent() const;
+		void Refresh();
 	};
 }
 
@@ -61,6 +144,33 @@ namespace Reksi
 		return ref;
 	}
 
+	template <typename T>
+	SharedPtr<T> Resource<T>::TryGetRef()
+	{
+		assert(IsValid());
+
+		auto ref = m_Data->GetDataIfLoaded<T>();
+		if ( ref ) return ref;
+
+		return m_Manager->GetDefaultResource<T>();
+	}
+
+	template <typename T>
+	ResourceView<T> Resource<T>::Borrow()
+	{
+		assert(IsValid());
+
+		return ResourceView<T>{m_Data, m_Manager, true};
+	}
+
+	template <typename T>
+	ResourceView<T> Resource<T>::TryBorrow()
+	{
+		assert(IsValid());
+
+		return ResourceView<T>{m_Data, m_Manager, false};
+	}
+
 	template <typename T>
 	T& Resource<T>::operator*()
 	{
@@ -114,6 +224,14 @@ namespace Reksi
 		return m_Data->Load();
 	}
 
+	template <typename T>
+	ResourceFuture<T> Resource<T>::LoadAsync(LoadPriority priority)
+	{
+		assert(IsValid());
+
+		return m_Manager->LoadAsync(*this, priority);
+	}
+
 	template <typename T>
 	std::filesystem::path Resource<T>::GetPath() const
 	{
@@ -122,6 +240,14 @@ namespace Reksi
 		return m_Data->GetPath();
 	}
 
+	template <typename T>
+	ResourceKey Resource<T>::GetKey() const
+	{
+		assert(IsValid());
+
+		return m_Data->GetKey();
+	}
+
 	template <typename T>
 	ResourceLoadFunc<T> Resource<T>::GetLoader() const
 	{
@@ -166,11 +292,130 @@ namespace Reksi
 		m_Data->ClearListeners();
 	}
 
+	template <typename T>
+	void Resource<T>::Pin()
+	{
+		assert(IsValid());
+
+		m_Data->Pin();
+	}
+
+	template <typename T>
+	void Resource<T>::Unpin()
+	{
+		assert(IsValid());
+
+		m_Data->Unpin();
+	}
+
+	template <typename T>
+	bool Resource<T>::IsPinned() const
+	{
+		assert(IsValid());
+
+		return m_Data->IsPinned();
+	}
+
 	template <typename T>
 	Resource<T>::Resource(ResourceHandleT handle, ResourceData* data, ResourceManager* manager)
 		: m_Handle(handle), m_Data(data), m_Manager(manager)
 	{
 	}
 
+	template <typename T>
+	ResourceView<T>::ResourceView(ResourceData* data, ResourceManager* manager, bool load)
+		: m_Data(data->BorrowData<T>(load))
+	{
+		if ( m_Data ) return;
+
+		m_Default = manager->GetDefaultResource<T>();
+		m_Data = m_Default.get();
+	}
+
+	template <typename T>
+	T& ResourceView<T>::operator*() const
+	{
+		assert(m_Data);
+
+		return *m_Data;
+	}
+
+	template <typename T>
+	T* ResourceView<T>::operator->() const
+	{
+		return m_Data;
+	}
+
+	template <typename T>
+	T* ResourceView<T>::Get() const
+	{
+		return m_Data;
+	}
+
+	template <typename T>
+	ResourceView<T>::operator bool() const
+	{
+		return m_Data != nullptr;
+	}
+
+	template <typename T>
+	ResourceRef<T>::ResourceRef(const Resource<T>& resource)
+		: m_Resource(resource),
+		  m_SlotState(resource.m_Manager->m_Resources.GetState(resource.m_Handle)),
+		  m_LiveState(ResourceSlotMap::GetLiveState(resource.m_Handle)),
+		  m_Version(0)
+	{
+	}
+
+	template <typename T>
+	const SharedPtr<T>& ResourceRef<T>::GetRef()
+	{
+		if ( !IsCurrent() ) Refresh();
+		return m_Cached;
+	}
+
+	template <typename T>
+	T& ResourceRef<T>::operator*()
+	{
+		return *GetRef();
+	}
+
+	template <typename T>
+	T* ResourceRef<T>::operator->()
+	{
+		return GetRef().get();
+	}
+
+	template <typename T>
+	bool ResourceRef<T>::IsValid() const
+	{
+		return m_SlotState && m_SlotState->load(std::memory_order_acquire) == m_LiveState;
+	}
+
+	template <typename T>
+	const Resource<T>& ResourceRef<T>::GetResource() const
+	{
+		return m_Resource;
+	}
+
+	template <typename T>
+	bool ResourceRef<T>::IsCurrent() const
+	{
+		// The cached data is owned, so it stays usable even if it was replaced meanwhile
+		// The slot is checked first, the ResourceData is gone once the resource was deleted
+		return m_Cached && m_SlotState->load(std::memory_order_relaxed) == m_LiveState &&
+			m_Resource.m_Data->GetVersion() == m_Version;
+	}
+
+	template <typename T>
+	void ResourceRef<T>::Refresh()
+	{
+		assert(IsValid());
+
+		// Read first, a change during the load is picked up by the next access
+		m_Version = m_Resource.m_Data->GetVersion();
+		m_Cached = m_Resource.GetRef();
+	}
+
 }
 #pragma endregion
@@ -1,6 +1,12 @@
 #pragma once
 
 #include "Reksi/Base.h"
+#include "Reksi/ResourceKey.h"
+#include "Reksi/FileIO.h"
+#include "Reksi/Archive.h"
+#include "Reksi/Epoch.h"
+#include "Reksi/Function.h"
+#include "Reksi/TypeId.h"
 
 #define RK_BIT(x) (1 << (x))
 
@@ -9,7 +15,8 @@ namespace Reksi
 	// Forward Declaration
 	class ResourceData;
 
-	using ResourceHandleT = uint32_t;
+	// See ResourceHandleLayout
+	using ResourceHandleT = uint64_t;
 	class ResourceStatus
 	{
 	public:
@@ -19,6 +26,7 @@ namespace Reksi
 		{
 			Loaded = RK_BIT(0),
 			Loading = RK_BIT(1),
+			Queued = RK_BIT(2),
 			MarkedForReload = RK_BIT(3),
 			MarkedForDelete = RK_BIT(4)
 		};
@@ -47,6 +55,8 @@ namespace Reksi
 			WaitedForLoad = RK_BIT(2),
 			MarkedForDelete = RK_BIT(3),
 			AlreadyReloading = RK_BIT(4),
+			// The loader threw, the load failed
+			LoaderThrew = RK_BIT(5),
 		};
 
 		ResourceLoadStatus()
@@ -89,11 +99,65 @@ namespace Reksi
 
 	template <typename T>
 	using ResourceLoadFunc = std::function<SharedPtr<T>(const std::filesystem::path&)>;
+	// Loads from the file contents, read by the manager, batched with other reads when loading asynchronously
+	template <typename T>
+	using ResourceBufferLoadFunc = std::function<SharedPtr<T>(const std::filesystem::path&, ByteSpan)>;
+
+	namespace Detail
+	{
+		template <typename T, typename = void>
+		struct HasGetResourceSize : std::false_type
+		{
+		};
+
+		template <typename T>
+		struct HasGetResourceSize<T, std::void_t<decltype(std::declval<const T&>().GetResourceSize())>> : std::true_type
+		{
+		};
+
+		template <typename T, typename = void>
+		struct HasCapacity : std::false_type
+		{
+		};
+
+		template <typename T>
+		struct HasCapacity<T, std::void_t<typename T::value_type, decltype(std::declval<const T&>().capacity())>>
+			: std::true_type
+		{
+		};
+	}
+
+	// Bytes a loaded resource occupies, counted against the manager's memory budget
+	// Uses a GetResourceSize() member if T has one, the capacity of containers like std::vector
+	// and std::string, and sizeof(T) otherwise
+	// Specialize for other types owning memory beyond their own size
+	template <typename T>
+	struct ResourceSize
+	{
+		static size_t Get(const T& resource)
+		{
+			if constexpr ( Detail::HasGetResourceSize<T>::value )
+			{
+				return static_cast<size_t>(resource.GetResourceSize());
+			}
+			else if constexpr ( Detail::HasCapacity<T>::value )
+			{
+				return sizeof(T) + resource.capacity() * sizeof(typename T::value_type);
+			}
+			else
+			{
+				return sizeof(T);
+			}
+		}
+	};
+
+	// Invoked on the thread which finished the load
+	using LoadContinuation = std::function<void(ResourceLoadStatus)>;
 
 	class ResourceData
 	{
 	public:
-		using ListenerList = std::list<ResourceListener*>;
+		using ListenerList = std::vector<ResourceListener*>;
 
 		// Public for external use
 		REKSI_THREADING_MUTABLE REKSI_MUTEX_AUTO;
@@ -105,70 +169,219 @@ namespace Reksi
 		ResourceUnloadStatus Unload();
 		template <typename T>
 		SharedPtr<T> GetData();
+		// Returns the data without loading it, nullptr if not loaded
+		template <typename T>
+		SharedPtr<T> GetDataIfLoaded();
+		// Returns the data without touching its reference count, nullptr if not loaded or the load failed
+		// Requires an EpochDomain::Guard, the data stays alive until the guard is left
+		template <typename T>
+		T* BorrowData(bool load);
+		// Runs the continuation once the load in flight completes
+		// Returns false without running it if no load is in flight
+		bool ContinueAfterLoad(LoadContinuation continuation);
 		void AddListener(ResourceListener* listener);
 		void RemoveListener(ResourceListener* listener);
 		void ClearListeners();
 		void AddListeners(const ListenerList& listeners);
 		void WaitUntilCurrentLoading();
+		// Joins the manager's base path with the name, defined with the ResourceManager
 		std::filesystem::path GetPath() const;
+		// Path relative to the manager's base path, owned by the manager, valid until it is compacted
+		std::string_view GetName() const;
+		ResourceKey GetKey() const;
 		template <typename T>
 		ResourceLoadFunc<T> GetLoader() const;
 		ResourceHandleT GetHandle() const;
+		ResourceTypeId GetTypeId() const;
 		std::type_index GetTypeIndex() const;
+		// Bytes of the loaded data, 0 if not loaded
+		size_t GetSize() const;
+		// Changes whenever the data is replaced or unloaded
+		uint32_t GetVersion() const;
+		// Pinned resources are never unloaded by the memory budget, pins are counted
+		void Pin();
+		void Unpin();
+		bool IsPinned() const;
 
 		~ResourceData();
 
+		// Created by the ResourceManager only, through Create
+		static void* operator new(size_t size) = delete;
+		// Also releases the memory of batch allocated resources, see AllocationBlock
+		static void operator delete(void* memory);
+
 	private:
-		using LoadFunc = std::function<SharedPtr<void>(const std::filesystem::path&)>;
+		using LoadFunc = InplaceFunction<SharedPtr<void>(const std::filesystem::path&)>;
+		using BufferLoadFunc = InplaceFunction<SharedPtr<void>(const std::filesystem::path&, ByteSpan)>;
+		using SizeFunc = size_t(*)(const void*);
 		using RLS = ResourceLoadStatus;
 		using RS = ResourceStatus;
 		using RUS = ResourceUnloadStatus;
 
-		ResourceData(ResourceHandleT handle, std::filesystem::path path, LoadFunc loader,
-		             ResourceManager* creator, std::type_index typeIndex);
+		// Everything the manager needs to create a resource of a type
+		// Shared by all resources using the same loader, default loaders by every resource of their type
+		struct Loaders
+		{
+			// One of the two is set, buffer loaders are given the file contents
+			LoadFunc Load;
+			BufferLoadFunc LoadBuffer;
+			SizeFunc SizeOf = nullptr;
+
+			// Reads the file for buffer loaders
+			SharedPtr<void> LoadFile(const std::filesystem::path& path) const;
+		};
+		using LoadersPtr = SharedPtr<const Loaders>;
+
+		// Takes any callable returning a SharedPtr<T> from a path, or from a path and the file contents
+		template <typename T, typename Func>
+		static LoadersPtr MakeLoaders(Func&& loader);
+		template <typename T>
+		static ResourceLoadFunc<T> MakeLoadFunc(LoadersPtr loaders);
+
+		// Memory for the ResourceData created by one batch, so they end up next to each other
+		// Freed once the batch and every ResourceData allocated from it released it
+		struct AllocationBlock
+		{
+			std::atomic<size_t> References;
+			size_t Used;
+			size_t Capacity;
+
+			// Holds the reference of the batch
+			static AllocationBlock* Create(size_t capacity);
+			void Release();
+		};
+
+		// Precedes every ResourceData, the block is nullptr if it was allocated on its own
+		struct alignas(std::max_align_t) AllocationHeader
+		{
+			AllocationBlock* Block;
+		};
+
+		// Allocated from the block if given, on its own otherwise
+		static ResourceData* Create(AllocationBlock* block, ResourceHandleT handle, ResourceKey key,
+		                            std::string_view name, LoadersPtr loaders, ResourceManager* creator,
+		                            ResourceTypeId typeId);
+		// Memory for a ResourceData after its header, the next free place of the block if given
+		static void* Allocate(AllocationBlock* block);
+		// Frees memory returned by Allocate
+		static void Deallocate(void* memory);
+		// Rounds up to the alignment of the headers
+		static constexpr size_t AlignAllocation(size_t size);
+		// Header and ResourceData
+		static constexpr size_t GetAllocationSize();
+
+		ResourceData(ResourceHandleT handle, ResourceKey key, std::string_view name, LoadersPtr loaders,
+		             ResourceManager* creator, ResourceTypeId typeId);
 
 		ResourceHandleT m_Handle;
 		ResourceStatus m_Status;
-		std::filesystem::path m_Path;
-		LoadFunc m_Loader;
-		SharedPtr<void> m_Data;
-		ListenerList m_Listeners;
+		const ResourceKey m_Key;
+		// Interned by the manager, the full path is only built when needed
+		// Moved by ResourceManager::Compact along with the interned paths
+		std::string_view m_Name;
+		const LoadersPtr m_Loaders;
+		// Swapped under the lock, read without it inside an EpochDomain::Guard, nullptr while not loaded
+		std::atomic<SharedPtr<void>*> m_Data;
+		std::atomic<uint32_t> m_Version;
+		size_t m_Size;
+		uint32_t m_PinCount;
+		// Set on every access, cleared by the eviction's clock hand passing by
+		std::atomic<bool> m_Referenced;
+		// Background load waiting in the scheduler, if any
+		SharedPtr<LoadTask> m_PendingLoad;
+		// Resumed from the completion path of the load in flight
+		std::vector<LoadContinuation> m_LoadContinuations;
+		// Immutable snapshot, replaced under the lock and read without it inside an EpochDomain::Guard
+		// nullptr while there are no listeners
+		std::atomic<SharedPtr<const ListenerList>*> m_Listeners;
 		ResourceManager* m_Creator;
-		const std::type_index m_TypeIndex;
+		const ResourceTypeId m_TypeId;
 
-		ListenerList GetListenersCopy() const;
+		// Shares the current snapshot, listeners added or removed meanwhile are not seen
+		SharedPtr<const ListenerList> GetListeners() const;
+		// Publishes a modified copy of the snapshot, the previous one is retired
+		template <typename Func>
+		void UpdateListeners(Func&& update);
 		void NotifyListenersOnLoadComplete(ResourceLoadStatus status);
 		void NotifyListenersOnUnloadComplete(ResourceUnloadStatus status);
 		void NotifyListenersBeforeDeleting();
 
 		void SetState(ResourceStatus::States state);
 		void ClearState(ResourceStatus::States state);
+		// Clears MarkedForReload, returns true if it was set and no other load took it over since
+		bool TakeReloadMark();
 
-		// Thread unsafe, use with caution
-		// Performs more checks in Debug mode
+		// Casts a snapshot of m_Data, which the caller keeps alive with the lock or an EpochDomain::Guard
+		// Throws std::runtime_error if T is not the type of the resource
 		template <typename T>
-		SharedPtr<T> GetDataInternal();
-
+		SharedPtr<T> GetDataInternal(const SharedPtr<void>* data);
+		// Only writes the flag if not set yet, so hot resources are not written on every access
+		void MarkReferenced();
+		// Publishes the data, the previous version is deleted once no reader uses it anymore
+		// Requires the unique lock, returns the previous version to retire once it is released
+		SharedPtr<void>* ExchangeData(SharedPtr<void>* data);
+
+		// Loads from the prefetched file contents if given
+		ResourceLoadStatus Load(ByteBuffer* prefetched);
 		// Just perform load without notifying listeners or the manager
-		ResourceLoadStatus LoadInternal();
+		ResourceLoadStatus LoadInternal(ByteBuffer* prefetched = nullptr);
+		bool HasBufferLoader() const;
+		// Loads the dependencies which are not loaded yet, returns false if one of them failed
+		// Defined with the ResourceManager, like ReloadDependents
+		bool LoadDependencies();
+		void ReloadDependents();
+		// Loads with the buffer loader if the manager has the resource in an archive, defined with the ResourceManager
+		// Returns false if it is not archived, data stays nullptr if it failed to decompress
+		bool LoadFromArchive(SharedPtr<void>& data) const;
 		// Just perform unload without notifying listeners or the manager
 		ResourceUnloadStatus UnloadInternal();
+		// Unloads the data unless it is pinned, loading or was referenced since the last call
+		// Clears the referenced bit, returns true if the data was unloaded
+		bool TryEvict();
+
+		template <typename T>
+		static size_t SizeOf(const void* data);
+		// Defined with the ResourceManager
+		void UpdateResidentSize(size_t oldSize, size_t newSize);
+		void EnforceMemoryBudget();
+
+		SharedPtr<LoadTask> GetPendingLoad() const;
+		// Loads the resource, or waits for its queued background load after moving it to the front
+		// Defined with the ResourceManager
+		void LoadOrWaitForPending();
+		// Returns the queued background load, creating it if none is pending
+		// created is set if the caller has to submit the new task
+		SharedPtr<LoadTask> GetOrCreatePendingLoad(bool& created);
+		// Runs a background load which the calling worker has claimed, and completes it
+		void LoadClaimed(const SharedPtr<LoadTask>& task);
+		// Detaches the task from this resource once it is no longer pending
+		void ReleasePendingLoad(LoadTask* task);
 
 		friend class ResourceManager;
+		friend class LoadTask;
+		friend class ReloadCoalescer;
 	};
 }
 
 #pragma region Defer
 // Implementation
+#include "Reksi/AsyncLoad.h"
 namespace Reksi
 {
-	inline ResourceData::ResourceData(ResourceHandleT handle, std::filesystem::path path, LoadFunc loader,
-	                                  ResourceManager* creator, std::type_index typeIndex)
+	inline ResourceData::ResourceData(ResourceHandleT handle, ResourceKey key, std::string_view name, LoadersPtr loaders,
+	                                  ResourceManager* creator, ResourceTypeId typeId)
 		: m_Handle(handle),
-		  m_Path(std::move(path)),
-		  m_Loader(std::move(loader)),
+		  m_Key(key),
+		  m_Name(name),
+		  m_Loaders(std::move(loaders)),
+		  m_Data(nullptr),
+		  m_Version(0),
+		  m_Size(0),
+		  m_PinCount(0),
+		  m_Referenced(false),
+		  m_Listeners(nullptr),
 		  m_Creator(creator),
-		  m_TypeIndex(typeIndex)
+		  m_TypeId(typeId)
 	{
 	}
 
@@ -185,13 +398,22 @@ namespace Reksi
 	}
 
 	inline ResourceLoadStatus ResourceData::Load()
+	{
+		return Load(nullptr);
+	}
+
+	inline ResourceLoadStatus ResourceData::Load(ByteBuffer* prefetched)
 	{
 		// Internal Load
-		const RLS status = LoadInternal();
+		const RLS status = LoadInternal(prefetched);
 		// Notify listeners
 		NotifyListenersOnLoadComplete(status);
-
-		// TODO: Notify the resource manager as well
+		// Let the manager unload cold resources if this load went over the memory budget
+		if ( status.Is(RLS::Success) ) EnforceMemoryBudget();
+		// Dependents built from the old data are reloaded as well
+		if ( status.Is(RLS::Success) && status.Is(RLS::Reloaded) ) ReloadDependents();
+		// The file changed again while loading, the data may already be stale
+		if ( TakeReloadMark() ) return Load(nullptr);
 
 		// Return status
 		return status;
@@ -214,62 +436,132 @@ namespace Reksi
 	SharedPtr<T> ResourceData::GetData()
 	{
 		{
-			// If data is loaded, return it
-			REKSI_LOCK_SHARED_AUTO;
+			// If data is loaded, return it without touching the lock
+			// Read once, an unload or eviction right after the check would otherwise leave nothing to return
+			EpochDomain::Guard guard;
 
-			if ( m_Status.Is(ResourceStatus::Loaded) )
+			if ( const SharedPtr<void>* data = m_Data.load() )
 			{
-				return GetDataInternal<T>();
+				MarkReferenced();
+				return GetDataInternal<T>(data);
 			}
 		}
 
-		auto status = Load();
+		// Pinned until handed out, so the memory budget cannot unload it right after the load
+		Pin();
+		LoadOrWaitForPending();
 
 		{
 			// Return the data
-			REKSI_LOCK_SHARED_AUTO;
+			REKSI_LOCK_UNIQUE_AUTO;
 
-			return GetDataInternal<T>();
+			--m_PinCount;
+			return GetDataInternal<T>(m_Data.load());
 		}
 	}
 
 	template <typename T>
-	SharedPtr<T> ResourceData::GetDataInternal()
+	SharedPtr<T> ResourceData::GetDataIfLoaded()
+	{
+		EpochDomain::Guard guard;
+
+		const SharedPtr<void>* data = m_Data.load();
+		if ( !data ) return nullptr;
+		MarkReferenced();
+		return GetDataInternal<T>(data);
+	}
+
+	template <typename T>
+	T* ResourceData::BorrowData(bool load)
 	{
-		if ( m_TypeIndex != typeid(T) )
+		if ( m_TypeId != GetResourceTypeId<T>() )
 		{
-			throw std::runtime_error("ResourceData::GetDataInternal: Type mismatch");
+			throw std::runtime_error("ResourceData::BorrowData: Type mismatch");
+		}
+
+		const SharedPtr<void>* data = m_Data.load();
+		if ( !data && load )
+		{
+			// Pinned until read, versions published after entering the guard are protected by it as well
+			Pin();
+			LoadOrWaitForPending();
+			data = m_Data.load();
+			Unpin();
 		}
+		if ( !data ) return nullptr;
 
-		return StaticSharedCast<T>(m_Data);
+		MarkReferenced();
+		return static_cast<T*>(data->get());
 	}
 
-	inline void ResourceData::AddListener(ResourceListener* listener)
+	inline bool ResourceData::ContinueAfterLoad(LoadContinuation continuation)
 	{
 		REKSI_LOCK_UNIQUE_AUTO;
 
-		m_Listeners.emplace_back(listener);
+		if ( !m_Status.Is(RS::Loading) ) return false;
+
+		m_LoadContinuations.emplace_back(std::move(continuation));
+		return true;
 	}
 
-	inline void ResourceData::RemoveListener(ResourceListener* listener)
+	template <typename T>
+	SharedPtr<T> ResourceData::GetDataInternal(const SharedPtr<void>* data)
 	{
-		REKSI_LOCK_UNIQUE_AUTO;
+		if ( m_TypeId != GetResourceTypeId<T>() )
+		{
+			throw std::runtime_error("ResourceData::GetDataInternal: Type mismatch");
+		}
 
-		m_Listeners.remove(listener);
+		return data ? StaticSharedCast<T>(*data) : nullptr;
 	}
 
-	inline void ResourceData::ClearListeners()
+	inline void ResourceData::MarkReferenced()
 	{
-		REKSI_LOCK_UNIQUE_AUTO;
+		if ( !m_Referenced.load(std::memory_order_relaxed) ) m_Referenced.store(true, std::memory_order_relaxed);
+	}
 
-		m_Listeners.clear();
+	inline SharedPtr<void>* ResourceData::ExchangeData(SharedPtr<void>* data)
+	{
+		m_Version.fetch_add(1, std::memory_order_relaxed);
+		// Sequentially consistent, so readers entering a guard afterwards cannot see the previous version
+		return m_Data.exchange(data);
 	}
 
-	inline void ResourceData::AddListeners(const ListenerList& listeners)
+	inline uint32_t ResourceData::GetVersion() const
 	{
-		REKSI_LOCK_UNIQUE_AUTO;
+		return m_Version.load(std::memory_order_relaxed);
+	}
+
+	inline void ResourceData::AddListener(ResourceListener* listener)
+	{
+		UpdateListeners([listener](ListenerList& listeners)
+		{
+			listeners.push_back(listener);
+		});
+	}
 
-		m_Listeners.insert(m_Listeners.end(), listeners.begin(), listeners.end());
+	inline void ResourceData::RemoveListener(ResourceListener* listener)
+	{
+		UpdateListeners([listener](ListenerList& listeners)
+		{
+			listeners.erase(std::remove(listeners.begin(), listeners.end(), listener), listeners.end());
+		});
+	}
+
+	inline void ResourceData::ClearListeners()
+	{
+		UpdateListeners([](ListenerList& listeners)
+		{
+			listeners.clear();
+		});
+	}
+
+	inline void ResourceData::AddListeners(const ListenerList& listeners)
+	{
+		UpdateListeners([&added = listeners](ListenerList& listeners)
+		{
+			listeners.insert(listeners.end(), added.begin(), added.end());
+		});
 	}
 
 	inline void ResourceData::WaitUntilCurrentLoading()
@@ -279,19 +571,25 @@ namespace Reksi
 		REKSI_CV_WAIT_AUTO([&] { return !m_Status.Is(ResourceStatus::Loading); });
 	}
 
-	inline std::filesystem::path ResourceData::GetPath() const
+	inline std::string_view ResourceData::GetName() const
 	{
-		REKSI_LOCK_SHARED_AUTO;
+		return m_Name;
+	}
 
-		return m_Path;
+	inline ResourceKey ResourceData::GetKey() const
+	{
+		return m_Key;
 	}
 
 	template <typename T>
 	ResourceLoadFunc<T> ResourceData::GetLoader() const
 	{
-		REKSI_LOCK_SHARED_AUTO;
+		if ( m_TypeId != GetResourceTypeId<T>() )
+		{
+			throw std::runtime_error("ResourceData::GetLoader: Type mismatch");
+		}
 
-		return m_Loader;
+		return MakeLoadFunc<T>(m_Loaders);
 	}
 
 	inline ResourceHandleT ResourceData::GetHandle() const
@@ -301,37 +599,117 @@ namespace Reksi
 		return m_Handle;
 	}
 
+	inline ResourceTypeId ResourceData::GetTypeId() const
+	{
+		return m_TypeId;
+	}
+
 	inline std::type_index ResourceData::GetTypeIndex() const
 	{
-		return m_TypeIndex;
+		return ResourceTypeRegistry::GetTypeIndex(m_TypeId);
+	}
+
+	inline size_t ResourceData::GetSize() const
+	{
+		REKSI_LOCK_SHARED_AUTO;
+
+		return m_Size;
+	}
+
+	inline void ResourceData::Pin()
+	{
+		REKSI_LOCK_UNIQUE_AUTO;
+
+		++m_PinCount;
+	}
+
+	inline void ResourceData::Unpin()
+	{
+		REKSI_LOCK_UNIQUE_AUTO;
+
+		assert(m_PinCount > 0);
+		--m_PinCount;
+	}
+
+	inline bool ResourceData::IsPinned() const
+	{
+		REKSI_LOCK_SHARED_AUTO;
+
+		return m_PinCount > 0;
 	}
 
 	inline ResourceData::~ResourceData()
 	{
 		NotifyListenersBeforeDeleting();
 
-		REKSI_LOCK_UNIQUE_AUTO;
-		m_Status.Set(RS::MarkedForDelete).Clear(RS::MarkedForReload);
-		REKSI_CV_WAIT_AUTO([&] { return !m_Status.Is(ResourceStatus::Loading); });
+		SharedPtr<LoadTask> cancelled;
+
+		{
+			REKSI_LOCK_UNIQUE_AUTO;
+			m_Status.Set(RS::MarkedForDelete).Clear(RS::MarkedForReload);
+
+			// A queued background load which nobody picked up yet is cancelled
+			if ( m_PendingLoad && m_PendingLoad->Claim() )
+			{
+				cancelled = std::move(m_PendingLoad);
+				m_Status.Clear(RS::Queued);
+			}
+
+			// Otherwise wait for the worker running it to let go of this resource
+			REKSI_CV_WAIT_AUTO([&] { return !m_Status.Is(ResourceStatus::Loading) && !m_PendingLoad; });
+		}
+
+		if ( cancelled )
+		{
+			cancelled->Complete(RLS().Set(RLS::MarkedForDelete));
+		}
+
+		// A ResourceView borrowed on another thread may still read the data, it only holds a guard
+		EpochDomain::Get().Retire(m_Data.exchange(nullptr));
+		// Notifications only run from this resource's own calls, none is left by now
+		delete m_Listeners.exchange(nullptr);
+		UpdateResidentSize(m_Size, 0);
+	}
+
+	inline SharedPtr<const ResourceData::ListenerList> ResourceData::GetListeners() const
+	{
+		// Only held while taking a reference, listeners may run for long and add or remove listeners themselves
+		EpochDomain::Guard guard;
+
+		const SharedPtr<const ListenerList>* listeners = m_Listeners.load();
+		return listeners ? *listeners : nullptr;
 	}
 
-	inline ResourceData::ListenerList ResourceData::GetListenersCopy() const
+	template <typename Func>
+	void ResourceData::UpdateListeners(Func&& update)
 	{
-		ListenerList listeners_copy;
+		SharedPtr<const ListenerList>* retired;
 
 		{
-			REKSI_LOCK_SHARED_AUTO;
+			REKSI_LOCK_UNIQUE_AUTO;
 
-			// Create a copy of the listeners
-			listeners_copy = m_Listeners;
+			const SharedPtr<const ListenerList>* current = m_Listeners.load(std::memory_order_relaxed);
+			ListenerList listeners = current ? **current : ListenerList{};
+			update(listeners);
+
+			SharedPtr<const ListenerList>* next = nullptr;
+			if ( !listeners.empty() )
+			{
+				next = new SharedPtr<const ListenerList>(CreateShared<const ListenerList>(std::move(listeners)));
+			}
+			retired = m_Listeners.exchange(next);
 		}
 
-		return listeners_copy;
+		// Notifications in flight keep their snapshot alive through the reference they took
+		EpochDomain::Get().Retire(retired);
 	}
 
 	inline void ResourceData::NotifyListenersOnLoadComplete(ResourceLoadStatus status)
 	{
-		for ( const auto listener : GetListenersCopy() )
+		const SharedPtr<const ListenerList> listeners = GetListeners();
+		if ( !listeners ) return;
+
+		for ( const auto listener : *listeners )
 		{
 			listener->OnLoadComplete(*this, status);
 		}
@@ -339,7 +717,10 @@ namespace Reksi
 
 	inline void ResourceData::NotifyListenersOnUnloadComplete(ResourceUnloadStatus status)
 	{
-		for ( const auto listener : GetListenersCopy() )
+		const SharedPtr<const ListenerList> listeners = GetListeners();
+		if ( !listeners ) return;
+
+		for ( const auto listener : *listeners )
 		{
 			listener->OnUnloadComplete(*this, status);
 		}
@@ -348,7 +729,10 @@ namespace Reksi
 
 	inline void ResourceData::NotifyListenersBeforeDeleting()
 	{
-		for ( const auto listener : GetListenersCopy() )
+		const SharedPtr<const ListenerList> listeners = GetListeners();
+		if ( !listeners ) return;
+
+		for ( const auto listener : *listeners )
 		{
 			listener->BeforeDeleting(*this);
 		}
@@ -356,28 +740,46 @@ namespace Reksi
 
 	inline void ResourceData::SetState(ResourceStatus::States state)
 	{
-		REKSI_LOCK_SHARED_AUTO;
+		// Writes the status, readers hold the shared lock
+		REKSI_LOCK_UNIQUE_AUTO;
 
 		m_Status.Set(state);
 	}
 
 	inline void ResourceData::ClearState(ResourceStatus::States state)
 	{
-		REKSI_LOCK_SHARED_AUTO;
+		REKSI_LOCK_UNIQUE_AUTO;
 
 		m_Status.Clear(state);
 	}
 
+	inline bool ResourceData::TakeReloadMark()
+	{
+		REKSI_LOCK_UNIQUE_AUTO;
+
+		// A load started since clears the mark itself
+		if ( !m_Status.Is(RS::MarkedForReload) || m_Status.Is(RS::Loading) || m_Status.Is(RS::MarkedForDelete) )
+		{
+			return false;
+		}
+
+		m_Status.Clear(RS::MarkedForReload);
+		return true;
+	}
+
 	/*
 	 * If not loaded, goes ahead and loads the resource
 	 * If loading on another thread, waits for the load to complete
 	 * If already loaded, reloads the resource
-	 * If reloading on another thread, returns immediately
+	 * If reloading on another thread, returns immediately and marks it for reload,
+	 * the reloading thread then reloads it once more after finishing
 	 */
-	inline ResourceLoadStatus ResourceData::LoadInternal()
+	inline ResourceLoadStatus ResourceData::LoadInternal(ByteBuffer* prefetched)
 	{
-		std::filesystem::path res_path;
 		RLS out;
+		// Queued background load taken over by this call
+		SharedPtr<LoadTask> claimed;
+		std::vector<LoadContinuation> continuations;
 
 		{
 			REKSI_LOCK_UNIQUE_AUTO;
@@ -390,12 +792,14 @@ namespace Reksi
 			// Resource is previously not loaded and loading, wait for load to complete
 			if ( !m_Status.Is(RS::Loaded) && m_Status.Is(RS::Loading) )
 			{
-				REKSI_CV_WAIT_AUTO([&] { return m_Status.Is(RS::Loaded); });
+				REKSI_CV_WAIT_AUTO([&] { return !m_Status.Is(RS::Loading); });
+				if ( m_Status.Is(RS::Loaded) ) out.Set(RLS::Success);
 				return out.Set(RLS::WaitedForLoad);
 			}
-			// Resource is previously loaded and loading, return already reloading
+			// Resource is previously loaded and loading, the reload in flight may have missed the latest change
 			if ( m_Status.Is(RS::Loaded) && m_Status.Is(RS::Loading) )
 			{
+				m_Status.Set(RS::MarkedForReload);
 				return out.Set(RLS::AlreadyReloading).Set(RLS::Reloaded);
 			}
 
@@ -404,12 +808,43 @@ namespace Reksi
 			{
 				out.Set(RLS::Reloaded);
 			}
-			m_Status.Set(RS::Loading).Clear(RS::MarkedForReload);
-			res_path = m_Path;
+			// Take over a queued background load, so it is not performed twice
+			if ( m_PendingLoad && m_PendingLoad->Claim() )
+			{
+				claimed = std::move(m_PendingLoad);
+			}
+
+			m_Status.Set(RS::Loading).Clear(RS::MarkedForReload).Clear(RS::Queued);
 		}
 
-		// Load the resource
-		const auto data = m_Loader(res_path);
+		// Load the resource, buffer loaders read archived resources from the mapped archive
+		// The loader only runs once all dependencies are loaded
+		// A throwing loader fails the load like one returning nullptr, the state below must be restored either way,
+		// otherwise waiters block forever and the exception would terminate a worker thread
+		SharedPtr<void> data;
+		size_t size = 0;
+		try
+		{
+			if ( LoadDependencies() )
+			{
+				if ( prefetched && m_Loaders->LoadBuffer )
+				{
+					data = m_Loaders->LoadBuffer(GetPath(), ByteSpan{prefetched->data(), prefetched->size()});
+				}
+				else if ( !m_Loaders->LoadBuffer || !LoadFromArchive(data) )
+				{
+					data = m_Loaders->LoadFile(GetPath());
+				}
+			}
+			if ( data ) size = m_Loaders->SizeOf(data.get());
+		}
+		catch ( ... )
+		{
+			data = nullptr;
+			out.Set(RLS::LoaderThrew);
+		}
+		size_t old_size = 0;
+		SharedPtr<void>* retired = nullptr;
 
 		{
 			REKSI_LOCK_UNIQUE_AUTO;
@@ -419,27 +854,300 @@ namespace Reksi
 			// In case of load failure, clear the loading state
 			if ( data )
 			{
-				m_Data = data;
+				retired = ExchangeData(new SharedPtr<void>(data));
+				old_size = m_Size;
+				m_Size = size;
 				m_Status.Set(RS::Loaded);
+				m_Referenced.store(true, std::memory_order_relaxed);
 				out.Set(RLS::Success);
 			}
+
+			continuations.swap(m_LoadContinuations);
 		}
 
+		// Readers of the previous version keep it alive until they leave their guards
+		EpochDomain::Get().Retire(retired);
+		if ( data ) UpdateResidentSize(old_size, size);
+
 		// Loading is complete, send Condition Variable signal
 		REKSI_CV_NOTIFY_ALL_AUTO;
 
+		if ( claimed )
+		{
+			claimed->Complete(out);
+		}
+
+		for ( const auto& continuation : continuations )
+		{
+			continuation(out);
+		}
+
 		return out;
 	}
 
 	inline ResourceUnloadStatus ResourceData::UnloadInternal()
 	{
-		REKSI_LOCK_UNIQUE_AUTO;
+		size_t old_size;
+		SharedPtr<void>* retired;
 
-		m_Data.reset();
-		m_Status.Clear(ResourceStatus::Loaded);
+		{
+			REKSI_LOCK_UNIQUE_AUTO;
+
+			retired = ExchangeData(nullptr);
+			m_Status.Clear(ResourceStatus::Loaded);
+			old_size = m_Size;
+			m_Size = 0;
+		}
+
+		EpochDomain::Get().Retire(retired);
+		UpdateResidentSize(old_size, 0);
 		return ResourceUnloadStatus::Success;
 	}
 
+	inline bool ResourceData::TryEvict()
+	{
+		// Second chance for resources used since the clock hand last passed
+		if ( m_Referenced.exchange(false, std::memory_order_relaxed) ) return false;
+
+		size_t old_size;
+		SharedPtr<void>* retired;
+
+		{
+			REKSI_LOCK_UNIQUE_AUTO;
+
+			if ( !m_Status.Is(RS::Loaded) || m_Status.Is(RS::Loading) || m_PinCount > 0 ) return false;
+
+			retired = ExchangeData(nullptr);
+			m_Status.Clear(RS::Loaded);
+			old_size = m_Size;
+			m_Size = 0;
+		}
+
+		EpochDomain::Get().Retire(retired);
+
+		UpdateResidentSize(old_size, 0);
+		return true;
+	}
+
+	inline SharedPtr<void> ResourceData::Loaders::LoadFile(const std::filesystem::path& path) const
+	{
+		if ( Load ) return Load(path);
+		// Given an empty loader, fails the load like calling an empty std::function
+		if ( !LoadBuffer ) throw std::bad_function_call();
+
+		// Synchronous loads read the file on the calling thread
+		ByteBuffer buffer;
+		if ( !FileReader::Read(path, buffer) ) return nullptr;
+		return LoadBuffer(path, ByteSpan{buffer.data(), buffer.size()});
+	}
+
+	template <typename T, typename Func>
+	ResourceData::LoadersPtr ResourceData::MakeLoaders(Func&& loader)
+	{
+		static_assert(std::is_invocable_r_v<SharedPtr<T>, Func&, const std::filesystem::path&> ||
+		              std::is_invocable_r_v<SharedPtr<T>, Func&, const std::filesystem::path&, ByteSpan>,
+		              "The loader must return a SharedPtr<T> from a path, or from a path and the file contents");
+
+		auto loaders = CreateShared<Loaders>();
+		if constexpr ( std::is_invocable_r_v<SharedPtr<T>, Func&, const std::filesystem::path&, ByteSpan> )
+		{
+			loaders->LoadBuffer = BufferLoadFunc{std::forward<Func>(loader)};
+		}
+		else
+		{
+			loaders->Load = LoadFunc{std::forward<Func>(loader)};
+		}
+		loaders->SizeOf = &SizeOf<T>;
+		return loaders;
+	}
+
+	template <typename T>
+	ResourceLoadFunc<T> ResourceData::MakeLoadFunc(LoadersPtr loaders)
+	{
+		if ( !loaders ) return nullptr;
+
+		// Only allocates here, when the loader is handed out
+		return [loaders = std::move(loaders)](const std::filesystem::path& path) -> SharedPtr<T>
+		{
+			return StaticSharedCast<T>(loaders->LoadFile(path));
+		};
+	}
+
+	inline ResourceData::AllocationBlock* ResourceData::AllocationBlock::Create(size_t capacity)
+	{
+		void* memory = ::operator new(AlignAllocation(sizeof(AllocationBlock)) + capacity * GetAllocationSize());
+		auto block = new(memory) AllocationBlock;
+		block->References.store(1, std::memory_order_relaxed);
+		block->Used = 0;
+		block->Capacity = capacity;
+		return block;
+	}
+
+	inline void ResourceData::AllocationBlock::Release()
+	{
+		if ( References.fetch_sub(1, std::memory_order_acq_rel) != 1 ) return;
+
+		this->~AllocationBlock();
+		::operator delete(this);
+	}
+
+	inline ResourceData* ResourceData::Create(AllocationBlock* block, ResourceHandleT handle, ResourceKey key,
+	                                          std::string_view name, LoadersPtr loaders, ResourceManager* creator,
+	                                          ResourceTypeId typeId)
+	{
+		void* memory = Allocate(block);
+		try
+		{
+			return ::new(memory) ResourceData{handle, key, name, std::move(loaders), creator, typeId};
+		}
+		catch ( ... )
+		{
+			Deallocate(memory);
+			throw;
+		}
+	}
+
+	inline void* ResourceData::Allocate(AllocationBlock* block)
+	{
+		AllocationHeader* header;
+		if ( block )
+		{
+			assert(block->Used < block->Capacity);
+
+			auto slots = reinterpret_cast<std::byte*>(block) + AlignAllocation(sizeof(AllocationBlock));
+			header = reinterpret_cast<AllocationHeader*>(slots + block->Used++ * GetAllocationSize());
+			block->References.fetch_add(1, std::memory_order_relaxed);
+		}
+		else
+		{
+			header = static_cast<AllocationHeader*>(::operator new(GetAllocationSize()));
+		}
+
+		header->Block = block;
+		return header + 1;
+	}
+
+	inline void ResourceData::operator delete(void* memory)
+	{
+		Deallocate(memory);
+	}
+
+	inline void ResourceData::Deallocate(void* memory)
+	{
+		if ( !memory ) return;
+
+		auto header = static_cast<AllocationHeader*>(memory) - 1;
+		if ( header->Block )
+		{
+			header->Block->Release();
+		}
+		else
+		{
+			::operator delete(header);
+		}
+	}
+
+	constexpr size_t ResourceData::AlignAllocation(size_t size)
+	{
+		constexpr size_t align = alignof(AllocationHeader);
+		return (size + align - 1) / align * align;
+	}
+
+	constexpr size_t ResourceData::GetAllocationSize()
+	{
+		static_assert(alignof(ResourceData) <= alignof(AllocationHeader));
+
+		return sizeof(AllocationHeader) + AlignAllocation(sizeof(ResourceData));
+	}
+
+	inline bool ResourceData::HasBufferLoader() const
+	{
+		return static_cast<bool>(m_Loaders->LoadBuffer);
+	}
+
+	template <typename T>
+	size_t ResourceData::SizeOf(const void* data)
+	{
+		return ResourceSize<T>::Get(*static_cast<const T*>(data));
+	}
+
+	inline SharedPtr<LoadTask> ResourceData::GetPendingLoad() const
+	{
+		REKSI_LOCK_SHARED_AUTO;
+
+		return m_PendingLoad;
+	}
+
+	inline SharedPtr<LoadTask> ResourceData::GetOrCreatePendingLoad(bool& created)
+	{
+		created = false;
+
+		{
+			REKSI_LOCK_UNIQUE_AUTO;
+
+			// Coalesce with the load which is already queued
+			if ( m_PendingLoad ) return m_PendingLoad;
+
+			if ( !m_Status.Is(RS::MarkedForDelete) )
+			{
+				m_PendingLoad = CreateShared<LoadTask>(this);
+				m_Status.Set(RS::Queued);
+				created = true;
+				return m_PendingLoad;
+			}
+		}
+
+		// Resource is marked for delete, hand out an already completed task
+		auto task = CreateShared<LoadTask>(nullptr);
+		task->Complete(RLS().Set(RLS::MarkedForDelete));
+		return task;
+	}
+
+	inline void ResourceData::LoadClaimed(const SharedPtr<LoadTask>& task)
+	{
+		{
+			REKSI_LOCK_UNIQUE_AUTO;
+
+			// Another thread is loading already, complete from its completion path instead of blocking the worker
+			if ( !m_Status.Is(RS::Loaded) && m_Status.Is(RS::Loading) )
+			{
+				if ( m_PendingLoad == task )
+				{
+					m_PendingLoad.reset();
+					m_Status.Clear(RS::Queued);
+				}
+
+				m_LoadContinuations.emplace_back([task](RLS status)
+				{
+					task->Complete(status.Set(RLS::WaitedForLoad));
+				});
+
+				REKSI_CV_NOTIFY_ALL_AUTO;
+				return;
+			}
+		}
+
+		ByteBuffer buffer;
+		const bool prefetched = task->TakePrefetched(buffer);
+		const RLS status = Load(prefetched ? &buffer : nullptr);
+		ReleasePendingLoad(task.get());
+		task->Complete(status);
+	}
+
+	inline void ResourceData::ReleasePendingLoad(LoadTask* task)
+	{
+		REKSI_LOCK_UNIQUE_AUTO;
+
+		if ( m_PendingLoad.get() == task )
+		{
+			m_PendingLoad.reset();
+			m_Status.Clear(RS::Queued);
+		}
+
+		// Notify while holding the lock, a waiting destructor may free this resource right after
+		REKSI_CV_NOTIFY_ALL_AUTO;
+	}
+
 	inline ResourceStatus& ResourceStatus::Set(States state)
 	{
 		State |= state;
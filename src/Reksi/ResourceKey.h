@@ -0,0 +1,147 @@
+#pragma once
+
+#include "Reksi/Base.h"
+
+namespace Reksi
+{
+	// 64 bit FNV-1a hash of a resource path
+	constexpr uint64_t HashResourcePath(std::string_view path);
+
+	// Path with its hash computed at compile time, written as "textures/stone.png"_rk
+	struct ResourcePathLiteral
+	{
+		std::string_view Path;
+		uint64_t Hash = 0;
+	};
+
+	inline namespace Literals
+	{
+		REKSI_CONSTEVAL ResourcePathLiteral operator""_rk(const char* path, size_t size);
+	}
+
+	// Interned resource path, handed out by the ResourceManager
+	// Lookups with a key neither hash nor compare the path again
+	// Only meaningful to the manager which created it
+	struct ResourceKey
+	{
+		static constexpr uint32_t InvalidIndex = ~0u;
+
+		uint64_t Hash = 0;
+		// Index of the path in the manager's string pool
+		uint32_t Index = InvalidIndex;
+
+		bool IsValid() const;
+		bool operator==(const ResourceKey& other) const;
+		bool operator!=(const ResourceKey& other) const;
+	};
+
+	// Path argument of the manager's lookups, refers to the caller's string without copying it
+	// The path is hashed once on construction
+	class ResourcePathView
+	{
+	public:
+		ResourcePathView(const char* path);
+		ResourcePathView(std::string_view path);
+		ResourcePathView(const std::string& path);
+		// Copies the path only on platforms where it is not stored as char, e.g. Windows
+		ResourcePathView(const std::filesystem::path& path);
+		// Uses the precomputed hash
+		ResourcePathView(const ResourcePathLiteral& path);
+
+		// Refers to the storage of this object
+		ResourcePathView(const ResourcePathView&) = delete;
+		ResourcePathView& operator=(const ResourcePathView&) = delete;
+
+		std::string_view GetString() const;
+		uint64_t GetHash() const;
+
+	private:
+		std::string m_Storage;
+		std::string_view m_Path;
+		uint64_t m_Hash;
+	};
+}
+
+#pragma region Defer
+namespace Reksi
+{
+	constexpr uint64_t HashResourcePath(std::string_view path)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for ( const char c : path )
+		{
+			hash ^= static_cast<uint8_t>(c);
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	inline namespace Literals
+	{
+		REKSI_CONSTEVAL ResourcePathLiteral operator""_rk(const char* path, size_t size)
+		{
+			return ResourcePathLiteral{std::string_view{path, size}, HashResourcePath(std::string_view{path, size})};
+		}
+	}
+
+	inline bool ResourceKey::IsValid() const
+	{
+		return Index != InvalidIndex;
+	}
+
+	inline bool ResourceKey::operator==(const ResourceKey& other) const
+	{
+		return Index == other.Index;
+	}
+
+	inline bool ResourceKey::operator!=(const ResourceKey& other) const
+	{
+		return Index != other.Index;
+	}
+
+	inline ResourcePathView::ResourcePathView(const char* path)
+		: ResourcePathView(std::string_view{path})
+	{
+	}
+
+	inline ResourcePathView::ResourcePathView(std::string_view path)
+		: m_Path(path), m_Hash(HashResourcePath(path))
+	{
+	}
+
+	inline ResourcePathView::ResourcePathView(const std::string& path)
+		: ResourcePathView(std::string_view{path})
+	{
+	}
+
+	inline ResourcePathView::ResourcePathView(const std::filesystem::path& path)
+	{
+		if constexpr ( std::is_same_v<std::filesystem::path::value_type, char> )
+		{
+			m_Path = path.native();
+		}
+		else
+		{
+			m_Storage = path.generic_string();
+			m_Path = m_Storage;
+		}
+
+		m_Hash = HashResourcePath(m_Path);
+	}
+
+	inline ResourcePathView::ResourcePathView(const ResourcePathLiteral& path)
+		: m_Path(path.Path), m_Hash(path.Hash)
+	{
+	}
+
+	inline std::string_view ResourcePathView::GetString() const
+	{
+		return m_Path;
+	}
+
+	inline uint64_t ResourcePathView::GetHash() const
+	{
+		return m_Hash;
+	}
+}
+#pragma endregion
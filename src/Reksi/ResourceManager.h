@@ -3,21 +3,106 @@
 #include "Reksi/Base.h"
 #include "Reksi/ResourceData.h"
 #include "Reksi/Resource.h"
+#include "Reksi/SlotMap.h"
+#include "Reksi/PathIndex.h"
+#include "Reksi/AssetTable.h"
 
 namespace Reksi
 {
+	// Snapshot returned by ResourceManager::GetMemoryStats
+	struct ResourceMemoryStats
+	{
+		struct Usage
+		{
+			// Number of resources
+			size_t Count = 0;
+			// Bytes of their loaded data, as reported by ResourceSize
+			size_t Bytes = 0;
+		};
+
+		Usage Total;
+		std::unordered_map<std::type_index, Usage> PerType;
+		// A resource may be counted in several states, e.g. Loaded and Loading while reloading
+		Usage Loaded;
+		Usage Loading;
+		Usage MarkedForDelete;
+		// Bytes used by the manager itself, the resource objects, slots, path tables and interned paths
+		size_t OverheadBytes = 0;
+		size_t MemoryBudget = 0;
+	};
+
+	// Path and type of a resource, for getting resources of different types in one batch
+	struct ResourceRequest
+	{
+		std::filesystem::path Path;
+		ResourceTypeId Type = 0;
+
+		template <typename T>
+		static ResourceRequest Of(std::filesystem::path path);
+	};
+
+	// Called by ResourceManager::Preload on the calling thread whenever a load finished
+	using PreloadProgressFunc = std::function<void(size_t done, size_t total)>;
+
 	class ResourceManager
 	{
 	public:
-		ResourceManager(std::filesystem::path basePath);
+		// A worker count of 0 uses the hardware concurrency
+		ResourceManager(std::filesystem::path basePath, uint32_t workerCount = 0);
+		~ResourceManager();
 
 		bool IsValid(ResourceHandleT handle) const;
-		ResourceHandleT GetHandle(const std::filesystem::path& path) const;
+		// Paths are relative to the base path, lookups do not allocate
+		ResourceHandleT GetHandle(const ResourcePathView& path) const;
+		ResourceHandleT GetHandle(const ResourceKey& key) const;
+		// Interns the path, the key skips hashing and comparing the path on later lookups
+		ResourceKey GetKey(const ResourcePathView& path);
+		// Interns every path of the table with its precomputed hash
+		// Lookups of its paths afterwards, like "textures/stone.png"_rk, go through the table instead of the path index
+		// Returns the keys in table order, index them with StaticAssetTable::Find
+		std::vector<ResourceKey> RegisterAssets(const StaticAssetTable& table);
+		// 0 if the handle is invalid
+		ResourceTypeId GetTypeId(ResourceHandleT handle) const;
 		std::type_index GetTypeIndex(ResourceHandleT handle) const;
+		// The loader returns a SharedPtr<T> from the path, like a ResourceLoadFunc, or from the path and the file
+		// contents read by the manager, like a ResourceBufferLoadFunc, it is only kept if the resource is created
+		template <typename T, typename Func>
+		Resource<T> GetResource(const ResourcePathView& path, Func&& loader);
+		// Throws std::runtime_error if the resource does not exist yet and T has no default loader
+		template <typename T>
+		Resource<T> GetResource(const ResourcePathView& path);
+		// Also throws std::runtime_error for a key of another manager or one Compact invalidated
 		template <typename T>
-		Resource<T> GetResource(const std::filesystem::path& path, const ResourceLoadFunc<T>& loader);
+		Resource<T> GetResource(const ResourceKey& key);
+		// Gets many resources with the default loader, locking each shard of the path index only once
+		// The new resources are allocated together, with load set the ones not loaded yet are queued
+		// Throws std::runtime_error before creating any resource if a type has no default loader
 		template <typename T>
-		Resource<T> GetResource(const std::filesystem::path& path);
+		std::vector<Resource<T>> GetResources(Span<const std::filesystem::path> paths, bool load = false,
+		                                      LoadPriority priority = LoadPriority::Visible);
+		// Resources of different types, each with the default loader of its type
+		std::vector<ResourceHandleT> GetResources(Span<const ResourceRequest> requests, bool load = false,
+		                                          LoadPriority priority = LoadPriority::Visible);
+
+		// Names the type in preload manifests, the type needs a default loader
+		template <typename T>
+		void RegisterTypeTag(std::string tag);
+		/*
+		 * Reads a preload manifest, one resource per line as "<type tag> <path>"
+		 * Paths are relative to the base path and may contain spaces, lines starting with # are comments
+		 * Throws std::runtime_error if the file cannot be read or a tag is not registered
+		 */
+		std::vector<ResourceRequest> ReadManifest(const std::filesystem::path& manifest) const;
+		/*
+		 * Registers the resources and loads them on the worker threads, returns once all loads finished
+		 * At most parallelism loads are queued at a time, 0 queues all of them at once
+		 * Resources which are already loaded are skipped, returns the number of loads which failed
+		 * Pin the resources afterwards to keep them resident under a memory budget
+		 */
+		size_t Preload(Span<const ResourceRequest> requests, uint32_t parallelism = 0,
+		               const PreloadProgressFunc& progress = nullptr);
+		size_t Preload(const std::filesystem::path& manifest, uint32_t parallelism = 0,
+		               const PreloadProgressFunc& progress = nullptr);
 
 		template <typename T>
 		void DeleteResource(const Resource<T>& resource);
@@ -29,225 +114,952 @@ namespace Reksi
 		void SetDefaultResource(const SharedPtr<T>& resource);
 		template <typename T>
 		ResourceLoadFunc<T> GetDefaultLoader() const;
-		template <typename T>
-		void SetDefaultLoader(const ResourceLoadFunc<T>& loader);
+		// Any callable like a ResourceLoadFunc or ResourceBufferLoadFunc, stored without allocating unless it is large,
+		// see InplaceFunction, all resources of the type share it
+		template <typename T, typename Func>
+		void SetDefaultLoader(Func&& loader);
 		// Uses the constructor for default loader
 		template <typename T>
 		void SetDefaultLoader();
+		// Loads from the file contents, async loads read their files through the manager's FileReader,
+		// which batches the reads into a single submission when built with REKSI_IO_URING
+		template <typename T, typename Func>
+		void SetDefaultBufferLoader(Func&& loader);
 
 		void Reload(ResourceHandleT handle);
+		/*
+		 * The dependency is loaded before the dependent's loader runs, async loads queue the dependencies first
+		 * and the dependent once they finished, so independent branches load concurrently
+		 * Once a reload of the dependency succeeded, its loaded dependents are queued for reload
+		 * Returns false if a handle is invalid or the dependency would close a cycle
+		 */
+		bool AddDependency(ResourceHandleT dependent, ResourceHandleT dependency);
+		void RemoveDependency(ResourceHandleT dependent, ResourceHandleT dependency);
+		std::vector<ResourceHandleT> GetDependencies(ResourceHandleT handle) const;
+		std::vector<ResourceHandleT> GetDependents(ResourceHandleT handle) const;
+		// Bytes of loaded data to keep resident, 0 for no limit
+		// Once a load goes over it, cold unpinned resources are unloaded until the data fits again,
+		// they are reloaded when accessed through GetRef
+		void SetMemoryBudget(size_t bytes);
+		size_t GetMemoryBudget() const;
+		// Bytes of loaded data, as reported by ResourceSize
+		size_t GetResidentBytes() const;
+		// Unloads resources with the CLOCK algorithm until the resident bytes fit the budget
+		void EnforceMemoryBudget();
+		// Walks all resources, holds off deletions and evictions meanwhile
+		ResourceMemoryStats GetMemoryStats() const;
+
+		// Mounts a packed archive, see scripts/build_archive.py, archives mounted later take precedence
+		// Resources with a buffer loader are loaded from the archive when their path is in it, without copying
+		// unless compressed, other loaders keep loading from the base path
+		// Throws std::runtime_error if the archive cannot be read
+		void Mount(const std::filesystem::path& archive);
+		// Decompresses archive entries of the codec's id, LzBlockCodec is registered by default
+		void RegisterCodec(SharedPtr<const BlockCodec> codec);
+
+		// Shrinks the internal tables after mass deletions and frees the interned paths without a resource,
+		// except the ones GetKey or RegisterAssets handed out, keys taken from deleted resources become invalid
+		// Must not run concurrently with any other use of the manager or its resources
+		void Compact();
+		// Queues the load on the worker threads, loading a resource which is already queued
+		// returns the pending load instead of queueing another one, raising its priority if needed
+		LoadFuture LoadAsync(ResourceHandleT handle, LoadPriority priority = LoadPriority::Visible);
+		template <typename T>
+		ResourceFuture<T> LoadAsync(const Resource<T>& resource, LoadPriority priority = LoadPriority::Visible);
+		// Gets the resource using the default loader and queues its load
+		template <typename T>
+		ResourceFuture<T> LoadAsync(const ResourcePathView& path, LoadPriority priority = LoadPriority::Visible);
 
 	private:
 		std::filesystem::path m_BasePath;
-		std::unordered_map<ResourceHandleT, UniquePtr<ResourceData>> m_Resources;
-		std::unordered_map<std::filesystem::path, ResourceHandleT> m_ResourcePaths;
-		std::vector<uint64_t> m_ValidityMask;
+		// Declared before the resources, which report their sizes when destroyed
+		std::atomic<size_t> m_MemoryBudget;
+		std::atomic<size_t> m_ResidentBytes;
+		// Slot index the eviction continues from
+		uint32_t m_ClockHand;
+		// Resources are only released under the shared side, so no resource is destroyed while the unique side is held
+		// Walks over the slots, like eviction passes, hold the unique side to use the data they find
+		REKSI_THREADING_MUTABLE REKSI_MUTEX(m_EvictionMutex);
+		// Interns the names the resources refer to, so declared before them
+		ResourcePathIndex m_ResourcePaths;
+		ResourceSlotMap m_Resources;
+
+		// Indexed by type id, grown when a type without an entry is set
+		std::vector<SharedPtr<void>> m_DefaultResources;
+		std::vector<ResourceData::LoadersPtr> m_DefaultLoaders;
+		std::unordered_map<std::string, ResourceTypeId> m_TypeTags;
 
-		std::unordered_map<std::type_index, SharedPtr<void>> m_DefaultResources;
-		std::unordered_map<std::type_index, ResourceData::LoadFunc> m_DefaultLoaders;
+		// Edges of the dependency graph, in both directions, by handle
+		std::unordered_map<ResourceHandleT, std::vector<ResourceHandleT>> m_Dependencies;
+		std::unordered_map<ResourceHandleT, std::vector<ResourceHandleT>> m_Dependents;
+		REKSI_THREADING_MUTABLE REKSI_MUTEX(m_DependencyMutex);
 
-		ResourceHandleT m_NextHandle;
+		// Mounted archives, in mount order
+		std::vector<SharedPtr<const ResourceArchive>> m_Archives;
+		std::unordered_map<uint32_t, SharedPtr<const BlockCodec>> m_Codecs;
+		REKSI_THREADING_MUTABLE REKSI_MUTEX(m_ArchiveMutex);
 
-		REKSI_THREADING_MUTABLE REKSI_MUTEX_AUTO;
-		// Mutex for the validity mask
-		REKSI_THREADING_MUTABLE REKSI_MUTEX(m_ValidMaskMutex);
-		// Mutex for default resources and loaders
+		// Worker threads for background loads, declared last so it shuts down first
+		UniquePtr<TaskScheduler> m_Scheduler;
+		// Set while the scheduler is destroyed, loads it cancels must not submit their dependents to it
+		std::atomic<bool> m_ShuttingDown;
+		// Reads files ahead of async loads with a buffer loader, hands them to the scheduler once read
+		UniquePtr<FileReader> m_FileReader;
+
+		// Mutex for default resources, loaders and type tags
 		REKSI_THREADING_MUTABLE REKSI_MUTEX(m_LoaderResourceMutex);
 
-		bool GetValidityImpl(ResourceHandleT handle) const;
-		void SetValidityImpl(ResourceHandleT handle, bool valid);
+		// Creates the resource, called by the path index while holding the lock of the path's shard
+		// Allocated from the block if given
+		ResourceHandleT CreateResourceImpl(const ResourceKey& key, std::string_view name, ResourceData::LoadersPtr loaders,
+		                                   ResourceTypeId type, ResourceData::AllocationBlock* block = nullptr);
+		// Shared by the batch lookups, create(i, key, name, block) creates the i-th resource if missing
+		template <typename PathFunc, typename CreateFunc>
+		std::vector<ResourceHandleT> GetResourcesImpl(size_t count, PathFunc&& path, CreateFunc&& create, bool load,
+		                                              LoadPriority priority);
+		template <typename T>
+		ResourceData::LoadersPtr GetDefaultLoaderImpl() const;
+		LoadFuture LoadAsyncImpl(ResourceData* data, LoadPriority priority);
+		// Returns the archive holding the path and the index of its entry, nullptr if none does
+		SharedPtr<const ResourceArchive> FindArchived(std::string_view name, uint64_t hash, size_t& index) const;
+		// Bytes refer to the archive, or to the buffer for compressed entries, returns false if decompression failed
+		// Large entries are decompressed block by block on the worker threads
+		bool ReadArchived(const ResourceArchive& archive, size_t index, ByteBuffer& buffer, ByteSpan& bytes) const;
+		// Moves a queued load to the front, returns false if the caller should load inline instead
+		bool PromoteLoad(const SharedPtr<LoadTask>& task);
+		// Drops the edges of a deleted resource
+		void RemoveDependencies(ResourceHandleT handle);
+
+		friend class ResourceData;
+		friend class ResourceWatcher;
+		friend class ReloadCoalescer;
 		template <typename T>
-		ResourceData::LoadFunc GetDefaultLoaderImpl() const;
+		friend class ResourceRef;
 	};
 }
 
 #pragma region Defer
 namespace Reksi
 {
-	inline ResourceManager::ResourceManager(std::filesystem::path basePath)
-		: m_BasePath(std::move(basePath)), m_ValidityMask({0}), m_NextHandle(1)
+	inline ResourceManager::ResourceManager(std::filesystem::path basePath, uint32_t workerCount)
+		: m_BasePath(std::move(basePath)),
+		  m_MemoryBudget(0),
+		  m_ResidentBytes(0),
+		  m_ClockHand(0),
+		  m_Scheduler(CreateUnique<TaskScheduler>(workerCount)),
+		  m_ShuttingDown(false),
+		  m_FileReader(FileReader::Create())
 	{
+		m_Codecs.emplace(LzBlockCodec::Id, CreateShared<const LzBlockCodec>());
+	}
+
+	inline ResourceManager::~ResourceManager()
+	{
+		// Finish the reads first, they submit their loads to the scheduler
+		m_FileReader.reset();
+		// Stop the workers before the resources they reference go away
+		// The pointer is cleared before the scheduler is destroyed, the queued loads it cancels cannot reach it
+		m_ShuttingDown.store(true, std::memory_order_release);
+		m_Scheduler.reset();
+
+		// Destroyed while the rest of the manager is alive, listeners notified before deleting may still use it
+		const uint32_t end = m_Resources.GetIndexEnd();
+		for ( uint32_t index = 0; index < end; ++index )
+		{
+			if ( const ResourceData* data = m_Resources.GetAt(index) ) m_Resources.Release(data->GetHandle()).reset();
+		}
+
+		// Data replaced by reloads is freed once unused, free what is left now
+		EpochDomain::Get().Collect();
 	}
 
 	inline bool ResourceManager::IsValid(ResourceHandleT handle) const
 	{
-		return GetValidityImpl(handle);
+		return m_Resources.IsValid(handle);
 	}
 
-	inline ResourceHandleT ResourceManager::GetHandle(const std::filesystem::path& path) const
+	inline ResourceHandleT ResourceManager::GetHandle(const ResourcePathView& path) const
 	{
-		REKSI_LOCK_SHARED_AUTO;
+		return m_ResourcePaths.Find(path);
+	}
 
-		auto itr = m_ResourcePaths.find(path);
-		if ( itr == m_ResourcePaths.end() ) return 0;
-		return itr->second;
+	inline ResourceHandleT ResourceManager::GetHandle(const ResourceKey& key) const
+	{
+		return m_ResourcePaths.Find(key);
+	}
+
+	inline ResourceKey ResourceManager::GetKey(const ResourcePathView& path)
+	{
+		return m_ResourcePaths.Intern(path);
 	}
 
-	inline bool ResourceManager::GetValidityImpl(ResourceHandleT handle) const
+	inline std::vector<ResourceKey> ResourceManager::RegisterAssets(const StaticAssetTable& table)
 	{
-		REKSI_LOCK_SHARED(m_ValidMaskMutex, lock);
+		return m_ResourcePaths.RegisterTable(table);
+	}
 
-		if ( handle / 64 >= m_ValidityMask.size() || handle == 0 ) return false;
-		return m_ValidityMask[handle / 64] & (1ull << (handle % 64));
+	inline ResourceTypeId ResourceManager::GetTypeId(ResourceHandleT handle) const
+	{
+		ResourceData* data = m_Resources.Get(handle);
+		if ( !data ) return 0;
+		return data->GetTypeId();
+	}
+
+	inline std::type_index ResourceManager::GetTypeIndex(ResourceHandleT handle) const
+	{
+		return ResourceTypeRegistry::GetTypeIndex(GetTypeId(handle));
 	}
 
-	inline void ResourceManager::SetValidityImpl(ResourceHandleT handle, bool valid)
+	template <typename T, typename Func>
+	Resource<T> ResourceManager::GetResource(const ResourcePathView& path, Func&& loader)
 	{
-		REKSI_LOCK_UNIQUE(m_ValidMaskMutex, lock);
+		// Creates the resource unless the path already exists
+		const ResourceHandleT handle = m_ResourcePaths.FindOrInsert(path, [&](const ResourceKey& key, std::string_view name)
+		{
+			return CreateResourceImpl(key, name, ResourceData::MakeLoaders<T>(std::forward<Func>(loader)), GetResourceTypeId<T>());
+		});
+		return Resource<T>{handle, m_Resources.Get(handle), this};
+	}
 
-		if ( handle / 64 == m_ValidityMask.size() )
+	template <typename T>
+	Resource<T> ResourceManager::GetResource(const ResourcePathView& path)
+	{
+		// Check if the resource already exists
+		if ( const ResourceHandleT handle = m_ResourcePaths.Find(path) )
 		{
-			m_ValidityMask.push_back(0);
+			// Another type was requested for the path before
+			assert(ResourceHandleLayout::MayBeType(handle, GetResourceTypeId<T>()));
+			return Resource<T>{handle, m_Resources.Get(handle), this};
 		}
-		else if ( handle / 64 > m_ValidityMask.size() )
+
+		// Need to have the loader, try to get it from the default loaders
+		ResourceData::LoadersPtr loader = GetDefaultLoaderImpl<T>();
+		if ( !loader )
 		{
-			// resize the vector and set all bits to 0
-			m_ValidityMask.resize(handle / 64 + 1, 0);
+			throw std::runtime_error("ResourceManager::GetResource: No default loader for the type");
 		}
 
-		// Set the bit to the valid bool
-		auto mask = 1ull << (handle % 64);
-		m_ValidityMask[handle / 64] = (m_ValidityMask[handle / 64] & (~mask)) | (valid ? mask : 0);
+		// Another thread may have created it in the meantime, in which case the loader goes unused
+		const ResourceHandleT handle = m_ResourcePaths.FindOrInsert(path, [&](const ResourceKey& key, std::string_view name)
+		{
+			return CreateResourceImpl(key, name, std::move(loader), GetResourceTypeId<T>());
+		});
+		return Resource<T>{handle, m_Resources.Get(handle), this};
 	}
 
 	template <typename T>
-	Resource<T> ResourceManager::GetResource(const std::filesystem::path& path, const ResourceLoadFunc<T>& loader)
+	Resource<T> ResourceManager::GetResource(const ResourceKey& key)
 	{
-		REKSI_LOCK_UNIQUE_AUTO;
+		if ( const ResourceHandleT handle = m_ResourcePaths.Find(key) )
+		{
+			assert(ResourceHandleLayout::MayBeType(handle, GetResourceTypeId<T>()));
+			return Resource<T>{handle, m_Resources.Get(handle), this};
+		}
 
-		// Check if the resource already exists
-		auto itr = m_ResourcePaths.find(path);
-		if ( itr != m_ResourcePaths.end() )
+		ResourceData::LoadersPtr loader = GetDefaultLoaderImpl<T>();
+		if ( !loader )
 		{
-			auto handle = itr->second;
-			ResourceData* data = m_Resources[handle].get();
-			return Resource<T>{handle, data, this};
+			throw std::runtime_error("ResourceManager::GetResource: No default loader for the type");
 		}
 
-		// Create a new resource
-		uint32_t handle = m_NextHandle++;
-		ResourceData* data = new ResourceData{handle, m_BasePath / path, loader, this, typeid(T)};
-		m_Resources[handle] = UniquePtr<ResourceData>{data};
-		m_ResourcePaths[path] = handle;
-		SetValidityImpl(handle, true);
-		return Resource<T>{handle, data, this};
+		const ResourceHandleT handle = m_ResourcePaths.FindOrInsert(key, [&](const ResourceKey&, std::string_view name)
+		{
+			return CreateResourceImpl(key, name, std::move(loader), GetResourceTypeId<T>());
+		});
+		// Key of another manager, or of a path Compact dropped
+		if ( handle == 0 )
+		{
+			throw std::runtime_error("ResourceManager::GetResource: Invalid key");
+		}
+		return Resource<T>{handle, m_Resources.Get(handle), this};
 	}
 
 	template <typename T>
-	Resource<T> ResourceManager::GetResource(const std::filesystem::path& path)
+	std::vector<Resource<T>> ResourceManager::GetResources(Span<const std::filesystem::path> paths, bool load,
+	                                                       LoadPriority priority)
+	{
+		ResourceData::LoadersPtr loaders = GetDefaultLoaderImpl<T>();
+		if ( !loaders )
+		{
+			throw std::runtime_error("ResourceManager::GetResources: No default loader for the type");
+		}
+
+		const std::vector<ResourceHandleT> handles = GetResourcesImpl(
+			paths.size(),
+			[&](size_t i) -> const std::filesystem::path& { return paths[i]; },
+			[&](size_t, const ResourceKey& key, std::string_view name, ResourceData::AllocationBlock& block)
+			{
+				return CreateResourceImpl(key, name, loaders, GetResourceTypeId<T>(), &block);
+			},
+			load, priority);
+
+		std::vector<Resource<T>> resources;
+		resources.reserve(handles.size());
+		for ( const ResourceHandleT handle : handles )
+		{
+			resources.push_back(Resource<T>{handle, m_Resources.Get(handle), this});
+		}
+		return resources;
+	}
+
+	inline std::vector<ResourceHandleT> ResourceManager::GetResources(Span<const ResourceRequest> requests, bool load,
+	                                                                  LoadPriority priority)
 	{
+		// Copied once, there is an entry per type at most
+		std::vector<ResourceData::LoadersPtr> loaders;
+
 		{
-			REKSI_LOCK_SHARED_AUTO;
+			REKSI_LOCK_SHARED(m_LoaderResourceMutex, lock);
+			loaders = m_DefaultLoaders;
+		}
 
-			// Check if the resource already exists
-			auto itr = m_ResourcePaths.find(path);
-			if ( itr != m_ResourcePaths.end() )
+		// Checked before creating any of them
+		for ( const auto& request : requests )
+		{
+			if ( request.Type >= loaders.size() || !loaders[request.Type] )
 			{
-				auto handle = itr->second;
-				ResourceData* data = m_Resources[handle].get();
-				return Resource<T>{handle, data, this};
+				throw std::runtime_error("ResourceManager::GetResources: No default loader for " + request.Path.string());
 			}
 		}
 
-		// Need to have the loader, try to get it from the default loaders
-		ResourceData::LoadFunc loader = GetDefaultLoaderImpl<T>();
-		if ( !loader )
+		return GetResourcesImpl(
+			requests.size(),
+			[&](size_t i) -> const std::filesystem::path& { return requests[i].Path; },
+			[&](size_t i, const ResourceKey& key, std::string_view name, ResourceData::AllocationBlock& block)
+			{
+				return CreateResourceImpl(key, name, loaders[requests[i].Type], requests[i].Type, &block);
+			},
+			load, priority);
+	}
+
+	template <typename T>
+	void ResourceManager::RegisterTypeTag(std::string tag)
+	{
+		REKSI_LOCK_UNIQUE(m_LoaderResourceMutex, lock);
+
+		m_TypeTags.insert_or_assign(std::move(tag), GetResourceTypeId<T>());
+	}
+
+	inline std::vector<ResourceRequest> ResourceManager::ReadManifest(const std::filesystem::path& manifest) const
+	{
+		std::ifstream stream(manifest);
+		if ( !stream )
+		{
+			throw std::runtime_error("ResourceManager: Failed to open manifest " + manifest.string());
+		}
+
+		std::vector<ResourceRequest> requests;
+		std::string line;
+
+		while ( std::getline(stream, line) )
+		{
+			// Trim, also drops the \r of files written on Windows
+			const size_t begin = line.find_first_not_of(" \t\r");
+			if ( begin == std::string::npos || line[begin] == '#' ) continue;
+			const size_t end = line.find_last_not_of(" \t\r") + 1;
+
+			const size_t tagEnd = line.find_first_of(" \t", begin);
+			const size_t pathBegin = tagEnd < end ? line.find_first_not_of(" \t", tagEnd) : std::string::npos;
+			if ( pathBegin == std::string::npos )
+			{
+				throw std::runtime_error("ResourceManager: Manifest line without a path: " + line);
+			}
+
+			const std::string tag = line.substr(begin, tagEnd - begin);
+			ResourceTypeId type = 0;
+
+			{
+				REKSI_LOCK_SHARED(m_LoaderResourceMutex, lock);
+
+				auto itr = m_TypeTags.find(tag);
+				if ( itr == m_TypeTags.end() )
+				{
+					throw std::runtime_error("ResourceManager: Unknown type tag in manifest: " + tag);
+				}
+				type = itr->second;
+			}
+
+			requests.push_back(ResourceRequest{line.substr(pathBegin, end - pathBegin), type});
+		}
+
+		return requests;
+	}
+
+	inline size_t ResourceManager::Preload(Span<const ResourceRequest> requests, uint32_t parallelism,
+	                                       const PreloadProgressFunc& progress)
+	{
+		const std::vector<ResourceHandleT> handles = GetResources(requests);
+
+		// Loads in flight, waited for oldest first
+		std::deque<LoadFuture> pending;
+		size_t done = 0;
+		size_t failed = 0;
+
+		auto waitOldest = [&]
+		{
+			if ( !pending.front().Get().Is(ResourceLoadStatus::Success) ) ++failed;
+			pending.pop_front();
+			if ( progress ) progress(++done, handles.size());
+		};
+
+		for ( const ResourceHandleT handle : handles )
 		{
-			assert(false);
+			ResourceData* data = m_Resources.Get(handle);
+			if ( !data || data->IsState(ResourceStatus::States::Loaded) )
+			{
+				if ( !data ) ++failed;
+				if ( progress ) progress(++done, handles.size());
+				continue;
+			}
+
+			if ( parallelism != 0 && pending.size() >= parallelism ) waitOldest();
+			pending.push_back(LoadAsyncImpl(data, LoadPriority::Critical));
 		}
 
+		while ( !pending.empty() )
 		{
-			REKSI_LOCK_UNIQUE_AUTO;
+			waitOldest();
+		}
+
+		return failed;
+	}
+
+	inline size_t ResourceManager::Preload(const std::filesystem::path& manifest, uint32_t parallelism,
+	                                       const PreloadProgressFunc& progress)
+	{
+		const std::vector<ResourceRequest> requests = ReadManifest(manifest);
+		return Preload(Span<const ResourceRequest>{requests}, parallelism, progress);
+	}
 
-			// Create the resource
-			uint32_t handle = m_NextHandle++;
-			auto data = new ResourceData{handle, m_BasePath / path, loader, this, typeid(T)};
-			m_Resources[handle] = UniquePtr<ResourceData>{data};
-			m_ResourcePaths[path] = handle;
-			SetValidityImpl(handle, true);
-			return Resource<T>{handle, data, this};
+	template <typename PathFunc, typename CreateFunc>
+	std::vector<ResourceHandleT> ResourceManager::GetResourcesImpl(size_t count, PathFunc&& path, CreateFunc&& create,
+	                                                               bool load, LoadPriority priority)
+	{
+		// Path views cannot be moved, a deque constructs them in place
+		std::deque<ResourcePathView> views;
+		for ( size_t i = 0; i < count; ++i )
+		{
+			views.emplace_back(path(i));
+		}
+
+		std::vector<ResourceHandleT> handles(count);
+		// Sized for the whole batch, slots of paths which already exist stay unused
+		ResourceData::AllocationBlock* block = ResourceData::AllocationBlock::Create(count);
+
+		m_ResourcePaths.FindOrInsert(
+			count,
+			[&](size_t i) -> const ResourcePathView& { return views[i]; },
+			[&](size_t i, const ResourceKey& key, std::string_view name)
+			{
+				return create(i, key, name, *block);
+			},
+			handles.data());
+
+		// Freed right away if every path existed
+		block->Release();
+
+		if ( load )
+		{
+			for ( const ResourceHandleT handle : handles )
+			{
+				ResourceData* data = m_Resources.Get(handle);
+				if ( data && !data->IsState(ResourceStatus::States::Loaded) ) LoadAsyncImpl(data, priority);
+			}
 		}
+
+		return handles;
+	}
+
+	inline ResourceHandleT ResourceManager::CreateResourceImpl(const ResourceKey& key, std::string_view name,
+	                                                           ResourceData::LoadersPtr loaders, ResourceTypeId type,
+	                                                           ResourceData::AllocationBlock* block)
+	{
+		const ResourceHandleT handle = ResourceHandleLayout::WithType(m_Resources.Allocate(), type);
+		ResourceData* data = ResourceData::Create(block, handle, key, name, std::move(loaders), this, type);
+		m_Resources.Publish(handle, data);
+		return handle;
 	}
 
 	template <typename T>
 	void ResourceManager::DeleteResource(const Resource<T>& resource)
 	{
-		REKSI_LOCK_UNIQUE_AUTO;
+		const ResourceHandleT handle = resource.m_Handle;
+		UniquePtr<ResourceData> deleted;
+
+		{
+			REKSI_LOCK_SHARED(m_EvictionMutex, lock);
+
+			// Read from the slot, a racing delete may be destroying the data already
+			// Also returns if the resource is deleted already
+			ResourceKey key;
+			if ( !m_Resources.GetKey(handle, key) ) return;
+
+			// Remove the resource from the resource paths first, so it cannot be found once invalid
+			// Only clears the entry while it still holds this handle
+			m_ResourcePaths.Erase(key, handle);
+
+			// Invalidate the handle, the slot may be reused from here on
+			// Only one of several racing deletes gets the data back and destroys it
+			deleted = m_Resources.Release(handle);
+		}
 
-		// Check if resource is already deleted
-		if ( !GetValidityImpl(resource.m_Handle) ) return;
+		if ( !deleted ) return;
+		RemoveDependencies(handle);
 
-		// If not, delete the resource
-		// Set validity to false
-		SetValidityImpl(resource.m_Handle, false);
-		// Remove the resource from the resource paths
-		auto path = resource.m_Data->GetPath();
-		// Remove the base path from the path
-		path = path.string().substr(m_BasePath.string().size());
-		m_ResourcePaths.erase(path);
-		// Remove the resource from the resources
-		m_Resources.erase(resource.m_Handle); // UniquePtr will delete the resource
+		// Destroyed outside the lock, as it waits for loads in flight
+		deleted.reset();
 	}
 
 	inline void ResourceManager::MarkForDelete(ResourceHandleT handle)
 	{
-		if ( !GetValidityImpl(handle) ) return;
+		ResourceData* data = m_Resources.Get(handle);
+		if ( !data ) return;
 
-		REKSI_LOCK_UNIQUE_AUTO;
-
-		auto data = m_Resources[handle].get();
 		data->SetState(ResourceStatus::MarkedForDelete);
 		data->ClearState(ResourceStatus::MarkedForReload);
 	}
 
 	inline void ResourceManager::Reload(ResourceHandleT handle)
 	{
-		if ( !GetValidityImpl(handle) ) ResourceLoadStatus();
+		ResourceData* data = m_Resources.Get(handle);
+		if ( !data ) return;
 
-		ResourceData* data;
-		{
-			REKSI_LOCK_UNIQUE_AUTO;
-			data = m_Resources[handle].get();
-		}
 		data->WaitUntilCurrentLoading();
 		data->Load();
 	}
 
+	inline void ResourceManager::SetMemoryBudget(size_t bytes)
+	{
+		m_MemoryBudget.store(bytes, std::memory_order_relaxed);
+		EnforceMemoryBudget();
+	}
+
+	inline size_t ResourceManager::GetMemoryBudget() const
+	{
+		return m_MemoryBudget.load(std::memory_order_relaxed);
+	}
+
+	inline size_t ResourceManager::GetResidentBytes() const
+	{
+		return m_ResidentBytes.load(std::memory_order_relaxed);
+	}
+
+	inline void ResourceManager::EnforceMemoryBudget()
+	{
+		const size_t budget = m_MemoryBudget.load(std::memory_order_relaxed);
+		if ( budget == 0 || m_ResidentBytes.load(std::memory_order_relaxed) <= budget ) return;
+
+		REKSI_LOCK_UNIQUE(m_EvictionMutex, lock);
+
+		// The first sweep may only clear referenced bits, give up after the second
+		const uint32_t end = m_Resources.GetIndexEnd();
+		for ( uint64_t step = 0; step < 2ull * end; ++step )
+		{
+			if ( m_ResidentBytes.load(std::memory_order_relaxed) <= budget ) return;
+
+			if ( m_ClockHand >= end ) m_ClockHand = 0;
+			if ( ResourceData* data = m_Resources.GetAt(m_ClockHand) ) data->TryEvict();
+			++m_ClockHand;
+		}
+	}
+
+	inline ResourceMemoryStats ResourceManager::GetMemoryStats() const
+	{
+		ResourceMemoryStats stats;
+		stats.MemoryBudget = m_MemoryBudget.load(std::memory_order_relaxed);
+
+		// By type id while walking, every resource's type was registered before it was created
+		std::vector<ResourceMemoryStats::Usage> perType(ResourceTypeRegistry::GetEnd());
+
+		{
+			REKSI_LOCK_UNIQUE(m_EvictionMutex, lock);
+
+			const uint32_t end = m_Resources.GetIndexEnd();
+			for ( uint32_t index = 0; index < end; ++index )
+			{
+				const ResourceData* data = m_Resources.GetAt(index);
+				if ( !data ) continue;
+
+				const ResourceStatus status = data->GetStatus();
+				const size_t bytes = data->GetSize();
+				const auto add = [bytes](ResourceMemoryStats::Usage& usage)
+				{
+					++usage.Count;
+					usage.Bytes += bytes;
+				};
+
+				add(stats.Total);
+				add(perType[data->GetTypeId()]);
+				if ( status.Is(ResourceStatus::Loaded) ) add(stats.Loaded);
+				if ( status.Is(ResourceStatus::Loading) ) add(stats.Loading);
+				if ( status.Is(ResourceStatus::MarkedForDelete) ) add(stats.MarkedForDelete);
+			}
+		}
+
+		for ( ResourceTypeId type = 0; type < perType.size(); ++type )
+		{
+			if ( perType[type].Count ) stats.PerType[ResourceTypeRegistry::GetTypeIndex(type)] = perType[type];
+		}
+
+		stats.OverheadBytes = sizeof(ResourceManager) + stats.Total.Count * ResourceData::GetAllocationSize() +
+			m_Resources.GetMemoryUsage() + m_ResourcePaths.GetMemoryUsage();
+		return stats;
+	}
+
+	inline void ResourceManager::Mount(const std::filesystem::path& archive)
+	{
+		auto mounted = CreateShared<const ResourceArchive>(archive);
+
+		REKSI_LOCK_UNIQUE(m_ArchiveMutex, lock);
+		m_Archives.push_back(std::move(mounted));
+	}
+
+	inline void ResourceManager::RegisterCodec(SharedPtr<const BlockCodec> codec)
+	{
+		REKSI_LOCK_UNIQUE(m_ArchiveMutex, lock);
+
+		const uint32_t id = codec->GetId();
+		m_Codecs[id] = std::move(codec);
+	}
+
+	inline SharedPtr<const ResourceArchive> ResourceManager::FindArchived(std::string_view name, uint64_t hash,
+	                                                                      size_t& index) const
+	{
+		REKSI_LOCK_SHARED(m_ArchiveMutex, lock);
+
+		for ( auto itr = m_Archives.rbegin(); itr != m_Archives.rend(); ++itr )
+		{
+			index = (*itr)->Find(name, hash);
+			if ( index != ResourceArchive::NotFound ) return *itr;
+		}
+
+		return nullptr;
+	}
+
+	inline bool ResourceManager::ReadArchived(const ResourceArchive& archive, size_t index, ByteBuffer& buffer,
+	                                          ByteSpan& bytes) const
+	{
+		if ( !archive.IsCompressed(index) )
+		{
+			bytes = archive.GetBytes(index);
+			return true;
+		}
+
+		SharedPtr<const BlockCodec> codec;
+
+		{
+			REKSI_LOCK_SHARED(m_ArchiveMutex, lock);
+
+			auto itr = m_Codecs.find(archive.GetEntry(index).Codec);
+			if ( itr == m_Codecs.end() ) return false;
+			codec = itr->second;
+		}
+
+		buffer.resize(static_cast<size_t>(archive.GetEntry(index).Size));
+		std::atomic<bool> success{true};
+
+		m_Scheduler->ParallelFor(archive.GetBlockCount(index), [&](size_t block)
+		{
+			if ( !archive.DecompressBlock(index, block, *codec, buffer.data()) )
+			{
+				success.store(false, std::memory_order_relaxed);
+			}
+		});
+
+		bytes = ByteSpan{buffer.data(), buffer.size()};
+		return success.load(std::memory_order_relaxed);
+	}
+
+	inline bool ResourceData::LoadFromArchive(SharedPtr<void>& data) const
+	{
+		size_t index;
+		const auto archive = m_Creator->FindArchived(m_Name, m_Key.Hash, index);
+		if ( !archive ) return false;
+
+		ByteBuffer buffer;
+		ByteSpan bytes;
+		if ( m_Creator->ReadArchived(*archive, index, buffer, bytes) )
+		{
+			data = m_Loaders->LoadBuffer(GetPath(), bytes);
+		}
+		return true;
+	}
+
+	inline void ResourceManager::Compact()
+	{
+		m_Resources.Compact();
+		m_ResourcePaths.Compact([this](ResourceHandleT handle, std::string_view path)
+		{
+			if ( ResourceData* data = m_Resources.Get(handle) ) data->m_Name = path;
+		});
+	}
+
+	inline LoadFuture ResourceManager::LoadAsync(ResourceHandleT handle, LoadPriority priority)
+	{
+		ResourceData* data = m_Resources.Get(handle);
+		if ( !data ) return LoadFuture();
+
+		return LoadAsyncImpl(data, priority);
+	}
+
+	template <typename T>
+	ResourceFuture<T> ResourceManager::LoadAsync(const Resource<T>& resource, LoadPriority priority)
+	{
+		return ResourceFuture<T>{resource, LoadAsyncImpl(resource.m_Data, priority)};
+	}
+
+	template <typename T>
+	ResourceFuture<T> ResourceManager::LoadAsync(const ResourcePathView& path, LoadPriority priority)
+	{
+		return LoadAsync(GetResource<T>(path), priority);
+	}
+
+	inline LoadFuture ResourceManager::LoadAsyncImpl(ResourceData* data, LoadPriority priority)
+	{
+		bool created;
+		auto task = data->GetOrCreatePendingLoad(created);
+		if ( !created )
+		{
+			m_Scheduler->Promote(task, priority);
+			return LoadFuture{std::move(task)};
+		}
+
+		// Queued once the file is read ahead and the dependencies finished loading, successfully or not
+		// Promoting it meanwhile loads it right away, the dependencies inline and without the read ahead
+		auto remaining = CreateShared<std::atomic<size_t>>(1);
+		auto ready = [this, task, priority, remaining]
+		{
+			if ( remaining->fetch_sub(1, std::memory_order_acq_rel) != 1 ) return;
+
+			// A dependency cancelled by the scheduler shutting down cancels the dependent as well
+			if ( m_ShuttingDown.load(std::memory_order_acquire) )
+			{
+				task->Cancel();
+				return;
+			}
+			m_Scheduler->Submit(task, priority);
+		};
+
+		size_t archived;
+		if ( data->HasBufferLoader() && !FindArchived(data->GetName(), data->GetKey().Hash, archived) )
+		{
+			remaining->fetch_add(1, std::memory_order_relaxed);
+			m_FileReader->ReadAsync(data->GetPath(), [task, ready](ByteBuffer buffer, bool success)
+			{
+				// A failed read is left to the loader, which reports the error
+				if ( success ) task->SetPrefetched(std::move(buffer));
+				ready();
+			});
+		}
+
+		for ( const ResourceHandleT handle : GetDependencies(data->GetHandle()) )
+		{
+			ResourceData* dependency = m_Resources.Get(handle);
+			if ( !dependency || dependency->IsState(ResourceStatus::States::Loaded) ) continue;
+
+			remaining->fetch_add(1, std::memory_order_relaxed);
+			const LoadFuture future = LoadAsyncImpl(dependency, priority);
+			if ( !future.ContinueWith([ready](ResourceLoadStatus) { ready(); }) ) ready();
+		}
+
+		ready();
+		return LoadFuture{std::move(task)};
+	}
+
+	inline bool ResourceManager::AddDependency(ResourceHandleT dependent, ResourceHandleT dependency)
+	{
+		if ( dependent == dependency || !m_Resources.IsValid(dependent) || !m_Resources.IsValid(dependency) )
+		{
+			return false;
+		}
+
+		REKSI_LOCK_UNIQUE(m_DependencyMutex, lock);
+
+		auto& dependencies = m_Dependencies[dependent];
+		if ( std::find(dependencies.begin(), dependencies.end(), dependency) != dependencies.end() ) return true;
+
+		// Walk everything the dependency depends on, finding the dependent there would close a cycle
+		std::vector<ResourceHandleT> stack{dependency};
+		std::vector<ResourceHandleT> visited;
+		while ( !stack.empty() )
+		{
+			const ResourceHandleT handle = stack.back();
+			stack.pop_back();
+
+			if ( handle == dependent ) return false;
+			if ( std::find(visited.begin(), visited.end(), handle) != visited.end() ) continue;
+			visited.push_back(handle);
+
+			auto itr = m_Dependencies.find(handle);
+			if ( itr != m_Dependencies.end() ) stack.insert(stack.end(), itr->second.begin(), itr->second.end());
+		}
+
+		dependencies.push_back(dependency);
+		m_Dependents[dependency].push_back(dependent);
+		return true;
+	}
+
+	inline void ResourceManager::RemoveDependency(ResourceHandleT dependent, ResourceHandleT dependency)
+	{
+		REKSI_LOCK_UNIQUE(m_DependencyMutex, lock);
+
+		auto erase = [](std::unordered_map<ResourceHandleT, std::vector<ResourceHandleT>>& edges,
+		                ResourceHandleT from, ResourceHandleT to)
+		{
+			auto itr = edges.find(from);
+			if ( itr == edges.end() ) return;
+
+			auto& handles = itr->second;
+			handles.erase(std::remove(handles.begin(), handles.end(), to), handles.end());
+			if ( handles.empty() ) edges.erase(itr);
+		};
+
+		erase(m_Dependencies, dependent, dependency);
+		erase(m_Dependents, dependency, dependent);
+	}
+
+	inline std::vector<ResourceHandleT> ResourceManager::GetDependencies(ResourceHandleT handle) const
+	{
+		REKSI_LOCK_SHARED(m_DependencyMutex, lock);
+
+		auto itr = m_Dependencies.find(handle);
+		if ( itr == m_Dependencies.end() ) return {};
+		return itr->second;
+	}
+
+	inline std::vector<ResourceHandleT> ResourceManager::GetDependents(ResourceHandleT handle) const
+	{
+		REKSI_LOCK_SHARED(m_DependencyMutex, lock);
+
+		auto itr = m_Dependents.find(handle);
+		if ( itr == m_Dependents.end() ) return {};
+		return itr->second;
+	}
+
+	inline void ResourceManager::RemoveDependencies(ResourceHandleT handle)
+	{
+		for ( const ResourceHandleT dependency : GetDependencies(handle) )
+		{
+			RemoveDependency(handle, dependency);
+		}
+		for ( const ResourceHandleT dependent : GetDependents(handle) )
+		{
+			RemoveDependency(dependent, handle);
+		}
+	}
+
+	inline bool ResourceData::LoadDependencies()
+	{
+		for ( const ResourceHandleT handle : m_Creator->GetDependencies(m_Handle) )
+		{
+			ResourceData* dependency = m_Creator->m_Resources.Get(handle);
+			if ( !dependency ) continue;
+
+			if ( !dependency->IsState(RS::Loaded) ) dependency->LoadOrWaitForPending();
+			if ( !dependency->IsState(RS::Loaded) ) return false;
+		}
+
+		return true;
+	}
+
+	inline void ResourceData::ReloadDependents()
+	{
+		for ( const ResourceHandleT handle : m_Creator->GetDependents(m_Handle) )
+		{
+			ResourceData* dependent = m_Creator->m_Resources.Get(handle);
+			if ( dependent && dependent->IsState(RS::Loaded) ) m_Creator->LoadAsyncImpl(dependent, LoadPriority::Visible);
+		}
+	}
+
+	inline std::filesystem::path ResourceData::GetPath() const
+	{
+		return m_Creator->m_BasePath / m_Name;
+	}
+
+	inline void ResourceData::UpdateResidentSize(size_t oldSize, size_t newSize)
+	{
+		if ( newSize >= oldSize )
+		{
+			m_Creator->m_ResidentBytes.fetch_add(newSize - oldSize, std::memory_order_relaxed);
+		}
+		else
+		{
+			m_Creator->m_ResidentBytes.fetch_sub(oldSize - newSize, std::memory_order_relaxed);
+		}
+	}
+
+	inline void ResourceData::EnforceMemoryBudget()
+	{
+		m_Creator->EnforceMemoryBudget();
+	}
+
+	inline void ResourceData::LoadOrWaitForPending()
+	{
+		// Waiting for the promoted load is cheaper than loading twice
+		const auto pending = GetPendingLoad();
+		if ( pending && m_Creator->PromoteLoad(pending) )
+		{
+			pending->Wait();
+			return;
+		}
+
+		Load();
+	}
+
+	inline bool ResourceManager::PromoteLoad(const SharedPtr<LoadTask>& task)
+	{
+		// Blocking a worker on the queue it is supposed to drain could deadlock
+		if ( m_Scheduler->IsWorkerThread() ) return false;
+
+		m_Scheduler->Promote(task, LoadPriority::Critical);
+		return true;
+	}
+
+	template <typename T>
+	ResourceRequest ResourceRequest::Of(std::filesystem::path path)
+	{
+		return ResourceRequest{std::move(path), GetResourceTypeId<T>()};
+	}
+
 	template <typename T>
 	SharedPtr<T> ResourceManager::GetDefaultResource() const
 	{
+		const ResourceTypeId type = GetResourceTypeId<T>();
+
 		REKSI_LOCK_SHARED(m_LoaderResourceMutex, lock);
 
-		auto itr = m_DefaultResources.find(typeid(T));
-		if ( itr == m_DefaultResources.end() ) return nullptr;
-		return StaticSharedCast<T>(itr->second);
+		if ( type >= m_DefaultResources.size() ) return nullptr;
+		return StaticSharedCast<T>(m_DefaultResources[type]);
 	}
 
 	template <typename T>
 	void ResourceManager::SetDefaultResource(const SharedPtr<T>& resource)
 	{
+		const ResourceTypeId type = GetResourceTypeId<T>();
+
 		REKSI_LOCK_UNIQUE(m_LoaderResourceMutex, lock);
 
-		m_DefaultResources[typeid(T)] = resource;
+		if ( type >= m_DefaultResources.size() ) m_DefaultResources.resize(type + 1);
+		m_DefaultResources[type] = resource;
 	}
 
 	template <typename T>
 	ResourceLoadFunc<T> ResourceManager::GetDefaultLoader() const
 	{
-		auto loader = GetDefaultLoaderImpl<T>();
-		if ( !loader ) return nullptr;
-		return [loader](const std::filesystem::path& path) -> SharedPtr<T>
-		{
-			return StaticSharedCast<T>(loader(path));
-		};
+		return ResourceData::MakeLoadFunc<T>(GetDefaultLoaderImpl<T>());
 	}
 
-	template <typename T>
-	void ResourceManager::SetDefaultLoader(const ResourceLoadFunc<T>& loader)
+	template <typename T, typename Func>
+	void ResourceManager::SetDefaultLoader(Func&& loader)
 	{
+		// Built outside the lock, resources created meanwhile keep sharing the previous loader
+		ResourceData::LoadersPtr loaders = ResourceData::MakeLoaders<T>(std::forward<Func>(loader));
+		const ResourceTypeId type = GetResourceTypeId<T>();
+
 		REKSI_LOCK_UNIQUE(m_LoaderResourceMutex, lock);
 
-		m_DefaultLoaders[typeid(T)] = loader;
+		if ( type >= m_DefaultLoaders.size() ) m_DefaultLoaders.resize(type + 1);
+		m_DefaultLoaders[type] = std::move(loaders);
 	}
 
 	template <typename T>
@@ -257,23 +1069,30 @@ namespace Reksi
 		static_assert(std::is_constructible_v<T, const std::filesystem::path&>,
 		              "T must have a constructor that takes a path");
 
-		ResourceData::LoadFunc loader = [](const std::filesystem::path& path) -> SharedPtr<T>
+		SetDefaultLoader<T>([](const std::filesystem::path& path) -> SharedPtr<T>
 		{
 			return CreateShared<T>(path);
-		};
+		});
+	}
 
-		REKSI_LOCK_UNIQUE(m_LoaderResourceMutex, lock);
-		m_DefaultLoaders[typeid(T)] = loader;
+	template <typename T, typename Func>
+	void ResourceManager::SetDefaultBufferLoader(Func&& loader)
+	{
+		static_assert(std::is_invocable_r_v<SharedPtr<T>, Func&, const std::filesystem::path&, ByteSpan>,
+		              "The loader must return a SharedPtr<T> from a path and the file contents");
+
+		SetDefaultLoader<T>(std::forward<Func>(loader));
 	}
 
 	template <typename T>
-	ResourceData::LoadFunc ResourceManager::GetDefaultLoaderImpl() const
+	ResourceData::LoadersPtr ResourceManager::GetDefaultLoaderImpl() const
 	{
+		const ResourceTypeId type = GetResourceTypeId<T>();
+
 		REKSI_LOCK_SHARED(m_LoaderResourceMutex, lock);
 
-		auto itr = m_DefaultLoaders.find(typeid(T));
-		if ( itr == m_DefaultLoaders.end() ) return nullptr;
-		return itr->second;
+		if ( type >= m_DefaultLoaders.size() ) return {};
+		return m_DefaultLoaders[type];
 	}
 }
 #pragma endregion
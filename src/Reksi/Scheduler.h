@@ -0,0 +1,402 @@
+#pragma once
+
+#include "Reksi/Base.h"
+
+namespace Reksi
+{
+	// Order in which queued tasks are picked up, lower values run first
+	enum class LoadPriority : uint8_t
+	{
+		Critical = 0,
+		Visible = 1,
+		Prefetch = 2
+	};
+
+	constexpr size_t LoadPriorityCount = 3;
+
+	// Unit of work executed by the TaskScheduler
+	class SchedulerTask
+	{
+	public:
+		SchedulerTask() = default;
+		virtual ~SchedulerTask() = default;
+
+		// Runs the task on a worker thread
+		virtual void Execute() = 0;
+
+		// Called instead of Execute if the scheduler shuts down before the task was picked up
+		virtual void Cancel()
+		{
+		}
+
+		LoadPriority GetPriority() const;
+
+	private:
+		std::atomic<uint8_t> m_Priority{static_cast<uint8_t>(LoadPriority::Visible)};
+		// A promoted task sits in several queues, only the first pop gets to run it
+		std::atomic<bool> m_Taken{false};
+
+		bool TryTake();
+		// Returns false if the task already has the same or a higher priority
+		bool Raise(LoadPriority priority);
+
+		friend class TaskScheduler;
+	};
+
+	// Pool of worker threads owned by the ResourceManager, used for background loads
+	// Every worker owns a deque per priority, idle workers steal from the others
+	// With REKSI_THREADING disabled, submitted tasks are executed inline
+	class TaskScheduler
+	{
+	public:
+		// A worker count of 0 uses the hardware concurrency
+		explicit TaskScheduler(uint32_t workerCount = 0);
+		~TaskScheduler();
+
+		TaskScheduler(const TaskScheduler&) = delete;
+		TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+		// Cancels the task instead once the scheduler is shutting down
+		void Submit(SharedPtr<SchedulerTask> task, LoadPriority priority = LoadPriority::Visible);
+		// Moves a queued task to a higher priority, does nothing if it already started
+		void Promote(const SharedPtr<SchedulerTask>& task, LoadPriority priority);
+		uint32_t GetWorkerCount() const;
+		// True when called from one of this scheduler's workers
+		bool IsWorkerThread() const;
+		// Runs body(i) for every i below count on the workers and the calling thread, returns once all ran
+		// The caller runs the parts no worker picked up yet, so it may be called from a worker as well
+		void ParallelFor(size_t count, const std::function<void(size_t)>& body,
+		                 LoadPriority priority = LoadPriority::Critical);
+
+	private:
+		// Part of a ParallelFor
+		class ParallelPart;
+
+		struct WorkerQueue
+		{
+			REKSI_MUTEX_AUTO;
+			std::deque<SharedPtr<SchedulerTask>> Tasks[LoadPriorityCount];
+		};
+
+		std::vector<UniquePtr<WorkerQueue>> m_Queues;
+#if REKSI_THREADING == 1
+		std::vector<std::thread> m_Workers;
+#endif
+		// Number of queue entries, including stale ones left behind by promotions
+		std::atomic<size_t> m_QueuedCount;
+		std::atomic<uint32_t> m_NextQueue;
+		std::atomic<bool> m_Stopping;
+
+		// Guards sleeping and waking up of idle workers
+		REKSI_THREADING_MUTABLE REKSI_MUTEX_AUTO;
+		REKSI_CV_AUTO;
+
+		static thread_local const TaskScheduler* s_CurrentScheduler;
+		static thread_local uint32_t s_CurrentWorker;
+
+		// Returns false without queueing the task once the scheduler is shutting down
+		bool Push(SharedPtr<SchedulerTask> task, LoadPriority priority);
+		SharedPtr<SchedulerTask> Pop(uint32_t worker);
+		void WorkerLoop(uint32_t worker);
+	};
+}
+
+#pragma region Defer
+namespace Reksi
+{
+	inline thread_local const TaskScheduler* TaskScheduler::s_CurrentScheduler = nullptr;
+	inline thread_local uint32_t TaskScheduler::s_CurrentWorker = 0;
+
+	inline LoadPriority SchedulerTask::GetPriority() const
+	{
+		return static_cast<LoadPriority>(m_Priority.load(std::memory_order_relaxed));
+	}
+
+	inline bool SchedulerTask::TryTake()
+	{
+		return !m_Taken.exchange(true, std::memory_order_acq_rel);
+	}
+
+	inline bool SchedulerTask::Raise(LoadPriority priority)
+	{
+		auto current = m_Priority.load(std::memory_order_relaxed);
+		while ( static_cast<uint8_t>(priority) < current )
+		{
+			if ( m_Priority.compare_exchange_weak(current, static_cast<uint8_t>(priority)) ) return true;
+		}
+		return false;
+	}
+
+	inline TaskScheduler::TaskScheduler([[maybe_unused]] uint32_t workerCount)
+		: m_QueuedCount(0), m_NextQueue(0), m_Stopping(false)
+	{
+#if REKSI_THREADING == 1
+		if ( workerCount == 0 )
+		{
+			workerCount = std::max(1u, std::thread::hardware_concurrency());
+		}
+
+		m_Queues.reserve(workerCount);
+		for ( uint32_t i = 0; i < workerCount; ++i )
+		{
+			m_Queues.emplace_back(CreateUnique<WorkerQueue>());
+		}
+
+		m_Workers.reserve(workerCount);
+		for ( uint32_t i = 0; i < workerCount; ++i )
+		{
+			m_Workers.emplace_back([this, i] { WorkerLoop(i); });
+		}
+#endif
+	}
+
+	inline TaskScheduler::~TaskScheduler()
+	{
+		{
+			REKSI_LOCK_UNIQUE_AUTO;
+
+			m_Stopping = true;
+		}
+
+		REKSI_CV_NOTIFY_ALL_AUTO;
+
+#if REKSI_THREADING == 1
+		for ( auto& worker : m_Workers )
+		{
+			worker.join();
+		}
+#endif
+
+		// Tasks which never got picked up are cancelled, so that anyone waiting on them is released
+		// Taken out of the queues first, cancelling may complete continuations which submit more work
+		std::vector<SharedPtr<SchedulerTask>> queued;
+		for ( const auto& queue : m_Queues )
+		{
+			REKSI_LOCK(queue->REKSI_MUTEX_AUTO_NAME, lock);
+
+			for ( auto& tasks : queue->Tasks )
+			{
+				queued.insert(queued.end(), std::make_move_iterator(tasks.begin()), std::make_move_iterator(tasks.end()));
+				tasks.clear();
+			}
+		}
+
+		for ( const auto& task : queued )
+		{
+			if ( task->TryTake() ) task->Cancel();
+		}
+	}
+
+	inline void TaskScheduler::Submit(SharedPtr<SchedulerTask> task, LoadPriority priority)
+	{
+		task->m_Priority.store(static_cast<uint8_t>(priority), std::memory_order_relaxed);
+
+#if REKSI_THREADING == 1
+		if ( Push(task, priority) ) return;
+
+		if ( task->TryTake() ) task->Cancel();
+#else
+		if ( task->TryTake() ) task->Execute();
+#endif
+	}
+
+	inline void TaskScheduler::Promote(const SharedPtr<SchedulerTask>& task, LoadPriority priority)
+	{
+		if ( task->m_Taken.load(std::memory_order_acquire) || !task->Raise(priority) ) return;
+
+		// The entry at the old priority stays behind and is skipped once the task was taken
+		Push(task, priority);
+	}
+
+	inline uint32_t TaskScheduler::GetWorkerCount() const
+	{
+#if REKSI_THREADING == 1
+		return static_cast<uint32_t>(m_Workers.size());
+#else
+		return 0;
+#endif
+	}
+
+	inline bool TaskScheduler::IsWorkerThread() const
+	{
+		return s_CurrentScheduler == this;
+	}
+
+#if REKSI_THREADING == 1
+	class TaskScheduler::ParallelPart : public SchedulerTask
+	{
+	public:
+		struct Group
+		{
+			const std::function<void(size_t)>* Body;
+			size_t Remaining;
+			REKSI_MUTEX_AUTO;
+			REKSI_CV_AUTO;
+
+			void Run(size_t index)
+			{
+				(*Body)(index);
+
+				{
+					REKSI_LOCK_UNIQUE_AUTO;
+
+					if ( --Remaining != 0 ) return;
+				}
+
+				REKSI_CV_NOTIFY_ALL_AUTO;
+			}
+		};
+
+		ParallelPart(SharedPtr<Group> group, size_t index)
+			: m_Group(std::move(group)), m_Index(index)
+		{
+		}
+
+		void Execute() override
+		{
+			m_Group->Run(m_Index);
+		}
+
+		// The caller is waiting for it
+		void Cancel() override
+		{
+			Execute();
+		}
+
+	private:
+		SharedPtr<Group> m_Group;
+		size_t m_Index;
+	};
+#endif
+
+	inline void TaskScheduler::ParallelFor(size_t count, const std::function<void(size_t)>& body,
+	                                       [[maybe_unused]] LoadPriority priority)
+	{
+#if REKSI_THREADING == 1
+		if ( count > 1 )
+		{
+			auto group = CreateShared<ParallelPart::Group>();
+			group->Body = &body;
+			group->Remaining = count;
+
+			std::vector<SharedPtr<ParallelPart>> parts;
+			parts.reserve(count - 1);
+			for ( size_t i = 1; i < count; ++i )
+			{
+				parts.push_back(CreateShared<ParallelPart>(group, i));
+				Submit(parts.back(), priority);
+			}
+
+			// The first part runs right away, the rest unless a worker took it meanwhile,
+			// newest first as the workers start with the oldest
+			group->Run(0);
+			for ( auto itr = parts.rbegin(); itr != parts.rend(); ++itr )
+			{
+				if ( (*itr)->TryTake() ) (*itr)->Execute();
+			}
+
+			REKSI_LOCK_UNIQUE(group->REKSI_MUTEX_AUTO_NAME, lock);
+			REKSI_CV_WAIT(group->REKSI_CV_AUTO_NAME, lock, [&] { return group->Remaining == 0; });
+			return;
+		}
+#endif
+
+		for ( size_t i = 0; i < count; ++i )
+		{
+			body(i);
+		}
+	}
+
+	inline bool TaskScheduler::Push(SharedPtr<SchedulerTask> task, LoadPriority priority)
+	{
+		// Workers keep what they spawn local, other threads spread submissions round robin
+		const uint32_t index = IsWorkerThread()
+			                       ? s_CurrentWorker
+			                       : m_NextQueue.fetch_add(1, std::memory_order_relaxed) % m_Queues.size();
+
+		{
+			WorkerQueue& queue = *m_Queues[index];
+			REKSI_LOCK(queue.REKSI_MUTEX_AUTO_NAME, lock);
+
+			// Checked under the queue lock, the destructor empties the queues under it once stopping
+			if ( m_Stopping.load(std::memory_order_acquire) ) return false;
+
+			queue.Tasks[static_cast<size_t>(priority)].emplace_back(std::move(task));
+		}
+
+		{
+			// Counted under the sleep lock, so a worker about to sleep cannot miss it
+			REKSI_LOCK_UNIQUE_AUTO;
+
+			m_QueuedCount.fetch_add(1, std::memory_order_release);
+		}
+
+		REKSI_CV_NOTIFY_ONE_AUTO;
+		return true;
+	}
+
+	inline SharedPtr<SchedulerTask> TaskScheduler::Pop(uint32_t worker)
+	{
+		const auto count = static_cast<uint32_t>(m_Queues.size());
+
+		for ( size_t priority = 0; priority < LoadPriorityCount; ++priority )
+		{
+			// Own queue first, oldest entry first
+			// then steal the newest entry of the same priority from the others
+			for ( uint32_t i = 0; i < count; ++i )
+			{
+				const uint32_t index = (worker + i) % count;
+				WorkerQueue& queue = *m_Queues[index];
+
+				while ( true )
+				{
+					SharedPtr<SchedulerTask> task;
+
+					{
+						REKSI_LOCK(queue.REKSI_MUTEX_AUTO_NAME, lock);
+
+						auto& tasks = queue.Tasks[priority];
+						if ( tasks.empty() ) break;
+
+						if ( i == 0 )
+						{
+							task = std::move(tasks.front());
+							tasks.pop_front();
+						}
+						else
+						{
+							task = std::move(tasks.back());
+							tasks.pop_back();
+						}
+					}
+
+					m_QueuedCount.fetch_sub(1, std::memory_order_relaxed);
+					if ( task->TryTake() ) return task;
+				}
+			}
+		}
+
+		return nullptr;
+	}
+
+	inline void TaskScheduler::WorkerLoop(uint32_t worker)
+	{
+		s_CurrentScheduler = this;
+		s_CurrentWorker = worker;
+
+		while ( !m_Stopping.load(std::memory_order_acquire) )
+		{
+			if ( auto task = Pop(worker) )
+			{
+				task->Execute();
+				continue;
+			}
+
+			REKSI_LOCK_UNIQUE_AUTO;
+
+			REKSI_CV_WAIT_AUTO([&] { return m_Stopping || m_QueuedCount.load(std::memory_order_acquire) > 0; });
+			if ( m_Stopping ) return;
+		}
+	}
+}
+#pragma endregion
@@ -0,0 +1,508 @@
+#pragma once
+
+#include "Reksi/Base.h"
+#include "Reksi/ResourceData.h"
+
+namespace Reksi
+{
+	/*
+	 * Handle layout
+	 * Bits  0-31: Slot index
+	 * Bits 32-55: Slot generation, never 0 for a live handle
+	 * Bits 56-63: Type id of the resource, 0 for ids which do not fit
+	 * Only the index and generation address the slot, the type lets typed handles be checked without a lookup
+	 */
+	class ResourceHandleLayout
+	{
+	public:
+		static constexpr uint32_t IndexBits = 32;
+		static constexpr uint32_t GenerationBits = 24;
+		static constexpr uint32_t GenerationMask = (1u << GenerationBits) - 1;
+		static constexpr uint32_t TypeShift = IndexBits + GenerationBits;
+		static constexpr uint32_t TypeMask = 0xFF;
+		// Generation of a slot which used up all of its generations, no handle carries it
+		static constexpr uint32_t ExhaustedGeneration = GenerationMask + 1;
+
+		static constexpr ResourceHandleT Make(uint32_t index, uint32_t generation)
+		{
+			return static_cast<ResourceHandleT>(index) |
+				(static_cast<ResourceHandleT>(generation & GenerationMask) << IndexBits);
+		}
+
+		static constexpr uint32_t GetIndex(ResourceHandleT handle)
+		{
+			return static_cast<uint32_t>(handle);
+		}
+
+		static constexpr uint32_t GetGeneration(ResourceHandleT handle)
+		{
+			return static_cast<uint32_t>(handle >> IndexBits) & GenerationMask;
+		}
+
+		// Ids above TypeMask are not stored
+		static constexpr ResourceHandleT WithType(ResourceHandleT handle, ResourceTypeId type)
+		{
+			return handle | static_cast<ResourceHandleT>(type <= TypeMask ? type : 0) << TypeShift;
+		}
+
+		// 0 if the handle does not carry its type
+		static constexpr ResourceTypeId GetType(ResourceHandleT handle)
+		{
+			return static_cast<ResourceTypeId>(handle >> TypeShift) & TypeMask;
+		}
+
+		// False only if the handle is known to refer to another type
+		static constexpr bool MayBeType(ResourceHandleT handle, ResourceTypeId type)
+		{
+			return GetType(handle) == 0 || GetType(handle) == type;
+		}
+
+		// Generation following the given one, ExhaustedGeneration after the last one instead of wrapping,
+		// a wrapped generation would validate old handles against an unrelated resource again
+		static constexpr uint32_t NextGeneration(uint32_t generation)
+		{
+			return generation + 1;
+		}
+	};
+
+	// Owns the ResourceData objects of a manager, addressed by generational handles
+	// Lookups and validity checks are lock-free, a handle to a deleted resource stays invalid
+	// even after its slot was reused
+	// Allocate, Publish and Release are lock-free as well, released slots are recycled through
+	// a tagged free list
+	// A slot released with its last generation is retired and never handed out again
+	class ResourceSlotMap
+	{
+	public:
+		ResourceSlotMap();
+		~ResourceSlotMap();
+
+		ResourceSlotMap(const ResourceSlotMap&) = delete;
+		ResourceSlotMap& operator=(const ResourceSlotMap&) = delete;
+
+		bool IsValid(ResourceHandleT handle) const;
+		// Returns nullptr if the handle is stale
+		ResourceData* Get(ResourceHandleT handle) const;
+		// Returns the data of the slot, nullptr if it is not live
+		ResourceData* GetAt(uint32_t index) const;
+		// Key of the handle's data, copied into the slot when published, so it can be read while a racing
+		// release destroys the data, returns false if the handle is stale
+		bool GetKey(ResourceHandleT handle, ResourceKey& key) const;
+		// One past the highest slot index handed out so far
+		uint32_t GetIndexEnd() const;
+		// State of the handle's slot, equal to GetLiveState while the handle is valid, nullptr if there is no slot
+		// Lets callers cache the slot, which stays in place until Compact frees its segment
+		const std::atomic<uint32_t>* GetState(ResourceHandleT handle) const;
+		static constexpr uint32_t GetLiveState(ResourceHandleT handle);
+
+		// Reserves a slot, the handle becomes valid once published
+		ResourceHandleT Allocate();
+		// Takes ownership of the data
+		void Publish(ResourceHandleT handle, ResourceData* data);
+		// Invalidates the handle and hands back ownership of the data
+		UniquePtr<ResourceData> Release(ResourceHandleT handle);
+
+		// Number of live resources
+		uint32_t GetLiveCount() const;
+		// Number of slots backed by memory
+		uint32_t GetCapacity() const;
+		// Bytes allocated for the slots, not counting the data they own
+		size_t GetMemoryUsage() const;
+
+		// Frees the segments past the last live slot and rebuilds the free list lowest index first,
+		// so new resources pack towards the front
+		// Must not run concurrently with any other call
+		void Compact();
+
+	private:
+		struct Slot
+		{
+			// Generation << 1 | live bit
+			std::atomic<uint32_t> State;
+			std::atomic<ResourceData*> Data{nullptr};
+			std::atomic<uint64_t> KeyHash{0};
+			std::atomic<uint32_t> KeyIndex{ResourceKey::InvalidIndex};
+			// Index + 1 of the next free slot, while this one is on the free list
+			std::atomic<uint32_t> NextFree{0};
+		};
+
+		struct Segment
+		{
+			UniquePtr<Slot[]> Slots;
+			// One bit per slot, set while the slot is live
+			UniquePtr<std::atomic<uint64_t>[]> Occupancy;
+		};
+
+		// Segment s holds FirstSegmentSize << s slots, so slots never move once created
+		static constexpr uint32_t FirstSegmentBits = 6;
+		static constexpr uint32_t FirstSegmentSize = 1u << FirstSegmentBits;
+		static constexpr uint32_t SegmentCount = 32 - FirstSegmentBits + 1;
+
+		std::atomic<Segment*> m_Segments[SegmentCount];
+		// Generation new slots of a segment start at, raised when Compact frees the segment
+		uint32_t m_SegmentGenerations[SegmentCount];
+		// Number of slots handed out from the end so far
+		std::atomic<uint32_t> m_Size;
+		// Tag << 32 | index + 1 of the first free slot, the tag guards the CAS loops against ABA
+		std::atomic<uint64_t> m_FreeHead;
+
+		static uint32_t GetSegmentIndex(uint32_t index);
+		static uint32_t GetSegmentStart(uint32_t segment);
+		static uint32_t GetSegmentSize(uint32_t segment);
+		Slot* GetSlot(uint32_t index) const;
+		Segment* GetOrCreateSegment(uint32_t segment);
+		void SetOccupied(uint32_t index, bool occupied);
+		bool PopFree(uint32_t& index);
+		void PushFree(uint32_t index);
+	};
+}
+
+#pragma region Defer
+namespace Reksi
+{
+	inline ResourceSlotMap::ResourceSlotMap()
+		: m_Size(0), m_FreeHead(0)
+	{
+		for ( uint32_t segment = 0; segment < SegmentCount; ++segment )
+		{
+			m_Segments[segment].store(nullptr, std::memory_order_relaxed);
+			m_SegmentGenerations[segment] = 1;
+		}
+	}
+
+	inline ResourceSlotMap::~ResourceSlotMap()
+	{
+		for ( uint32_t segment = 0; segment < SegmentCount; ++segment )
+		{
+			Segment* entry = m_Segments[segment].load(std::memory_order_acquire);
+			if ( !entry ) continue;
+
+			for ( uint32_t i = 0; i < GetSegmentSize(segment); ++i )
+			{
+				delete entry->Slots[i].Data.load(std::memory_order_acquire);
+			}
+			delete entry;
+		}
+	}
+
+	inline bool ResourceSlotMap::IsValid(ResourceHandleT handle) const
+	{
+		const Slot* slot = GetSlot(ResourceHandleLayout::GetIndex(handle));
+		if ( !slot ) return false;
+
+		return slot->State.load(std::memory_order_acquire) == (ResourceHandleLayout::GetGeneration(handle) << 1 | 1u);
+	}
+
+	inline ResourceData* ResourceSlotMap::Get(ResourceHandleT handle) const
+	{
+		const Slot* slot = GetSlot(ResourceHandleLayout::GetIndex(handle));
+		if ( !slot ) return nullptr;
+
+		const uint32_t expected = ResourceHandleLayout::GetGeneration(handle) << 1 | 1u;
+		if ( slot->State.load(std::memory_order_acquire) != expected ) return nullptr;
+
+		ResourceData* data = slot->Data.load(std::memory_order_acquire);
+		// The slot could have been released and reused between the two loads
+		if ( slot->State.load(std::memory_order_acquire) != expected ) return nullptr;
+		return data;
+	}
+
+	inline bool ResourceSlotMap::GetKey(ResourceHandleT handle, ResourceKey& key) const
+	{
+		const Slot* slot = GetSlot(ResourceHandleLayout::GetIndex(handle));
+		if ( !slot ) return false;
+
+		const uint32_t expected = ResourceHandleLayout::GetGeneration(handle) << 1 | 1u;
+		if ( slot->State.load(std::memory_order_acquire) != expected ) return false;
+
+		key.Hash = slot->KeyHash.load(std::memory_order_relaxed);
+		key.Index = slot->KeyIndex.load(std::memory_order_relaxed);
+		// Same as Get, the slot could have been reused in between
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return slot->State.load(std::memory_order_relaxed) == expected;
+	}
+
+	inline ResourceData* ResourceSlotMap::GetAt(uint32_t index) const
+	{
+		const Slot* slot = GetSlot(index);
+		if ( !slot ) return nullptr;
+
+		const uint32_t state = slot->State.load(std::memory_order_acquire);
+		if ( !(state & 1u) ) return nullptr;
+
+		ResourceData* data = slot->Data.load(std::memory_order_acquire);
+		if ( slot->State.load(std::memory_order_acquire) != state ) return nullptr;
+		return data;
+	}
+
+	inline const std::atomic<uint32_t>* ResourceSlotMap::GetState(ResourceHandleT handle) const
+	{
+		const Slot* slot = GetSlot(ResourceHandleLayout::GetIndex(handle));
+		return slot ? &slot->State : nullptr;
+	}
+
+	constexpr uint32_t ResourceSlotMap::GetLiveState(ResourceHandleT handle)
+	{
+		return ResourceHandleLayout::GetGeneration(handle) << 1 | 1u;
+	}
+
+	inline uint32_t ResourceSlotMap::GetIndexEnd() const
+	{
+		return m_Size.load(std::memory_order_acquire);
+	}
+
+	inline ResourceHandleT ResourceSlotMap::Allocate()
+	{
+		while ( true )
+		{
+			uint32_t index;
+			if ( !PopFree(index) )
+			{
+				index = m_Size.fetch_add(1, std::memory_order_relaxed);
+				GetOrCreateSegment(GetSegmentIndex(index));
+			}
+
+			// Growing passes over retired slots again once Compact moved the end below them
+			const uint32_t generation = GetSlot(index)->State.load(std::memory_order_relaxed) >> 1;
+			if ( generation != ResourceHandleLayout::ExhaustedGeneration )
+			{
+				return ResourceHandleLayout::Make(index, generation);
+			}
+		}
+	}
+
+	inline void ResourceSlotMap::Publish(ResourceHandleT handle, ResourceData* data)
+	{
+		const uint32_t index = ResourceHandleLayout::GetIndex(handle);
+		Slot* slot = GetSlot(index);
+		assert(slot && !slot->Data.load(std::memory_order_relaxed));
+
+		slot->Data.store(data, std::memory_order_release);
+		slot->KeyHash.store(data->GetKey().Hash, std::memory_order_relaxed);
+		slot->KeyIndex.store(data->GetKey().Index, std::memory_order_relaxed);
+		slot->State.store(ResourceHandleLayout::GetGeneration(handle) << 1 | 1u, std::memory_order_release);
+		SetOccupied(index, true);
+	}
+
+	inline UniquePtr<ResourceData> ResourceSlotMap::Release(ResourceHandleT handle)
+	{
+		const uint32_t index = ResourceHandleLayout::GetIndex(handle);
+		Slot* slot = GetSlot(index);
+		if ( !slot ) return nullptr;
+
+		// Bumping the generation invalidates every outstanding handle to the slot,
+		// and only one of several racing releases wins
+		const uint32_t generation = ResourceHandleLayout::GetGeneration(handle);
+		const uint32_t next = ResourceHandleLayout::NextGeneration(generation);
+		uint32_t expected = generation << 1 | 1u;
+		if ( !slot->State.compare_exchange_strong(expected, next << 1, std::memory_order_acq_rel) )
+		{
+			return nullptr;
+		}
+
+		UniquePtr<ResourceData> data{slot->Data.exchange(nullptr, std::memory_order_acq_rel)};
+		SetOccupied(index, false);
+		// Retired once its generations are used up
+		if ( next != ResourceHandleLayout::ExhaustedGeneration ) PushFree(index);
+		return data;
+	}
+
+	inline uint32_t ResourceSlotMap::GetLiveCount() const
+	{
+		uint32_t count = 0;
+		for ( uint32_t segment = 0; segment < SegmentCount; ++segment )
+		{
+			const Segment* entry = m_Segments[segment].load(std::memory_order_acquire);
+			if ( !entry ) continue;
+
+			const uint32_t words = GetSegmentSize(segment) / 64;
+			for ( uint32_t word = 0; word < words; ++word )
+			{
+				count += PopCount(entry->Occupancy[word].load(std::memory_order_relaxed));
+			}
+		}
+		return count;
+	}
+
+	inline uint32_t ResourceSlotMap::GetCapacity() const
+	{
+		uint32_t capacity = 0;
+		for ( uint32_t segment = 0; segment < SegmentCount; ++segment )
+		{
+			if ( m_Segments[segment].load(std::memory_order_acquire) ) capacity += GetSegmentSize(segment);
+		}
+		return capacity;
+	}
+
+	inline size_t ResourceSlotMap::GetMemoryUsage() const
+	{
+		size_t bytes = 0;
+		for ( uint32_t segment = 0; segment < SegmentCount; ++segment )
+		{
+			if ( !m_Segments[segment].load(std::memory_order_acquire) ) continue;
+
+			const size_t size = GetSegmentSize(segment);
+			bytes += sizeof(Segment) + size * sizeof(Slot) + size / 64 * sizeof(uint64_t);
+		}
+		return bytes;
+	}
+
+	inline void ResourceSlotMap::Compact()
+	{
+		// Find the end of the live slots, scanning the occupancy bitmap from the top
+		uint32_t size = 0;
+		for ( uint32_t segment = SegmentCount; segment-- > 0 && size == 0; )
+		{
+			const Segment* entry = m_Segments[segment].load(std::memory_order_relaxed);
+			if ( !entry ) continue;
+
+			for ( uint32_t word = GetSegmentSize(segment) / 64; word-- > 0; )
+			{
+				const uint64_t bits = entry->Occupancy[word].load(std::memory_order_relaxed);
+				if ( bits == 0 ) continue;
+
+				size = GetSegmentStart(segment) + word * 64 + FloorLog2(bits) + 1;
+				break;
+			}
+		}
+
+		// Free the segments past the end, remembering their generations so that stale handles
+		// to them stay invalid once the segment is created again
+		// A segment whose slots would restart at an exhausted generation is kept instead, with its retired slots
+		for ( uint32_t segment = 0; segment < SegmentCount; ++segment )
+		{
+			Segment* entry = m_Segments[segment].load(std::memory_order_relaxed);
+			if ( !entry || GetSegmentStart(segment) < size ) continue;
+
+			uint32_t generation = m_SegmentGenerations[segment];
+			for ( uint32_t i = 0; i < GetSegmentSize(segment); ++i )
+			{
+				generation = std::max(generation, entry->Slots[i].State.load(std::memory_order_relaxed) >> 1);
+			}
+			if ( generation >= ResourceHandleLayout::GenerationMask ) continue;
+			m_SegmentGenerations[segment] = ResourceHandleLayout::NextGeneration(generation);
+
+			m_Segments[segment].store(nullptr, std::memory_order_relaxed);
+			delete entry;
+		}
+
+		// Rebuild the free list from the zero bits below the end, pushed from the top so the
+		// lowest index is handed out first
+		m_FreeHead.store(0, std::memory_order_relaxed);
+		m_Size.store(size, std::memory_order_relaxed);
+		for ( uint32_t word = (size + 63) / 64; word-- > 0; )
+		{
+			const uint32_t first = word * 64;
+			const uint32_t segment = GetSegmentIndex(first);
+			const Segment* entry = m_Segments[segment].load(std::memory_order_relaxed);
+			const uint32_t local = (first - GetSegmentStart(segment)) / 64;
+
+			uint64_t free = ~entry->Occupancy[local].load(std::memory_order_relaxed);
+			// Slots at or past the end are handed out by growing instead
+			if ( size - first < 64 ) free &= (1ull << (size - first)) - 1;
+
+			while ( free )
+			{
+				const uint32_t bit = FloorLog2(free);
+				free &= ~(1ull << bit);
+
+				if ( (GetSlot(first + bit)->State.load(std::memory_order_relaxed) >> 1) ==
+				     ResourceHandleLayout::ExhaustedGeneration )
+				{
+					continue;
+				}
+				PushFree(first + bit);
+			}
+		}
+	}
+
+	inline uint32_t ResourceSlotMap::GetSegmentIndex(uint32_t index)
+	{
+		return FloorLog2((static_cast<uint64_t>(index) >> FirstSegmentBits) + 1);
+	}
+
+	inline uint32_t ResourceSlotMap::GetSegmentStart(uint32_t segment)
+	{
+		return static_cast<uint32_t>(((1ull << segment) - 1) << FirstSegmentBits);
+	}
+
+	inline uint32_t ResourceSlotMap::GetSegmentSize(uint32_t segment)
+	{
+		return FirstSegmentSize << segment;
+	}
+
+	inline ResourceSlotMap::Slot* ResourceSlotMap::GetSlot(uint32_t index) const
+	{
+		const uint32_t segment = GetSegmentIndex(index);
+		Segment* entry = m_Segments[segment].load(std::memory_order_acquire);
+		if ( !entry ) return nullptr;
+
+		return &entry->Slots[index - GetSegmentStart(segment)];
+	}
+
+	inline ResourceSlotMap::Segment* ResourceSlotMap::GetOrCreateSegment(uint32_t segment)
+	{
+		Segment* entry = m_Segments[segment].load(std::memory_order_acquire);
+		if ( entry ) return entry;
+
+		const uint32_t size = GetSegmentSize(segment);
+		auto created = CreateUnique<Segment>();
+		created->Slots = UniquePtr<Slot[]>(new Slot[size]);
+		created->Occupancy = UniquePtr<std::atomic<uint64_t>[]>(new std::atomic<uint64_t>[size / 64]);
+		for ( uint32_t i = 0; i < size; ++i )
+		{
+			created->Slots[i].State.store(m_SegmentGenerations[segment] << 1, std::memory_order_relaxed);
+		}
+		for ( uint32_t word = 0; word < size / 64; ++word )
+		{
+			created->Occupancy[word].store(0, std::memory_order_relaxed);
+		}
+
+		// Several threads may grow into a new segment at once, the first one to publish wins
+		if ( m_Segments[segment].compare_exchange_strong(entry, created.get(), std::memory_order_acq_rel) )
+		{
+			return created.release();
+		}
+		return entry;
+	}
+
+	inline void ResourceSlotMap::SetOccupied(uint32_t index, bool occupied)
+	{
+		const uint32_t segment = GetSegmentIndex(index);
+		const uint32_t local = index - GetSegmentStart(segment);
+		auto& word = m_Segments[segment].load(std::memory_order_acquire)->Occupancy[local / 64];
+
+		const uint64_t mask = 1ull << (local % 64);
+		if ( occupied ) word.fetch_or(mask, std::memory_order_relaxed);
+		else word.fetch_and(~mask, std::memory_order_relaxed);
+	}
+
+	inline bool ResourceSlotMap::PopFree(uint32_t& index)
+	{
+		uint64_t head = m_FreeHead.load(std::memory_order_acquire);
+		while ( static_cast<uint32_t>(head) != 0 )
+		{
+			const uint32_t first = static_cast<uint32_t>(head) - 1;
+			const uint64_t next = ((head >> 32) + 1) << 32 | GetSlot(first)->NextFree.load(std::memory_order_relaxed);
+			if ( m_FreeHead.compare_exchange_weak(head, next, std::memory_order_acq_rel) )
+			{
+				index = first;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	inline void ResourceSlotMap::PushFree(uint32_t index)
+	{
+		Slot* slot = GetSlot(index);
+		uint64_t head = m_FreeHead.load(std::memory_order_relaxed);
+		while ( true )
+		{
+			slot->NextFree.store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+			const uint64_t next = ((head >> 32) + 1) << 32 | (index + 1);
+			if ( m_FreeHead.compare_exchange_weak(head, next, std::memory_order_release) ) return;
+		}
+	}
+}
+#pragma endregion
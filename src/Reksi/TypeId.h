@@ -0,0 +1,82 @@
+#pragma once
+
+#include "Reksi/Base.h"
+
+namespace Reksi
+{
+	// Dense id of a resource type, assigned on first use and kept for the lifetime of the process
+	// Ids start at 1, 0 is never a type, so per type tables can be indexed by them directly
+	using ResourceTypeId = uint32_t;
+
+	template <typename T>
+	ResourceTypeId GetResourceTypeId();
+
+	// Assigns the ids, only entered once per type, GetResourceTypeId reads a function local static afterwards
+	class ResourceTypeRegistry
+	{
+	public:
+		// Returns the id of the type, assigning the next one if it has none yet
+		static ResourceTypeId Register(std::type_index type);
+		// typeid(void) for ids never assigned
+		static std::type_index GetTypeIndex(ResourceTypeId id);
+		// Every id assigned so far is below it
+		static ResourceTypeId GetEnd();
+
+	private:
+		// Type of id i + 1
+		std::vector<std::type_index> m_Types;
+
+		REKSI_MUTEX(m_Mutex);
+
+		// Never destroyed, ids may be requested during static destruction
+		static ResourceTypeRegistry& Get();
+	};
+}
+
+#pragma region Defer
+namespace Reksi
+{
+	template <typename T>
+	ResourceTypeId GetResourceTypeId()
+	{
+		// Registered by type_index, so const T and T from another module share the id
+		static const ResourceTypeId id = ResourceTypeRegistry::Register(typeid(T));
+		return id;
+	}
+
+	inline ResourceTypeId ResourceTypeRegistry::Register(std::type_index type)
+	{
+		ResourceTypeRegistry& registry = Get();
+		REKSI_LOCK_UNIQUE(registry.m_Mutex, lock);
+
+		const auto itr = std::find(registry.m_Types.begin(), registry.m_Types.end(), type);
+		if ( itr != registry.m_Types.end() ) return static_cast<ResourceTypeId>(itr - registry.m_Types.begin()) + 1;
+
+		registry.m_Types.push_back(type);
+		return static_cast<ResourceTypeId>(registry.m_Types.size());
+	}
+
+	inline std::type_index ResourceTypeRegistry::GetTypeIndex(ResourceTypeId id)
+	{
+		ResourceTypeRegistry& registry = Get();
+		REKSI_LOCK_SHARED(registry.m_Mutex, lock);
+
+		if ( id == 0 || id > registry.m_Types.size() ) return typeid(void);
+		return registry.m_Types[id - 1];
+	}
+
+	inline ResourceTypeId ResourceTypeRegistry::GetEnd()
+	{
+		ResourceTypeRegistry& registry = Get();
+		REKSI_LOCK_SHARED(registry.m_Mutex, lock);
+
+		return static_cast<ResourceTypeId>(registry.m_Types.size()) + 1;
+	}
+
+	inline ResourceTypeRegistry& ResourceTypeRegistry::Get()
+	{
+		static ResourceTypeRegistry* registry = new ResourceTypeRegistry;
+		return *registry;
+	}
+}
+#pragma endregion
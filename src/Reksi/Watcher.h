@@ -0,0 +1,444 @@
+#pragma once
+
+#include "Reksi/Base.h"
+#include "Reksi/ResourceManager.h"
+
+#include <chrono>
+
+#if REKSI_PLATFORM_LINUX == 1
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace Reksi
+{
+	/*
+	 * Debounces change notifications per resource, a resource is reloaded once no change was reported
+	 * for the window, so a file written in several chunks is loaded once
+	 * Due resources are reloaded together as one parallel batch on the manager's worker threads
+	 * A change reported while the resource is reloading gets a trailing reload once the reload in flight finished
+	 */
+	class ReloadCoalescer
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		static constexpr std::chrono::milliseconds DefaultWindow{100};
+
+		// The manager must outlive the coalescer
+		explicit ReloadCoalescer(ResourceManager& manager, std::chrono::milliseconds window = DefaultWindow);
+
+		ReloadCoalescer(const ReloadCoalescer&) = delete;
+		ReloadCoalescer& operator=(const ReloadCoalescer&) = delete;
+
+		// Restarts the window of the resource
+		void Notify(ResourceHandleT handle, Clock::time_point now = Clock::now());
+		// Reloads the loaded resources whose window passed, returns the number of reloads run by this call
+		// Resources deleted meanwhile are skipped, a resource deleted while reloading waits for the reload
+		size_t Flush(Clock::time_point now = Clock::now());
+		// Time until the next window passes, rounded up, negative if nothing is pending
+		std::chrono::milliseconds GetTimeUntilNext(Clock::time_point now = Clock::now()) const;
+		size_t GetPendingCount() const;
+
+	private:
+		ResourceManager& m_Manager;
+		const Clock::duration m_Window;
+		// End of the window of every resource with pending changes
+		std::unordered_map<ResourceHandleT, Clock::time_point> m_Pending;
+
+		REKSI_THREADING_MUTABLE REKSI_MUTEX_AUTO;
+	};
+
+	/*
+	 * Reloads loaded resources when their files under the manager's base path change
+	 * On Linux one inotify watch per directory covers all of its files, so a single thread serves any number
+	 * of resources, events are mapped back to handles through the path index
+	 * Elsewhere the write times of the loaded resources are polled every interval instead
+	 * Resources must be registered by their path relative to the base path, e.g. "textures/wall.png"
+	 * Changes go through a ReloadCoalescer, so a save in several writes reloads the resource once
+	 *
+	 * ResourceWatcher watcher(manager);
+	 */
+	class ResourceWatcher
+	{
+	public:
+		static constexpr std::chrono::milliseconds DefaultInterval{500};
+
+		// The manager must outlive the watcher, the interval is only used when polling write times
+		// Throws std::runtime_error if the base path cannot be watched
+		explicit ResourceWatcher(ResourceManager& manager,
+		                         std::chrono::milliseconds debounce = ReloadCoalescer::DefaultWindow,
+		                         std::chrono::milliseconds interval = DefaultInterval);
+		~ResourceWatcher();
+
+		ResourceWatcher(const ResourceWatcher&) = delete;
+		ResourceWatcher& operator=(const ResourceWatcher&) = delete;
+
+		// Waits up to the timeout for changes, or until the next debounce window passed, and reloads the resources
+		// which are due, returns the number of reloads, a negative timeout waits for the next change
+		// Called by the watcher's thread, only call it yourself with REKSI_THREADING disabled
+		size_t Poll(std::chrono::milliseconds timeout);
+
+	private:
+		ResourceManager& m_Manager;
+		ReloadCoalescer m_Coalescer;
+		std::chrono::milliseconds m_Interval;
+		std::atomic<bool> m_Stopping;
+#if REKSI_THREADING == 1
+		std::thread m_Thread;
+#endif
+
+#if REKSI_PLATFORM_LINUX == 1
+		int m_Inotify;
+		// Signalled to wake the thread up when stopping
+		int m_WakeEvent;
+		// Directory of every watch, relative to the base path
+		std::unordered_map<int, std::string> m_Directories;
+
+		// Watches the directory and the ones below it, directories which cannot be watched are skipped
+		void AddDirectories(const std::string& relative);
+#else
+		REKSI_MUTEX_AUTO;
+		REKSI_CV_AUTO;
+		// Last seen write time of every loaded resource
+		std::unordered_map<ResourceHandleT, std::filesystem::file_time_type> m_WriteTimes;
+#endif
+
+		// Handles of all loaded resources, for when the changes are not known
+		std::vector<ResourceHandleT> GetLoadedResources() const;
+		// Shortens the timeout to the next debounce window
+		std::chrono::milliseconds GetWaitTime(std::chrono::milliseconds timeout) const;
+	};
+}
+
+#pragma region Defer
+namespace Reksi
+{
+	inline ReloadCoalescer::ReloadCoalescer(ResourceManager& manager, std::chrono::milliseconds window)
+		: m_Manager(manager), m_Window(window)
+	{
+	}
+
+	inline void ReloadCoalescer::Notify(ResourceHandleT handle, Clock::time_point now)
+	{
+		REKSI_LOCK_UNIQUE_AUTO;
+
+		m_Pending[handle] = now + m_Window;
+	}
+
+	inline size_t ReloadCoalescer::Flush(Clock::time_point now)
+	{
+		std::vector<ResourceHandleT> due;
+
+		{
+			REKSI_LOCK_UNIQUE_AUTO;
+
+			for ( auto it = m_Pending.begin(); it != m_Pending.end(); )
+			{
+				if ( it->second > now )
+				{
+					++it;
+					continue;
+				}
+
+				due.push_back(it->first);
+				it = m_Pending.erase(it);
+			}
+		}
+
+		// Each reload is queued as the resource's pending load, which its destructor waits for,
+		// so the resource stays alive once the eviction lock is left
+		std::vector<SharedPtr<LoadTask>> reloads;
+
+		{
+			REKSI_LOCK_UNIQUE(m_Manager.m_EvictionMutex, lock);
+
+			for ( const ResourceHandleT handle : due )
+			{
+				// Resources which were never loaded stay that way
+				ResourceData* data = m_Manager.m_Resources.Get(handle);
+				if ( !data || !data->GetStatus().Is(ResourceStatus::Loaded) ) continue;
+
+				bool created;
+				SharedPtr<LoadTask> task = data->GetOrCreatePendingLoad(created);
+				if ( created )
+				{
+					reloads.push_back(std::move(task));
+					continue;
+				}
+
+				// A load queued already may be reading the old file, it reloads once more after finishing
+				data->SetState(ResourceStatus::MarkedForReload);
+			}
+		}
+
+		// Reloading a resource which is reloading already marks it for a trailing reload instead of waiting
+		// A task promoted by a LoadAsync caller meanwhile is only run once
+		m_Manager.m_Scheduler->ParallelFor(reloads.size(), [&reloads](size_t i)
+		{
+			reloads[i]->Execute();
+		}, LoadPriority::Visible);
+
+		return reloads.size();
+	}
+
+	inline std::chrono::milliseconds ReloadCoalescer::GetTimeUntilNext(Clock::time_point now) const
+	{
+		REKSI_LOCK_SHARED_AUTO;
+
+		if ( m_Pending.empty() ) return std::chrono::milliseconds(-1);
+
+		Clock::time_point next = Clock::time_point::max();
+		for ( const auto& pending : m_Pending )
+		{
+			next = std::min(next, pending.second);
+		}
+
+		if ( next <= now ) return std::chrono::milliseconds(0);
+		return std::chrono::ceil<std::chrono::milliseconds>(next - now);
+	}
+
+	inline size_t ReloadCoalescer::GetPendingCount() const
+	{
+		REKSI_LOCK_SHARED_AUTO;
+
+		return m_Pending.size();
+	}
+
+#if REKSI_PLATFORM_LINUX == 1
+	inline ResourceWatcher::ResourceWatcher(ResourceManager& manager, std::chrono::milliseconds debounce,
+	                                        std::chrono::milliseconds interval)
+		: m_Manager(manager), m_Coalescer(manager, debounce), m_Interval(interval), m_Stopping(false), m_Inotify(-1),
+		  m_WakeEvent(-1)
+	{
+		m_Inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		m_WakeEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if ( m_Inotify < 0 || m_WakeEvent < 0 )
+		{
+			if ( m_Inotify >= 0 ) close(m_Inotify);
+			if ( m_WakeEvent >= 0 ) close(m_WakeEvent);
+			throw std::runtime_error("ResourceWatcher: Failed to create inotify instance");
+		}
+
+		AddDirectories("");
+		if ( m_Directories.empty() )
+		{
+			close(m_Inotify);
+			close(m_WakeEvent);
+			throw std::runtime_error("ResourceWatcher: Failed to watch the base path");
+		}
+
+#if REKSI_THREADING == 1
+		m_Thread = std::thread([this]()
+		{
+			while ( !m_Stopping.load(std::memory_order_acquire) )
+			{
+				Poll(std::chrono::milliseconds(-1));
+			}
+		});
+#endif
+	}
+
+	inline ResourceWatcher::~ResourceWatcher()
+	{
+		m_Stopping.store(true, std::memory_order_release);
+#if REKSI_THREADING == 1
+		const uint64_t wake = 1;
+		[[maybe_unused]] const ssize_t written = write(m_WakeEvent, &wake, sizeof(wake));
+		m_Thread.join();
+#endif
+
+		close(m_Inotify);
+		close(m_WakeEvent);
+	}
+
+	inline size_t ResourceWatcher::Poll(std::chrono::milliseconds timeout)
+	{
+		pollfd fds[2] = {{m_Inotify, POLLIN, 0}, {m_WakeEvent, POLLIN, 0}};
+		const int ready = poll(fds, 2, static_cast<int>(GetWaitTime(timeout).count()));
+		if ( ready > 0 && (fds[1].revents & POLLIN) ) return 0;
+
+		bool overflow = false;
+		std::string path;
+		const auto now = ReloadCoalescer::Clock::now();
+
+		alignas(inotify_event) char buffer[64 * 1024];
+		while ( ready > 0 )
+		{
+			const ssize_t size = read(m_Inotify, buffer, sizeof(buffer));
+			if ( size <= 0 ) break;
+
+			for ( ssize_t offset = 0; offset < size; )
+			{
+				const auto event = reinterpret_cast<const inotify_event*>(buffer + offset);
+				offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+				if ( event->mask & IN_Q_OVERFLOW )
+				{
+					overflow = true;
+					continue;
+				}
+
+				const auto directory = m_Directories.find(event->wd);
+				if ( directory == m_Directories.end() ) continue;
+
+				// The kernel drops the watch once the directory is gone
+				if ( event->mask & IN_IGNORED )
+				{
+					m_Directories.erase(directory);
+					continue;
+				}
+				if ( event->len == 0 ) continue;
+
+				path = directory->second;
+				if ( !path.empty() ) path += '/';
+				path += event->name;
+
+				if ( event->mask & IN_ISDIR )
+				{
+					AddDirectories(path);
+				}
+				else if ( const ResourceHandleT handle = m_Manager.GetHandle(ResourcePathView{path}) )
+				{
+					m_Coalescer.Notify(handle, now);
+				}
+			}
+		}
+
+		// Events were lost, any file may have changed
+		if ( overflow )
+		{
+			for ( const ResourceHandleT handle : GetLoadedResources() )
+			{
+				m_Coalescer.Notify(handle, now);
+			}
+		}
+
+		return m_Coalescer.Flush();
+	}
+
+	inline void ResourceWatcher::AddDirectories(const std::string& relative)
+	{
+		const std::filesystem::path& base = m_Manager.m_BasePath;
+		const std::filesystem::path full = relative.empty() ? base : base / relative;
+
+		// Files are reported once written and closed, or once moved in, which covers editors saving by rename
+		const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_ONLYDIR;
+		const int watch = inotify_add_watch(m_Inotify, full.c_str(), mask);
+		if ( watch < 0 ) return;
+		m_Directories[watch] = relative;
+
+		std::error_code error;
+		for ( std::filesystem::directory_iterator it{full, error}, end; !error && it != end; it.increment(error) )
+		{
+			if ( !it->is_directory(error) || it->is_symlink(error) ) continue;
+
+			const std::string name = it->path().filename().string();
+			AddDirectories(relative.empty() ? name : relative + '/' + name);
+		}
+	}
+#else
+	inline ResourceWatcher::ResourceWatcher(ResourceManager& manager, std::chrono::milliseconds debounce,
+	                                        std::chrono::milliseconds interval)
+		: m_Manager(manager), m_Coalescer(manager, debounce), m_Interval(interval), m_Stopping(false)
+	{
+		std::error_code error;
+		if ( !std::filesystem::is_directory(m_Manager.m_BasePath, error) )
+		{
+			throw std::runtime_error("ResourceWatcher: Failed to watch the base path");
+		}
+
+#if REKSI_THREADING == 1
+		m_Thread = std::thread([this]()
+		{
+			while ( !m_Stopping.load(std::memory_order_acquire) )
+			{
+				Poll(m_Interval);
+			}
+		});
+#endif
+	}
+
+	inline ResourceWatcher::~ResourceWatcher()
+	{
+#if REKSI_THREADING == 1
+		{
+			REKSI_LOCK_UNIQUE_AUTO;
+			m_Stopping.store(true, std::memory_order_release);
+		}
+		REKSI_CV_NOTIFY_ALL_AUTO;
+		m_Thread.join();
+#endif
+	}
+
+	inline size_t ResourceWatcher::Poll(std::chrono::milliseconds timeout)
+	{
+		// Without change notifications the next change is only seen by polling
+		const std::chrono::milliseconds wait = GetWaitTime(timeout.count() < 0 ? m_Interval : timeout);
+#if REKSI_THREADING == 1
+		{
+			REKSI_LOCK_UNIQUE_AUTO;
+			REKSI_CV_AUTO_NAME.wait_for(REKSI_LOCK_AUTO_NAME, wait, [this]()
+			{
+				return m_Stopping.load(std::memory_order_acquire);
+			});
+			if ( m_Stopping.load(std::memory_order_acquire) ) return 0;
+		}
+#else
+		std::this_thread::sleep_for(wait);
+#endif
+
+		std::unordered_map<ResourceHandleT, std::filesystem::file_time_type> writeTimes;
+		const auto now = ReloadCoalescer::Clock::now();
+
+		for ( const ResourceHandleT handle : GetLoadedResources() )
+		{
+			const ResourceData* data = m_Manager.m_Resources.Get(handle);
+			if ( !data ) continue;
+
+			std::error_code error;
+			const auto time = std::filesystem::last_write_time(data->GetPath(), error);
+			if ( error ) continue;
+
+			// Resources seen for the first time are taken as up to date
+			const auto last = m_WriteTimes.find(handle);
+			if ( last != m_WriteTimes.end() && last->second != time ) m_Coalescer.Notify(handle, now);
+			writeTimes.emplace(handle, time);
+		}
+
+		// Drops the deleted and unloaded resources
+		m_WriteTimes = std::move(writeTimes);
+
+		return m_Coalescer.Flush();
+	}
+#endif
+
+	inline std::vector<ResourceHandleT> ResourceWatcher::GetLoadedResources() const
+	{
+		std::vector<ResourceHandleT> handles;
+
+		REKSI_LOCK_UNIQUE(m_Manager.m_EvictionMutex, lock);
+
+		const uint32_t end = m_Manager.m_Resources.GetIndexEnd();
+		for ( uint32_t index = 0; index < end; ++index )
+		{
+			const ResourceData* data = m_Manager.m_Resources.GetAt(index);
+			if ( data && data->GetStatus().Is(ResourceStatus::Loaded) ) handles.push_back(data->GetHandle());
+		}
+
+		return handles;
+	}
+
+	inline std::chrono::milliseconds ResourceWatcher::GetWaitTime(std::chrono::milliseconds timeout) const
+	{
+		const std::chrono::milliseconds next = m_Coalescer.GetTimeUntilNext();
+		if ( next.count() < 0 ) return timeout;
+		if ( timeout.count() < 0 ) return next;
+		return std::min(timeout, next);
+	}
+}
+#pragma endregion
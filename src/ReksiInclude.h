@@ -3,6 +3,21 @@
 #include "Reksi/PlatformDetection.h"
 #include "Reksi/Definitions.h"
 #include "Reksi/Base.h"
+#include "Reksi/ResourceKey.h"
+#include "Reksi/AssetTable.h"
+#include "Reksi/MappedFile.h"
+#include "Reksi/FileIO.h"
+#include "Reksi/Codec.h"
+#include "Reksi/Archive.h"
+#include "Reksi/Epoch.h"
+#include "Reksi/Function.h"
+#include "Reksi/TypeId.h"
 #include "Reksi/ResourceData.h"
+#include "Reksi/Scheduler.h"
+#include "Reksi/AsyncLoad.h"
 #include "Reksi/Resource.h"
-#include "Reksi/ResourceManager.h"
\ No newline at end of file
+#include "Reksi/SlotMap.h"
+#include "Reksi/PathIndex.h"
+#include "Reksi/ResourceManager.h"
+#include "Reksi/Watcher.h"
+#include "Reksi/Coroutine.h"
\ No newline at end of file
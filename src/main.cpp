@@ -26,34 +26,6 @@ SharedPtr<std::string> FileLoader(const std::filesystem::path& path)
 	return ptr;
 }
 
-template <typename T>
-void file_reloader(Resource<T> resource, std::function<void(Resource<T>& res)> callback = nullptr)
-{
-	std::filesystem::path path = resource.GetPath();
-	//Set the last write time of the file to zero
-	std::filesystem::file_time_type last_write;
-
-	while ( true )
-	{
-		// Get the latest write time of the file
-		auto latest_write = last_write_time(path);
-
-		if ( latest_write != last_write )
-		{
-			last_write = latest_write;
-
-			// Reload the resource
-			resource.Reload();
-
-			// Run the callback if it exists
-			if ( callback )
-			{
-				callback(resource);
-			}
-		}
-	}
-}
-
 class Listener : public ResourceListener
 {
 public:
@@ -90,16 +62,11 @@ int main()
 	Resource<std::string> res = manager.GetResource<std::string>("test.txt");
 
 	res.AddListener(listener);
+	res.Load();
 
-	//Create a thread to reload the file
-	std::thread file_reloader_thread([res]()
-	{
-		std::function<void(Resource<std::string>& r)> callback = [](Resource<std::string>& r)
-		{
-			LOG(*r)
-		};
-		file_reloader(res, callback);
-	});
-
-	file_reloader_thread.join();
+	// Reloads the resource whenever test.txt is saved, the listener reports the reloads
+	ResourceWatcher watcher(manager);
+
+	LOGV("Watching assets/ for changes, press enter to quit\n")
+	std::cin.get();
 }
@@ -0,0 +1,58 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include "../Reksi.h"
+
+using namespace Reksi;
+
+#define CHECK(x) if ( !(x) ) { std::cout << "Failed: " << #x << "\n"; return 1; }
+
+struct Value
+{
+};
+
+// Destroying the manager while a dependency load is still queued cancels it,
+// which completes the dependent and must not submit it to the scheduler being destroyed
+int main()
+{
+	std::atomic<bool> release{false};
+	LoadFuture future;
+	std::thread releaser;
+
+	{
+		ResourceManager manager("assets/", 1);
+		manager.SetDefaultLoader<Value>([](const std::filesystem::path&) { return CreateShared<Value>(); });
+
+		auto a = manager.GetResource<Value>("a");
+		auto b = manager.GetResource<Value>("b");
+		CHECK(manager.AddDependency(a.GetHandle(), b.GetHandle()))
+
+		// Keeps the only worker busy, so the dependency stays queued
+		std::atomic<bool> busy{false};
+		manager.LoadAsync(manager.GetResource<Value>("busy", [&](const std::filesystem::path&)
+		{
+			busy = true;
+			while ( !release ) std::this_thread::yield();
+			return CreateShared<Value>();
+		}).GetHandle());
+		while ( !busy ) std::this_thread::yield();
+
+		future = manager.LoadAsync(a.GetHandle());
+
+		// Lets the worker finish while the manager is being destroyed
+		releaser = std::thread([&]
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+			release = true;
+		});
+	}
+	releaser.join();
+
+	CHECK(future.IsReady())
+	CHECK(!future.Get().Is(ResourceLoadStatus::Success))
+
+	std::cout << "Passed\n";
+	return 0;
+}